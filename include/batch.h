@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * NAME:	    batch.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the batch fits in batch.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_BATCH_H__
+#define __ET_BATCH_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "fit.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One dataset of a batch, and what became of it. */
+typedef struct batch_item {
+  const fit_data_t * data;
+  int status; /* From fit_context_fit(). */
+  fit_result_t result;
+  char * log; /* What the fit logged, if asked for; the caller frees it. */
+} batch_item_t;
+
+typedef struct batch_options {
+  size_t threads; /* Or 0 for one per CPU. */
+  bool log; /* Keep what each fit logs in its item. */
+  bool iterations; /* Log every iteration, too. */
+} batch_options_t;
+
+/* How the work was shared. */
+typedef struct batch_stats {
+  size_t threads;
+  size_t contexts; /* Threads which could make a fit context. */
+  size_t steals; /* Times a thread took work from another's queue. */
+  double seconds;
+} batch_stats_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Fit many datasets at once, each in a fit context of its thread's.
+ * Every thread starts with an equal share of the items, and takes half of
+ * what another has left when it runs out.
+ * \param items The datasets, whose outcomes are written in place
+ * \param count The number of items
+ * \param options The options, or \c NULL for the defaults
+ * \param stats Location for how the work was shared, or \c NULL
+ * \return The number of fits which failed, or \c count if the threads
+ * couldn't be started.
+ */
+extern size_t batch_fit(batch_item_t * items, size_t count,
+			const batch_options_t * options, batch_stats_t * stats);
+
+#endif /* __ET_BATCH_H__ */
+
+/******************************************************************************/
@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * NAME:	    bootstrap.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the bootstrap confidence intervals in
+ *		    bootstrap.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_BOOTSTRAP_H__
+#define __ET_BOOTSTRAP_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fit.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* What each replicate resamples. */
+typedef enum bootstrap_method {
+  BOOTSTRAP_ROWS,	/* n rows of the data, with replacement. */
+  BOOTSTRAP_RESIDUALS	/* n residuals of the fit, with replacement, added
+			 * back to the fitted currents. */
+} bootstrap_method_t;
+
+typedef struct bootstrap_options {
+  size_t replicates; /* B, or 0 for 1000. */
+  size_t threads; /* Threads to fit them on, or 0 for one per CPU. */
+  bootstrap_method_t method;
+  unsigned long seed;
+  double level; /* Of the intervals, or 0 for 0.95. */
+} bootstrap_options_t;
+
+/* The intervals of one coefficient. */
+typedef struct bootstrap_interval {
+  double mean; /* Of the replicates. */
+  double error; /* Their standard deviation. */
+  double lower; /* Percentile interval. */
+  double upper;
+  double bca_lower; /* Bias-corrected and accelerated interval. */
+  double bca_upper;
+  double bias; /* z0, the bias correction of the BCa interval. */
+  double acceleration; /* a, from the jackknife. */
+} bootstrap_interval_t;
+
+typedef struct bootstrap {
+  size_t replicates;
+  size_t p;
+  size_t threads;
+  bootstrap_method_t method;
+  double level;
+  size_t failed; /* Replicates which couldn't be fitted, and are left
+		  * out of the intervals. */
+  double seconds; /* Wall time for all of the fits. */
+  fit_result_t fit; /* The fit of the data itself. */
+  bootstrap_interval_t * interval; /* p intervals. */
+  double * samples; /* The coefficients of replicate b, p at b * p, or NaN
+		     * if it failed. */
+} bootstrap_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Estimate confidence intervals for the coefficients of a fit by
+ * refitting resampled data, on a pool of threads
+ * \param data The data and model, as for fit_context_fit()
+ * \param options How many replicates, and how to resample
+ * \return The intervals, or \c NULL if the data itself couldn't be fitted.
+ */
+extern bootstrap_t * bootstrap_fit(const fit_data_t * data,
+				   const bootstrap_options_t * options);
+
+/**
+ * \brief Log the intervals of every coefficient
+ * \param result The intervals
+ * \param data The data they are of
+ * \param outfh The log
+ */
+extern void bootstrap_print(const bootstrap_t * result,
+			    const fit_data_t * data, FILE * outfh);
+
+/**
+ * \brief Free the intervals of a bootstrap
+ * \param result The intervals, or \c NULL
+ */
+extern void bootstrap_free(bootstrap_t * result);
+
+#endif /* __ET_BOOTSTRAP_H__ */
+
+/******************************************************************************/
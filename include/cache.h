@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * NAME:	    cache.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the functions in cache.c, which keep
+ *		    a binary, columnar copy of each parsed .csv file alongside
+ *		    it.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_CACHE_H__
+#define __ET_CACHE_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define TUPLE_CACHE_MAGIC "VTATUPLE"
+#define TUPLE_CACHE_VERSION 3
+#define TUPLE_CACHE_SUFFIX ".vtc"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* On-disk header. It is followed by <cols> 64-bit field numbers, saying which
+ * field of a line of the source each column was parsed from, then by <cols>
+ * NUL-terminated column names, one after another and in full, with "" for a
+ * column without one. At <data_offset>, zero padded up to it, come the columns
+ * themselves: <rows> doubles each, one column after another. Everything is
+ * in native byte order. */
+typedef struct tuple_cache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t cols;
+  uint64_t rows;
+  uint64_t source_size;
+  int64_t source_mtime;
+  int64_t source_mtime_nsec;
+  uint64_t checksum; /* Of the fields and names, then the column data. */
+  uint64_t data_offset;
+} tuple_cache_header_t;
+
+/* A cache file mapped into memory. */
+typedef struct tuple_cache {
+  void * map;
+  size_t length;
+  size_t rows;
+  size_t cols;
+  const uint64_t * fields; /* The field of the source of each column. */
+  const char * names; /* cols NUL-terminated names, one after another. */
+  const double * data; /* cols x rows, column-major. */
+} tuple_cache_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Map the cache of a CSV file, if it is present and current
+ * \param filename The path of the CSV file (not of the cache)
+ * \param n The number of columns needed
+ * \return The cache, or \c NULL if it is missing, stale, corrupt or has
+ * fewer than \c n columns.
+ */
+extern tuple_cache_t * tuple_cache_open(const char * filename, size_t n);
+
+/**
+ * \brief Unmap a cache
+ * \param cache The cache
+ */
+extern void tuple_cache_close(tuple_cache_t * cache);
+
+/**
+ * \brief View one column of a cache, without copying it
+ * \param cache The cache
+ * \param j The column
+ * \return A view of \c rows contiguous doubles in the mapping.
+ */
+extern gsl_vector_const_view tuple_cache_column(const tuple_cache_t * cache,
+						size_t j);
+
+/**
+ * \brief View the first \c n columns of a cache as an \c n x \c rows matrix
+ * \param cache The cache
+ * \param n The number of columns
+ * \return A view over the mapping. Row \c j of the view is column \c j.
+ */
+extern gsl_matrix_const_view tuple_cache_view(const tuple_cache_t * cache,
+					      size_t n);
+
+/**
+ * \brief Copy the first \c n columns of a cache into a row-major matrix
+ * \param cache The cache
+ * \param n The number of columns
+ * \return The matrix, as read_tuples_csv() would have returned it, or
+ * \c NULL on failure.
+ */
+extern gsl_matrix * tuple_cache_matrix(const tuple_cache_t * cache, size_t n);
+
+/**
+ * \brief Find a column of a cache by name
+ * \param cache The cache
+ * \param name The name, as in the header comment of the CSV file
+ * \return The index of the column, or -1 if there is none by exactly that
+ * name, or more than one.
+ */
+extern ssize_t tuple_cache_find(const tuple_cache_t * cache,
+				const char * name);
+
+/**
+ * \brief Copy the given columns of a cache into a row-major matrix
+ * \param cache The cache
+ * \param columns The indices of the columns, in the order wanted
+ * \param n The number of columns
+ * \return The matrix, or \c NULL on failure.
+ */
+extern gsl_matrix * tuple_cache_gather(const tuple_cache_t * cache,
+				       const size_t * columns, size_t n);
+
+/**
+ * \brief Write the cache of a CSV file
+ * \param filename The path of the CSV file (not of the cache)
+ * \param matrix The tuples parsed from it
+ * \param fields The field of a line each column of \c matrix was parsed
+ * from, or \c NULL if column \c j is field \c j
+ * \param names The name of each column, or \c NULL if they have none
+ * \return 0 on success, -1 otherwise.
+ */
+extern int tuple_cache_write(const char * filename, const gsl_matrix * matrix,
+			     const size_t * fields,
+			     const char * const * names);
+
+#endif /* __ET_CACHE_H__ */
+
+/******************************************************************************/
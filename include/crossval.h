@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * NAME:	    crossval.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the cross-validation of models in
+ *		    crossval.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_CROSSVAL_H__
+#define __ET_CROSSVAL_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gsl/gsl_matrix.h>
+
+#include "poly.h"
+#include "triode.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct crossval_options {
+  size_t folds; /* K, or 0 for 10. */
+  size_t threads; /* Threads to fit on, or 0 for one per CPU. */
+  unsigned long seed; /* For the shuffle that deals rows to folds. */
+} crossval_options_t;
+
+/* One model, and how well it predicted the rows held out of each fit. */
+typedef struct crossval_candidate {
+  const char * spec; /* As given; a surface or a triode model. */
+  poly_model_t model;
+  const triode_model_t * triode; /* Or NULL for the surface. */
+  size_t p; /* The number of coefficients. */
+  double rmse; /* Out of sample, over the held out rows of every fold. */
+  double rss; /* Of the fit of every row, for the criteria. */
+  double aic; /* n ln(rss / n) + 2p */
+  double bic; /* n ln(rss / n) + p ln n */
+  size_t failed; /* Fits which failed; rmse is infinite if any did. */
+  double seconds; /* Wall time of the model's fits, summed over them. */
+} crossval_candidate_t;
+
+typedef struct crossval {
+  size_t n; /* Rows. */
+  size_t folds;
+  size_t threads;
+  size_t count; /* Candidates. */
+  size_t best; /* The candidate with the least rmse, or <count> if every
+		* one failed. */
+  double seconds; /* Wall time for all of the fits. */
+  crossval_candidate_t * candidate;
+} crossval_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* The candidates tried when none are given: every degree of surface up to
+ * 4, with and without cross terms, and every triode model. */
+extern const char * const crossval_defaults[];
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Cross-validate models on the same rows, by K folds, fitting the
+ * candidates and folds on a pool of threads, and pick the one that predicts
+ * held out rows best
+ * \param values The empirical data, with at least the Ep, Eg and Ig columns;
+ * only read
+ * \param specs The candidates, each a surface as for poly_parse() or the name
+ * of a triode model, or \c NULL for crossval_defaults
+ * \param count The number of candidates
+ * \param options The number of folds, threads and seed
+ * \return The outcome of every candidate, or \c NULL if a candidate isn't a
+ * model or there was no memory.
+ */
+extern crossval_t * crossval_run(const gsl_matrix * values,
+				 const char * const * specs, size_t count,
+				 const crossval_options_t * options);
+
+/**
+ * \brief Log the outcome of every candidate, and the best
+ * \param result The outcome
+ * \param outfh The log
+ */
+extern void crossval_print(const crossval_t * result, FILE * outfh);
+
+/**
+ * \brief Free the outcome of a cross-validation
+ * \param result The outcome, or \c NULL
+ */
+extern void crossval_free(crossval_t * result);
+
+#endif /* __ET_CROSSVAL_H__ */
+
+/******************************************************************************/
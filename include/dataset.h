@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * NAME:	    dataset.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the dataset registry in dataset.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_DATASET_H__
+#define __ET_DATASET_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+#include <gsl/gsl_matrix.h>
+
+#include "util.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct dataset_registry dataset_registry_t;
+
+typedef struct dataset_options {
+  size_t prefetch; /* Datasets loaded ahead of the one asked for. */
+  size_t memory_cap; /* Bytes of datasets held at once, or 0 for no cap. */
+  size_t threads; /* Threads loading datasets, or 0 for one. */
+  const char * const * columns; /* Columns to load by name, or NULL. */
+  size_t ncolumns; /* Number of columns to load. */
+  csv_options_t csv; /* Passed to the CSV loaders; error and stats are
+		      * ignored. */
+} dataset_options_t;
+
+typedef struct dataset {
+  const char * path;
+  size_t index; /* Position in the registry. */
+  gsl_matrix * data; /* NULL if the file couldn't be loaded. */
+  int error; /* errno from the load, if data is NULL. */
+  csv_error_t csv_error; /* Rows the load found malformed or ragged. */
+  csv_stats_t stats; /* What the load read; all 0 for .xml files. */
+} dataset_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Open a registry of the datasets in a directory tree or manifest
+ * \param path A directory, searched recursively for .csv and .xml files, or
+ * a manifest listing one file per line
+ * \param options The options, or \c NULL for the defaults
+ * \return The registry, or \c NULL on failure.
+ */
+extern dataset_registry_t * dataset_registry_open(const char * path,
+					const dataset_options_t * options);
+
+/**
+ * \brief The number of datasets in a registry
+ * \param registry The registry
+ * \return The number of datasets.
+ */
+extern size_t dataset_registry_size(const dataset_registry_t * registry);
+
+/**
+ * \brief The path of a dataset in a registry
+ * \param registry The registry
+ * \param i The index of the dataset
+ * \return The path.
+ */
+extern const char * dataset_registry_path(const dataset_registry_t * registry,
+					  size_t i);
+
+/**
+ * \brief Take the next dataset, in order, waiting for it to load if need be
+ * \param registry The registry
+ * \return The dataset, or \c NULL when there are none left.
+ */
+extern dataset_t * dataset_registry_next(dataset_registry_t * registry);
+
+/**
+ * \brief Free a dataset taken with dataset_registry_next()
+ * \param registry The registry
+ * \param dataset The dataset
+ */
+extern void dataset_release(dataset_registry_t * registry,
+			    dataset_t * dataset);
+
+/**
+ * \brief Stop loading, and free the registry and every dataset still in it
+ * \param registry The registry
+ */
+extern void dataset_registry_close(dataset_registry_t * registry);
+
+#endif /* __ET_DATASET_H__ */
+
+/******************************************************************************/
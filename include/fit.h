@@ -8,7 +8,7 @@
  *
  * CREATED:	    08/22/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/17/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -26,38 +26,159 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ***/
 
+#ifndef __ET_FIT_H__
+#define __ET_FIT_H__
+
 /*******************************************************************************
  * INCLUDES
  ***/
 
+#include <stdio.h>
 #include <stdbool.h>
 
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
 
+#include "fitpool.h"
+#include "gof.h"
+#include "poly.h"
+#include "robust.h"
+#include "triode.h"
+#include "trust.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Alignment, in bytes, of the columns of a fit_samples_t: a cache line, and
+ * the width of an AVX-512 vector. */
+#define FIT_SAMPLES_ALIGN 64
+
 /*******************************************************************************
  * TYPE DEFINITIONS
  ***/
 
+/* Columns of fit_data_t.empirical_data. The squares are optional; when the
+ * matrix has them, surface_f() uses them instead of recomputing them. */
+typedef enum fit_column {
+  FIT_EP,
+  FIT_EG,
+  FIT_IG,
+  FIT_EP2,
+  FIT_EG2,
+  FIT_NCOLUMNS
+} fit_column_t;
+
+/* How fit_surface() solves for the coefficients of a surface. Triode models
+ * are always fitted by the trust region method. */
+typedef enum fit_solver {
+  FIT_SOLVER_AUTO,	/* Directly, since the surfaces are linear in them. */
+  FIT_SOLVER_LINEAR,	/* Least squares on the design matrix, by QR. */
+  FIT_SOLVER_NONLINEAR	/* Trust region iterations from initial_values,
+			 * by fit_data_t.method. */
+} fit_solver_t;
+
+/* The empirical data as one contiguous array per column, in the order of
+ * fit_column_t and squares included, for the kernels in fit.c and
+ * residual.c. Columns are aligned to FIT_SAMPLES_ALIGN and padded with
+ * zeros to <stride> doubles. */
+typedef struct fit_samples {
+  size_t n;
+  size_t stride;
+  double * block;
+  double * column[FIT_NCOLUMNS];
+} fit_samples_t;
+
 typedef struct fit_param {
   double value;
   double error;
 } fit_param_t;
 
 typedef struct fit_data {
-  fit_param_t * coefficients;
+  fit_param_t * coefficients; /* From fit_surface(), or NULL. */
   double * initial_values;
   gsl_matrix * empirical_data;
+  fit_solver_t solver;
+  fit_samples_t * samples; /* From fit_samples_alloc(), or NULL. */
+  const poly_model_t * model; /* The surface, or NULL for poly_quadratic. */
+  const triode_model_t * triode; /* A model to fit instead of the surface,
+				  * or NULL. */
+  robust_loss_t loss; /* ROBUST_NONE for a plain least squares fit. */
+  double tuning; /* The loss's constant, or 0 for its usual one. */
+  gof_t * gof; /* Location for the statistics of the residuals of
+		* fit_surface(), or NULL. */
+  trust_method_t method; /* Of the trust region; zeros for the defaults. */
+  const size_t * rows; /* Indices of the rows of empirical_data and samples
+			* to fit, or NULL for every row. Only
+			* fit_context_fit() reads them, and fits of a subset
+			* have no statistics in gof. */
+  size_t nrows; /* The number of indices in rows. */
 } fit_data_t;
 
+/* The outcome of a fit with fit_context_fit(). The counts are those of the
+ * trust region method, summed over every pass of a robust fit, and are 0
+ * for a direct fit. */
+typedef struct fit_result {
+  size_t p; /* The number of coefficients, or 0 if the fit failed. */
+  fit_param_t coefficients[POLY_MAX_TERMS];
+  size_t n; /* Samples fitted. */
+  double chisq0; /* Sum of squared residuals at the starting point. */
+  double chisq; /* And at the fit, weighted if it is robust. */
+  size_t niter;
+  size_t nevalf;
+  size_t nevaldf;
+  size_t nevalfvv;
+  int info; /* Why the driver stopped, as gsl_multifit_nlinear_driver(). */
+  int status;
+  size_t reweights; /* Passes of a robust fit after the plain one. */
+  double scale; /* Robust scale of the residuals, or 0. */
+  size_t outliers; /* Samples given less than half weight. */
+  double cost; /* Work of the fit as a multiple of a plain one's. */
+  gof_t gof; /* Statistics of the unweighted residuals. */
+} fit_result_t;
+
+/* The state of one fit at a time: its log, and its outcome. Fits with
+ * different contexts may run at once. */
+typedef struct fit_context fit_context_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* Names of the columns in the header of a data file, for read_columns_csv(). */
+extern const char * const fit_columns[FIT_NCOLUMNS];
+
 /*******************************************************************************
  * API FUNCTION PROTOTYPES
  ***/
 
 extern int surface_f(const gsl_vector * x, void * data, gsl_vector * f);
-/* This function is currently still in development. */
-/* extern int surface_df(const gsl_vector * x, void * data, gsl_matrix * J); */
+extern int surface_df(const gsl_vector * x, void * data, gsl_matrix * J);
+extern int triode_f(const gsl_vector * x, void * data, gsl_vector * f);
+extern int triode_df(const gsl_vector * x, void * data, gsl_matrix * J);
+extern int triode_fvv(const gsl_vector * x, const gsl_vector * v, void * data,
+		      gsl_vector * fvv);
+extern fit_context_t * fit_context_alloc(FILE * log, bool iterations);
+extern void fit_context_set_log(fit_context_t * ctx, FILE * log,
+				bool iterations);
+extern void fit_context_set_pool(fit_context_t * ctx, fit_pool_t * pool);
+extern void fit_context_free(fit_context_t * ctx);
+extern const fit_result_t * fit_context_result(const fit_context_t * ctx);
+extern int fit_context_copy(const fit_context_t * ctx, fit_data_t * data);
+extern int fit_context_fit(fit_context_t * ctx, const fit_data_t * data);
+extern int fit_context_stream(fit_context_t * ctx, const fit_data_t * data,
+			      const char * filename);
 extern int fit_surface(fit_data_t * data, bool callback, FILE * outfh);
+extern int fit_surface_stream(fit_data_t * data, const char * filename,
+			      FILE * outfh);
+extern void fit_coefficients_free(fit_data_t * data);
 extern int plot(fit_data_t * data, bool png_output);
+extern fit_samples_t * fit_samples_alloc(const gsl_matrix * values);
+extern int fit_samples_fill(fit_samples_t * samples,
+			    const gsl_matrix * values);
+extern void fit_samples_free(fit_samples_t * samples);
+extern void jacobian_covar(const gsl_matrix * J, fit_buffers_t * buffers);
+
+#endif /* __ET_FIT_H__ */
 
 /******************************************************************************/
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * NAME:	    fitpool.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the pool of solver workspaces in
+ *		    fitpool.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_FITPOOL_H__
+#define __ET_FITPOOL_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multifit_nlinear.h>
+
+#include "linfit.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The most sets of buffers a pool keeps. Past this, the free set used least
+ * recently is freed whenever another is made. */
+#define FIT_POOL_MAX_ENTRIES 16
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* A pool of the buffers fits need, kept from one fit to the next. The pool
+ * owns every buffer it makes, and frees them all in fit_pool_free(), which
+ * must only be called once every fit using the pool is done. A fit borrows
+ * one set of buffers with fit_pool_acquire() and has them to itself until
+ * it gives them back with fit_pool_release(). The pool may be shared by
+ * fits on different threads; it holds one set of buffers for each shape
+ * of fit, times the most fits of that shape that ran at once, but no more
+ * than FIT_POOL_MAX_ENTRIES of them while they are free. */
+typedef struct fit_pool fit_pool_t;
+
+/* The buffers for one fit of n samples and p coefficients. */
+typedef struct fit_buffers {
+  gsl_multifit_nlinear_workspace * w; /* NULL for a linear fit. */
+  linfit_t * linfit; /* The fit itself, or the covariance of w's. */
+  gsl_vector * c; /* p coefficients. */
+  gsl_matrix * covar; /* p x p. */
+  gsl_vector * weights; /* n, or NULL if n is 0. */
+  gsl_vector * work; /* n residuals, or NULL if n is 0. */
+} fit_buffers_t;
+
+typedef struct fit_pool_stats {
+  size_t entries; /* Sets of buffers the pool holds. */
+  size_t hits; /* Acquisitions served from the pool. */
+  size_t misses; /* And those that made a new set. */
+  size_t evictions; /* Free sets freed to make room for new ones. */
+} fit_pool_stats_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Make an empty pool
+ * \return The pool, or \c NULL if there was no memory.
+ */
+extern fit_pool_t * fit_pool_alloc(void);
+
+/**
+ * \brief Free a pool and every buffer it holds
+ * \param pool The pool, or \c NULL
+ */
+extern void fit_pool_free(fit_pool_t * pool);
+
+/**
+ * \brief Borrow the buffers for a fit, making them if the pool has none of
+ * that shape free
+ * \param pool The pool
+ * \param params The parameters of the trust region method, or \c NULL for a
+ * linear fit, which needs no workspace
+ * \param n The number of samples, or 0 for a linear fit that needs no
+ * weights
+ * \param p The number of coefficients
+ * \return The buffers, or \c NULL if there was no memory.
+ */
+extern fit_buffers_t * fit_pool_acquire(fit_pool_t * pool,
+				const gsl_multifit_nlinear_parameters * params,
+				size_t n, size_t p);
+
+/**
+ * \brief Give back buffers borrowed with fit_pool_acquire()
+ * \param pool The pool
+ * \param buffers The buffers, or \c NULL
+ */
+extern void fit_pool_release(fit_pool_t * pool, fit_buffers_t * buffers);
+
+/**
+ * \brief How much a pool holds, and how often it was used
+ * \param pool The pool
+ * \param stats Location for the statistics
+ */
+extern void fit_pool_stats(fit_pool_t * pool, fit_pool_stats_t * stats);
+
+#endif /* __ET_FITPOOL_H__ */
+
+/******************************************************************************/
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * NAME:	    gof.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the goodness-of-fit statistics
+ *		    in gof.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_GOF_H__
+#define __ET_GOF_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gsl/gsl_vector.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Most regions the residuals are summarized in. The regions are bands of
+ * grid voltage, GOF_REGION_WIDTH volts wide to begin with; a fit whose data
+ * spans more bands than this gets bands twice as wide, until it fits. */
+#define GOF_MAX_REGIONS 16
+#define GOF_REGION_WIDTH 0.5
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* How gof_write() writes the statistics. */
+typedef enum gof_format {
+  GOF_JSON,	/* One object per fit, on a line of its own. */
+  GOF_CSV	/* One row per fit, then one per region. */
+} gof_format_t;
+
+/* The residuals of the samples with Eg in [eg_lower, eg_upper). */
+typedef struct gof_region {
+  double eg_lower;
+  double eg_upper;
+  size_t n;
+  double mean; /* Their bias. */
+  double rms;
+  double max_abs;
+} gof_region_t;
+
+/* Statistics of the residuals f_i = Ig_i - Y_i of a fit. */
+typedef struct gof {
+  size_t n; /* Samples, or 0 if the statistics weren't computed. */
+  size_t p; /* Coefficients. */
+  double r2; /* 1 - RSS / TSS */
+  double adj_r2; /* 1 - (1 - R^2)(n - 1) / (n - p) */
+  double rmse; /* sqrt(RSS / n) */
+  double max_abs; /* The largest |f_i|, */
+  size_t max_row; /* and its sample. */
+  double mean;
+  double skew;
+  double kurtosis; /* Excess kurtosis, 0 for normal residuals. */
+  double durbin_watson; /* sum (f_i - f_i-1)^2 / RSS; 2 if uncorrelated. */
+  size_t nregions;
+  gof_region_t region[GOF_MAX_REGIONS]; /* By increasing Eg. */
+} gof_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Compute every statistic of a fit in one pass over its residuals
+ * \param gof Location for the statistics
+ * \param f The n residuals, in the order of the samples
+ * \param eg The grid voltage of each sample
+ * \param ig The plate current of each sample
+ * \param stride The distance, in doubles, between samples in \c eg and \c ig
+ * \param p The number of coefficients of the fit
+ */
+extern void gof_compute(gof_t * gof, const gsl_vector * f, const double * eg,
+			const double * ig, size_t stride, size_t p);
+
+/**
+ * \brief Choose the format of a report from the name of its file
+ * \param filename The name
+ * \return GOF_CSV if it ends in .csv, GOF_JSON otherwise.
+ */
+extern gof_format_t gof_format(const char * filename);
+
+/**
+ * \brief Write what goes before the statistics of any fit: the header row
+ * of a CSV report, or nothing for JSON
+ * \param outfh The report
+ * \param format The format
+ */
+extern void gof_write_header(FILE * outfh, gof_format_t format);
+
+/**
+ * \brief Write the statistics of one fit
+ * \param outfh The report
+ * \param name The name of the fit, such as the file of its data
+ * \param gof The statistics
+ * \param format The format
+ */
+extern void gof_write(FILE * outfh, const char * name, const gof_t * gof,
+		      gof_format_t format);
+
+#endif /* __ET_GOF_H__ */
+
+/******************************************************************************/
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * NAME:	    linfit.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the functions in linfit.c, which
+ *		    solve least-squares problems that are linear in their
+ *		    coefficients from a compact QR factorization.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_LINFIT_H__
+#define __ET_LINFIT_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The triangular factor R of the augmented design matrix [X y]. Its last
+ * column holds Q^T y, and R[p][p]^2 is the residual sum of squares. */
+typedef struct linfit {
+  size_t p;
+  size_t n;
+  gsl_matrix * R;
+} linfit_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Allocate an empty accumulator for \c p coefficients
+ * \param p The number of coefficients
+ * \return The accumulator, or \c NULL on failure.
+ */
+extern linfit_t * linfit_alloc(size_t p);
+
+/**
+ * \brief Free an accumulator
+ * \param fit The accumulator
+ */
+extern void linfit_free(linfit_t * fit);
+
+/**
+ * \brief Discard every row added to an accumulator
+ * \param fit The accumulator
+ */
+extern void linfit_reset(linfit_t * fit);
+
+/**
+ * \brief Add one observation to the factorization
+ * \param fit The accumulator
+ * \param x The \c p regressors of the observation
+ * \param y The observed value
+ */
+extern void linfit_add(linfit_t * fit, const double * x, double y);
+
+/**
+ * \brief Add every observation of another accumulator to the factorization
+ * \param fit The accumulator
+ * \param other An accumulator of the same size, which isn't changed
+ */
+extern void linfit_merge(linfit_t * fit, const linfit_t * other);
+
+/**
+ * \brief Take back one observation added to the factorization
+ * \param fit The accumulator
+ * \param x The \c p regressors of the observation
+ * \param y The observed value
+ * \return \c GSL_SUCCESS, or \c GSL_EDOM if the rows left wouldn't determine
+ * the fit, in which case \c fit is unchanged.
+ */
+extern int linfit_remove(linfit_t * fit, const double * x, double y);
+
+/**
+ * \brief Solve for the coefficients of the rows added so far
+ * \param fit The accumulator
+ * \param c Vector of size \c p for the coefficients
+ * \param covar Matrix of size \c p x \c p for (X^T X)^-1, or \c NULL
+ * \param chisq Location for the residual sum of squares, or \c NULL
+ * \return \c GSL_SUCCESS, or \c GSL_ESING if the design is rank deficient.
+ */
+extern int linfit_solve(const linfit_t * fit, gsl_vector * c,
+			gsl_matrix * covar, double * chisq);
+
+#endif /* __ET_LINFIT_H__ */
+
+/******************************************************************************/
@@ -8,7 +8,7 @@
  *
  * CREATED:	    03/29/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/17/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -61,7 +61,7 @@ typedef struct _List_ {
 
 #define list_isempty(list) ((list)->size == 0 ? 1 : 0)
 #define list_ishead(list, element) ((list)->head == element ? 1 : 0)
-#define list_istail(list, element) ((list)->tail == NULL ? 1 : 0)
+#define list_istail(list, element) ((list)->tail == element ? 1 : 0)
 
 /*******************************************************************************
  * API FUNCTION PROTOTYPES
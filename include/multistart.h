@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * NAME:	    multistart.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the multi-start fits in
+ *		    multistart.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_MULTISTART_H__
+#define __ET_MULTISTART_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fit.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* How the starting points fill their box. */
+typedef enum multistart_sampling {
+  MULTISTART_LHS,	/* Latin hypercube: one start in each of K slices of
+			 * every coefficient's range. */
+  MULTISTART_SOBOL	/* The first K points of a Sobol sequence. */
+} multistart_sampling_t;
+
+typedef struct multistart_options {
+  size_t starts; /* K, the number of fits. */
+  size_t threads; /* Threads to fit them on, or 0 for one per CPU. */
+  multistart_sampling_t sampling;
+  unsigned long seed; /* For the Latin hypercube. */
+  size_t max_iter; /* Per fit, or 0 for 100, unless the data's method has
+		     * a limit of its own. */
+
+  /* The box the starts are drawn from, p values each. If either is NULL,
+   * each coefficient b of the model's starting point is scaled by
+   * spread^u for u uniform in [-1, 1], and coefficients of 0 are drawn
+   * from [-1, 1]. */
+  const double * lower;
+  const double * upper;
+  double spread; /* 0 for 4. */
+} multistart_options_t;
+
+/* The outcome of the fit from one start. */
+typedef struct multistart_start {
+  double * start; /* The p coefficients it started from. */
+  double * x; /* And those it ended at. */
+  double * error; /* Their standard errors. */
+  double chisq; /* Final sum of squared residuals. */
+  size_t niter;
+  size_t nevalf;
+  size_t nevaldf;
+  size_t nevalfvv;
+  int info; /* Why the driver stopped, as gsl_multifit_nlinear_driver(). */
+  int status;
+  double seconds; /* Wall time of this fit alone. */
+} multistart_start_t;
+
+typedef struct multistart {
+  size_t starts;
+  size_t p;
+  size_t threads;
+  multistart_sampling_t sampling;
+  size_t best; /* Start with the least chisq, or <starts> if none ended. */
+  double seconds; /* Wall time for all of the fits. */
+  multistart_start_t * start;
+  double * block; /* Backing for every start's vectors. */
+} multistart_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Fit the model from many starting points at once, by the trust region
+ * method, each in its own workspace on a pool of threads
+ * \param data The data and model, as for fit_surface(). The best fit is
+ * written to data->coefficients, as fit_surface() would.
+ * \param options How to choose the starts, and how many
+ * \return The outcome of every start, or \c NULL on failure.
+ */
+extern multistart_t * multistart_fit(fit_data_t * data,
+				     const multistart_options_t * options);
+
+/**
+ * \brief Write the starting points for a fit
+ * \param sampling How they fill the box
+ * \param starts The number of points, K
+ * \param p The number of coefficients
+ * \param lower The lower corner of the box, p values
+ * \param upper The upper corner
+ * \param seed The seed, for the Latin hypercube
+ * \param points Location for the K points, p values each
+ * \return 0 on success, -1 otherwise.
+ */
+extern int multistart_points(multistart_sampling_t sampling, size_t starts,
+			     size_t p, const double * lower,
+			     const double * upper, unsigned long seed,
+			     double * points);
+
+/**
+ * \brief Log the outcome of every start, then the best fit
+ * \param result The outcome
+ * \param data The data it was fitted to
+ * \param outfh The log
+ */
+extern void multistart_print(const multistart_t * result,
+			     const fit_data_t * data, FILE * outfh);
+
+/**
+ * \brief Free the outcome of a multi-start fit
+ * \param result The outcome
+ */
+extern void multistart_free(multistart_t * result);
+
+#endif /* __ET_MULTISTART_H__ */
+
+/******************************************************************************/
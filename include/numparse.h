@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * NAME:	    numparse.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the number parsing kernel in
+ *		    numparse.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_NUMPARSE_H__
+#define __ET_NUMPARSE_H__
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Parse the whole of [begin, end) as a double
+ * \param begin The first character of the number
+ * \param end One past its last character; need not be NUL
+ * \param value Location for the result
+ * \return 0 on success, -1 if the range isn't exactly one number.
+ */
+extern int parse_double(const char * begin, const char * end, double * value);
+
+#endif /* __ET_NUMPARSE_H__ */
+
+/******************************************************************************/
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * NAME:	    poly.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the polynomial surface models in
+ *		    poly.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_POLY_H__
+#define __ET_POLY_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Most terms, and highest power of Ep or Eg, a model may have. */
+#define POLY_MAX_TERMS 16
+#define POLY_MAX_DEGREE 8
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One term of a surface, Eg^eg Ep^ep. The constant term is (0, 0). */
+typedef struct poly_term {
+  unsigned char eg;
+  unsigned char ep;
+} poly_term_t;
+
+/* Kernels that evaluate a surface. Each but the generic one is specialized
+ * for the terms poly_init() makes for one degree, in the same order. */
+typedef enum poly_kernel {
+  POLY_KERNEL_GENERIC,	/* Any terms, read from the model. */
+  POLY_KERNEL_QUADRATIC,	/* Degree 2: the kernels in residual.c. */
+  POLY_KERNEL_LINEAR,	/* Degree 1. */
+  POLY_KERNEL_CUBIC,	/* Degree 3. */
+  POLY_KERNEL_QUARTIC,	/* Degree 4. */
+  POLY_KERNEL_QUADRATIC_CROSS,	/* Degree 2, with cross terms. */
+  POLY_KERNEL_CUBIC_CROSS,	/* Degree 3, with cross terms. */
+  POLY_KERNEL_QUARTIC_CROSS,	/* Degree 4, with cross terms. */
+  POLY_NKERNELS
+} poly_kernel_t;
+
+/* How poly_expr() and poly_term_name() write a surface. */
+typedef enum poly_syntax {
+  POLY_SYNTAX_TEXT,	/* 1.4000e+00Eg + ... + 3.0000e-01, for the log. */
+  POLY_SYNTAX_GNUPLOT	/* 1.4*y + ... + 0.3, with x = Ep and y = Eg. */
+} poly_syntax_t;
+
+/* A polynomial surface Y = sum b_k term_k(Ep, Eg), which is linear in its
+ * coefficients b_k. */
+typedef struct poly_model {
+  size_t nterms;
+  poly_term_t term[POLY_MAX_TERMS];
+  unsigned degree; /* Highest power of Ep or Eg in any term. */
+  poly_kernel_t kernel; /* Set by poly_init() and poly_parse(). */
+} poly_model_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* Y = b0 Eg + b1 Ep + b2 Eg^2 + b3 Ep^2 + b4, the surface fit.c always fit
+ * before models were configurable. */
+extern const poly_model_t poly_quadratic;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Make the surface of a degree: Eg^k and Ep^k for k = 1 to \c degree,
+ * then, if asked for, the cross terms Eg^a Ep^b with a + b <= \c degree, by
+ * increasing a + b and decreasing a, then the constant
+ * \param model Location for the model
+ * \param degree The degree, at least 1
+ * \param cross Whether to include the cross terms
+ * \return 0 on success, -1 if the model would have too many terms.
+ */
+extern int poly_init(poly_model_t * model, unsigned degree, int cross);
+
+/**
+ * \brief Make a surface from a description: a degree, as for poly_init(),
+ * followed by 'x' for the cross terms ("2", "3x"), or a comma separated list
+ * of terms, each "1" or a product of powers ("Eg,Ep,Eg*Ep,Ep^3,1")
+ * \param model Location for the model
+ * \param spec The description
+ * \return 0 on success, -1 if \c spec isn't a valid model.
+ */
+extern int poly_parse(poly_model_t * model, const char * spec);
+
+/**
+ * \brief Compute the terms of a surface at one sample
+ * \param model The model
+ * \param ep The plate voltage
+ * \param eg The grid voltage
+ * \param ep2 The square of \c ep, which may be rounded as stored in the data
+ * \param eg2 The square of \c eg
+ * \param x Location for the model->nterms values
+ */
+extern void poly_basis(const poly_model_t * model, double ep, double eg,
+		       double ep2, double eg2, double * x);
+
+/**
+ * \brief Compute the residuals f_i = Ig_i - Y_i of a surface, with the
+ * kernel of the model
+ * \param model The model
+ * \param ep The plate voltages, n contiguous doubles
+ * \param eg The grid voltages
+ * \param ig The plate currents
+ * \param ep2 The squares of \c ep, or \c NULL to compute them
+ * \param eg2 The squares of \c eg, or \c NULL to compute them
+ * \param b The model->nterms coefficients
+ * \param f Location for the n residuals
+ * \param n The number of samples
+ */
+extern void poly_residuals(const poly_model_t * model, const double * ep,
+			   const double * eg, const double * ig,
+			   const double * ep2, const double * eg2,
+			   const double * b, double * f, size_t n);
+
+/**
+ * \brief Write the name of a term, such as "Eg^2*Ep"
+ * \param term The term
+ * \param syntax The syntax
+ * \param buf Location for the name; the constant term's is "1"
+ * \param size The size of \c buf
+ * \return The length of the name, as snprintf() returns.
+ */
+extern int poly_term_name(poly_term_t term, poly_syntax_t syntax, char * buf,
+			  size_t size);
+
+/**
+ * \brief Write a surface with its coefficients, as an expression
+ * \param model The model
+ * \param b The model->nterms coefficients
+ * \param syntax The syntax
+ * \return The expression, to be freed by the caller, or \c NULL on failure.
+ */
+extern char * poly_expr(const poly_model_t * model, const double * b,
+			poly_syntax_t syntax);
+
+/**
+ * \brief The name of a kernel
+ * \param kernel The kernel
+ * \return A static string, such as "cubic".
+ */
+extern const char * poly_kernel_name(poly_kernel_t kernel);
+
+#endif /* __ET_POLY_H__ */
+
+/******************************************************************************/
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * NAME:	    refit.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the incremental surface fits in
+ *		    refit.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_REFIT_H__
+#define __ET_REFIT_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+#include <gsl/gsl_matrix.h>
+
+#include "fit.h"
+#include "poly.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* A surface fitted to a set of rows which may grow or shrink, keeping only
+ * the (p+1) x (p+1) QR factor of the design matrix, so that adding or
+ * removing k rows costs O(k p^2) whatever the number of rows already in
+ * it. */
+typedef struct refit refit_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Make an empty incremental fit
+ * \param model The surface, or \c NULL for poly_quadratic; it is copied
+ * \return The fit, or \c NULL if there was no memory.
+ */
+extern refit_t * refit_alloc(const poly_model_t * model);
+
+/**
+ * \brief Free an incremental fit
+ * \param refit The fit, or \c NULL
+ */
+extern void refit_free(refit_t * refit);
+
+/**
+ * \brief Add rows to the fit
+ * \param refit The fit
+ * \param rows The rows, with the columns of fit_data_t.empirical_data
+ */
+extern void refit_add(refit_t * refit, const gsl_matrix * rows);
+
+/**
+ * \brief Remove rows which were added to the fit
+ * \param refit The fit
+ * \param rows The rows, as they were added
+ * \return 0 on success, or -1 if a row couldn't be removed, in which case
+ * the rows before it were.
+ */
+extern int refit_remove(refit_t * refit, const gsl_matrix * rows);
+
+/**
+ * \brief Solve for the coefficients of the rows in the fit
+ * \param refit The fit
+ * \param result Location for the coefficients, their errors and chisq
+ * \param covar A p x p matrix for (X^T X)^-1, or \c NULL
+ * \return 0 on success, or -1 if the rows don't determine every
+ * coefficient.
+ */
+extern int refit_solve(refit_t * refit, fit_result_t * result,
+		       gsl_matrix * covar);
+
+/**
+ * \brief The number of rows in the fit
+ */
+extern size_t refit_rows(const refit_t * refit);
+
+#endif /* __ET_REFIT_H__ */
+
+/******************************************************************************/
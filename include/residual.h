@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * NAME:	    residual.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the vectorized residual kernels in
+ *		    residual.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_RESIDUAL_H__
+#define __ET_RESIDUAL_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* Instruction sets the kernels are written for, from least to most capable. */
+typedef enum residual_isa {
+  RESIDUAL_SCALAR,
+  RESIDUAL_SSE2,
+  RESIDUAL_AVX2,	/* With FMA. */
+  RESIDUAL_AVX512,
+  RESIDUAL_NISAS
+} residual_isa_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Compute the residuals of the quadratic surface,
+ * f_i = Ig_i - (b0 Eg_i + b1 Ep_i + b2 Eg_i^2 + b3 Ep_i^2 + b4)
+ * \param ep The plate voltages, n contiguous doubles
+ * \param eg The grid voltages
+ * \param ig The plate currents
+ * \param ep2 The squares of \c ep, or \c NULL to compute them
+ * \param eg2 The squares of \c eg, or \c NULL to compute them
+ * \param b The 5 coefficients
+ * \param f Location for the n residuals
+ * \param n The number of samples
+ */
+extern void residual_surface(const double * ep, const double * eg,
+			     const double * ig, const double * ep2,
+			     const double * eg2, const double * b, double * f,
+			     size_t n);
+
+/**
+ * \brief As residual_surface(), with the kernel for a given instruction set
+ * \param isa The instruction set, which must be supported by this CPU
+ * \return 0 on success, -1 if \c isa isn't supported.
+ */
+extern int residual_surface_isa(residual_isa_t isa, const double * ep,
+				const double * eg, const double * ig,
+				const double * ep2, const double * eg2,
+				const double * b, double * f, size_t n);
+
+/**
+ * \brief Whether this CPU, and this build, can run an instruction set
+ * \param isa The instruction set
+ * \return true if it can.
+ */
+extern bool residual_isa_supported(residual_isa_t isa);
+
+/**
+ * \brief The instruction set residual_surface() dispatches to
+ * \return The most capable one supported.
+ */
+extern residual_isa_t residual_isa(void);
+
+/**
+ * \brief The name of an instruction set
+ * \param isa The instruction set
+ * \return A static string, such as "avx2".
+ */
+extern const char * residual_isa_name(residual_isa_t isa);
+
+#endif /* __ET_RESIDUAL_H__ */
+
+/******************************************************************************/
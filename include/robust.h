@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * NAME:	    robust.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the robust loss functions in
+ *		    robust.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_ROBUST_H__
+#define __ET_ROBUST_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <gsl/gsl_vector.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The usual tuning constants, for 95% efficiency on normal residuals. */
+#define ROBUST_HUBER_K 1.345
+#define ROBUST_TUKEY_K 4.685
+
+/* Most reweighted fits after the first, plain one. */
+#define ROBUST_MAX_PASSES 30
+
+/* Reweighting stops once no coefficient moves by more than this, relative
+ * to its size. */
+#define ROBUST_TOL 1e-6
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The loss which iteratively reweighted least squares minimizes. u is a
+ * residual in units of the robust scale, and k the tuning constant. */
+typedef enum robust_loss {
+  ROBUST_NONE,	/* Least squares: every sample has weight 1. */
+  ROBUST_HUBER,	/* Weight min(1, k/|u|): outliers count linearly. */
+  ROBUST_TUKEY	/* Bisquare, weight (1 - (u/k)^2)^2 inside k: outliers
+		 * beyond it count not at all. */
+} robust_loss_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Parse a loss, "huber" or "tukey", with an optional tuning constant,
+ * as in "tukey:3.5"
+ * \param spec The description
+ * \param loss Location for the loss
+ * \param tuning Location for the constant, or 0 if \c spec has none
+ * \return 0 on success, -1 if \c spec isn't valid.
+ */
+extern int robust_parse(const char * spec, robust_loss_t * loss,
+			double * tuning);
+
+/**
+ * \brief The name of a loss, as robust_parse() reads it
+ */
+extern const char * robust_name(robust_loss_t loss);
+
+/**
+ * \brief The tuning constant of a loss
+ * \param loss The loss
+ * \param tuning A constant, or 0 for the loss's usual one
+ */
+extern double robust_tuning(robust_loss_t loss, double tuning);
+
+/**
+ * \brief Weigh residuals for the next pass of iteratively reweighted least
+ * squares
+ * \param loss The loss
+ * \param k Its tuning constant, from robust_tuning()
+ * \param r The residuals, unweighted
+ * \param weights Location for the n weights; also used as scratch for the
+ * scale
+ * \return The robust scale of the residuals, median(|r|) / 0.6745.
+ */
+extern double robust_weights(robust_loss_t loss, double k,
+			     const gsl_vector * r, gsl_vector * weights);
+
+/**
+ * \brief The number of samples weighed as outliers, with less than half
+ * weight
+ */
+extern size_t robust_outliers(const gsl_vector * weights);
+
+/**
+ * \brief Whether reweighting has converged
+ * \param previous The p coefficients of the last pass
+ * \param x Those of this pass
+ * \return true if no coefficient moved by more than ROBUST_TOL of its size.
+ */
+extern bool robust_converged(const gsl_vector * previous,
+			     const gsl_vector * x);
+
+#endif /* __ET_ROBUST_H__ */
+
+/******************************************************************************/
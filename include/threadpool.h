@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * NAME:	    threadpool.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the fixed-size pool of worker threads
+ *		    in threadpool.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_THREADPOOL_H__
+#define __ET_THREADPOOL_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct threadpool threadpool_t;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Start a pool of worker threads
+ * \param nthreads The number of threads, or 0 for one per online CPU
+ * \return The pool, or \c NULL on failure.
+ */
+extern threadpool_t * threadpool_create(size_t nthreads);
+
+/**
+ * \brief Queue \c func(arg) to run on one of the pool's threads
+ * \param pool The pool
+ * \param func The task
+ * \param arg Its argument
+ * \return 0 on success, -1 otherwise.
+ */
+extern int threadpool_submit(threadpool_t * pool, void (*func)(void *),
+			     void * arg);
+
+/**
+ * \brief Wait until every task submitted so far has finished
+ * \param pool The pool
+ */
+extern void threadpool_wait(threadpool_t * pool);
+
+/**
+ * \brief Finish the queued tasks, then stop the threads and free the pool
+ * \param pool The pool
+ */
+extern void threadpool_destroy(threadpool_t * pool);
+
+/**
+ * \brief The number of threads in a pool
+ * \param pool The pool
+ * \return The number of threads.
+ */
+extern size_t threadpool_size(const threadpool_t * pool);
+
+/**
+ * \brief The number of online CPUs
+ * \return The number of CPUs, at least 1.
+ */
+extern size_t threadpool_ncpus(void);
+
+#endif /* __ET_THREADPOOL_H__ */
+
+/******************************************************************************/
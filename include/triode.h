@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * NAME:	    triode.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the physical triode models in
+ *		    triode.c.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_TRIODE_H__
+#define __ET_TRIODE_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Most coefficients any triode model has. */
+#define TRIODE_MAX_PARAMS 5
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* A physical model of the plate current Ip(Ep, Eg), in mA for voltages in V,
+ * which is nonlinear in its coefficients. */
+typedef struct triode_model {
+  const char * name;
+  size_t p; /* The number of coefficients. */
+  const char * const * params; /* Their names. */
+  const double * initial; /* A starting point, from a 12AX7. */
+
+  /* Ip at one sample, and its gradient in the coefficients if <grad> isn't
+   * NULL. */
+  double (*eval)(const double * b, double ep, double eg, double * grad);
+
+  /* The second derivative of Ip at one sample along the direction <v>,
+   * v^T H v for the Hessian H in the coefficients. */
+  double (*eval_vv)(const double * b, const double * v, double ep,
+		    double eg);
+
+  /* Ip as a gnuplot expression in x = Ep and y = Eg, with the coefficients
+   * as the variables b0, b1, ... */
+  const char * gnuplot;
+} triode_model_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* Norman Koren's model, with the coefficients mu, ex, kg1, kp and kvb. */
+extern const triode_model_t triode_koren;
+
+/* The Child-Langmuir law, Ip = K (Eg + Ep/mu)^(3/2). */
+extern const triode_model_t triode_child_langmuir;
+
+/* The cathode current of Dempwolf and Zoelzer's model, with the
+ * coefficients G, C, mu and gamma. Grid current is neglected. */
+extern const triode_model_t triode_dempwolf;
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Look up a triode model by name
+ * \param name "koren", "child-langmuir" or "dempwolf"
+ * \return The model, or \c NULL if there is none by that name.
+ */
+extern const triode_model_t * triode_find(const char * name);
+
+#endif /* __ET_TRIODE_H__ */
+
+/******************************************************************************/
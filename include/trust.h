@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * NAME:	    trust.h
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Public interface for the choice of trust region method in
+ *		    trust.c.
+ *
+ * CREATED:	    10/17/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef __ET_TRUST_H__
+#define __ET_TRUST_H__
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <gsl/gsl_multifit_nlinear.h>
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* When the trust region method stops, unless told otherwise. */
+#define TRUST_MAX_ITER 20
+#define TRUST_XTOL 1e-8 /* Step tolerance */
+#define TRUST_GTOL 1e-8 /* Gradient tolerance */
+#define TRUST_FTOL 0.0
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* How each step solves the trust region subproblem. */
+typedef enum trust_trs {
+  TRUST_TRS_DEFAULT,	/* lm, or lmaccel for the triode models. */
+  TRUST_LM,		/* Levenberg-Marquardt. */
+  TRUST_LMACCEL,	/* Levenberg-Marquardt with geodesic acceleration. */
+  TRUST_DOGLEG,		/* Powell's dogleg. */
+  TRUST_DDOGLEG,	/* Double dogleg. */
+  TRUST_SUBSPACE2D,	/* Two dimensional subspace. */
+  TRUST_NTRS
+} trust_trs_t;
+
+/* How the coefficients are scaled, by the diagonal of D. */
+typedef enum trust_scale {
+  TRUST_SCALE_DEFAULT,	/* more. */
+  TRUST_LEVENBERG,	/* D = I; not invariant to the units of the data. */
+  TRUST_MARQUARDT,	/* D from the diagonal of J^T J. */
+  TRUST_MORE,		/* Marquardt's, never shrinking. */
+  TRUST_NSCALES
+} trust_scale_t;
+
+/* How each step's linear least squares system is solved. */
+typedef enum trust_solver {
+  TRUST_SOLVER_DEFAULT,	/* qr. */
+  TRUST_QR,		/* QR of J: slowest, but for any J. */
+  TRUST_CHOLESKY,	/* Cholesky of J^T J: fastest, unless J is nearly
+			 * singular. */
+  TRUST_MCHOLESKY,	/* Modified Cholesky, which tolerates an indefinite
+			 * J^T J. */
+  TRUST_SVD,		/* SVD of J: the most robust to rank deficiency. */
+  TRUST_NSOLVERS
+} trust_solver_t;
+
+/* The method of a fit. Zeros choose the defaults, so a zeroed method is the
+ * one fit_surface() has always used. */
+typedef struct trust_method {
+  trust_trs_t trs;
+  trust_scale_t scale;
+  trust_solver_t solver;
+  size_t max_iter; /* Iterations per pass, or 0 for TRUST_MAX_ITER. */
+  double xtol; /* Or 0 for TRUST_XTOL, */
+  double gtol; /* TRUST_GTOL */
+  double ftol; /* and TRUST_FTOL. */
+} trust_method_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* Names of the choices, as trust_parse() reads them. The defaults are named
+ * "default". */
+extern const char * const trust_trs_names[TRUST_NTRS];
+extern const char * const trust_scale_names[TRUST_NSCALES];
+extern const char * const trust_solver_names[TRUST_NSOLVERS];
+
+/*******************************************************************************
+ * API FUNCTION PROTOTYPES
+ ***/
+
+/**
+ * \brief Parse a method: names of a subproblem, scale and solver, and limits
+ * such as iter=50 or xtol=1e-10, in any order and separated by colons, as in
+ * "dogleg:svd:iter=50"
+ * \param spec The description
+ * \param method Location for the method; what \c spec doesn't name is
+ * left at its default
+ * \return 0 on success, -1 if \c spec isn't valid.
+ */
+extern int trust_parse(const char * spec, trust_method_t * method);
+
+/**
+ * \brief Write the description of a method with its defaults filled in, as
+ * trust_parse() reads it, as in "lmaccel:more:qr"
+ * \param method The method
+ * \param triode Whether the fit is of a triode model
+ * \param buf Location for the description
+ * \param len The size of \c buf
+ * \return The length of the description, as snprintf().
+ */
+extern int trust_name(const trust_method_t * method, bool triode,
+		      char * buf, size_t len);
+
+/**
+ * \brief Fill the parameters of the GSL's trust region method
+ * \param method The method
+ * \param triode Whether the fit is of a triode model
+ * \param params Location for the parameters
+ */
+extern void trust_params(const trust_method_t * method, bool triode,
+			 gsl_multifit_nlinear_parameters * params);
+
+/**
+ * \brief Iterate the trust region method until it converges or reaches the
+ * method's limits
+ * \param method The method
+ * \param max_iter The iteration limit, if the method has none
+ * \param callback As gsl_multifit_nlinear_driver()
+ * \param callback_params As gsl_multifit_nlinear_driver()
+ * \param info As gsl_multifit_nlinear_driver()
+ * \param w The workspace
+ * \return As gsl_multifit_nlinear_driver().
+ */
+extern int trust_driver(const trust_method_t * method, size_t max_iter,
+			void (*callback)(const size_t iter, void * params,
+					 const gsl_multifit_nlinear_workspace *
+					 w),
+			void * callback_params, int * info,
+			gsl_multifit_nlinear_workspace * w);
+
+#endif /* __ET_TRUST_H__ */
+
+/******************************************************************************/
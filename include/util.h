@@ -8,7 +8,7 @@
  *
  * CREATED:	    08/21/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/16/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -35,7 +35,59 @@
 
 #include <gsl/gsl_matrix.h>
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct tuple_reader tuple_reader_t;
+
+/* Rows a load found which weren't well formed. */
+typedef struct csv_error {
+  size_t malformed; /* Rows dropped because a field didn't parse. */
+  size_t line; /* Line of the first such row, counting from 1. */
+  size_t field; /* Field of the first such row, counting from 1. */
+  size_t ragged; /* Rows kept with empty fields skipped or missing ones 0. */
+} csv_error_t;
+
+/* Why a row was dropped. */
+typedef enum csv_reject {
+  CSV_REJECT_NUMBER,	/* A field wasn't a number. */
+  CSV_REJECT_EMPTY,	/* A field held nothing but blanks. */
+  CSV_REJECT_SHORT,	/* The line ended before a column that was asked for. */
+  CSV_REJECT_REASONS
+} csv_reject_t;
+
+/* What a load read, and how long it took. */
+typedef struct csv_stats {
+  size_t bytes; /* Of the file, or of its cache if that was read instead. */
+  size_t lines;
+  size_t rows; /* Rows accepted, ragged ones included. */
+  size_t ragged;
+  size_t rejected[CSV_REJECT_REASONS];
+  size_t comments; /* Lines with nothing before a '#', headers included. */
+  size_t blank;
+  bool cached; /* Served from the cache: only bytes and rows are counted. */
+  double wall; /* Seconds from open to return. */
+  double cpu; /* Seconds of CPU, on the caller's thread and the parser's. */
+} csv_stats_t;
+
+typedef enum csv_stats_format {
+  CSV_STATS_TEXT,	/* One line for people. */
+  CSV_STATS_JSON	/* One JSON object per line. */
+} csv_stats_format_t;
+
+typedef struct csv_options {
+  size_t threads; /* Threads to parse with; 0 or 1 uses the caller's. */
+  bool no_cache; /* Neither read nor write the binary cache. */
+  bool strict; /* Fail on a malformed field instead of dropping its row. */
+  csv_error_t * error; /* If not NULL, filled in by every load. */
+  csv_stats_t * stats; /* If not NULL, filled in by every load. */
+} csv_options_t;
 
 /*******************************************************************************
  * API FUNCTION PROTOTYPES
@@ -49,6 +101,28 @@
  */
 extern gsl_matrix * read_tuples_csv(const char * filename, size_t n);
 
+/**
+ * \brief Read tuples of size \c n from a CSV file, with options
+ * \param filename The path of the file to open
+ * \param n The size of the tuples to read
+ * \param options The options, or \c NULL for the defaults
+ * \return \c gsl_matrix with tuples or \c NULL on failure.
+ */
+extern gsl_matrix * read_tuples_csv_opt(const char * filename, size_t n,
+					const csv_options_t * options);
+
+/**
+ * \brief Read the named columns of a CSV file with a header comment
+ * \param filename The path of the file to open
+ * \param names The names of the columns, in the order wanted
+ * \param n The number of names
+ * \param options The options, or \c NULL for the defaults
+ * \return \c gsl_matrix with a column per name, or \c NULL on failure.
+ */
+extern gsl_matrix * read_columns_csv(const char * filename,
+				     const char * const * names, size_t n,
+				     const csv_options_t * options);
+
 /**
  * \brief Read tuples of size \c n from an XML file
  * \param filename The path of the file to open
@@ -57,6 +131,74 @@ extern gsl_matrix * read_tuples_csv(const char * filename, size_t n);
  */
 extern gsl_matrix * read_tuples_xml(const char * filename, size_t n);
 
+/**
+ * \brief Open a CSV file for reading tuples of size \c n in chunks
+ * \param filename The path of the file to open
+ * \param n The size of the tuples to read
+ * \return The reader, or \c NULL on failure.
+ */
+extern tuple_reader_t * tuple_reader_open(const char * filename, size_t n);
+
+/**
+ * \brief Open a CSV file for reading the named columns in chunks
+ * \param filename The path of the file to open
+ * \param names The names of the columns, in the order wanted
+ * \param n The number of names
+ * \return The reader, or \c NULL on failure.
+ */
+extern tuple_reader_t * tuple_reader_open_columns(const char * filename,
+						  const char * const * names,
+						  size_t n);
+
+/**
+ * \brief The malformed rows a reader has seen so far
+ * \param reader The reader
+ * \return The count and position of the first, or \c NULL if there were none.
+ */
+extern const csv_error_t * tuple_reader_error(const tuple_reader_t * reader);
+
+/**
+ * \brief What a reader has read so far
+ * \param reader The reader
+ * \return The counts; the reader isn't timed, so wall and cpu are 0.
+ */
+extern const csv_stats_t * tuple_reader_stats(const tuple_reader_t * reader);
+
+/**
+ * \brief Read up to \c max tuples into \c rows, row-major
+ * \param reader The reader
+ * \param rows Space for \c max tuples
+ * \param max The most tuples to read
+ * \return The number of tuples read, 0 at end of file or -1 on error.
+ */
+extern ssize_t tuple_reader_read(tuple_reader_t * reader, double * rows,
+				 size_t max);
+
+/**
+ * \brief Close the file and free the reader
+ * \param reader The reader
+ */
+extern void tuple_reader_close(tuple_reader_t * reader);
+
+/**
+ * \brief The rate a load read at
+ * \param stats The stats of the load
+ * \return Megabytes (10^6 bytes) per second of wall time, or 0.
+ */
+extern double csv_stats_throughput(const csv_stats_t * stats);
+
+/**
+ * \brief Write the stats of a load
+ * \param stream Where to write them
+ * \param filename The file loaded, for the record
+ * \param stats The stats
+ * \param format Whether to write text or JSON
+ * \return 0 on success, -1 if the write failed.
+ */
+extern int csv_stats_print(FILE * stream, const char * filename,
+			   const csv_stats_t * stats,
+			   csv_stats_format_t format);
+
 #endif /* __ET_UTIL_H__ */
 
 /******************************************************************************/
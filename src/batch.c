@@ -0,0 +1,311 @@
+/*******************************************************************************
+ * NAME:	    batch.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Fits many datasets at once on a pool of threads. Each
+ *		    thread fits in a context of its own and starts with an
+ *		    equal share of the datasets; a thread that runs out steals
+ *		    half of what another has left, so a few slow fits don't
+ *		    leave the other threads idle.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "batch.h"
+#include "fit.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The items a thread has left, [head, tail). The thread takes them from the
+ * head; others steal from the tail. */
+typedef struct batch_queue {
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} batch_queue_t;
+
+typedef struct batch {
+  batch_item_t * items;
+  const batch_options_t * options;
+  size_t nqueues;
+  batch_queue_t * queues;
+  size_t steals;
+  size_t failed;
+  size_t contexts; /* Threads which made a context. */
+} batch_t;
+
+/* One thread of a batch, as a task for the pool. */
+typedef struct batch_worker {
+  batch_t * batch;
+  size_t id;
+} batch_worker_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void batch_worker(void * arg);
+static bool batch_take(batch_queue_t * queue, size_t * item);
+static bool batch_steal(batch_t * batch, size_t id);
+static void batch_fit_item(fit_context_t * ctx, batch_item_t * item,
+			   const batch_options_t * options);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    batch_fit
+ *
+ * DESCRIPTION:	    Fits every item's data with fit_context_fit(), on a pool
+ *		    of threads, and writes the outcome to the item.
+ *
+ * ARGUMENTS:	    items: (batch_item_t *) -- the datasets.
+ *		    count: (size_t) -- the number of items.
+ *		    options: (const batch_options_t *) -- the options, or
+ *			NULL for the defaults.
+ *		    stats: (batch_stats_t *) -- location for how the work was
+ *			shared, or NULL.
+ *
+ * RETURN:	    size_t -- the number of fits which failed, or <count> if
+ *		    the threads couldn't be started.
+ *
+ * NOTES:	    Items may share their data's matrix and samples, which the
+ *		    fits only read. A thread which can't make a context takes
+ *		    no items; the others steal its share. Items are only left
+ *		    unfitted, and failed, if no thread could make one.
+ ***/
+size_t batch_fit(batch_item_t * items, size_t count,
+		 const batch_options_t * options, batch_stats_t * stats)
+{
+  static const batch_options_t defaults = {0};
+  if (options == NULL)
+    options = &defaults;
+  for (size_t i = 0; i < count; i++) {
+    items[i].status = -1;
+    items[i].log = NULL;
+  }
+  if (count == 0)
+    return 0;
+
+  size_t threads = options->threads > 0 ? options->threads
+    : threadpool_ncpus();
+  if (threads > count)
+    threads = count;
+
+  batch_t batch = {
+    .items = items,
+    .options = options,
+    .nqueues = threads
+  };
+  batch.queues = calloc(threads, sizeof(batch_queue_t));
+  batch_worker_t * workers = calloc(threads, sizeof(batch_worker_t));
+  threadpool_t * pool = NULL;
+  if (batch.queues == NULL || workers == NULL
+      || (pool = threadpool_create(threads)) == NULL) {
+    free(batch.queues);
+    free(workers);
+    return count;
+  }
+
+  /* Deal the items out in contiguous shares. */
+  for (size_t t = 0; t < threads; t++) {
+    pthread_mutex_init(&batch.queues[t].lock, NULL);
+    batch.queues[t].head = count * t / threads;
+    batch.queues[t].tail = count * (t + 1) / threads;
+    workers[t] = (batch_worker_t){ .batch = &batch, .id = t };
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t t = 0; t < threads; t++) {
+    if (threadpool_submit(pool, batch_worker, &workers[t]) != 0)
+      batch_worker(&workers[t]);
+  }
+  threadpool_destroy(pool);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  /* A thread with a context only stops once every queue is empty, so
+   * anything left was never taken. */
+  for (size_t t = 0; t < threads; t++)
+    batch.failed += batch.queues[t].tail - batch.queues[t].head;
+
+  if (stats != NULL) {
+    stats->threads = threads;
+    stats->contexts = batch.contexts;
+    stats->steals = batch.steals;
+    stats->seconds = (end.tv_sec - start.tv_sec)
+      + (end.tv_nsec - start.tv_nsec) / 1e9;
+  }
+
+  for (size_t t = 0; t < threads; t++)
+    pthread_mutex_destroy(&batch.queues[t].lock);
+  free(batch.queues);
+  free(workers);
+  return batch.failed;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    batch_worker
+ *
+ * DESCRIPTION:	    Fits the items of one thread's queue, then steals from the
+ *		    others until none has any left.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the batch_worker_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). If the thread can't
+ *		    make a context, it returns at once and leaves its items
+ *		    to be stolen by the others; batch_fit() fails them if
+ *		    there are none.
+ ***/
+static void batch_worker(void * arg)
+{
+  batch_worker_t * worker = (batch_worker_t *)arg;
+  batch_t * batch = worker->batch;
+  batch_queue_t * queue = &batch->queues[worker->id];
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  if (ctx == NULL)
+    return;
+  __atomic_add_fetch(&batch->contexts, 1, __ATOMIC_RELAXED);
+
+  size_t i;
+  do {
+    while (batch_take(queue, &i)) {
+      batch_fit_item(ctx, &batch->items[i], batch->options);
+      if (batch->items[i].status != 0)
+	__atomic_add_fetch(&batch->failed, 1, __ATOMIC_RELAXED);
+    }
+  } while (batch_steal(batch, worker->id));
+
+  fit_context_free(ctx);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    batch_take
+ *
+ * DESCRIPTION:	    Takes the next item from the head of a queue.
+ *
+ * ARGUMENTS:	    queue: (batch_queue_t *) -- the thread's own queue.
+ *		    item: (size_t *) -- location for the index of the item.
+ *
+ * RETURN:	    bool -- false if the queue was empty.
+ *
+ * NOTES:	    none.
+ ***/
+static bool batch_take(batch_queue_t * queue, size_t * item)
+{
+  pthread_mutex_lock(&queue->lock);
+  bool took = queue->head < queue->tail;
+  if (took)
+    *item = queue->head++;
+  pthread_mutex_unlock(&queue->lock);
+  return took;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    batch_steal
+ *
+ * DESCRIPTION:	    Moves half of the items left in another thread's queue,
+ *		    from its tail, to the empty queue of thread <id>. The
+ *		    other queues are tried in turn, starting after <id>.
+ *
+ * ARGUMENTS:	    batch: (batch_t *) -- the batch.
+ *		    id: (size_t) -- the thread which ran out.
+ *
+ * RETURN:	    bool -- false if every queue was empty.
+ *
+ * NOTES:	    Only one lock is held at a time. Items are never added to
+ *		    a batch, so a thread that finds every queue empty is done.
+ ***/
+static bool batch_steal(batch_t * batch, size_t id)
+{
+  for (size_t k = 1; k < batch->nqueues; k++) {
+    batch_queue_t * victim = &batch->queues[(id + k) % batch->nqueues];
+    pthread_mutex_lock(&victim->lock);
+    size_t left = victim->tail - victim->head;
+    size_t tail = victim->tail;
+    victim->tail -= (left + 1) / 2;
+    size_t head = victim->tail;
+    pthread_mutex_unlock(&victim->lock);
+    if (left == 0)
+      continue;
+
+    batch_queue_t * queue = &batch->queues[id];
+    pthread_mutex_lock(&queue->lock);
+    queue->head = head;
+    queue->tail = tail;
+    pthread_mutex_unlock(&queue->lock);
+    __atomic_add_fetch(&batch->steals, 1, __ATOMIC_RELAXED);
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    batch_fit_item
+ *
+ * DESCRIPTION:	    Fits one item, logging to a buffer of its own if asked to.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the thread's context.
+ *		    item: (batch_item_t *) -- the item.
+ *		    options: (const batch_options_t *) -- the options.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If the buffer can't be made, the fit isn't logged.
+ ***/
+static void batch_fit_item(fit_context_t * ctx, batch_item_t * item,
+			   const batch_options_t * options)
+{
+  FILE * log = NULL;
+  size_t size;
+  if (options->log)
+    log = open_memstream(&item->log, &size);
+
+  fit_context_set_log(ctx, log, options->iterations);
+  item->status = fit_context_fit(ctx, item->data);
+  item->result = *fit_context_result(ctx);
+  fit_context_set_log(ctx, NULL, false);
+  if (log != NULL)
+    fclose(log);
+}
+
+/******************************************************************************/
@@ -0,0 +1,2417 @@
+/*******************************************************************************
+ * NAME:	    bench.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Benchmark driver for the loaders and the fitter. Reports
+ *		    wall time, peak RSS and the number of heap allocations
+ *		    made by each operation.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multifit_nlinear.h>
+#include <gsl/gsl_randist.h>
+#include <gsl/gsl_rng.h>
+
+#include "dataset.h"
+#include "fit.h"
+#include "fitpool.h"
+#include "gof.h"
+#include "linfit.h"
+#include "poly.h"
+#include "refit.h"
+#include "residual.h"
+#include "robust.h"
+#include "batch.h"
+#include "bootstrap.h"
+#include "crossval.h"
+#include "multistart.h"
+#include "threadpool.h"
+#include "triode.h"
+#include "trust.h"
+#include "util.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct bench_sample {
+  struct timespec start;
+  size_t allocs;
+} bench_sample_t;
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+static size_t alloc_count;
+
+/* While fail_contexts is above 0, that many more callocs of fail_size bytes,
+ * the size of a fit_context_t, fail, so that batch_fit()'s threads can be
+ * made to run without a context. record_size catches the size. */
+static size_t fail_contexts;
+static size_t fail_size;
+static bool record_size;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static int bench_gen(const char * filename, size_t rows);
+static int bench_csv(const char * filename, size_t n);
+static int bench_columns(const char * filename, const char * const * names,
+			 size_t n);
+static int bench_stats(size_t n, char * const * filenames, size_t count);
+static int bench_jacobian(const char * filename);
+static double bench_jacobian_error(fit_data_t * data);
+static double bench_nlinear(fit_data_t * data, bool analytic);
+static int bench_linear(const char * filename);
+static int bench_residual(const char * filename, size_t reps);
+static int bench_model(const char * filename, size_t reps,
+		       const char * const * specs, size_t count);
+static int bench_triode(const char * filename);
+static double bench_triode_error(const triode_model_t * triode,
+				 const gsl_matrix * matrix, bool second);
+static void bench_triode_fit(const triode_model_t * triode,
+			     fit_data_t * data, bool accel);
+static int bench_multistart(const char * filename, const char * name,
+			    size_t starts, size_t max);
+static int bench_batch(const char * filename, size_t count, size_t max);
+static int bench_pool(const char * filename, size_t fits, const char * spec);
+static int bench_robust(const char * filename, const char * spec,
+			size_t every);
+static int bench_refit(const char * filename, size_t chunk);
+static double bench_refit_distance(const fit_result_t * a,
+				   const fit_result_t * b);
+static int bench_bootstrap(const char * filename, const char * spec,
+			   size_t replicates, size_t max);
+static int bench_crossval(const char * filename, size_t folds, size_t max,
+			  const char * const * specs, size_t count);
+static int bench_gof(const char * filename, const char * spec, size_t reps);
+static int bench_trust(const char * filename, const char * spec, size_t reps);
+static int bench_xml(const char * filename, size_t n);
+static int bench_threads(const char * filename, size_t n, size_t max);
+static int bench_stream(const char * filename);
+static int bench_registry(const char * path, size_t prefetch,
+			  size_t threads);
+static double bench_seconds(const struct timespec * start);
+static void bench_start(bench_sample_t * sample);
+static void bench_report(const char * name, bench_sample_t * sample,
+			 size_t bytes);
+static void usage(const char * name);
+
+/*******************************************************************************
+ * ALLOCATION COUNTING
+ ***/
+
+#ifdef __GLIBC__
+/* glibc routes every allocation in the process through these symbols, so
+ * counting them here also catches allocations made inside libgsl and libc. */
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t nmemb, size_t size);
+extern void * __libc_realloc(void * ptr, size_t size);
+
+void * malloc(size_t size)
+{
+  __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+  return __libc_malloc(size);
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+  __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+  if (record_size) {
+    fail_size = nmemb * size;
+    record_size = false;
+  } else if (nmemb * size == fail_size) {
+    size_t left = __atomic_load_n(&fail_contexts, __ATOMIC_RELAXED);
+    while (left > 0) {
+      if (__atomic_compare_exchange_n(&fail_contexts, &left, left - 1, false,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	return NULL;
+    }
+  }
+  return __libc_calloc(nmemb, size);
+}
+
+void * realloc(void * ptr, size_t size)
+{
+  __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+  return __libc_realloc(ptr, size);
+}
+#endif /* __GLIBC__ */
+
+/*******************************************************************************
+ * MAIN
+ ***/
+
+int main(int argc, char * argv[])
+{
+  if (argc < 3) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (!strcmp(argv[1], "gen") && argc == 4)
+    return bench_gen(argv[2], strtoul(argv[3], NULL, 10));
+  else if (!strcmp(argv[1], "csv"))
+    return bench_csv(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 3);
+  else if (!strcmp(argv[1], "columns") && argc > 3)
+    return bench_columns(argv[2], (const char * const *)argv + 3, argc - 3);
+  else if (!strcmp(argv[1], "threads"))
+    return bench_threads(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 3,
+			 argc > 4 ? strtoul(argv[4], NULL, 10)
+			 : threadpool_ncpus());
+  else if (!strcmp(argv[1], "stats") && argc > 3)
+    return bench_stats(strtoul(argv[2], NULL, 10), argv + 3, argc - 3);
+  else if (!strcmp(argv[1], "jacobian"))
+    return bench_jacobian(argv[2]);
+  else if (!strcmp(argv[1], "linear"))
+    return bench_linear(argv[2]);
+  else if (!strcmp(argv[1], "residual"))
+    return bench_residual(argv[2],
+			  argc > 3 ? strtoul(argv[3], NULL, 10) : 100);
+  else if (!strcmp(argv[1], "model"))
+    return bench_model(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 20,
+		       (const char * const *)argv + 4,
+		       argc > 4 ? argc - 4 : 0);
+  else if (!strcmp(argv[1], "triode"))
+    return bench_triode(argv[2]);
+  else if (!strcmp(argv[1], "multistart"))
+    return bench_multistart(argv[2], argc > 3 ? argv[3] : "koren",
+			    argc > 4 ? strtoul(argv[4], NULL, 10) : 32,
+			    argc > 5 ? strtoul(argv[5], NULL, 10)
+			    : threadpool_ncpus());
+  else if (!strcmp(argv[1], "batch"))
+    return bench_batch(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 64,
+		       argc > 4 ? strtoul(argv[4], NULL, 10)
+		       : threadpool_ncpus());
+  else if (!strcmp(argv[1], "pool"))
+    return bench_pool(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 100,
+		      argc > 4 ? argv[4] : "koren");
+  else if (!strcmp(argv[1], "robust"))
+    return bench_robust(argv[2], argc > 3 ? argv[3] : "koren",
+			argc > 4 ? strtoul(argv[4], NULL, 10) : 20);
+  else if (!strcmp(argv[1], "refit"))
+    return bench_refit(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 256);
+  else if (!strcmp(argv[1], "bootstrap"))
+    return bench_bootstrap(argv[2], argc > 3 ? argv[3] : "koren",
+			   argc > 4 ? strtoul(argv[4], NULL, 10) : 200,
+			   argc > 5 ? strtoul(argv[5], NULL, 10)
+			   : threadpool_ncpus());
+  else if (!strcmp(argv[1], "crossval"))
+    return bench_crossval(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 10,
+			  argc > 4 ? strtoul(argv[4], NULL, 10)
+			  : threadpool_ncpus(),
+			  (const char * const *)argv + 5,
+			  argc > 5 ? argc - 5 : 0);
+  else if (!strcmp(argv[1], "gof"))
+    return bench_gof(argv[2], argc > 3 ? argv[3] : "koren",
+		     argc > 4 ? strtoul(argv[4], NULL, 10) : 100);
+  else if (!strcmp(argv[1], "trust"))
+    return bench_trust(argv[2], argc > 3 ? argv[3] : "koren",
+		       argc > 4 ? strtoul(argv[4], NULL, 10) : 3);
+  else if (!strcmp(argv[1], "xml"))
+    return bench_xml(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 3);
+  else if (!strcmp(argv[1], "stream"))
+    return bench_stream(argv[2]);
+  else if (!strcmp(argv[1], "registry"))
+    return bench_registry(argv[2],
+			  argc > 3 ? strtoul(argv[3], NULL, 10) : 2,
+			  argc > 4 ? strtoul(argv[4], NULL, 10) : 1);
+
+  usage(argv[0]);
+  return 1;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    bench_gen
+ *
+ * DESCRIPTION:	    Writes a synthetic dataset of <rows> rows, in the format of
+ *		    data/12AX7-Data.csv, for benchmarking against. If the name
+ *		    ends in .xml the same rows are written in the format read
+ *		    by read_tuples_xml() instead.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to write.
+ *		    rows: (size_t) -- the number of rows to write.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    The plate current follows the quadratic surface that main
+ *		    fits, plus a little noise, so that fits converge.
+ ***/
+static int bench_gen(const char * filename, size_t rows)
+{
+  FILE * file = fopen(filename, "w");
+  if (file == NULL) {
+    perror(filename);
+    return 1;
+  }
+
+  size_t len = strlen(filename);
+  bool xml = len > 4 && !strcmp(filename + len - 4, ".xml");
+
+  srand(1);
+  fprintf(file, xml ? "<tuples>\n" : "# Ep, Eg, Ig, Ep^2, Eg^2\n");
+  for (size_t i = 0; i < rows; i++) {
+    double Ep = 300.0 * rand() / RAND_MAX;
+    double Eg = -4.0 * rand() / RAND_MAX;
+    double noise = 0.05 * ((double)rand() / RAND_MAX - 0.5);
+    double Ig = 1.4 * Eg + 0.011 * Ep + 0.06 * Eg * Eg + 1.5e-5 * Ep * Ep
+      + 0.3 + noise;
+    if (xml)
+      fprintf(file, "<tuple><dim val=\"%.6g\"/><dim val=\"%.6g\"/>"
+	      "<dim val=\"%.6g\"/><dim val=\"%.6g\"/><dim val=\"%.6g\"/>"
+	      "</tuple>\n", Ep, Eg, Ig, Ep * Ep, Eg * Eg);
+    else
+      fprintf(file, "%.6g,%.6g,%.6g,%.6g,%.6g\n", Ep, Eg, Ig, Ep * Ep,
+	      Eg * Eg);
+  }
+  if (xml)
+    fprintf(file, "</tuples>\n");
+
+  fclose(file);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_csv
+ *
+ * DESCRIPTION:	    Times read_tuples_csv() on <filename>.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to load. Pass
+ *			/dev/stdin with a pipe to exercise the stream path.
+ *		    n: (size_t) -- the size of the tuples.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int bench_csv(const char * filename, size_t n)
+{
+  csv_stats_t stats;
+  csv_options_t options = { .stats = &stats };
+  bench_sample_t sample;
+  bench_start(&sample);
+  gsl_matrix * matrix = read_tuples_csv_opt(filename, n, &options);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read tuples\n", filename);
+    return 1;
+  }
+  bench_report("read_tuples_csv", &sample,
+	       matrix->size1 * matrix->size2 * sizeof(double));
+  printf("rows: %zu\n", matrix->size1);
+  csv_stats_print(stdout, filename, &stats, CSV_STATS_TEXT);
+
+  gsl_matrix_free(matrix);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_columns
+ *
+ * DESCRIPTION:	    Times read_columns_csv() on <filename>, bypassing the
+ *		    cache. Compare against "csv" with every column to see what
+ *		    skipping the unwanted ones saves. Then loads the columns
+ *		    twice more through the cache, and checks that the second
+ *		    load was served from it, with the same tuples.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to load.
+ *		    names: (const char * const *) -- the columns to read.
+ *		    n: (size_t) -- the number of names.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    The first load through the cache writes it, if it wasn't
+ *		    current already.
+ ***/
+static int bench_columns(const char * filename, const char * const * names,
+			 size_t n)
+{
+  csv_stats_t stats;
+  csv_options_t options = { .no_cache = true, .stats = &stats };
+  bench_sample_t sample;
+  bench_start(&sample);
+  gsl_matrix * matrix = read_columns_csv(filename, names, n, &options);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+  bench_report("read_columns_csv", &sample,
+	       matrix->size1 * matrix->size2 * sizeof(double));
+  printf("rows: %zu\n", matrix->size1);
+  csv_stats_print(stdout, filename, &stats, CSV_STATS_TEXT);
+
+  options.no_cache = false;
+  gsl_matrix * cached = NULL;
+  for (int pass = 0; pass < 2; pass++) {
+    if (cached != NULL)
+      gsl_matrix_free(cached);
+    bench_start(&sample);
+    cached = read_columns_csv(filename, names, n, &options);
+    bench_report(pass == 0 ? "read_columns_csv, first through the cache"
+		 : "read_columns_csv, second through the cache", &sample, 0);
+    if (cached == NULL)
+      break;
+    csv_stats_print(stdout, filename, &stats, CSV_STATS_TEXT);
+  }
+
+  bool same = cached != NULL && stats.cached
+    && gsl_matrix_equal(cached, matrix);
+  printf("second load %s\n", same ? "served from the cache"
+	 : "NOT served from the cache, or differs");
+
+  if (cached != NULL)
+    gsl_matrix_free(cached);
+  gsl_matrix_free(matrix);
+  return !same;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_stats
+ *
+ * DESCRIPTION:	    Loads each file, bypassing the cache, and writes its
+ *		    ingestion stats to stdout as JSON Lines, one object per
+ *		    file, for collecting in a spreadsheet or a script.
+ *
+ * ARGUMENTS:	    n: (size_t) -- the size of the tuples.
+ *		    filenames: (char * const *) -- the files to load.
+ *		    count: (size_t) -- the number of files.
+ *
+ * RETURN:	    int -- 0 if every file loaded, 1 otherwise.
+ *
+ * NOTES:	    A file that fails to load is still reported, with what
+ *		    was read of it before the failure.
+ ***/
+static int bench_stats(size_t n, char * const * filenames, size_t count)
+{
+  int status = 0;
+  for (size_t i = 0; i < count; i++) {
+    csv_stats_t stats;
+    csv_options_t options = { .no_cache = true, .stats = &stats };
+    gsl_matrix * matrix = read_tuples_csv_opt(filenames[i], n, &options);
+    if (matrix == NULL) {
+      fprintf(stderr, "%s: could not read tuples\n", filenames[i]);
+      status = 1;
+    }
+    csv_stats_print(stdout, filenames[i], &stats, CSV_STATS_JSON);
+    gsl_matrix_free(matrix);
+  }
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_jacobian
+ *
+ * DESCRIPTION:	    Checks surface_df() against central differences of
+ *		    surface_f(), then fits <filename> with the finite
+ *		    difference Jacobian and with surface_df(), and reports
+ *		    the evaluations and time each fit took.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			the columns in fit_columns, as "gen" writes.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read or
+ *		    the Jacobians disagree.
+ *
+ * NOTES:	    The check is made away from the solution, at x = 1, where
+ *		    every column of the Jacobian matters.
+ ***/
+static int bench_jacobian(const char * filename)
+{
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_NCOLUMNS,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = { .empirical_data = matrix };
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+
+  /* Check both layouts: the matrix, and the columns the fits use. */
+  double worst = bench_jacobian_error(&data);
+  data.samples = samples;
+  double columns = bench_jacobian_error(&data);
+  printf("jacobian: worst error against central differences %.3g on the "
+	 "matrix, %.3g on columns\n", worst, columns);
+  if (worst > 1e-8 || columns > 1e-8) {
+    fprintf(stderr, "%s: surface_df() disagrees with surface_f()\n",
+	    filename);
+    fit_samples_free(samples);
+    gsl_matrix_free(matrix);
+    return 1;
+  }
+
+  double fd = bench_nlinear(&data, false);
+  double analytic = bench_nlinear(&data, true);
+  printf("speedup: %.2fx\n", fd / analytic);
+
+  fit_samples_free(samples);
+  gsl_matrix_free(matrix);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_jacobian_error
+ *
+ * DESCRIPTION:	    Compares surface_df() with central differences of
+ *		    surface_f() at x = 1.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- the data, with or without samples.
+ *
+ * RETURN:	    double -- the worst difference, relative to the size of
+ *		    the residual.
+ *
+ * NOTES:	    The residuals are linear in x, so central differences are
+ *		    exact up to rounding.
+ ***/
+static double bench_jacobian_error(fit_data_t * data)
+{
+  const size_t n = data->empirical_data->size1, p = 5;
+  double init[5] = {1.0, 1.0, 1.0, 1.0, 1.0};
+  gsl_vector_view x = gsl_vector_view_array(init, p);
+  gsl_matrix * J = gsl_matrix_alloc(n, p);
+  gsl_vector * fplus = gsl_vector_alloc(n);
+  gsl_vector * fminus = gsl_vector_alloc(n);
+  surface_df(&x.vector, data, J);
+
+  double worst = 0.0;
+  for (size_t j = 0; j < p; j++) {
+    const double h = 1e-3;
+    init[j] = 1.0 + h;
+    surface_f(&x.vector, data, fplus);
+    init[j] = 1.0 - h;
+    surface_f(&x.vector, data, fminus);
+    init[j] = 1.0;
+    for (size_t i = 0; i < n; i++) {
+      double fd = (gsl_vector_get(fplus, i) - gsl_vector_get(fminus, i))
+	/ (2 * h);
+      double scale = fabs(gsl_vector_get(fplus, i)) + 1.0;
+      double error = fabs(fd - gsl_matrix_get(J, i, j)) / scale;
+      if (error > worst)
+	worst = error;
+    }
+  }
+
+  gsl_matrix_free(J);
+  gsl_vector_free(fplus);
+  gsl_vector_free(fminus);
+  return worst;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_nlinear
+ *
+ * DESCRIPTION:	    Fits the surface to data->empirical_data as fit_surface()
+ *		    does, with either Jacobian, and prints the iterations,
+ *		    evaluations and wall time of the fit.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- the data to fit.
+ *		    analytic: (bool) -- use surface_df() rather than finite
+ *			differences.
+ *
+ * RETURN:	    double -- the wall time of the fit, in seconds.
+ *
+ * NOTES:	    none.
+ ***/
+static double bench_nlinear(fit_data_t * data, bool analytic)
+{
+  double init[5] = {1.0, 1.0, 1.0, 1.0, 1.0};
+  gsl_vector_view x = gsl_vector_view_array(init, 5);
+  gsl_multifit_nlinear_parameters params =
+    gsl_multifit_nlinear_default_parameters();
+  gsl_multifit_nlinear_fdf fdf = {
+    .f = surface_f,
+    .df = analytic ? surface_df : NULL,
+    .fvv = NULL,
+    .n = data->empirical_data->size1,
+    .p = 5,
+    .params = data
+  };
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  gsl_multifit_nlinear_workspace * w =
+    gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &params, fdf.n,
+			       fdf.p);
+  gsl_multifit_nlinear_winit(&x.vector, NULL, &fdf, w);
+  int info;
+  gsl_multifit_nlinear_driver(20, 1e-8, 1e-8, 0.0, NULL, NULL, &info, w);
+  double seconds = bench_seconds(&start);
+
+  printf("%s jacobian: %zu iterations, nevalf %zu, nevaldf %zu, %.6f s\n",
+	 analytic ? "analytic" : "finite difference",
+	 gsl_multifit_nlinear_niter(w), fdf.nevalf, fdf.nevaldf, seconds);
+  gsl_multifit_nlinear_free(w);
+  return seconds;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_linear
+ *
+ * DESCRIPTION:	    Fits <filename> with fit_surface() by the trust region
+ *		    method and by direct linear least squares, and reports the
+ *		    time each took and how far apart their coefficients are,
+ *		    in units of their errors.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			the columns in fit_columns.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    The fit logs go to /dev/null. Both fits are given the
+ *		    samples, as main gives them, so neither pays to make them.
+ ***/
+static int bench_linear(const char * filename)
+{
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_NCOLUMNS,
+					 NULL);
+  FILE * devnull = fopen("/dev/null", "w");
+  if (matrix == NULL || devnull == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    gsl_matrix_free(matrix);
+    if (devnull != NULL) fclose(devnull);
+    return 1;
+  }
+
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+  static const fit_solver_t solvers[] = {
+    FIT_SOLVER_NONLINEAR, FIT_SOLVER_LINEAR
+  };
+  static const char * const names[] = { "trust region", "linear" };
+  fit_param_t * coefficients[2] = {NULL};
+  double seconds[2];
+  int status = 0;
+  for (int k = 0; k < 2; k++) {
+    double init[5] = {1.0, 1.0, 1.0, 1.0, 1.0};
+    fit_data_t data = {
+      .initial_values = init,
+      .empirical_data = matrix,
+      .solver = solvers[k],
+      .samples = samples
+    };
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (fit_surface(&data, false, devnull) != 0)
+      status = 1;
+    seconds[k] = bench_seconds(&start);
+    coefficients[k] = data.coefficients;
+    printf("%s: %.6f s\n", names[k], seconds[k]);
+  }
+
+  if (status == 0) {
+    double worst = 0.0;
+    for (size_t i = 0; i < 5; i++) {
+      double d = fabs(coefficients[0][i].value - coefficients[1][i].value)
+	/ coefficients[1][i].error;
+      if (d > worst)
+	worst = d;
+    }
+    printf("speedup: %.1fx, largest difference %.3g errors\n",
+	   seconds[0] / seconds[1], worst);
+  }
+
+  free(coefficients[0]);
+  free(coefficients[1]);
+  fit_samples_free(samples);
+  fclose(devnull);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_residual
+ *
+ * DESCRIPTION:	    Times surface_f() on the row-major matrix, which is the
+ *		    scalar reference, then each residual kernel this CPU
+ *		    supports on the same data in columns, and checks every
+ *		    kernel against the reference.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			the columns in fit_columns.
+ *		    reps: (size_t) -- evaluations to time of each.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read or a
+ *		    kernel disagrees with the reference.
+ *
+ * NOTES:	    Disagreement is measured relative to the largest term of
+ *		    the sum, since the FMA kernels round differently.
+ ***/
+static int bench_residual(const char * filename, size_t reps)
+{
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_NCOLUMNS,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  size_t n = matrix->size1;
+  fit_data_t data = { .empirical_data = matrix };
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+  double b[5] = {1.4, 0.011, 0.06, 1.5e-5, 0.3};
+  gsl_vector_view x = gsl_vector_view_array(b, 5);
+  gsl_vector * reference = gsl_vector_alloc(n);
+  gsl_vector * f = gsl_vector_alloc(n);
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t r = 0; r < reps; r++)
+    surface_f(&x.vector, &data, reference);
+  double base = bench_seconds(&start) / reps;
+  printf("reference: %.3f ms per evaluation\n", base * 1e3);
+
+  int status = 0;
+  for (int isa = 0; isa < RESIDUAL_NISAS; isa++) {
+    if (!residual_isa_supported(isa))
+      continue;
+
+    const double * const * col = (const double * const *)samples->column;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < reps; r++)
+      residual_surface_isa(isa, col[FIT_EP], col[FIT_EG], col[FIT_IG],
+			   col[FIT_EP2], col[FIT_EG2], b, f->data, n);
+    double seconds = bench_seconds(&start) / reps;
+
+    double worst = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      double scale = fabs(b[3] * col[FIT_EP2][i]) + fabs(b[1] * col[FIT_EP][i])
+	+ fabs(gsl_matrix_get(matrix, i, FIT_IG)) + 1.0;
+      double error = fabs(gsl_vector_get(f, i)
+			  - gsl_vector_get(reference, i)) / scale;
+      if (error > worst)
+	worst = error;
+    }
+    printf("%-8s %.3f ms per evaluation, %.2fx, worst error %.3g\n",
+	   residual_isa_name(isa), seconds * 1e3, base / seconds, worst);
+    if (worst > 1e-14)
+      status = 1;
+  }
+
+  printf("dispatch: %s\n", residual_isa_name(residual_isa()));
+  gsl_vector_free(reference);
+  gsl_vector_free(f);
+  fit_samples_free(samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_model
+ *
+ * DESCRIPTION:	    For each model, times the residuals with the kernel the
+ *		    model is specialized for and with the generic kernel,
+ *		    checks that they agree, and fits the model to <filename>
+ *		    by linear least squares, reporting the time and the RMS
+ *		    residual of the fit.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			the columns in fit_columns.
+ *		    reps: (size_t) -- evaluations to time of each kernel.
+ *		    specs: (const char * const *) -- the models, as described
+ *			at poly_parse().
+ *		    count: (size_t) -- the number of models, or 0 for the
+ *			degrees 1 to 4, with and without cross terms, and a
+ *			set of terms no kernel is specialized for.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, a
+ *		    model is invalid or a kernel disagrees with the generic
+ *		    one.
+ *
+ * NOTES:	    The quadratic kernel rounds differently, so agreement is
+ *		    measured relative to the largest term of the sum.
+ ***/
+static int bench_model(const char * filename, size_t reps,
+		       const char * const * specs, size_t count)
+{
+  static const char * const sweep[] = {
+    "1", "2", "3", "4", "2x", "3x", "4x", "Eg,Ep,Eg*Ep,Ep^3,1"
+  };
+  if (count == 0) {
+    specs = sweep;
+    count = sizeof(sweep) / sizeof(sweep[0]);
+  }
+
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_NCOLUMNS,
+					 NULL);
+  FILE * devnull = fopen("/dev/null", "w");
+  if (matrix == NULL || devnull == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    gsl_matrix_free(matrix);
+    if (devnull != NULL) fclose(devnull);
+    return 1;
+  }
+
+  size_t n = matrix->size1;
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+  const double * const * col = (const double * const *)samples->column;
+  double * f = malloc(n * sizeof(double));
+  double * reference = malloc(n * sizeof(double));
+  int status = 0;
+  for (size_t m = 0; m < count; m++) {
+    poly_model_t model, generic;
+    if (poly_parse(&model, specs[m]) != 0) {
+      fprintf(stderr, "%s: not a valid model\n", specs[m]);
+      status = 1;
+      continue;
+    }
+    generic = model;
+    generic.kernel = POLY_KERNEL_GENERIC;
+
+    /* Small coefficients for the high powers keep every term in range. */
+    double b[POLY_MAX_TERMS];
+    for (size_t t = 0; t < model.nterms; t++)
+      b[t] = 1.0 / (1.0 + pow(100.0, model.term[t].ep)
+		    + pow(10.0, model.term[t].eg));
+
+    double seconds[2];
+    const poly_model_t * models[2] = { &generic, &model };
+    double * out[2] = { reference, f };
+    for (int k = 0; k < 2; k++) {
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (size_t r = 0; r < reps; r++)
+	poly_residuals(models[k], col[FIT_EP], col[FIT_EG], col[FIT_IG],
+		       col[FIT_EP2], col[FIT_EG2], b, out[k], n);
+      seconds[k] = bench_seconds(&start) / reps;
+    }
+
+    double worst = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      double x[POLY_MAX_TERMS], scale = fabs(col[FIT_IG][i]) + 1.0;
+      poly_basis(&model, col[FIT_EP][i], col[FIT_EG][i], col[FIT_EP2][i],
+		 col[FIT_EG2][i], x);
+      for (size_t t = 0; t < model.nterms; t++)
+	scale += fabs(b[t] * x[t]);
+      double error = fabs(f[i] - reference[i]) / scale;
+      if (error > worst)
+	worst = error;
+    }
+    if (worst > 1e-14)
+      status = 1;
+
+    fit_data_t data = {
+      .empirical_data = matrix,
+      .solver = FIT_SOLVER_LINEAR,
+      .samples = samples,
+      .model = &model
+    };
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int fitted = fit_surface(&data, false, devnull);
+    double fit_seconds = bench_seconds(&start);
+    double rms = NAN;
+    if (fitted == 0) {
+      for (size_t t = 0; t < model.nterms; t++)
+	b[t] = data.coefficients[t].value;
+      poly_residuals(&model, col[FIT_EP], col[FIT_EG], col[FIT_IG],
+		     col[FIT_EP2], col[FIT_EG2], b, f, n);
+      double sum = 0.0;
+      for (size_t i = 0; i < n; i++)
+	sum += f[i] * f[i];
+      rms = sqrt(sum / n);
+    }
+    fit_coefficients_free(&data);
+
+    printf("%-20s %2zu terms, %-22s %.3f ms, generic %.3f ms, %.2fx, "
+	   "worst error %.3g; fit %.3f ms, rms %.4g\n",
+	   specs[m], model.nterms, poly_kernel_name(model.kernel),
+	   seconds[1] * 1e3, seconds[0] * 1e3, seconds[0] / seconds[1],
+	   worst, fit_seconds * 1e3, rms);
+  }
+
+  free(f);
+  free(reference);
+  fit_samples_free(samples);
+  fclose(devnull);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_triode
+ *
+ * DESCRIPTION:	    For each triode model, checks the analytic gradient and
+ *		    second directional derivative against finite differences
+ *		    on every sample of <filename>, then fits the model with
+ *		    and without geodesic acceleration and reports the
+ *		    iterations, evaluations and wall time of each.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read or a
+ *		    derivative disagrees with its finite difference.
+ *
+ * NOTES:	    The derivatives are checked at each model's starting
+ *		    point.
+ ***/
+static int bench_triode(const char * filename)
+{
+  static const triode_model_t * const triodes[] = {
+    &triode_koren, &triode_child_langmuir, &triode_dempwolf
+  };
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  int status = 0;
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+  for (size_t m = 0; m < sizeof(triodes) / sizeof(triodes[0]); m++) {
+    const triode_model_t * triode = triodes[m];
+    double grad = bench_triode_error(triode, matrix, false);
+    double vv = bench_triode_error(triode, matrix, true);
+    printf("%s: worst error against finite differences %.3g in the "
+	   "gradient, %.3g in fvv\n", triode->name, grad, vv);
+    if (grad > 1e-5 || vv > 1e-3)
+      status = 1;
+
+    fit_data_t data = {
+      .empirical_data = matrix,
+      .samples = samples,
+      .triode = triode
+    };
+    bench_triode_fit(triode, &data, false);
+    bench_triode_fit(triode, &data, true);
+  }
+
+  fit_samples_free(samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_triode_error
+ *
+ * DESCRIPTION:	    Compares a model's gradient with central differences of
+ *		    its value, or its second directional derivative with
+ *		    second differences along the same direction.
+ *
+ * ARGUMENTS:	    triode: (const triode_model_t *) -- the model.
+ *		    matrix: (const gsl_matrix *) -- the samples.
+ *		    second: (bool) -- check the second derivative.
+ *
+ * RETURN:	    double -- the worst difference, relative to the largest
+ *		    derivative over the samples.
+ *
+ * NOTES:	    The direction changes each coefficient by a percent, with
+ *		    alternating signs, so every cross term contributes.
+ *		    Samples where the differences reach cutoff are skipped,
+ *		    since the models aren't differentiable there; just above
+ *		    it, the second differences of the Child-Langmuir law
+ *		    converge slowly, which is why fvv is held to less.
+ ***/
+static double bench_triode_error(const triode_model_t * triode,
+				 const gsl_matrix * matrix, bool second)
+{
+  const double * b = triode->initial;
+  size_t p = triode->p, n = matrix->size1;
+  double v[TRIODE_MAX_PARAMS], plus[TRIODE_MAX_PARAMS],
+    minus[TRIODE_MAX_PARAMS];
+  for (size_t j = 0; j < p; j++)
+    v[j] = (j % 2 ? -0.01 : 0.01) * b[j];
+
+  double worst = 0.0;
+  for (size_t j = 0; j < (second ? 1 : p); j++) {
+    double largest = 0.0, error = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      double ep = gsl_matrix_get(matrix, i, FIT_EP);
+      double eg = gsl_matrix_get(matrix, i, FIT_EG);
+      double exact, fd, yplus, yminus;
+      if (second) {
+	const double t = 1e-3;
+	for (size_t k = 0; k < p; k++) {
+	  plus[k] = b[k] + t * v[k];
+	  minus[k] = b[k] - t * v[k];
+	}
+	exact = triode->eval_vv(b, v, ep, eg);
+	yplus = triode->eval(plus, ep, eg, NULL);
+	yminus = triode->eval(minus, ep, eg, NULL);
+	fd = (yplus - 2.0 * triode->eval(b, ep, eg, NULL) + yminus) / (t * t);
+      } else {
+	double g[TRIODE_MAX_PARAMS], h = 1e-6 * fabs(b[j]);
+	memcpy(plus, b, p * sizeof(double));
+	memcpy(minus, b, p * sizeof(double));
+	plus[j] += h;
+	minus[j] -= h;
+	triode->eval(b, ep, eg, g);
+	exact = g[j];
+	yplus = triode->eval(plus, ep, eg, NULL);
+	yminus = triode->eval(minus, ep, eg, NULL);
+	fd = (yplus - yminus) / (2.0 * h);
+      }
+      if (yplus == 0.0 || yminus == 0.0)
+	continue;
+      if (fabs(exact) > largest)
+	largest = fabs(exact);
+      if (fabs(fd - exact) > error)
+	error = fabs(fd - exact);
+    }
+    if (largest > 0.0 && error / largest > worst)
+      worst = error / largest;
+  }
+  return worst;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_triode_fit
+ *
+ * DESCRIPTION:	    Fits a triode model by the trust region method from its
+ *		    starting point, as fit_surface() does, and prints the
+ *		    iterations, evaluations, final cost and wall time.
+ *
+ * ARGUMENTS:	    triode: (const triode_model_t *) -- the model.
+ *		    data: (fit_data_t *) -- the data, with data->triode set.
+ *		    accel: (bool) -- use geodesic acceleration.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void bench_triode_fit(const triode_model_t * triode,
+			     fit_data_t * data, bool accel)
+{
+  gsl_vector_const_view x = gsl_vector_const_view_array(triode->initial,
+							 triode->p);
+  gsl_multifit_nlinear_parameters params =
+    gsl_multifit_nlinear_default_parameters();
+  if (accel)
+    params.trs = gsl_multifit_nlinear_trs_lmaccel;
+  gsl_multifit_nlinear_fdf fdf = {
+    .f = triode_f,
+    .df = triode_df,
+    .fvv = accel ? triode_fvv : NULL,
+    .n = data->empirical_data->size1,
+    .p = triode->p,
+    .params = data
+  };
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  gsl_multifit_nlinear_workspace * w =
+    gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &params, fdf.n,
+			       fdf.p);
+  gsl_multifit_nlinear_winit(&x.vector, NULL, &fdf, w);
+  int info;
+  int status = gsl_multifit_nlinear_driver(100, 1e-8, 1e-8, 0.0, NULL, NULL,
+					   &info, w);
+  double seconds = bench_seconds(&start);
+
+  double chisq;
+  gsl_vector * f = gsl_multifit_nlinear_residual(w);
+  gsl_blas_ddot(f, f, &chisq);
+  printf("  %-12s %3zu iterations, nevalf %3zu, nevaldf %3zu, nevalfvv %3zu, "
+	 "|f| %.6g, %.6f s, %s\n", accel ? "accelerated" : "plain",
+	 gsl_multifit_nlinear_niter(w), fdf.nevalf, fdf.nevaldf,
+	 fdf.nevalfvv, sqrt(chisq), seconds, gsl_strerror(status));
+  gsl_multifit_nlinear_free(w);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_multistart
+ *
+ * DESCRIPTION:	    Fits a triode model from <starts> Latin hypercube starts
+ *		    on 1, 2, 4, ... up to <max> threads, and reports the wall
+ *		    time and speedup over one thread, then the outcome of
+ *		    each start.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    name: (const char *) -- the triode model.
+ *		    starts: (size_t) -- the number of starts.
+ *		    max: (size_t) -- the most threads to try.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, the
+ *		    model doesn't exist, or the best fit depends on the
+ *		    number of threads.
+ *
+ * NOTES:	    The starts are seeded the same way for every run, so
+ *		    every run should find the same best fit.
+ ***/
+static int bench_multistart(const char * filename, const char * name,
+			    size_t starts, size_t max)
+{
+  const triode_model_t * triode = triode_find(name);
+  if (triode == NULL) {
+    fprintf(stderr, "%s: no such triode model\n", name);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .triode = triode
+  };
+  multistart_options_t options = {
+    .starts = starts,
+    .sampling = MULTISTART_LHS,
+    .seed = 1
+  };
+
+  int status = 0;
+  double single = 0.0, best = 0.0;
+  multistart_t * last = NULL;
+  for (size_t threads = 1; threads <= max; threads *= 2) {
+    options.threads = threads;
+    multistart_t * result = multistart_fit(&data, &options);
+    fit_coefficients_free(&data);
+    if (result == NULL) {
+      fprintf(stderr, "%s: no start could be fitted\n", triode->name);
+      status = 1;
+      break;
+    }
+
+    double chisq = result->start[result->best].chisq;
+    if (threads == 1) {
+      single = result->seconds;
+      best = chisq;
+    } else if (chisq != best) {
+      status = 1;
+    }
+    printf("%s, %zu starts, %2zu threads: %.6f s, speedup %.2fx, "
+	   "best chisq %.6g\n", triode->name, result->starts, threads,
+	   result->seconds, single / result->seconds, chisq);
+    multistart_free(last);
+    last = result;
+  }
+
+  if (last != NULL) {
+    multistart_print(last, &data, stdout);
+    multistart_free(last);
+  }
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_batch
+ *
+ * DESCRIPTION:	    Fits <count> copies of <filename> with batch_fit() on 1,
+ *		    2, 4, ... up to <max> threads, and reports the wall time,
+ *		    speedup over one thread and steals of each. The copies
+ *		    cycle through the three triode models and the quadratic
+ *		    surface, so the fits take unequal times, and every
+ *		    outcome is checked against the same fit made alone.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    count: (size_t) -- the number of fits.
+ *		    max: (size_t) -- the most threads to try.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read or a
+ *		    fit in a batch differs from the fit made alone.
+ *
+ * NOTES:	    The copies share one matrix and one set of samples, which
+ *		    the fits only read. Finally, the batch is fitted on at
+ *		    least two threads with all but one of them unable to make
+ *		    a context, when every fit must still succeed, then with
+ *		    none able to, when every fit must fail.
+ ***/
+static int bench_batch(const char * filename, size_t count, size_t max)
+{
+  static const triode_model_t * const triodes[] = {
+    &triode_koren, &triode_child_langmuir, &triode_dempwolf, NULL
+  };
+  const size_t nmodels = sizeof(triodes) / sizeof(triodes[0]);
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_samples_t * samples = fit_samples_alloc(matrix);
+  fit_data_t data[sizeof(triodes) / sizeof(triodes[0])];
+  fit_result_t alone[sizeof(triodes) / sizeof(triodes[0])];
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  batch_item_t * items = calloc(count, sizeof(batch_item_t));
+  record_size = true;
+  fit_context_free(fit_context_alloc(NULL, false));
+  if (samples == NULL || ctx == NULL || items == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  for (size_t m = 0; m < nmodels; m++) {
+    data[m] = (fit_data_t){
+      .empirical_data = matrix,
+      .samples = samples,
+      .triode = triodes[m]
+    };
+    fit_context_fit(ctx, &data[m]);
+    alone[m] = *fit_context_result(ctx);
+  }
+  for (size_t i = 0; i < count; i++)
+    items[i].data = &data[i % nmodels];
+
+  int status = 0;
+  double single = 0.0;
+  for (size_t threads = 1; threads <= max; threads *= 2) {
+    batch_options_t options = { .threads = threads };
+    batch_stats_t stats;
+    size_t failed = batch_fit(items, count, &options, &stats);
+
+    size_t differ = 0;
+    for (size_t i = 0; i < count; i++) {
+      const fit_result_t * r = &items[i].result;
+      const fit_result_t * a = &alone[i % nmodels];
+      if (r->p != a->p || r->chisq != a->chisq)
+	differ++;
+      for (size_t j = 0; j < r->p && j < a->p; j++)
+	if (r->coefficients[j].value != a->coefficients[j].value)
+	  differ++;
+    }
+    if (differ > 0)
+      status = 1;
+
+    if (threads == 1)
+      single = stats.seconds;
+    printf("%zu fits, %2zu threads: %.6f s, speedup %.2fx, %zu steals, "
+	   "%zu failed, %zu differ\n", count, stats.threads, stats.seconds,
+	   single / stats.seconds, stats.steals, failed, differ);
+  }
+
+  /* Without glibc's hooks, no allocation can be made to fail. */
+  size_t threads = max > 2 ? max : 2;
+  for (size_t fails = threads - 1; fail_size > 0 && fails <= threads;
+       fails++) {
+    batch_options_t options = { .threads = threads };
+    batch_stats_t stats;
+    __atomic_store_n(&fail_contexts, fails, __ATOMIC_RELAXED);
+    size_t failed = batch_fit(items, count, &options, &stats);
+    __atomic_store_n(&fail_contexts, 0, __ATOMIC_RELAXED);
+
+    size_t expect = fails < threads ? 0 : count;
+    if (failed != expect || stats.contexts != threads - fails)
+      status = 1;
+    printf("%zu fits, %2zu threads, %zu with a context: %zu failed, "
+	   "expected %zu\n", count, stats.threads, stats.contexts, failed,
+	   expect);
+  }
+
+  free(items);
+  fit_context_free(ctx);
+  fit_samples_free(samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_pool
+ *
+ * DESCRIPTION:	    Fits the same data <fits> times in one context, and
+ *		    reports the allocations made by the first fit, which fills
+ *		    the context's pool, and per fit after it; then the same
+ *		    for fit_surface(), which has no pool to keep, and the
+ *		    pool's statistics. Finally, checks that a pool given
+ *		    more shapes than it keeps frees the least recently used.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    fits: (size_t) -- the number of fits.
+ *		    spec: (const char *) -- a triode model, or a surface as
+ *			described at poly_parse().
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, the
+ *		    model doesn't exist, a warm fit allocated, or the pool
+ *		    kept the wrong buffers.
+ *
+ * NOTES:	    The samples are made beforehand, as batch_fit() and
+ *		    multistart_fit() share them between fits.
+ ***/
+static int bench_pool(const char * filename, size_t fits, const char * spec)
+{
+  poly_model_t model;
+  const triode_model_t * triode = triode_find(spec);
+  if (triode == NULL && poly_parse(&model, spec) != 0) {
+    fprintf(stderr, "%s: no such model\n", spec);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .model = triode ? NULL : &model,
+    .triode = triode
+  };
+  fit_pool_t * pool = fit_pool_alloc();
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  FILE * devnull = fopen("/dev/null", "w");
+  if (data.samples == NULL || pool == NULL || ctx == NULL
+      || devnull == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  fit_context_set_pool(ctx, pool);
+  if (fits < 2)
+    fits = 2;
+
+  bench_sample_t sample;
+  bench_start(&sample);
+  fit_context_fit(ctx, &data);
+  bench_report("pooled fit, cold", &sample, 0);
+  double chisq = fit_context_result(ctx)->chisq;
+
+  size_t differ = 0;
+  bench_start(&sample);
+  for (size_t i = 1; i < fits; i++) {
+    fit_context_fit(ctx, &data);
+    if (fit_context_result(ctx)->chisq != chisq)
+      differ++;
+  }
+  size_t warm = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED)
+    - sample.allocs;
+  bench_report("pooled fits, warm", &sample, 0);
+  printf("  allocations per fit: %.2f\n", (double)warm / (fits - 1));
+
+  bench_start(&sample);
+  for (size_t i = 1; i < fits; i++)
+    fit_surface(&data, false, devnull);
+  size_t allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED)
+    - sample.allocs;
+  bench_report("fit_surface()", &sample, 0);
+  printf("  allocations per fit: %.2f\n", (double)allocs / (fits - 1));
+
+  fit_pool_stats_t stats;
+  fit_pool_stats(pool, &stats);
+  printf("pool: %zu entries, %zu hits, %zu misses, %zu differ\n",
+	 stats.entries, stats.hits, stats.misses, differ);
+
+  /* Twice as many shapes as the pool keeps: the newest half stay. */
+  fit_pool_t * bounded = fit_pool_alloc();
+  size_t shapes = 2 * FIT_POOL_MAX_ENTRIES;
+  for (size_t k = 1; bounded != NULL && k <= shapes + 2; k++) {
+    size_t n = k <= shapes ? k : k == shapes + 1 ? shapes : 1;
+    fit_pool_release(bounded, fit_pool_acquire(bounded, NULL, n, 2));
+  }
+  fit_pool_stats_t bound = {0};
+  if (bounded != NULL)
+    fit_pool_stats(bounded, &bound);
+  bool evicted = bound.entries == FIT_POOL_MAX_ENTRIES
+    && bound.hits == 1 && bound.misses == shapes + 1
+    && bound.evictions == shapes + 1 - FIT_POOL_MAX_ENTRIES;
+  printf("bounded pool, %zu shapes: %zu entries, %zu hits, %zu misses, "
+	 "%zu evictions%s\n", shapes, bound.entries, bound.hits,
+	 bound.misses, bound.evictions, evicted ? "" : ", NOT least recent");
+  fit_pool_free(bounded);
+
+  fclose(devnull);
+  fit_coefficients_free(&data);
+  fit_context_free(ctx);
+  fit_pool_free(pool);
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return differ > 0 || warm > 0 || !evicted;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_robust
+ *
+ * DESCRIPTION:	    Fits the data as read, then with a spike of ten times the
+ *		    plate current in every <every>th sample, by least squares
+ *		    and with each loss. Reports how far each fit of the spiked
+ *		    data lands from the fit of the clean data, and what it
+ *		    cost as a multiple of the plain fit, both in evaluations
+ *		    and in wall time.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    spec: (const char *) -- a triode model, or a surface as
+ *			described at poly_parse().
+ *		    every: (size_t) -- spike one sample in this many.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, the
+ *		    model doesn't exist, or a fit failed.
+ *
+ * NOTES:	    The distance is the largest change of a coefficient,
+ *		    relative to its size in the clean fit.
+ ***/
+static int bench_robust(const char * filename, const char * spec,
+			size_t every)
+{
+  static const robust_loss_t losses[] = {
+    ROBUST_NONE, ROBUST_HUBER, ROBUST_TUKEY
+  };
+  poly_model_t model;
+  const triode_model_t * triode = triode_find(spec);
+  if (triode == NULL && poly_parse(&model, spec) != 0) {
+    fprintf(stderr, "%s: no such model\n", spec);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .model = triode ? NULL : &model,
+    .triode = triode
+  };
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  if (data.samples == NULL || ctx == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  if (fit_context_fit(ctx, &data) != 0) {
+    fprintf(stderr, "%s: the clean data couldn't be fitted\n", spec);
+    return 1;
+  }
+  fit_result_t clean = *fit_context_result(ctx);
+
+  size_t spikes = 0;
+  if (every == 0)
+    every = 20;
+  for (size_t i = every / 2; i < matrix->size1; i += every, spikes++)
+    gsl_matrix_set(matrix, i, FIT_IG, 10 * gsl_matrix_get(matrix, i, FIT_IG));
+  fit_samples_free(data.samples);
+  data.samples = fit_samples_alloc(matrix);
+  printf("%s: %zu samples, %zu spiked\n", spec, matrix->size1, spikes);
+
+  int status = 0;
+  double plain = 0.0;
+  for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+    data.loss = losses[l];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int fitted = fit_context_fit(ctx, &data);
+    double seconds = bench_seconds(&start);
+    const fit_result_t * result = fit_context_result(ctx);
+    if (fitted != 0) {
+      printf("  %-13s failed\n", robust_name(losses[l]));
+      status = 1;
+      continue;
+    }
+
+    double distance = 0.0;
+    for (size_t j = 0; j < result->p; j++) {
+      double b = clean.coefficients[j].value;
+      double d = fabs(result->coefficients[j].value - b)
+	/ (fabs(b) > 0 ? fabs(b) : 1.0);
+      if (d > distance)
+	distance = d;
+    }
+    if (losses[l] == ROBUST_NONE)
+      plain = seconds;
+    printf("  %-13s distance %.3e, %2zu reweights, %4zu outliers, "
+	   "cost %5.2fx, %.6f s (%.2fx)\n", robust_name(losses[l]),
+	   distance, result->reweights, result->outliers, result->cost,
+	   seconds, seconds / plain);
+  }
+
+  fit_context_free(ctx);
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_refit
+ *
+ * DESCRIPTION:	    Fits the first half of the rows of a file incrementally,
+ *		    then appends the rest <chunk> rows at a time, then slides
+ *		    a window of the same size over the rows by removing as
+ *		    many from the front as it appends. Each step is solved
+ *		    and compared with a fit of the same rows from scratch;
+ *		    the time of a step is reported with that of the fit
+ *		    from scratch, for windows of growing size.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    chunk: (size_t) -- the rows added or removed per step.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read or an
+ *		    incremental fit strays from the fit from scratch by more
+ *		    than 1e-6.
+ *
+ * NOTES:	    The surface is poly_quadratic.
+ ***/
+static int bench_refit(const char * filename, size_t chunk)
+{
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+  size_t n = matrix->size1;
+  if (chunk == 0 || chunk > n / 4)
+    chunk = n / 4 > 0 ? n / 4 : 1;
+
+  refit_t * refit = refit_alloc(NULL);
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  if (refit == NULL || ctx == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  size_t half = n / 2;
+  gsl_matrix_view rows = gsl_matrix_submatrix(matrix, 0, 0, half,
+					      matrix->size2);
+  refit_add(refit, &rows.matrix);
+
+  /* Append the rest, then slide the window. */
+  int status = 0;
+  double update = 0.0, scratch = 0.0, worst = 0.0;
+  size_t steps = 0;
+  for (size_t first = 0, last = half; last + chunk <= n; last += chunk) {
+    bool slide = last >= n - n / 4;
+    fit_result_t result;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rows = gsl_matrix_submatrix(matrix, last, 0, chunk, matrix->size2);
+    refit_add(refit, &rows.matrix);
+    if (slide) {
+      rows = gsl_matrix_submatrix(matrix, first, 0, chunk, matrix->size2);
+      if (refit_remove(refit, &rows.matrix) != 0) {
+	fprintf(stderr, "rows %zu-%zu couldn't be removed\n", first,
+		first + chunk);
+	status = 1;
+	break;
+      }
+      first += chunk;
+    }
+    refit_solve(refit, &result, NULL);
+    update += bench_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rows = gsl_matrix_submatrix(matrix, first, 0, last + chunk - first,
+				matrix->size2);
+    fit_data_t data = { .empirical_data = &rows.matrix };
+    fit_context_fit(ctx, &data);
+    scratch += bench_seconds(&start);
+
+    double distance = bench_refit_distance(&result, fit_context_result(ctx));
+    if (distance > worst)
+      worst = distance;
+    steps++;
+  }
+  if (worst > 1e-6)
+    status = 1;
+  printf("%zu steps of %zu rows, %zu rows at the end: update %.3e s, "
+	 "from scratch %.3e s per step (%.1fx); worst distance %.3e\n",
+	 steps, chunk, refit_rows(refit), update / steps, scratch / steps,
+	 scratch / update, worst);
+
+  /* The time of one step, by the size of the fit it updates. */
+  for (size_t size = n / 8; size + chunk <= n; size *= 2) {
+    refit_t * sized = refit_alloc(NULL);
+    if (sized == NULL)
+      break;
+    rows = gsl_matrix_submatrix(matrix, 0, 0, size, matrix->size2);
+    refit_add(sized, &rows.matrix);
+
+    fit_result_t result;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rows = gsl_matrix_submatrix(matrix, size, 0, chunk, matrix->size2);
+    refit_add(sized, &rows.matrix);
+    refit_solve(sized, &result, NULL);
+    double seconds = bench_seconds(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rows = gsl_matrix_submatrix(matrix, 0, 0, size + chunk, matrix->size2);
+    fit_data_t data = { .empirical_data = &rows.matrix };
+    fit_context_fit(ctx, &data);
+    printf("  %8zu rows: update %.3e s, from scratch %.3e s\n",
+	   size + chunk, seconds, bench_seconds(&start));
+    refit_free(sized);
+  }
+
+  refit_free(refit);
+  fit_context_free(ctx);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_refit_distance
+ *
+ * DESCRIPTION:	    The largest difference between the coefficients or the
+ *		    errors of two fits, relative to their size.
+ *
+ * ARGUMENTS:	    a, b: (const fit_result_t *) -- the fits.
+ *
+ * RETURN:	    double -- the difference, or infinity if either failed.
+ *
+ * NOTES:	    none.
+ ***/
+static double bench_refit_distance(const fit_result_t * a,
+				   const fit_result_t * b)
+{
+  if (a->p == 0 || a->p != b->p)
+    return INFINITY;
+
+  double distance = 0.0;
+  for (size_t j = 0; j < a->p; j++) {
+    const fit_param_t * x = &a->coefficients[j], * y = &b->coefficients[j];
+    double d = fabs(x->value - y->value) / GSL_MAX_DBL(fabs(y->value), 1e-12);
+    double e = fabs(x->error - y->error) / GSL_MAX_DBL(fabs(y->error), 1e-12);
+    distance = GSL_MAX_DBL(distance, GSL_MAX_DBL(d, e));
+  }
+  return distance;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_threads
+ *
+ * DESCRIPTION:	    Times the parallel parse of <filename> with 1, 2, 4, ...
+ *		    up to <max> threads, bypassing the cache, and reports the
+ *		    speedup over one thread.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to load.
+ *		    n: (size_t) -- the size of the tuples.
+ *		    max: (size_t) -- the most threads to try.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int bench_threads(const char * filename, size_t n, size_t max)
+{
+  double base = 0.0;
+  for (size_t threads = 1; threads <= max; threads *= 2) {
+    csv_options_t options = { .threads = threads, .no_cache = true };
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    gsl_matrix * matrix = read_tuples_csv_opt(filename, n, &options);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (matrix == NULL) {
+      fprintf(stderr, "%s: could not read tuples\n", filename);
+      return 1;
+    }
+
+    double seconds = (end.tv_sec - start.tv_sec)
+      + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (threads == 1)
+      base = seconds;
+    printf("threads: %2zu  rows: %zu  wall time: %.6f s  speedup: %.2fx\n",
+	   threads, matrix->size1, seconds, base / seconds);
+    gsl_matrix_free(matrix);
+
+    if (threads < max && threads * 2 > max)
+      threads = max / 2;
+  }
+
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_bootstrap
+ *
+ * DESCRIPTION:	    Bootstraps a fit of <filename> with <replicates> replicates
+ *		    of the rows, then of the residuals, on 1, 2, 4, ... up to
+ *		    <max> threads, and reports the wall time, speedup over one
+ *		    thread and allocations per replicate of each, then the
+ *		    intervals.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    spec: (const char *) -- a triode model, or a surface.
+ *		    replicates: (size_t) -- the number of replicates.
+ *		    max: (size_t) -- the most threads to try.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, the
+ *		    model doesn't exist, or the intervals depend on the number
+ *		    of threads.
+ *
+ * NOTES:	    Every replicate is seeded by its index, so every run should
+ *		    give the same intervals, bit for bit.
+ ***/
+static int bench_bootstrap(const char * filename, const char * spec,
+			   size_t replicates, size_t max)
+{
+  static const bootstrap_method_t methods[] = {
+    BOOTSTRAP_ROWS, BOOTSTRAP_RESIDUALS
+  };
+  poly_model_t model;
+  const triode_model_t * triode = triode_find(spec);
+  if (triode == NULL && poly_parse(&model, spec) != 0) {
+    fprintf(stderr, "%s: no such model\n", spec);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .model = triode ? NULL : &model,
+    .triode = triode
+  };
+
+  int status = 0;
+  for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++) {
+    bootstrap_options_t options = {
+      .replicates = replicates,
+      .method = methods[m],
+      .seed = 1
+    };
+    double single = 0.0;
+    bootstrap_t * first = NULL;
+    for (size_t threads = 1; threads <= max; threads *= 2) {
+      options.threads = threads;
+      size_t allocs = alloc_count;
+      bootstrap_t * result = bootstrap_fit(&data, &options);
+      allocs = alloc_count - allocs;
+      if (result == NULL) {
+	fprintf(stderr, "%s: the data couldn't be fitted\n", spec);
+	status = 1;
+	break;
+      }
+
+      bool same = true;
+      if (first == NULL) {
+	single = result->seconds;
+      } else {
+	for (size_t j = 0; j < result->p; j++) {
+	  const bootstrap_interval_t * a = &first->interval[j];
+	  const bootstrap_interval_t * b = &result->interval[j];
+	  same = same && a->lower == b->lower && a->upper == b->upper
+	    && a->bca_lower == b->bca_lower && a->bca_upper == b->bca_upper;
+	}
+	status |= !same;
+      }
+      printf("%s, %zu replicates (%s), %2zu threads: %.6f s, "
+	     "speedup %.2fx, %.1f allocations/replicate, %zu failed%s\n",
+	     spec, result->replicates,
+	     result->method == BOOTSTRAP_ROWS ? "rows" : "residuals",
+	     result->threads, result->seconds, single / result->seconds,
+	     (double)allocs / result->replicates, result->failed,
+	     same ? "" : ", intervals differ");
+      if (first == NULL)
+	first = result;
+      else
+	bootstrap_free(result);
+    }
+
+    if (first != NULL) {
+      bootstrap_print(first, &data, stdout);
+      bootstrap_free(first);
+    }
+  }
+
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_crossval
+ *
+ * DESCRIPTION:	    Cross-validates candidate models on <filename> with
+ *		    crossval_run() on 1, 2, 4, ... up to <max> threads, and
+ *		    reports the wall time and speedup over one thread, then
+ *		    the scores. The score of the first surface is checked
+ *		    against folds copied out and fitted from scratch.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- a file with a header naming
+ *			Ep, Eg and Ig.
+ *		    folds: (size_t) -- the number of folds.
+ *		    max: (size_t) -- the most threads to try.
+ *		    specs: (const char * const *) -- the candidates.
+ *		    count: (size_t) -- the number of candidates, or 0 for
+ *			crossval_defaults.
+ *
+ * RETURN:	    int -- 0 on success, 1 if the file couldn't be read, a
+ *		    candidate isn't a model, or the scores depend on the
+ *		    number of threads.
+ *
+ * NOTES:	    The naive check deals the rows to folds the same way,
+ *		    by shuffling their indices with the same seed.
+ ***/
+static int bench_crossval(const char * filename, size_t folds, size_t max,
+			  const char * const * specs, size_t count)
+{
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  crossval_options_t options = { .folds = folds, .seed = 1 };
+  int status = 0;
+  double single = 0.0;
+  crossval_t * first = NULL;
+  for (size_t threads = 1; threads <= max; threads *= 2) {
+    options.threads = threads;
+    crossval_t * result = crossval_run(matrix, count ? specs : NULL, count,
+				       &options);
+    if (result == NULL) {
+      fprintf(stderr, "%s: could not cross-validate\n", filename);
+      status = 1;
+      break;
+    }
+
+    bool same = true;
+    if (first == NULL) {
+      single = result->seconds;
+    } else {
+      for (size_t c = 0; c < result->count; c++)
+	same = same && result->candidate[c].rmse == first->candidate[c].rmse;
+      status |= !same;
+    }
+    printf("%zu candidates, %zu folds, %2zu threads: %.6f s, "
+	   "speedup %.2fx%s\n", result->count, result->folds,
+	   result->threads, result->seconds, single / result->seconds,
+	   same ? "" : ", scores differ");
+    if (first == NULL)
+      first = result;
+    else
+      crossval_free(result);
+  }
+  if (first == NULL) {
+    gsl_matrix_free(matrix);
+    return 1;
+  }
+  crossval_print(first, stdout);
+
+  /* Fit the folds of the first surface again, from copies. */
+  const crossval_candidate_t * surface = NULL;
+  for (size_t c = 0; c < first->count && surface == NULL; c++) {
+    if (first->candidate[c].triode == NULL)
+      surface = &first->candidate[c];
+  }
+  if (surface != NULL) {
+    size_t n = matrix->size1, K = first->folds;
+    size_t * order = malloc(n * sizeof(size_t));
+    gsl_matrix * train = gsl_matrix_alloc(n, matrix->size2);
+    gsl_rng * rng = gsl_rng_alloc(gsl_rng_mt19937);
+    fit_context_t * ctx = fit_context_alloc(NULL, false);
+    gsl_rng_set(rng, options.seed);
+    for (size_t i = 0; i < n; i++)
+      order[i] = i;
+    gsl_ran_shuffle(rng, order, n, sizeof(size_t));
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double sse = 0.0;
+    for (size_t k = 0; k < K; k++) {
+      size_t lo = n * k / K, hi = n * (k + 1) / K, m = 0;
+      for (size_t r = 0; r < n; r++) {
+	if (r < lo || r >= hi) {
+	  gsl_vector_const_view row = gsl_matrix_const_row(matrix, order[r]);
+	  gsl_matrix_set_row(train, m++, &row.vector);
+	}
+      }
+      gsl_matrix_view rows = gsl_matrix_submatrix(train, 0, 0, m,
+						  train->size2);
+      fit_data_t data = {
+	.empirical_data = &rows.matrix,
+	.model = &surface->model
+      };
+      fit_context_fit(ctx, &data);
+      const fit_result_t * result = fit_context_result(ctx);
+      for (size_t r = lo; r < hi; r++) {
+	double x[POLY_MAX_TERMS], ep, eg;
+	ep = gsl_matrix_get(matrix, order[r], FIT_EP);
+	eg = gsl_matrix_get(matrix, order[r], FIT_EG);
+	poly_basis(&surface->model, ep, eg, ep * ep, eg * eg, x);
+	double e = gsl_matrix_get(matrix, order[r], FIT_IG);
+	for (size_t j = 0; j < surface->p; j++)
+	  e -= x[j] * result->coefficients[j].value;
+	sse += e * e;
+      }
+    }
+    double rmse = sqrt(sse / n);
+    printf("%s from copied folds: rmse %.6e in %.6f s, %.3f s merged, "
+	   "relative difference %.3g\n", surface->spec, rmse,
+	   bench_seconds(&start), surface->seconds,
+	   fabs(rmse - surface->rmse) / rmse);
+
+    fit_context_free(ctx);
+    gsl_rng_free(rng);
+    gsl_matrix_free(train);
+    free(order);
+  }
+
+  crossval_free(first);
+  gsl_matrix_free(matrix);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_gof
+ *
+ * DESCRIPTION:	    Fits <filename> once, then times gof_compute() on the
+ *		    fit's residuals against a plain computation that takes a
+ *		    pass over them for each statistic, checks that the two
+ *		    agree, and writes the statistics in both formats.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to fit.
+ *		    spec: (const char *) -- the model, as for -m.
+ *		    reps: (size_t) -- times to compute the statistics.
+ *
+ * RETURN:	    int -- 0 if the statistics agree, 1 otherwise.
+ *
+ * NOTES:	    The fit itself computes the statistics too; its copy in
+ *		    the result must match the one computed here.
+ ***/
+static int bench_gof(const char * filename, const char * spec, size_t reps)
+{
+  poly_model_t model;
+  const triode_model_t * triode = triode_find(spec);
+  if (triode == NULL && poly_parse(&model, spec) != 0) {
+    fprintf(stderr, "%s: no such model\n", spec);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  size_t n = matrix->size1;
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .model = triode ? NULL : &model,
+    .triode = triode
+  };
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  gsl_vector * f = gsl_vector_alloc(n);
+  if (data.samples == NULL || ctx == NULL || f == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  if (reps == 0)
+    reps = 1;
+
+  bench_sample_t sample;
+  bench_start(&sample);
+  int status = fit_context_fit(ctx, &data);
+  bench_report("fit", &sample, 0);
+  if (status != 0) {
+    fprintf(stderr, "%s: couldn't be fitted\n", spec);
+    return 1;
+  }
+  const fit_result_t * fit = fit_context_result(ctx);
+  gsl_vector_const_view x = gsl_vector_const_view_array_with_stride(
+    &fit->coefficients[0].value, sizeof(fit_param_t) / sizeof(double),
+    fit->p);
+  if (triode != NULL)
+    triode_f(&x.vector, &data, f);
+  else
+    surface_f(&x.vector, &data, f);
+
+  const double * eg = gsl_matrix_const_ptr(matrix, 0, FIT_EG);
+  const double * ig = gsl_matrix_const_ptr(matrix, 0, FIT_IG);
+  gof_t gof;
+  bench_start(&sample);
+  for (size_t r = 0; r < reps; r++)
+    gof_compute(&gof, f, eg, ig, matrix->tda, fit->p);
+  bench_report("gof_compute(), one pass", &sample, n * sizeof(double) * reps);
+
+  /* Mean, then the central moments, then R^2, then the serial terms, then
+   * the range of Eg, then the regions. */
+  double mean = 0, m2 = 0, m3 = 0, m4 = 0, rss = 0, dw = 0, ymean = 0;
+  double tss = 0, max_abs = 0;
+  double region_sum[GOF_MAX_REGIONS], region_sumsq[GOF_MAX_REGIONS];
+  bench_start(&sample);
+  for (size_t r = 0; r < reps; r++) {
+    mean = m2 = m3 = m4 = rss = dw = ymean = tss = max_abs = 0;
+    for (size_t i = 0; i < n; i++)
+      mean += gsl_vector_get(f, i);
+    mean /= n;
+    for (size_t i = 0; i < n; i++) {
+      double d = gsl_vector_get(f, i) - mean;
+      m2 += d * d;
+      m3 += d * d * d;
+      m4 += d * d * d * d;
+    }
+    for (size_t i = 0; i < n; i++)
+      ymean += gsl_matrix_get(matrix, i, FIT_IG);
+    ymean /= n;
+    for (size_t i = 0; i < n; i++) {
+      double d = gsl_matrix_get(matrix, i, FIT_IG) - ymean;
+      tss += d * d;
+      rss += gsl_vector_get(f, i) * gsl_vector_get(f, i);
+    }
+    for (size_t i = 1; i < n; i++) {
+      double d = gsl_vector_get(f, i) - gsl_vector_get(f, i - 1);
+      dw += d * d;
+    }
+    for (size_t i = 0; i < n; i++)
+      if (fabs(gsl_vector_get(f, i)) > max_abs)
+	max_abs = fabs(gsl_vector_get(f, i));
+
+    double lower = INFINITY, upper = -INFINITY, width = GOF_REGION_WIDTH;
+    for (size_t i = 0; i < n; i++) {
+      lower = fmin(lower, gsl_matrix_get(matrix, i, FIT_EG));
+      upper = fmax(upper, gsl_matrix_get(matrix, i, FIT_EG));
+    }
+    while (floor(upper / width) - floor(lower / width) >= GOF_MAX_REGIONS)
+      width *= 2;
+    long first = (long)floor(lower / width);
+    memset(region_sum, 0, sizeof(region_sum));
+    memset(region_sumsq, 0, sizeof(region_sumsq));
+    for (size_t i = 0; i < n; i++) {
+      size_t k = (long)floor(gsl_matrix_get(matrix, i, FIT_EG) / width)
+	- first;
+      region_sum[k] += gsl_vector_get(f, i);
+      region_sumsq[k] += gsl_vector_get(f, i) * gsl_vector_get(f, i);
+    }
+  }
+  bench_report("naive, seven passes", &sample, n * sizeof(double) * reps);
+
+  /* The mean of good residuals is near 0, so it is compared as a fraction
+   * of the RMSE. */
+  double expect[] = {
+    1 - rss / tss, sqrt(rss / n), mean / sqrt(rss / n),
+    sqrt((double)n) * m3 / pow(m2, 1.5),
+    n * m4 / (m2 * m2) - 3, dw / rss, max_abs
+  };
+  double got[] = {
+    gof.r2, gof.rmse, gof.mean / gof.rmse, gof.skew, gof.kurtosis, gof.durbin_watson,
+    gof.max_abs
+  };
+  /* Statistics near 0, like the skew of normal residuals, are compared
+   * absolutely. */
+  double worst = 0;
+  for (size_t k = 0; k < sizeof(got) / sizeof(got[0]); k++) {
+    double error = fabs(got[k] - expect[k]) / fmax(fabs(expect[k]), 1e-3);
+    if (!(error <= worst))
+      worst = error;
+  }
+  bool same = !memcmp(&gof, &fit->gof, sizeof(gof_t));
+  printf("largest relative difference: %.3g\n", worst);
+  printf("fit's own statistics %s\n", same ? "match" : "differ");
+
+  gof_write(stdout, filename, &gof, GOF_JSON);
+  gof_write_header(stdout, GOF_CSV);
+  gof_write(stdout, filename, &gof, GOF_CSV);
+
+  gsl_vector_free(f);
+  fit_context_free(ctx);
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return worst > 1e-9 || !same;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_trust
+ *
+ * DESCRIPTION:	    Fits <filename> by every combination of trust region
+ *		    subproblem, scale and solver, and reports the iterations,
+ *		    evaluations, wall time and final cost of each. The
+ *		    fastest of those which converged to the least cost found
+ *		    is named at the end.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to fit.
+ *		    spec: (const char *) -- the model, as for -m. Surfaces
+ *			are fitted by the trust region method too.
+ *		    reps: (size_t) -- fits per combination; the fastest is
+ *			reported.
+ *
+ * RETURN:	    int -- 0 if any combination converged, 1 otherwise.
+ *
+ * NOTES:	    A combination converged if its fit stopped by the
+ *		    tolerances, not the iteration limit, at a cost within
+ *		    1e-6 of the least. Every fit shares one pool, so only the
+ *		    first fit of each combination makes a workspace.
+ ***/
+static int bench_trust(const char * filename, const char * spec, size_t reps)
+{
+  poly_model_t model;
+  const triode_model_t * triode = triode_find(spec);
+  if (triode == NULL && poly_parse(&model, spec) != 0) {
+    fprintf(stderr, "%s: no such model\n", spec);
+    return 1;
+  }
+  gsl_matrix * matrix = read_columns_csv(filename, fit_columns, FIT_IG + 1,
+					 NULL);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read columns\n", filename);
+    return 1;
+  }
+
+  fit_data_t data = {
+    .empirical_data = matrix,
+    .samples = fit_samples_alloc(matrix),
+    .model = triode ? NULL : &model,
+    .triode = triode,
+    .solver = FIT_SOLVER_NONLINEAR
+  };
+  size_t count = (TRUST_NTRS - 1) * (TRUST_NSCALES - 1)
+    * (TRUST_NSOLVERS - 1);
+  fit_result_t * results = calloc(count, sizeof(fit_result_t));
+  trust_method_t * methods = calloc(count, sizeof(trust_method_t));
+  double * seconds = calloc(count, sizeof(double));
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  if (data.samples == NULL || results == NULL || methods == NULL
+      || seconds == NULL || ctx == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  if (reps == 0)
+    reps = 1;
+
+  char name[64];
+  trust_name(&data.method, triode != NULL, name, sizeof(name));
+  printf("%s, %zu samples, default %s\n", spec, matrix->size1, name);
+  printf("%-30s %5s %6s %6s %6s %12s %14s %s\n", "method", "iter", "f",
+	 "df", "fvv", "seconds", "cost", "status");
+
+  size_t i = 0;
+  double least = INFINITY;
+  for (trust_trs_t trs = 1; trs < TRUST_NTRS; trs++) {
+    for (trust_scale_t scale = 1; scale < TRUST_NSCALES; scale++) {
+      for (trust_solver_t solver = 1; solver < TRUST_NSOLVERS; solver++) {
+	methods[i] = (trust_method_t){
+	  .trs = trs, .scale = scale, .solver = solver
+	};
+	data.method = methods[i];
+	seconds[i] = INFINITY;
+	for (size_t r = 0; r < reps; r++) {
+	  struct timespec start;
+	  clock_gettime(CLOCK_MONOTONIC, &start);
+	  int status = fit_context_fit(ctx, &data);
+	  double s = bench_seconds(&start);
+	  if (s < seconds[i])
+	    seconds[i] = s;
+	  results[i] = *fit_context_result(ctx);
+	  if (status != 0)
+	    results[i].status = GSL_ENOMEM;
+	}
+
+	const fit_result_t * result = &results[i];
+	trust_name(&methods[i], triode != NULL, name, sizeof(name));
+	printf("%-30s %5zu %6zu %6zu %6zu %12.6f %14.8g %s\n", name,
+	       result->niter, result->nevalf, result->nevaldf,
+	       result->nevalfvv, seconds[i], result->chisq,
+	       gsl_strerror(result->status));
+	if (result->status == GSL_SUCCESS && result->chisq < least)
+	  least = result->chisq;
+	i++;
+      }
+    }
+  }
+
+  size_t fastest = count;
+  for (i = 0; i < count; i++) {
+    if (results[i].status == GSL_SUCCESS
+	&& results[i].chisq <= least * (1 + 1e-6)
+	&& (fastest == count || seconds[i] < seconds[fastest]))
+      fastest = i;
+  }
+  if (fastest < count) {
+    trust_name(&methods[fastest], triode != NULL, name, sizeof(name));
+    printf("fastest converged: %s, %.6f s\n", name, seconds[fastest]);
+  } else {
+    printf("no method converged\n");
+  }
+
+  fit_context_free(ctx);
+  free(seconds);
+  free(methods);
+  free(results);
+  fit_samples_free(data.samples);
+  gsl_matrix_free(matrix);
+  return fastest == count;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_xml
+ *
+ * DESCRIPTION:	    Times read_tuples_xml() on <filename>. Compare against
+ *		    'csv' on a file generated with the same number of rows.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to load.
+ *		    n: (size_t) -- the size of the tuples.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int bench_xml(const char * filename, size_t n)
+{
+  bench_sample_t sample;
+  bench_start(&sample);
+  gsl_matrix * matrix = read_tuples_xml(filename, n);
+  if (matrix == NULL) {
+    fprintf(stderr, "%s: could not read tuples\n", filename);
+    return 1;
+  }
+  bench_report("read_tuples_xml", &sample,
+	       matrix->size1 * matrix->size2 * sizeof(double));
+  printf("rows: %zu\n", matrix->size1);
+
+  gsl_matrix_free(matrix);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_stream
+ *
+ * DESCRIPTION:	    Times fit_surface_stream() on <filename>. Peak RSS should
+ *		    stay flat however large the file is.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the file to fit.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int bench_stream(const char * filename)
+{
+  fit_data_t data = {0};
+  bench_sample_t sample;
+  bench_start(&sample);
+  if (fit_surface_stream(&data, filename, stdout) != 0) {
+    fprintf(stderr, "%s: fit failed\n", filename);
+    return 1;
+  }
+  bench_report("fit_surface_stream", &sample, 0);
+
+  fit_coefficients_free(&data);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_registry
+ *
+ * DESCRIPTION:	    Walks a dataset registry, fitting the surface to each
+ *		    dataset by linear least squares, and reports how much of
+ *		    the wall time was spent waiting for datasets to load. Run
+ *		    with a prefetch of 0 to see the cost of loading inline.
+ *
+ * ARGUMENTS:	    path: (const char *) -- the directory or manifest.
+ *		    prefetch: (size_t) -- datasets to load ahead.
+ *		    threads: (size_t) -- threads to load them on.
+ *
+ * RETURN:	    int -- 0 on success, 1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int bench_registry(const char * path, size_t prefetch,
+			  size_t threads)
+{
+  dataset_options_t options = {
+    .prefetch = prefetch,
+    .threads = threads,
+    .ncolumns = 3,
+    .csv = { .no_cache = true }
+  };
+
+  bench_sample_t sample;
+  bench_start(&sample);
+  dataset_registry_t * registry = dataset_registry_open(path, &options);
+  linfit_t * fit = linfit_alloc(5);
+  gsl_vector * c = gsl_vector_alloc(5);
+  if (registry == NULL || fit == NULL || c == NULL) {
+    fprintf(stderr, "%s: could not open the registry\n", path);
+    return 1;
+  }
+
+  double waiting = 0.0;
+  size_t datasets = 0, failed = 0, rows = 0;
+  for (;;) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    dataset_t * dataset = dataset_registry_next(registry);
+    waiting += bench_seconds(&start);
+    if (dataset == NULL)
+      break;
+
+    datasets++;
+    if (dataset->data == NULL) {
+      failed++;
+      dataset_release(registry, dataset);
+      continue;
+    }
+
+    const gsl_matrix * m = dataset->data;
+    linfit_reset(fit);
+    for (size_t i = 0; i < m->size1; i++) {
+      double Ep = gsl_matrix_get(m, i, 0), Eg = gsl_matrix_get(m, i, 1);
+      double x[5] = { Eg, Ep, Eg * Eg, Ep * Ep, 1.0 };
+      linfit_add(fit, x, gsl_matrix_get(m, i, 2));
+    }
+    linfit_solve(fit, c, NULL, NULL);
+    rows += m->size1;
+    dataset_release(registry, dataset);
+  }
+
+  dataset_registry_close(registry);
+  linfit_free(fit);
+  gsl_vector_free(c);
+  bench_report("dataset registry", &sample, 0);
+  printf("datasets: %zu (%zu failed)  rows: %zu\n", datasets, failed, rows);
+  printf("waiting for loads: %.6f s\n", waiting);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_seconds
+ *
+ * DESCRIPTION:	    Returns the seconds elapsed since <start>.
+ *
+ * ARGUMENTS:	    start: (const struct timespec *) -- CLOCK_MONOTONIC time.
+ *
+ * RETURN:	    double -- the elapsed time.
+ *
+ * NOTES:	    none.
+ ***/
+static double bench_seconds(const struct timespec * start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_start
+ *
+ * DESCRIPTION:	    Records the starting time and allocation count of a
+ *		    measurement.
+ *
+ * ARGUMENTS:	    sample: (bench_sample_t *) -- the measurement.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void bench_start(bench_sample_t * sample)
+{
+  sample->allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+  clock_gettime(CLOCK_MONOTONIC, &sample->start);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bench_report
+ *
+ * DESCRIPTION:	    Prints the wall time, allocations and peak RSS of a
+ *		    measurement started with bench_start().
+ *
+ * ARGUMENTS:	    name: (const char *) -- label for the measurement.
+ *		    sample: (bench_sample_t *) -- the measurement.
+ *		    bytes: (size_t) -- size of the result, for comparison
+ *			against the peak RSS.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Peak RSS is for the whole process, so only the first
+ *		    measurement in a run is meaningful on its own.
+ ***/
+static void bench_report(const char * name, bench_sample_t * sample,
+			 size_t bytes)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  size_t allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED)
+    - sample->allocs;
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  double seconds = (end.tv_sec - sample->start.tv_sec)
+    + (end.tv_nsec - sample->start.tv_nsec) / 1e9;
+  printf("%s:\n", name);
+  printf("  wall time: %.6f s\n", seconds);
+  printf("  allocations: %zu\n", allocs);
+  printf("  peak RSS: %ld KiB (result %zu KiB)\n", usage.ru_maxrss,
+	 bytes / 1024);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    usage
+ *
+ * DESCRIPTION:	    Prints the usage message.
+ *
+ * ARGUMENTS:	    name: (const char *) -- argv[0].
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void usage(const char * name)
+{
+  fprintf(stderr,
+	  "Usage: %s gen <file.csv> <rows>\n"
+	  "       %s csv <file.csv> [n]\n"
+	  "       %s columns <file.csv> <name>...\n"
+	  "       %s threads <file.csv> [n] [max threads]\n"
+	  "       %s stats <n> <file.csv>...\n"
+	  "       %s jacobian <file.csv>\n"
+	  "       %s linear <file.csv>\n"
+	  "       %s residual <file.csv> [reps]\n"
+	  "       %s model <file.csv> [reps] [model]...\n"
+	  "       %s triode <file.csv>\n"
+	  "       %s multistart <file.csv> [model] [starts] [max threads]\n"
+	  "       %s batch <file.csv> [count] [max threads]\n"
+	  "       %s pool <file.csv> [fits] [model]\n"
+	  "       %s robust <file.csv> [model] [every]\n"
+	  "       %s refit <file.csv> [chunk]\n"
+	  "       %s bootstrap <file.csv> [model] [replicates] [max threads]\n"
+	  "       %s crossval <file.csv> [folds] [max threads] [model]...\n"
+	  "       %s gof <file.csv> [model] [reps]\n"
+	  "       %s trust <file.csv> [model] [reps]\n"
+	  "       %s xml <file.xml> [n]\n"
+	  "       %s stream <file.csv>\n"
+	  "       %s registry <dir|manifest> [prefetch] [threads]\n",
+	  name, name, name, name, name, name, name, name, name, name, name,
+	  name, name, name, name, name, name, name, name, name, name, name);
+}
+
+/******************************************************************************/
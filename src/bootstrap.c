@@ -0,0 +1,570 @@
+/*******************************************************************************
+ * NAME:	    bootstrap.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Bootstrap confidence intervals for the coefficients of a
+ *		    fit. The data is resampled B times, by rows or by the
+ *		    residuals of the fit, and each replicate is refitted; the
+ *		    spread of the refitted coefficients gives percentile
+ *		    intervals, and with the bias of the replicates and a
+ *		    jackknife of the data, bias-corrected and accelerated
+ *		    (BCa) ones. The replicates are fitted on a pool of
+ *		    threads, each with its own generator, context and
+ *		    buffers, which are reused for every replicate it fits.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_cdf.h>
+#include <gsl/gsl_sort.h>
+#include <gsl/gsl_statistics_double.h>
+
+#include "bootstrap.h"
+#include "fit.h"
+#include "threadpool.h"
+#include "triode.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define BOOTSTRAP_REPLICATES 1000
+#define BOOTSTRAP_LEVEL 0.95
+
+/* The data is split into this many groups, by row modulo the number, for
+ * the jackknife which estimates the acceleration of the BCa intervals.
+ * Leaving out one row at a time would take n fits. */
+#define BOOTSTRAP_GROUPS 50
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The work shared by the threads. Tasks [0, replicates) are replicates,
+ * and [replicates, replicates + groups) the fits of the jackknife; each
+ * thread takes the next task until there are none left. */
+typedef struct bootstrap_job {
+  const fit_data_t * data;
+  bootstrap_method_t method;
+  unsigned long seed;
+  size_t p;
+  size_t replicates;
+  size_t groups;
+  size_t next;
+  const double * initial; /* The coefficients of the fit of the data. */
+  const double * fitted; /* Its n fitted currents, and residuals. */
+  const double * residuals;
+  double * samples; /* p coefficients per replicate. */
+  double * jackknife; /* And per group. */
+} bootstrap_job_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void bootstrap_worker(void * arg);
+static void resample(const bootstrap_job_t * job, gsl_rng * rng,
+		     gsl_matrix * matrix);
+static size_t leave_out(const bootstrap_job_t * job, size_t group,
+			gsl_matrix * matrix);
+static void fit_residuals(const fit_data_t * data, const fit_result_t * fit,
+			  double * fitted, double * residuals);
+static void intervals(bootstrap_t * result, const double * jackknife,
+		      size_t groups, double * scratch);
+static double seconds_since(const struct timespec * start);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    bootstrap_fit
+ *
+ * DESCRIPTION:	    Fits the data, then options->replicates resamplings of it
+ *		    and BOOTSTRAP_GROUPS jackknife subsets of it, on a pool of
+ *		    threads, and computes the percentile and BCa intervals of
+ *		    every coefficient.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the data and model; only
+ *			read.
+ *		    options: (const bootstrap_options_t *) -- the options.
+ *
+ * RETURN:	    bootstrap_t * -- the intervals, or NULL if the data
+ *		    couldn't be fitted or there was no memory.
+ *
+ * NOTES:	    Replicate b is drawn from a generator seeded with
+ *		    options->seed + b, whichever thread draws it, so the
+ *		    intervals don't depend on the number of threads. The
+ *		    replicates are fitted from the coefficients of the data,
+ *		    with the same model and loss.
+ ***/
+bootstrap_t * bootstrap_fit(const fit_data_t * data,
+			    const bootstrap_options_t * options)
+{
+  size_t n = data->empirical_data->size1;
+  size_t replicates = options->replicates > 0 ? options->replicates
+    : BOOTSTRAP_REPLICATES;
+  size_t groups = n < BOOTSTRAP_GROUPS ? n : BOOTSTRAP_GROUPS;
+
+  bootstrap_t * result = calloc(1, sizeof(bootstrap_t));
+  if (result == NULL)
+    return NULL;
+  result->replicates = replicates;
+  result->method = options->method;
+  result->level = options->level > 0 && options->level < 1 ? options->level
+    : BOOTSTRAP_LEVEL;
+
+  /* Fit the data itself. */
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  if (ctx == NULL)
+    goto error_exit;
+  int status = fit_context_fit(ctx, data);
+  result->fit = *fit_context_result(ctx);
+  fit_context_free(ctx);
+  size_t p = result->p = result->fit.p;
+  if (status != 0 || p == 0)
+    goto error_exit;
+
+  double initial[POLY_MAX_TERMS];
+  for (size_t j = 0; j < p; j++)
+    initial[j] = result->fit.coefficients[j].value;
+
+  result->interval = calloc(p, sizeof(bootstrap_interval_t));
+  result->samples = malloc(replicates * p * sizeof(double));
+  double * jackknife = malloc(groups * p * sizeof(double));
+  double * fitted = malloc(2 * n * sizeof(double));
+  double * scratch = malloc(replicates * sizeof(double));
+  if (result->interval == NULL || result->samples == NULL
+      || jackknife == NULL || fitted == NULL || scratch == NULL) {
+    free(jackknife);
+    free(fitted);
+    free(scratch);
+    goto error_exit;
+  }
+  fit_residuals(data, &result->fit, fitted, fitted + n);
+
+  /* Tasks no thread gets to stay NaN, and count as failed. */
+  for (size_t k = 0; k < replicates * p; k++)
+    result->samples[k] = NAN;
+  for (size_t k = 0; k < groups * p; k++)
+    jackknife[k] = NAN;
+
+  bootstrap_job_t job = {
+    .data = data,
+    .method = options->method,
+    .seed = options->seed,
+    .p = p,
+    .replicates = replicates,
+    .groups = groups,
+    .next = 0,
+    .initial = initial,
+    .fitted = fitted,
+    .residuals = fitted + n,
+    .samples = result->samples,
+    .jackknife = jackknife
+  };
+
+  size_t threads = options->threads > 0 ? options->threads
+    : threadpool_ncpus();
+  if (threads > replicates + groups)
+    threads = replicates + groups;
+  struct timespec begin;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  threadpool_t * pool = threadpool_create(threads);
+  if (pool == NULL) {
+    bootstrap_worker(&job);
+    result->threads = 1;
+  } else {
+    result->threads = threadpool_size(pool);
+    for (size_t t = 0; t < result->threads; t++) {
+      if (threadpool_submit(pool, bootstrap_worker, &job) != 0)
+	bootstrap_worker(&job);
+    }
+    threadpool_destroy(pool);
+  }
+  result->seconds = seconds_since(&begin);
+
+  intervals(result, jackknife, groups, scratch);
+  free(jackknife);
+  free(fitted);
+  free(scratch);
+  return result;
+
+ error_exit:
+  bootstrap_free(result);
+  return NULL;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bootstrap_print
+ *
+ * DESCRIPTION:	    Logs the intervals of every coefficient, with the error
+ *		    the fit itself estimated for comparison.
+ *
+ * ARGUMENTS:	    result: (const bootstrap_t *) -- the intervals.
+ *		    data: (const fit_data_t *) -- the data, for the names of
+ *			the coefficients.
+ *		    outfh: (FILE *) -- the log.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void bootstrap_print(const bootstrap_t * result, const fit_data_t * data,
+		     FILE * outfh)
+{
+  const triode_model_t * triode = data->triode;
+  fprintf(outfh, "Bootstrap: %zu replicates (%s) on %zu threads, %.3f s, "
+	  "%zu failed\n", result->replicates,
+	  result->method == BOOTSTRAP_ROWS ? "rows" : "residuals",
+	  result->threads, result->seconds, result->failed);
+  for (size_t j = 0; j < result->p; j++) {
+    const bootstrap_interval_t * in = &result->interval[j];
+    const fit_param_t * b = &result->fit.coefficients[j];
+    char name[16];
+    if (triode != NULL)
+      snprintf(name, sizeof(name), "%s", triode->params[j]);
+    else
+      snprintf(name, sizeof(name), "B_%zu", j);
+    fprintf(outfh, "%s = %.5f +/- %.5f (bootstrap %.5f); %g%%: "
+	    "percentile [%.5f, %.5f], BCa [%.5f, %.5f]\n", name, b->value,
+	    b->error, in->error, 100 * result->level, in->lower, in->upper,
+	    in->bca_lower, in->bca_upper);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bootstrap_free
+ *
+ * DESCRIPTION:	    Frees the intervals of a bootstrap.
+ *
+ * ARGUMENTS:	    result: (bootstrap_t *) -- the intervals, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void bootstrap_free(bootstrap_t * result)
+{
+  if (result == NULL)
+    return;
+  free(result->interval);
+  free(result->samples);
+  free(result);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    bootstrap_worker
+ *
+ * DESCRIPTION:	    Fits the tasks of a job until there are none left. The
+ *		    thread's generator, context, matrix and samples are made
+ *		    once and reused for every task it takes.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the bootstrap_job_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). A thread that can't
+ *		    make its buffers takes no tasks, leaving them to the
+ *		    others.
+ ***/
+static void bootstrap_worker(void * arg)
+{
+  bootstrap_job_t * job = (bootstrap_job_t *)arg;
+  const gsl_matrix * values = job->data->empirical_data;
+  fit_context_t * ctx = fit_context_alloc(NULL, false);
+  gsl_rng * rng = gsl_rng_alloc(gsl_rng_mt19937);
+  gsl_matrix * matrix = gsl_matrix_alloc(values->size1, values->size2);
+  fit_samples_t * samples = fit_samples_alloc(values);
+  if (ctx == NULL || rng == NULL || matrix == NULL || samples == NULL)
+    goto out;
+
+  fit_data_t replicate = *job->data;
+  replicate.coefficients = NULL;
+  replicate.initial_values = (double *)job->initial;
+  replicate.samples = samples;
+
+  size_t k;
+  while ((k = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+	 < job->replicates + job->groups) {
+    size_t rows = values->size1;
+    double * out;
+    if (k < job->replicates) {
+      gsl_rng_set(rng, job->seed + k);
+      resample(job, rng, matrix);
+      out = job->samples + k * job->p;
+    } else {
+      rows = leave_out(job, k - job->replicates, matrix);
+      out = job->jackknife + (k - job->replicates) * job->p;
+    }
+
+    gsl_matrix_view view = gsl_matrix_submatrix(matrix, 0, 0, rows,
+						matrix->size2);
+    replicate.empirical_data = &view.matrix;
+    fit_samples_fill(samples, &view.matrix);
+    if (fit_context_fit(ctx, &replicate) != 0)
+      continue;
+    const fit_result_t * result = fit_context_result(ctx);
+    if (result->p != job->p)
+      continue;
+    for (size_t j = 0; j < job->p; j++)
+      out[j] = result->coefficients[j].value;
+  }
+
+ out:
+  fit_context_free(ctx);
+  if (rng != NULL)
+    gsl_rng_free(rng);
+  if (matrix != NULL)
+    gsl_matrix_free(matrix);
+  fit_samples_free(samples);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    resample
+ *
+ * DESCRIPTION:	    Draws one replicate of the data into <matrix>: n rows of
+ *		    the data with replacement, or the rows of the data with
+ *		    n residuals of the fit, drawn with replacement, added
+ *		    back to its fitted currents.
+ *
+ * ARGUMENTS:	    job: (const bootstrap_job_t *) -- the job.
+ *		    rng: (gsl_rng *) -- the generator for this replicate.
+ *		    matrix: (gsl_matrix *) -- location for the replicate, the
+ *			size of the data.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void resample(const bootstrap_job_t * job, gsl_rng * rng,
+		     gsl_matrix * matrix)
+{
+  const gsl_matrix * values = job->data->empirical_data;
+  size_t n = values->size1, size = values->size2 * sizeof(double);
+  for (size_t i = 0; i < n; i++) {
+    size_t j = gsl_rng_uniform_int(rng, n);
+    if (job->method == BOOTSTRAP_ROWS) {
+      memcpy(gsl_matrix_ptr(matrix, i, 0), gsl_matrix_const_ptr(values, j, 0),
+	     size);
+    } else {
+      memcpy(gsl_matrix_ptr(matrix, i, 0), gsl_matrix_const_ptr(values, i, 0),
+	     size);
+      gsl_matrix_set(matrix, i, FIT_IG, job->fitted[i] + job->residuals[j]);
+    }
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    leave_out
+ *
+ * DESCRIPTION:	    Copies the rows of the data not in one group of the
+ *		    jackknife to the top of <matrix>.
+ *
+ * ARGUMENTS:	    job: (const bootstrap_job_t *) -- the job.
+ *		    group: (size_t) -- the group to leave out, the rows whose
+ *			index is <group> modulo job->groups.
+ *		    matrix: (gsl_matrix *) -- location for the rows.
+ *
+ * RETURN:	    size_t -- the number of rows copied.
+ *
+ * NOTES:	    none.
+ ***/
+static size_t leave_out(const bootstrap_job_t * job, size_t group,
+			gsl_matrix * matrix)
+{
+  const gsl_matrix * values = job->data->empirical_data;
+  size_t rows = 0, size = values->size2 * sizeof(double);
+  for (size_t i = 0; i < values->size1; i++) {
+    if (i % job->groups != group)
+      memcpy(gsl_matrix_ptr(matrix, rows++, 0),
+	     gsl_matrix_const_ptr(values, i, 0), size);
+  }
+  return rows;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_residuals
+ *
+ * DESCRIPTION:	    Computes the fitted currents and the residuals of a fit
+ *		    of the data.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the data and model.
+ *		    fit: (const fit_result_t *) -- the fit.
+ *		    fitted: (double *) -- location for the n fitted currents.
+ *		    residuals: (double *) -- location for the n residuals.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The residuals are those of surface_f() or triode_f(),
+ *		    Ig - f(Ep, Eg).
+ ***/
+static void fit_residuals(const fit_data_t * data, const fit_result_t * fit,
+			  double * fitted, double * residuals)
+{
+  size_t n = data->empirical_data->size1;
+  fit_data_t copy = *data;
+  gsl_vector_const_view x = gsl_vector_const_view_array_with_stride(
+    &fit->coefficients[0].value, sizeof(fit_param_t) / sizeof(double),
+    fit->p);
+  gsl_vector_view r = gsl_vector_view_array(residuals, n);
+  if (data->triode != NULL)
+    triode_f(&x.vector, &copy, &r.vector);
+  else
+    surface_f(&x.vector, &copy, &r.vector);
+
+  for (size_t i = 0; i < n; i++)
+    fitted[i] = gsl_matrix_get(data->empirical_data, i, FIT_IG)
+      - residuals[i];
+}
+
+/*******************************************************************************
+ * FUNCTION:	    intervals
+ *
+ * DESCRIPTION:	    Computes the intervals of every coefficient from the
+ *		    replicates that could be fitted. The percentile interval
+ *		    is the middle <level> of them; the BCa interval moves
+ *		    those percentiles by z0, the bias of the replicates
+ *		    against the fit, and a, the skew of the jackknife:
+ *
+ *			alpha' = Phi(z0 + (z0 + z) / (1 - a (z0 + z)))
+ *
+ *		    for z = Phi^-1 of each percentile.
+ *
+ * ARGUMENTS:	    result: (bootstrap_t *) -- the bootstrap, with its
+ *			replicates, for the intervals.
+ *		    jackknife: (const double *) -- the coefficients of each
+ *			group of the jackknife.
+ *		    groups: (size_t) -- the number of groups.
+ *		    scratch: (double *) -- room for one coefficient of every
+ *			replicate.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    z0 is computed from ties counting half, and held within
+ *		    the replicates, so that a coefficient every replicate
+ *		    lands on one side of doesn't give an infinite interval.
+ ***/
+static void intervals(bootstrap_t * result, const double * jackknife,
+		      size_t groups, double * scratch)
+{
+  size_t p = result->p, replicates = result->replicates;
+  double tail = (1 - result->level) / 2;
+  double zlo = gsl_cdf_ugaussian_Pinv(tail), zhi = -zlo;
+
+  result->failed = 0;
+  for (size_t b = 0; b < replicates; b++)
+    result->failed += !isfinite(result->samples[b * p]);
+
+  for (size_t j = 0; j < p; j++) {
+    bootstrap_interval_t * in = &result->interval[j];
+    double theta = result->fit.coefficients[j].value;
+    size_t m = 0;
+    double below = 0.0;
+    for (size_t b = 0; b < replicates; b++) {
+      double t = result->samples[b * p + j];
+      if (!isfinite(t))
+	continue;
+      scratch[m++] = t;
+      below += t < theta ? 1.0 : t == theta ? 0.5 : 0.0;
+    }
+    if (m < 2) {
+      *in = (bootstrap_interval_t){
+	NAN, NAN, NAN, NAN, NAN, NAN, NAN, NAN
+      };
+      continue;
+    }
+
+    gsl_sort(scratch, 1, m);
+    in->mean = gsl_stats_mean(scratch, 1, m);
+    in->error = gsl_stats_sd_m(scratch, 1, m, in->mean);
+    in->lower = gsl_stats_quantile_from_sorted_data(scratch, 1, m, tail);
+    in->upper = gsl_stats_quantile_from_sorted_data(scratch, 1, m, 1 - tail);
+
+    double fraction = below / m;
+    fraction = GSL_MIN_DBL(GSL_MAX_DBL(fraction, 0.5 / m), 1 - 0.5 / m);
+    double z0 = gsl_cdf_ugaussian_Pinv(fraction);
+
+    /* The acceleration, from the skew of the jackknife. */
+    double mean = 0.0, sum2 = 0.0, sum3 = 0.0;
+    size_t k = 0;
+    for (size_t g = 0; g < groups; g++) {
+      if (isfinite(jackknife[g * p + j])) {
+	mean += jackknife[g * p + j];
+	k++;
+      }
+    }
+    mean = k > 0 ? mean / k : 0.0;
+    for (size_t g = 0; g < groups; g++) {
+      double d = mean - jackknife[g * p + j];
+      if (isfinite(d)) {
+	sum2 += d * d;
+	sum3 += d * d * d;
+      }
+    }
+    double a = sum2 > 0 ? sum3 / (6 * pow(sum2, 1.5)) : 0.0;
+
+    double lo = gsl_cdf_ugaussian_P(z0 + (z0 + zlo) / (1 - a * (z0 + zlo)));
+    double hi = gsl_cdf_ugaussian_P(z0 + (z0 + zhi) / (1 - a * (z0 + zhi)));
+    in->bca_lower = gsl_stats_quantile_from_sorted_data(scratch, 1, m, lo);
+    in->bca_upper = gsl_stats_quantile_from_sorted_data(scratch, 1, m, hi);
+    in->bias = z0;
+    in->acceleration = a;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    seconds_since
+ *
+ * DESCRIPTION:	    Wall time since <start>.
+ *
+ * ARGUMENTS:	    start: (const struct timespec *) -- from CLOCK_MONOTONIC.
+ *
+ * RETURN:	    double -- the time, in seconds.
+ *
+ * NOTES:	    none.
+ ***/
+static double seconds_since(const struct timespec * start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+/******************************************************************************/
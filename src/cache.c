@@ -0,0 +1,535 @@
+/*******************************************************************************
+ * NAME:	    cache.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    This file keeps a binary, columnar copy of each .csv file
+ *		    that read_tuples_csv() parses, so that later loads of the
+ *		    same file can map the columns instead of parsing text. A
+ *		    cache is only used while the size and modification time
+ *		    of its source match the ones recorded in it, and while its
+ *		    checksum holds.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+#include "cache.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Columns start on a boundary of this many bytes. */
+#define TUPLE_CACHE_ALIGN 64
+
+/* Number of doubles tuple_cache_write() gathers before each write(). */
+#define TUPLE_CACHE_CHUNK 8192
+
+#define CHECKSUM_INIT 0xcbf29ce484222325ULL
+#define CHECKSUM_PRIME 0x100000001b3ULL
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static char * cache_path(const char * filename);
+static bool names_fit(const char * names, const char * end, size_t cols);
+static uint64_t checksum(uint64_t hash, const void * data, size_t words);
+static int write_all(int fd, const void * buf, size_t len);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_open
+ *
+ * DESCRIPTION:	    Maps the cache of <filename> into memory, after checking
+ *		    that it belongs to the current version of the file.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the path of the .csv file.
+ *		    n: (size_t) -- the number of columns the caller needs.
+ *
+ * RETURN:	    tuple_cache_t * -- the cache, or NULL if there isn't a
+ *		    usable one.
+ *
+ * NOTES:	    The checksum, over the fields, the names and the columns,
+ *		    is verified on every open. It costs one pass over the
+ *		    mapping, which is far cheaper than parsing. The fields
+ *		    and every name must lie between the header and the data,
+ *		    so that tuple_cache_find() can't read past the mapping.
+ ***/
+tuple_cache_t * tuple_cache_open(const char * filename, size_t n)
+{
+  struct stat src;
+  if (stat(filename, &src) == -1)
+    return NULL;
+
+  char * path = cache_path(filename);
+  if (path == NULL)
+    return NULL;
+  int fd = open(path, O_RDONLY);
+  free(path);
+  if (fd == -1)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1
+      || (size_t)st.st_size < sizeof(tuple_cache_header_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t length = (size_t)st.st_size;
+  void * map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const tuple_cache_header_t * header = map;
+  if (memcmp(header->magic, TUPLE_CACHE_MAGIC, sizeof(header->magic))
+      || header->version != TUPLE_CACHE_VERSION
+      || header->cols == 0 || header->cols < n || header->rows == 0
+      || header->source_size != (uint64_t)src.st_size
+      || header->source_mtime != (int64_t)src.st_mtim.tv_sec
+      || header->source_mtime_nsec != (int64_t)src.st_mtim.tv_nsec
+      || header->data_offset > length
+      || header->data_offset % TUPLE_CACHE_ALIGN != 0
+      || header->data_offset < sizeof(tuple_cache_header_t)
+         + (uint64_t)header->cols * (sizeof(uint64_t) + 1)
+      || (length - header->data_offset) / sizeof(double)
+         / header->cols < header->rows)
+    goto error_exit;
+
+  const uint64_t * fields = (const uint64_t *)(header + 1);
+  const char * names = (const char *)(fields + header->cols);
+  const double * data =
+    (const double *)((const char *)map + header->data_offset);
+  if (!names_fit(names, (const char *)data, header->cols))
+    goto error_exit;
+  uint64_t hash = checksum(CHECKSUM_INIT, fields,
+			   (header->data_offset - sizeof(tuple_cache_header_t))
+			   / sizeof(uint64_t));
+  if (checksum(hash, data, header->rows * header->cols) != header->checksum)
+    goto error_exit;
+
+  tuple_cache_t * cache = malloc(sizeof(tuple_cache_t));
+  if (cache == NULL)
+    goto error_exit;
+
+  cache->map = map;
+  cache->length = length;
+  cache->rows = header->rows;
+  cache->cols = header->cols;
+  cache->fields = fields;
+  cache->names = names;
+  cache->data = data;
+  return cache;
+
+ error_exit: {
+    munmap(map, length);
+    return NULL;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_close
+ *
+ * DESCRIPTION:	    Unmaps a cache. Views taken of it become invalid.
+ *
+ * ARGUMENTS:	    cache: (tuple_cache_t *) -- the cache.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void tuple_cache_close(tuple_cache_t * cache)
+{
+  if (cache == NULL)
+    return;
+
+  munmap(cache->map, cache->length);
+  free(cache);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_column
+ *
+ * DESCRIPTION:	    Returns a view of column <j> of the cache.
+ *
+ * ARGUMENTS:	    cache: (const tuple_cache_t *) -- the cache.
+ *		    j: (size_t) -- the column.
+ *
+ * RETURN:	    gsl_vector_const_view -- view over the mapping.
+ *
+ * NOTES:	    none.
+ ***/
+gsl_vector_const_view tuple_cache_column(const tuple_cache_t * cache,
+					 size_t j)
+{
+  return gsl_vector_const_view_array(cache->data + j * cache->rows,
+				     cache->rows);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_view
+ *
+ * DESCRIPTION:	    Returns a view of the first <n> columns of the cache as the
+ *		    rows of an <n> x <rows> matrix.
+ *
+ * ARGUMENTS:	    cache: (const tuple_cache_t *) -- the cache.
+ *		    n: (size_t) -- the number of columns.
+ *
+ * RETURN:	    gsl_matrix_const_view -- view over the mapping.
+ *
+ * NOTES:	    This is the transpose of what read_tuples_csv() returns.
+ ***/
+gsl_matrix_const_view tuple_cache_view(const tuple_cache_t * cache, size_t n)
+{
+  return gsl_matrix_const_view_array(cache->data, n, cache->rows);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_matrix
+ *
+ * DESCRIPTION:	    Gathers the first <n> columns of the cache into a new
+ *		    row-major matrix.
+ *
+ * ARGUMENTS:	    cache: (const tuple_cache_t *) -- the cache.
+ *		    n: (size_t) -- the number of columns.
+ *
+ * RETURN:	    gsl_matrix * -- the matrix, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+gsl_matrix * tuple_cache_matrix(const tuple_cache_t * cache, size_t n)
+{
+  gsl_matrix * matrix = gsl_matrix_alloc(cache->rows, n);
+  if (matrix == NULL)
+    return NULL;
+
+  for (size_t j = 0; j < n; j++) {
+    const double * column = cache->data + j * cache->rows;
+    double * out = matrix->data + j;
+    for (size_t i = 0; i < cache->rows; i++)
+      out[i * matrix->tda] = column[i];
+  }
+
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_find
+ *
+ * DESCRIPTION:	    Looks up a column of the cache by name.
+ *
+ * ARGUMENTS:	    cache: (const tuple_cache_t *) -- the cache.
+ *		    name: (const char *) -- the name of the column.
+ *
+ * RETURN:	    ssize_t -- the index of the column, or -1 if no column,
+ *		    or more than one, has exactly that name.
+ *
+ * NOTES:	    Names are kept in full, so they are compared exactly. A
+ *		    column without a name is never found; nor is one whose
+ *		    name is shared, so that the caller parses the file rather
+ *		    than guess.
+ ***/
+ssize_t tuple_cache_find(const tuple_cache_t * cache, const char * name)
+{
+  ssize_t found = -1;
+  const char * next = cache->names;
+  for (size_t j = 0; j < cache->cols; j++) {
+    if (*name != '\0' && !strcmp(next, name)) {
+      if (found != -1)
+	return -1;
+      found = j;
+    }
+    next += strlen(next) + 1;
+  }
+  return found;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_gather
+ *
+ * DESCRIPTION:	    Gathers the columns <columns> of the cache, in that order,
+ *		    into a new row-major matrix.
+ *
+ * ARGUMENTS:	    cache: (const tuple_cache_t *) -- the cache.
+ *		    columns: (const size_t *) -- indices of the columns.
+ *		    n: (size_t) -- the number of columns.
+ *
+ * RETURN:	    gsl_matrix * -- the matrix, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+gsl_matrix * tuple_cache_gather(const tuple_cache_t * cache,
+				const size_t * columns, size_t n)
+{
+  gsl_matrix * matrix = gsl_matrix_alloc(cache->rows, n);
+  if (matrix == NULL)
+    return NULL;
+
+  for (size_t j = 0; j < n; j++) {
+    const double * column = cache->data + columns[j] * cache->rows;
+    double * out = matrix->data + j;
+    for (size_t i = 0; i < cache->rows; i++)
+      out[i * matrix->tda] = column[i];
+  }
+
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_cache_write
+ *
+ * DESCRIPTION:	    Writes the cache of <filename> from the tuples that were
+ *		    parsed from it, with the field each column came from and
+ *		    its name.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the path of the .csv file.
+ *		    matrix: (const gsl_matrix *) -- its tuples.
+ *		    fields: (const size_t *) -- the field of each column, or
+ *			NULL if they are the leading ones.
+ *		    names: (const char * const *) -- the name of each column,
+ *			as the caller read it from the header, or NULL. A
+ *			NULL name is written as "".
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    The cache is written to a temporary file and renamed into
+ *		    place, so a reader never sees half of one.
+ ***/
+int tuple_cache_write(const char * filename, const gsl_matrix * matrix,
+		      const size_t * fields, const char * const * names)
+{
+  struct stat src;
+  if (stat(filename, &src) == -1)
+    return -1;
+
+  size_t cols = matrix->size2, rows = matrix->size1;
+  size_t names_len = 0;
+  for (size_t j = 0; j < cols; j++)
+    names_len += (names && names[j] ? strlen(names[j]) : 0) + 1;
+  size_t offset = sizeof(tuple_cache_header_t) + cols * sizeof(uint64_t)
+    + names_len;
+  offset = (offset + TUPLE_CACHE_ALIGN - 1) & ~(size_t)(TUPLE_CACHE_ALIGN - 1);
+
+  char * path = cache_path(filename), * tmp = NULL;
+  char * prefix = calloc(1, offset - sizeof(tuple_cache_header_t));
+  double * chunk = malloc(TUPLE_CACHE_CHUNK * sizeof(double));
+  int fd = -1;
+  if (path == NULL || prefix == NULL || chunk == NULL
+      || asprintf(&tmp, "%s.XXXXXX", path) == -1)
+    goto error_exit;
+  if ((fd = mkstemp(tmp)) == -1) {
+    free(tmp);
+    tmp = NULL;
+    goto error_exit;
+  }
+
+  tuple_cache_header_t header = {
+    .version = TUPLE_CACHE_VERSION,
+    .cols = cols,
+    .rows = rows,
+    .source_size = src.st_size,
+    .source_mtime = src.st_mtim.tv_sec,
+    .source_mtime_nsec = src.st_mtim.tv_nsec,
+    .data_offset = offset
+  };
+  memcpy(header.magic, TUPLE_CACHE_MAGIC, sizeof(header.magic));
+
+  /* The header is written last, once the checksum is known. */
+  char * name = prefix + cols * sizeof(uint64_t);
+  for (size_t j = 0; j < cols; j++) {
+    uint64_t field = fields != NULL ? fields[j] : j;
+    memcpy(prefix + j * sizeof(uint64_t), &field, sizeof(field));
+    if (names != NULL && names[j] != NULL)
+      name = stpcpy(name, names[j]);
+    *name++ = '\0';
+  }
+  if (lseek(fd, sizeof(header), SEEK_SET) == -1
+      || write_all(fd, prefix, offset - sizeof(header)) != 0)
+    goto error_exit;
+
+  uint64_t hash = checksum(CHECKSUM_INIT, prefix,
+			   (offset - sizeof(header)) / sizeof(uint64_t));
+  for (size_t j = 0; j < cols; j++) {
+    for (size_t i = 0; i < rows; i += TUPLE_CACHE_CHUNK) {
+      size_t count = rows - i < TUPLE_CACHE_CHUNK ? rows - i
+	: TUPLE_CACHE_CHUNK;
+      for (size_t k = 0; k < count; k++)
+	chunk[k] = gsl_matrix_get(matrix, i + k, j);
+      hash = checksum(hash, chunk, count);
+      if (write_all(fd, chunk, count * sizeof(double)) != 0)
+	goto error_exit;
+    }
+  }
+
+  header.checksum = hash;
+  if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)
+      || close(fd) != 0) {
+    fd = -1;
+    goto error_exit;
+  }
+  fd = -1;
+  if (rename(tmp, path) != 0)
+    goto error_exit;
+
+  free(tmp);
+  free(path);
+  free(prefix);
+  free(chunk);
+  return 0;
+
+ error_exit: {
+    if (fd != -1) close(fd);
+    if (tmp != NULL) {
+      unlink(tmp);
+      free(tmp);
+    }
+    free(path);
+    free(prefix);
+    free(chunk);
+    return -1;
+  }
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    cache_path
+ *
+ * DESCRIPTION:	    Returns the path of the cache of <filename>.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the path of the .csv file.
+ *
+ * RETURN:	    char * -- the path, which the caller must free(), or NULL.
+ *
+ * NOTES:	    none.
+ ***/
+static char * cache_path(const char * filename)
+{
+  char * path = NULL;
+  if (asprintf(&path, "%s" TUPLE_CACHE_SUFFIX, filename) == -1)
+    return NULL;
+  return path;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    names_fit
+ *
+ * DESCRIPTION:	    Whether <cols> NUL-terminated names lie between <names>
+ *		    and <end>.
+ *
+ * ARGUMENTS:	    names: (const char *) -- the first name.
+ *		    end: (const char *) -- one past the last byte they may use.
+ *		    cols: (size_t) -- the number of names.
+ *
+ * RETURN:	    bool -- true if they do.
+ *
+ * NOTES:	    none.
+ ***/
+static bool names_fit(const char * names, const char * end, size_t cols)
+{
+  for (size_t j = 0; j < cols; j++) {
+    const char * nul = memchr(names, '\0', end - names);
+    if (nul == NULL)
+      return false;
+    names = nul + 1;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    checksum
+ *
+ * DESCRIPTION:	    Folds <words> 64-bit words into a running FNV-1a style
+ *		    hash, a word at a time.
+ *
+ * ARGUMENTS:	    hash: (uint64_t) -- the hash so far.
+ *		    data: (const void *) -- the data: doubles, or the names.
+ *		    words: (size_t) -- the number of words.
+ *
+ * RETURN:	    uint64_t -- the new hash.
+ *
+ * NOTES:	    none.
+ ***/
+static uint64_t checksum(uint64_t hash, const void * data, size_t words)
+{
+  const char * p = data;
+  for (size_t i = 0; i < words; i++) {
+    uint64_t word;
+    memcpy(&word, p + i * sizeof(word), sizeof(word));
+    hash = (hash ^ word) * CHECKSUM_PRIME;
+  }
+  return hash;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    write_all
+ *
+ * DESCRIPTION:	    write()s all of <buf>, retrying short writes.
+ *
+ * ARGUMENTS:	    fd: (int) -- the file descriptor.
+ *		    buf: (const void *) -- the data.
+ *		    len: (size_t) -- the number of bytes.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int write_all(int fd, const void * buf, size_t len)
+{
+  const char * p = buf;
+  while (len > 0) {
+    ssize_t done = write(fd, p, len);
+    if (done == -1) {
+      if (errno == EINTR)
+	continue;
+      return -1;
+    }
+    p += done;
+    len -= done;
+  }
+  return 0;
+}
+
+/******************************************************************************/
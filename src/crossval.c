@@ -0,0 +1,568 @@
+/*******************************************************************************
+ * NAME:	    crossval.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    K-fold cross-validation of candidate models, to choose the
+ *		    order of a surface, or between surfaces and triode models,
+ *		    by how well each predicts rows it wasn't fitted to. The
+ *		    rows are dealt to folds by a shuffled index, and folds are
+ *		    read through it in place. Surfaces, which are linear in
+ *		    their coefficients, accumulate one QR factor per fold in
+ *		    a single pass; the fit without fold k merges the factors
+ *		    of the others, so K folds cost little more than one fit.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+
+#include "crossval.h"
+#include "fit.h"
+#include "linfit.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define CROSSVAL_FOLDS 10
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One fit, or set of fits, for a thread to take. A surface is one task,
+ * which fits every fold; a triode model is K + 1 tasks, one per fold held
+ * out and one, fold K, of every row. */
+typedef struct crossval_task {
+  size_t candidate;
+  size_t fold;
+  double sse; /* Over the rows held out. */
+  double rss; /* Of the fit of every row, if the task made it. */
+  size_t failed;
+  double seconds;
+} crossval_task_t;
+
+typedef struct crossval_job {
+  const gsl_matrix * values;
+  const size_t * order; /* Fold k is order[n k / K] to order[n (k + 1) / K]. */
+  size_t folds;
+  crossval_candidate_t * candidate;
+  crossval_task_t * task;
+  size_t ntasks;
+  size_t next; /* The next task, taken atomically. */
+  bool nonlinear; /* Whether any candidate is a triode model. */
+  fit_samples_t * samples; /* Of every row, for the triode models. */
+} crossval_job_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void crossval_worker(void * arg);
+static void crossval_surface(const crossval_job_t * job,
+			     crossval_task_t * task);
+static void crossval_triode(const crossval_job_t * job, fit_context_t * ctx,
+			    size_t * rows, crossval_task_t * task);
+static inline size_t fold_start(const crossval_job_t * job, size_t k);
+static void row_basis(const gsl_matrix * values, size_t i,
+		      const poly_model_t * model, double * x);
+static double seconds_since(const struct timespec * start);
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+const char * const crossval_defaults[] = {
+  "1", "2", "3", "4", "2x", "3x", "4x", "koren", "child-langmuir", "dempwolf",
+  NULL
+};
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_run
+ *
+ * DESCRIPTION:	    Deals the rows to options->folds folds at random, then
+ *		    fits every candidate without each fold in turn, on a pool
+ *		    of threads, and scores it by the RMSE of its predictions
+ *		    of the rows held out. Every candidate is also fitted to
+ *		    every row, for its AIC and BIC.
+ *
+ * ARGUMENTS:	    values: (const gsl_matrix *) -- the empirical data; only
+ *			read.
+ *		    specs: (const char * const *) -- the candidates, or NULL
+ *			for crossval_defaults.
+ *		    count: (size_t) -- the number of candidates, ignored if
+ *			<specs> is NULL.
+ *		    options: (const crossval_options_t *) -- the options.
+ *
+ * RETURN:	    crossval_t * -- the outcome, or NULL if a candidate isn't
+ *		    a model, there are fewer rows than folds, or there was no
+ *		    memory.
+ *
+ * NOTES:	    Every candidate sees the same folds, so their scores are
+ *		    comparable. Fits are plain least squares; triode models
+ *		    start from their usual starting point.
+ ***/
+crossval_t * crossval_run(const gsl_matrix * values,
+			  const char * const * specs, size_t count,
+			  const crossval_options_t * options)
+{
+  if (specs == NULL) {
+    specs = crossval_defaults;
+    for (count = 0; specs[count] != NULL; count++);
+  }
+  size_t n = values->size1;
+  size_t folds = options->folds > 0 ? options->folds : CROSSVAL_FOLDS;
+  if (count == 0 || folds < 2 || n < folds)
+    return NULL;
+
+  crossval_t * result = calloc(1, sizeof(crossval_t));
+  if (result == NULL)
+    return NULL;
+  result->n = n;
+  result->folds = folds;
+  result->count = count;
+  result->best = count;
+
+  crossval_job_t job = {
+    .values = values,
+    .folds = folds
+  };
+  size_t * order = malloc(n * sizeof(size_t));
+  result->candidate = calloc(count, sizeof(crossval_candidate_t));
+  job.task = calloc(count * (folds + 1), sizeof(crossval_task_t));
+  if (order == NULL || result->candidate == NULL || job.task == NULL)
+    goto error_exit;
+  job.order = order;
+  job.candidate = result->candidate;
+
+  for (size_t c = 0; c < count; c++) {
+    crossval_candidate_t * candidate = &result->candidate[c];
+    candidate->spec = specs[c];
+    if ((candidate->triode = triode_find(specs[c])) != NULL) {
+      candidate->p = candidate->triode->p;
+      for (size_t k = 0; k <= folds; k++)
+	job.task[job.ntasks++] = (crossval_task_t){ .candidate = c,
+						    .fold = k };
+      job.nonlinear = true;
+    } else if (poly_parse(&candidate->model, specs[c]) == 0) {
+      candidate->p = candidate->model.nterms;
+      job.task[job.ntasks++] = (crossval_task_t){ .candidate = c };
+    } else {
+      goto error_exit;
+    }
+  }
+  if (job.nonlinear && (job.samples = fit_samples_alloc(values)) == NULL)
+    goto error_exit;
+
+  /* Deal the rows out by a Fisher-Yates shuffle of their indices. */
+  gsl_rng * rng = gsl_rng_alloc(gsl_rng_mt19937);
+  if (rng == NULL)
+    goto error_exit;
+  gsl_rng_set(rng, options->seed);
+  for (size_t i = 0; i < n; i++)
+    order[i] = i;
+  gsl_ran_shuffle(rng, order, n, sizeof(size_t));
+  gsl_rng_free(rng);
+
+  size_t threads = options->threads > 0 ? options->threads
+    : threadpool_ncpus();
+  if (threads > job.ntasks)
+    threads = job.ntasks;
+  struct timespec begin;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  threadpool_t * pool = threadpool_create(threads);
+  if (pool == NULL) {
+    crossval_worker(&job);
+    result->threads = 1;
+  } else {
+    result->threads = threadpool_size(pool);
+    for (size_t t = 0; t < result->threads; t++) {
+      if (threadpool_submit(pool, crossval_worker, &job) != 0)
+	crossval_worker(&job);
+    }
+    threadpool_destroy(pool);
+  }
+  result->seconds = seconds_since(&begin);
+
+  /* Gather the tasks of each candidate. */
+  double * sse = calloc(count, sizeof(double));
+  if (sse == NULL)
+    goto error_exit;
+  for (size_t t = 0; t < job.ntasks; t++) {
+    const crossval_task_t * task = &job.task[t];
+    crossval_candidate_t * candidate = &result->candidate[task->candidate];
+    sse[task->candidate] += task->sse;
+    candidate->failed += task->failed;
+    candidate->seconds += task->seconds;
+    if (candidate->triode == NULL || task->fold == folds)
+      candidate->rss = task->rss;
+  }
+
+  for (size_t c = 0; c < count; c++) {
+    crossval_candidate_t * candidate = &result->candidate[c];
+    double p = candidate->p;
+    candidate->rmse = candidate->failed ? INFINITY : sqrt(sse[c] / n);
+    candidate->aic = n * log(candidate->rss / n) + 2 * p;
+    candidate->bic = n * log(candidate->rss / n) + p * log(n);
+    if (isfinite(candidate->rmse) && (result->best == count
+	 || candidate->rmse < result->candidate[result->best].rmse))
+      result->best = c;
+  }
+
+  free(sse);
+  free(order);
+  free(job.task);
+  fit_samples_free(job.samples);
+  return result;
+
+ error_exit:
+  free(order);
+  free(job.task);
+  fit_samples_free(job.samples);
+  crossval_free(result);
+  return NULL;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_print
+ *
+ * DESCRIPTION:	    Logs the scores of every candidate, marking the best.
+ *
+ * ARGUMENTS:	    result: (const crossval_t *) -- the outcome.
+ *		    outfh: (FILE *) -- the log.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void crossval_print(const crossval_t * result, FILE * outfh)
+{
+  fprintf(outfh, "Cross-validation: %zu candidates, %zu folds of %zu rows, "
+	  "on %zu threads, %.3f s\n", result->count, result->folds, result->n,
+	  result->threads, result->seconds);
+  for (size_t c = 0; c < result->count; c++) {
+    const crossval_candidate_t * candidate = &result->candidate[c];
+    fprintf(outfh, "%c %-16s p = %2zu, rmse = %.6e, aic = %.6e, "
+	    "bic = %.6e, %.3f s", c == result->best ? '*' : ' ',
+	    candidate->spec, candidate->p, candidate->rmse, candidate->aic,
+	    candidate->bic, candidate->seconds);
+    if (candidate->failed)
+      fprintf(outfh, ", %zu fits failed", candidate->failed);
+    fprintf(outfh, "\n");
+  }
+  if (result->best < result->count)
+    fprintf(outfh, "Best: %s\n", result->candidate[result->best].spec);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_free
+ *
+ * DESCRIPTION:	    Frees the outcome of a cross-validation.
+ *
+ * ARGUMENTS:	    result: (crossval_t *) -- the outcome, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void crossval_free(crossval_t * result)
+{
+  if (result == NULL)
+    return;
+  free(result->candidate);
+  free(result);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_worker
+ *
+ * DESCRIPTION:	    Takes the tasks of a job until there are none left. The
+ *		    context and the index of training rows for the triode
+ *		    models are made once, and reused for every fit the
+ *		    thread makes.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the crossval_job_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). A thread that can't
+ *		    make its buffers takes no tasks, leaving them to the
+ *		    others.
+ ***/
+static void crossval_worker(void * arg)
+{
+  crossval_job_t * job = (crossval_job_t *)arg;
+  fit_context_t * ctx = NULL;
+  size_t * rows = NULL;
+  if (job->nonlinear
+      && ((ctx = fit_context_alloc(NULL, false)) == NULL
+	  || (rows = malloc(job->values->size1 * sizeof(size_t))) == NULL))
+    goto out;
+
+  size_t k;
+  while ((k = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+	 < job->ntasks) {
+    crossval_task_t * task = &job->task[k];
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (job->candidate[task->candidate].triode != NULL)
+      crossval_triode(job, ctx, rows, task);
+    else
+      crossval_surface(job, task);
+    task->seconds = seconds_since(&start);
+  }
+
+ out:
+  fit_context_free(ctx);
+  free(rows);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_surface
+ *
+ * DESCRIPTION:	    Cross-validates a surface: the rows of each fold are
+ *		    accumulated into a QR factor of their own, in one pass
+ *		    over the data; the fit without fold k merges the other
+ *		    K - 1 factors, and the fit of every row merges them all.
+ *
+ * ARGUMENTS:	    job: (const crossval_job_t *) -- the job.
+ *		    task: (crossval_task_t *) -- the candidate's task.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    O(n p^2 + K^2 p^3). A fold that leaves too few rows to
+ *		    determine the surface counts as a failed fit.
+ ***/
+static void crossval_surface(const crossval_job_t * job,
+			     crossval_task_t * task)
+{
+  const crossval_candidate_t * candidate = &job->candidate[task->candidate];
+  const gsl_matrix * values = job->values;
+  size_t p = candidate->p, folds = job->folds;
+  linfit_t ** fold = calloc(folds, sizeof(linfit_t *));
+  linfit_t * fit = linfit_alloc(p);
+  gsl_vector * c = gsl_vector_alloc(p);
+  task->failed = folds + 1;
+  if (fold == NULL || fit == NULL || c == NULL)
+    goto out;
+  for (size_t k = 0; k < folds; k++) {
+    if ((fold[k] = linfit_alloc(p)) == NULL)
+      goto out;
+  }
+
+  double x[POLY_MAX_TERMS];
+  for (size_t k = 0; k < folds; k++) {
+    for (size_t r = fold_start(job, k); r < fold_start(job, k + 1); r++) {
+      size_t i = job->order[r];
+      row_basis(values, i, &candidate->model, x);
+      linfit_add(fold[k], x, gsl_matrix_get(values, i, FIT_IG));
+    }
+  }
+
+  task->failed = 0;
+  for (size_t k = 0; k < folds; k++)
+    linfit_merge(fit, fold[k]);
+  if (linfit_solve(fit, c, NULL, &task->rss) != GSL_SUCCESS) {
+    task->rss = NAN;
+    task->failed++;
+  }
+
+  for (size_t k = 0; k < folds; k++) {
+    linfit_reset(fit);
+    for (size_t j = 0; j < folds; j++) {
+      if (j != k)
+	linfit_merge(fit, fold[j]);
+    }
+    if (linfit_solve(fit, c, NULL, NULL) != GSL_SUCCESS) {
+      task->failed++;
+      continue;
+    }
+
+    for (size_t r = fold_start(job, k); r < fold_start(job, k + 1); r++) {
+      size_t i = job->order[r];
+      row_basis(values, i, &candidate->model, x);
+      double e = gsl_matrix_get(values, i, FIT_IG);
+      for (size_t j = 0; j < p; j++)
+	e -= x[j] * gsl_vector_get(c, j);
+      task->sse += e * e;
+    }
+  }
+
+ out:
+  if (fold != NULL) {
+    for (size_t k = 0; k < folds; k++)
+      linfit_free(fold[k]);
+    free(fold);
+  }
+  linfit_free(fit);
+  if (c != NULL)
+    gsl_vector_free(c);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    crossval_triode
+ *
+ * DESCRIPTION:	    Makes one fit of a triode model: of every row, or of the
+ *		    rows outside one fold, scoring its predictions of the
+ *		    fold.
+ *
+ * ARGUMENTS:	    job: (const crossval_job_t *) -- the job.
+ *		    ctx: (fit_context_t *) -- the thread's context.
+ *		    rows: (size_t *) -- the thread's index, the size of the
+ *			data.
+ *		    task: (crossval_task_t *) -- the task.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The training rows are the index of the job without the
+ *		    fold, in the same order, and are fitted through
+ *		    fit_data_t's rows; nothing of the data is copied.
+ ***/
+static void crossval_triode(const crossval_job_t * job, fit_context_t * ctx,
+			    size_t * rows, crossval_task_t * task)
+{
+  const crossval_candidate_t * candidate = &job->candidate[task->candidate];
+  const triode_model_t * triode = candidate->triode;
+  const gsl_matrix * values = job->values;
+  size_t k = task->fold, folds = job->folds;
+  size_t lo = fold_start(job, k), hi = fold_start(job, k + 1);
+
+  fit_data_t data = {
+    .empirical_data = (gsl_matrix *)values,
+    .samples = job->samples,
+    .triode = triode
+  };
+  if (k < folds) {
+    size_t n = values->size1;
+    memcpy(rows, job->order, lo * sizeof(size_t));
+    memcpy(rows + lo, job->order + hi, (n - hi) * sizeof(size_t));
+    data.rows = rows;
+    data.nrows = n - (hi - lo);
+  }
+  if (fit_context_fit(ctx, &data) != 0) {
+    task->failed = 1;
+    task->rss = NAN;
+    return;
+  }
+
+  const fit_result_t * result = fit_context_result(ctx);
+  if (k == folds) {
+    task->rss = result->chisq;
+    return;
+  }
+
+  double b[TRIODE_MAX_PARAMS];
+  for (size_t j = 0; j < triode->p; j++)
+    b[j] = result->coefficients[j].value;
+  for (size_t r = lo; r < hi; r++) {
+    size_t i = job->order[r];
+    double e = gsl_matrix_get(values, i, FIT_IG)
+      - triode->eval(b, gsl_matrix_get(values, i, FIT_EP),
+		     gsl_matrix_get(values, i, FIT_EG), NULL);
+    task->sse += e * e;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fold_start
+ *
+ * DESCRIPTION:	    The position in the index of the first row of a fold.
+ *
+ * ARGUMENTS:	    job: (const crossval_job_t *) -- the job.
+ *		    k: (size_t) -- the fold, or K for the end of the index.
+ *
+ * RETURN:	    size_t -- the position.
+ *
+ * NOTES:	    The folds differ in size by at most one row.
+ ***/
+static inline size_t fold_start(const crossval_job_t * job, size_t k)
+{
+  return job->values->size1 * k / job->folds;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    row_basis
+ *
+ * DESCRIPTION:	    Computes the terms of a surface at one row of the data.
+ *
+ * ARGUMENTS:	    values: (const gsl_matrix *) -- the empirical data.
+ *		    i: (size_t) -- the row.
+ *		    model: (const poly_model_t *) -- the surface.
+ *		    x: (double *) -- location for the model->nterms terms.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The squares are read from the data if it has them, as
+ *		    fit.c does.
+ ***/
+static void row_basis(const gsl_matrix * values, size_t i,
+		      const poly_model_t * model, double * x)
+{
+  double ep = gsl_matrix_get(values, i, FIT_EP);
+  double eg = gsl_matrix_get(values, i, FIT_EG);
+  bool squares = values->size2 >= FIT_NCOLUMNS;
+  poly_basis(model, ep, eg,
+	     squares ? gsl_matrix_get(values, i, FIT_EP2) : ep * ep,
+	     squares ? gsl_matrix_get(values, i, FIT_EG2) : eg * eg, x);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    seconds_since
+ *
+ * DESCRIPTION:	    Wall time since <start>.
+ *
+ * ARGUMENTS:	    start: (const struct timespec *) -- from CLOCK_MONOTONIC.
+ *
+ * RETURN:	    double -- the time, in seconds.
+ *
+ * NOTES:	    none.
+ ***/
+static double seconds_since(const struct timespec * start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+/******************************************************************************/
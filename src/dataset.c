@@ -0,0 +1,652 @@
+/*******************************************************************************
+ * NAME:	    dataset.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    A registry of the datasets in a directory tree or listed in
+ *		    a manifest. Datasets are handed out in order, and the next
+ *		    few are loaded on a pool of threads while the caller is
+ *		    busy with the current one. The number loaded ahead and the
+ *		    memory they may take up are both bounded.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <gsl/gsl_matrix.h>
+
+#include "dataset.h"
+#include "threadpool.h"
+#include "util.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Used when dataset_registry_open() is given no options. */
+#define DATASET_DEFAULT_PREFETCH 2
+#define DATASET_DEFAULT_COLUMNS 3
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef enum dataset_state {
+  DATASET_WAITING,	/* Not yet submitted to the pool. */
+  DATASET_LOADING,	/* Submitted, and not yet loaded. */
+  DATASET_READY,	/* Loaded, and not yet taken. */
+  DATASET_TAKEN,	/* Handed to the caller. */
+  DATASET_RELEASED	/* Given back, and freed. */
+} dataset_state_t;
+
+typedef struct dataset_entry {
+  dataset_t dataset;
+  dataset_state_t state;
+  size_t estimate; /* The most its matrix can take, from the file's size. */
+  size_t bytes; /* Charged to registry->held. */
+  dataset_registry_t * registry;
+} dataset_entry_t;
+
+struct dataset_registry {
+  dataset_options_t options;
+  char ** paths;
+  size_t count;
+  dataset_entry_t * entries;
+  size_t submitted; /* Entries before this have been submitted. */
+  size_t taken; /* Entries before this have been taken. */
+  size_t held; /* Bytes of entries loading, ready or taken. */
+  bool closing;
+  threadpool_t * pool;
+  pthread_mutex_t lock;
+  pthread_cond_t loaded; /* An entry became ready. */
+};
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void dataset_load(void * arg);
+static void dataset_schedule(dataset_registry_t * registry);
+static void dataset_submit(dataset_registry_t * registry);
+static size_t estimate_bytes(off_t size, size_t ncolumns);
+static int collect_directory(const char * dir, char *** paths,
+			     size_t * count, size_t * capacity);
+static int collect_manifest(const char * manifest, char *** paths,
+			    size_t * count, size_t * capacity);
+static int append_path(char * path, char *** paths, size_t * count,
+		       size_t * capacity);
+static bool has_suffix(const char * path, const char * suffix);
+static int compare_paths(const void * a, const void * b);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_registry_open
+ *
+ * DESCRIPTION:	    Builds a registry of datasets. If <path> is a directory,
+ *		    every .csv and .xml file under it is registered, in order
+ *		    of path. Otherwise <path> is a manifest: one path per
+ *		    line, relative to the manifest's directory unless they are
+ *		    absolute, with blank lines and '#' comments ignored.
+ *
+ * ARGUMENTS:	    path: (const char *) -- the directory or manifest.
+ *		    options: (const dataset_options_t *) -- the options, or
+ *			NULL for the defaults.
+ *
+ * RETURN:	    dataset_registry_t * -- the registry, or NULL on failure.
+ *
+ * NOTES:	    Nothing is loaded until the first dataset_registry_next().
+ ***/
+dataset_registry_t * dataset_registry_open(const char * path,
+					   const dataset_options_t * options)
+{
+  static const dataset_options_t defaults = {
+    .prefetch = DATASET_DEFAULT_PREFETCH,
+    .ncolumns = DATASET_DEFAULT_COLUMNS
+  };
+  if (options == NULL)
+    options = &defaults;
+
+  struct stat st;
+  if (stat(path, &st) == -1)
+    return NULL;
+
+  dataset_registry_t * registry = calloc(1, sizeof(dataset_registry_t));
+  if (registry == NULL)
+    return NULL;
+  registry->options = *options;
+  registry->options.csv.error = NULL;
+  registry->options.csv.stats = NULL;
+  if (registry->options.ncolumns == 0)
+    registry->options.ncolumns = DATASET_DEFAULT_COLUMNS;
+  pthread_mutex_init(&registry->lock, NULL);
+  pthread_cond_init(&registry->loaded, NULL);
+
+  size_t capacity = 0;
+  if (S_ISDIR(st.st_mode)) {
+    if (collect_directory(path, &registry->paths, &registry->count,
+			  &capacity) != 0)
+      goto error_exit;
+    qsort(registry->paths, registry->count, sizeof(char *), compare_paths);
+  } else if (collect_manifest(path, &registry->paths, &registry->count,
+			      &capacity) != 0) {
+    goto error_exit;
+  }
+
+  if (registry->count > 0) {
+    registry->entries = calloc(registry->count, sizeof(dataset_entry_t));
+    registry->pool = threadpool_create(options->threads > 0
+				       ? options->threads : 1);
+    if (registry->entries == NULL || registry->pool == NULL)
+      goto error_exit;
+  }
+
+  for (size_t i = 0; i < registry->count; i++) {
+    dataset_entry_t * entry = &registry->entries[i];
+    entry->dataset.path = registry->paths[i];
+    entry->dataset.index = i;
+    entry->state = DATASET_WAITING;
+    entry->registry = registry;
+    if (stat(registry->paths[i], &st) == 0)
+      entry->estimate = estimate_bytes(st.st_size,
+				       registry->options.ncolumns);
+  }
+
+  return registry;
+
+ error_exit: {
+    dataset_registry_close(registry);
+    return NULL;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_registry_size
+ *
+ * DESCRIPTION:	    Returns the number of datasets in the registry.
+ *
+ * ARGUMENTS:	    registry: (const dataset_registry_t *) -- the registry.
+ *
+ * RETURN:	    size_t -- the number of datasets.
+ *
+ * NOTES:	    none.
+ ***/
+size_t dataset_registry_size(const dataset_registry_t * registry)
+{
+  return registry->count;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_registry_path
+ *
+ * DESCRIPTION:	    Returns the path of the <i>th dataset.
+ *
+ * ARGUMENTS:	    registry: (const dataset_registry_t *) -- the registry.
+ *		    i: (size_t) -- the index of the dataset.
+ *
+ * RETURN:	    const char * -- the path, owned by the registry.
+ *
+ * NOTES:	    none.
+ ***/
+const char * dataset_registry_path(const dataset_registry_t * registry,
+				   size_t i)
+{
+  return registry->paths[i];
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_registry_next
+ *
+ * DESCRIPTION:	    Takes the next dataset, in order. If it hasn't finished
+ *		    loading, waits until it has. Taking a dataset makes room
+ *		    for another to be loaded ahead.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry.
+ *
+ * RETURN:	    dataset_t * -- the dataset, or NULL when every dataset has
+ *		    been taken. A dataset whose file couldn't be loaded has
+ *		    data NULL and error set.
+ *
+ * NOTES:	    The dataset asked for is always loaded, even if it takes
+ *		    the registry over its memory cap; only loads ahead of the
+ *		    caller wait for memory.
+ ***/
+dataset_t * dataset_registry_next(dataset_registry_t * registry)
+{
+  pthread_mutex_lock(&registry->lock);
+  if (registry->taken == registry->count) {
+    pthread_mutex_unlock(&registry->lock);
+    return NULL;
+  }
+
+  dataset_entry_t * entry = &registry->entries[registry->taken];
+  if (entry->state == DATASET_WAITING)
+    dataset_submit(registry);
+  while (entry->state != DATASET_READY)
+    pthread_cond_wait(&registry->loaded, &registry->lock);
+
+  entry->state = DATASET_TAKEN;
+  registry->taken++;
+  dataset_schedule(registry);
+  pthread_mutex_unlock(&registry->lock);
+  return &entry->dataset;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_release
+ *
+ * DESCRIPTION:	    Frees the data of a dataset taken from the registry, and
+ *		    lets its memory be used to load ahead.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry.
+ *		    dataset: (dataset_t *) -- the dataset.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The dataset must not be used afterwards.
+ ***/
+void dataset_release(dataset_registry_t * registry, dataset_t * dataset)
+{
+  dataset_entry_t * entry = &registry->entries[dataset->index];
+  if (dataset->data != NULL)
+    gsl_matrix_free(dataset->data);
+  dataset->data = NULL;
+
+  pthread_mutex_lock(&registry->lock);
+  registry->held -= entry->bytes;
+  entry->bytes = 0;
+  entry->state = DATASET_RELEASED;
+  dataset_schedule(registry);
+  pthread_mutex_unlock(&registry->lock);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_registry_close
+ *
+ * DESCRIPTION:	    Frees the registry. Loads which haven't started are
+ *		    abandoned, and those which have are waited for.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Datasets which were taken and not released are freed too.
+ ***/
+void dataset_registry_close(dataset_registry_t * registry)
+{
+  if (registry == NULL)
+    return;
+
+  pthread_mutex_lock(&registry->lock);
+  registry->closing = true;
+  pthread_mutex_unlock(&registry->lock);
+  threadpool_destroy(registry->pool);
+
+  for (size_t i = 0; i < registry->count; i++) {
+    if (registry->entries != NULL && registry->entries[i].dataset.data)
+      gsl_matrix_free(registry->entries[i].dataset.data);
+    free(registry->paths[i]);
+  }
+
+  pthread_mutex_destroy(&registry->lock);
+  pthread_cond_destroy(&registry->loaded);
+  free(registry->entries);
+  free(registry->paths);
+  free(registry);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_load
+ *
+ * DESCRIPTION:	    Loads one dataset on a thread of the pool. XML files are
+ *		    read with read_tuples_xml(), and .csv files by column name
+ *		    if the options name columns, or with read_tuples_csv_opt()
+ *		    otherwise.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the dataset_entry_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). Once loaded, the
+ *		    entry is charged its actual size instead of its estimate.
+ ***/
+static void dataset_load(void * arg)
+{
+  dataset_entry_t * entry = (dataset_entry_t *)arg;
+  dataset_registry_t * registry = entry->registry;
+  const dataset_options_t * options = &registry->options;
+  dataset_t * dataset = &entry->dataset;
+
+  pthread_mutex_lock(&registry->lock);
+  bool closing = registry->closing;
+  pthread_mutex_unlock(&registry->lock);
+
+  gsl_matrix * data = NULL;
+  int error = ECANCELED;
+  if (!closing) {
+    csv_options_t csv = options->csv;
+    csv.error = &dataset->csv_error;
+    csv.stats = &dataset->stats;
+    errno = 0;
+    if (has_suffix(dataset->path, ".xml"))
+      data = read_tuples_xml(dataset->path, options->ncolumns);
+    else if (options->columns != NULL)
+      data = read_columns_csv(dataset->path, options->columns,
+			      options->ncolumns, &csv);
+    else
+      data = read_tuples_csv_opt(dataset->path, options->ncolumns, &csv);
+    error = data == NULL ? (errno != 0 ? errno : EINVAL) : 0;
+  }
+
+  pthread_mutex_lock(&registry->lock);
+  dataset->data = data;
+  dataset->error = error;
+  size_t bytes = data != NULL
+    ? data->size1 * data->size2 * sizeof(double) : 0;
+  registry->held = registry->held - entry->bytes + bytes;
+  entry->bytes = bytes;
+  entry->state = DATASET_READY;
+  dataset_schedule(registry);
+  pthread_cond_broadcast(&registry->loaded);
+  pthread_mutex_unlock(&registry->lock);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_schedule
+ *
+ * DESCRIPTION:	    Submits loads ahead of the caller for as long as fewer
+ *		    than options.prefetch untaken datasets are loading or
+ *		    ready, and the next one's estimate fits under the memory
+ *		    cap.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry, locked.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void dataset_schedule(dataset_registry_t * registry)
+{
+  const dataset_options_t * options = &registry->options;
+  while (!registry->closing && registry->submitted < registry->count
+	 && registry->submitted - registry->taken < options->prefetch) {
+    const dataset_entry_t * entry = &registry->entries[registry->submitted];
+    if (options->memory_cap > 0
+	&& registry->held + entry->estimate > options->memory_cap)
+      break;
+    dataset_submit(registry);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dataset_submit
+ *
+ * DESCRIPTION:	    Submits the load of the next entry which hasn't been, and
+ *		    charges its estimate to the registry.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry, locked.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    If the task can't be queued, the entry is made ready with
+ *		    the error, so that nobody waits on it forever.
+ ***/
+static void dataset_submit(dataset_registry_t * registry)
+{
+  dataset_entry_t * entry = &registry->entries[registry->submitted++];
+  entry->state = DATASET_LOADING;
+  entry->bytes = entry->estimate;
+  registry->held += entry->bytes;
+
+  if (threadpool_submit(registry->pool, dataset_load, entry) != 0) {
+    registry->held -= entry->bytes;
+    entry->bytes = 0;
+    entry->dataset.error = ENOMEM;
+    entry->state = DATASET_READY;
+    pthread_cond_broadcast(&registry->loaded);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    estimate_bytes
+ *
+ * DESCRIPTION:	    Bounds the size of the matrix loaded from a file of <size>
+ *		    bytes. Every field takes at least two bytes of text, a
+ *		    digit and its separator, so no more than
+ *		    ceil(size / (2 * ncolumns)) rows of <ncolumns> doubles
+ *		    can come out of it.
+ *
+ * ARGUMENTS:	    size: (off_t) -- the size of the file.
+ *		    ncolumns: (size_t) -- the number of columns loaded, not 0.
+ *
+ * RETURN:	    size_t -- the bound, in bytes.
+ *
+ * NOTES:	    none.
+ ***/
+static size_t estimate_bytes(off_t size, size_t ncolumns)
+{
+  size_t rows = ((size_t)size + 2 * ncolumns - 1) / (2 * ncolumns);
+  return rows * ncolumns * sizeof(double);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    collect_directory
+ *
+ * DESCRIPTION:	    Appends the path of every .csv and .xml file under <dir>
+ *		    to <paths>, recursively. Hidden files are skipped, and
+ *		    symbolic links are followed to files but not directories.
+ *
+ * ARGUMENTS:	    dir: (const char *) -- the directory.
+ *		    paths: (char ***) -- the array of paths.
+ *		    count: (size_t *) -- the number of paths in it.
+ *		    capacity: (size_t *) -- its capacity.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int collect_directory(const char * dir, char *** paths,
+			     size_t * count, size_t * capacity)
+{
+  DIR * stream = opendir(dir);
+  if (stream == NULL)
+    return -1;
+
+  struct dirent * ent;
+  while ((ent = readdir(stream)) != NULL) {
+    if (ent->d_name[0] == '.')
+      continue;
+
+    char * path = NULL;
+    if (asprintf(&path, "%s/%s", dir, ent->d_name) == -1)
+      goto error_exit;
+
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+      int status = collect_directory(path, paths, count, capacity);
+      free(path);
+      if (status != 0)
+	goto error_exit;
+    } else if (stat(path, &st) == 0 && S_ISREG(st.st_mode)
+	       && (has_suffix(path, ".csv") || has_suffix(path, ".xml"))) {
+      if (append_path(path, paths, count, capacity) != 0)
+	goto error_exit;
+    } else {
+      free(path);
+    }
+  }
+
+  closedir(stream);
+  return 0;
+
+ error_exit: {
+    closedir(stream);
+    return -1;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    collect_manifest
+ *
+ * DESCRIPTION:	    Appends the paths listed in a manifest to <paths>.
+ *
+ * ARGUMENTS:	    manifest: (const char *) -- the path of the manifest.
+ *		    paths: (char ***) -- the array of paths.
+ *		    count: (size_t *) -- the number of paths in it.
+ *		    capacity: (size_t *) -- its capacity.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    Lines are trimmed of blanks. A '#' starts a comment, as in
+ *		    the data files.
+ ***/
+static int collect_manifest(const char * manifest, char *** paths,
+			    size_t * count, size_t * capacity)
+{
+  FILE * file = fopen(manifest, "r");
+  if (file == NULL)
+    return -1;
+
+  const char * slash = strrchr(manifest, '/');
+  int dirlen = slash != NULL ? (int)(slash - manifest) : 1;
+  const char * dir = slash != NULL ? manifest : ".";
+
+  char * line = NULL;
+  size_t linecap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &linecap, file)) != -1) {
+    char * comment = memchr(line, '#', len);
+    if (comment != NULL)
+      len = comment - line;
+    char * p = line;
+    while (len > 0 && (*p == ' ' || *p == '\t'))
+      p++, len--;
+    while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t'
+		       || p[len - 1] == '\r' || p[len - 1] == '\n'))
+      len--;
+    if (len == 0)
+      continue;
+
+    char * path = NULL;
+    int status = p[0] == '/'
+      ? asprintf(&path, "%.*s", (int)len, p)
+      : asprintf(&path, "%.*s/%.*s", dirlen, dir, (int)len, p);
+    if (status == -1 || append_path(path, paths, count, capacity) != 0)
+      goto error_exit;
+  }
+
+  free(line);
+  fclose(file);
+  return 0;
+
+ error_exit: {
+    free(line);
+    fclose(file);
+    return -1;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    append_path
+ *
+ * DESCRIPTION:	    Appends a path to a growable array of them.
+ *
+ * ARGUMENTS:	    path: (char *) -- the path. Ownership passes to the array,
+ *			or the path is freed if there is an error.
+ *		    paths: (char ***) -- the array of paths.
+ *		    count: (size_t *) -- the number of paths in it.
+ *		    capacity: (size_t *) -- its capacity.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int append_path(char * path, char *** paths, size_t * count,
+		       size_t * capacity)
+{
+  if (*count == *capacity) {
+    size_t grown = *capacity > 0 ? 2 * *capacity : 16;
+    char ** array = realloc(*paths, grown * sizeof(char *));
+    if (array == NULL) {
+      free(path);
+      return -1;
+    }
+    *paths = array;
+    *capacity = grown;
+  }
+
+  (*paths)[(*count)++] = path;
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    has_suffix
+ *
+ * DESCRIPTION:	    Tests whether a path ends in <suffix>.
+ *
+ * ARGUMENTS:	    path: (const char *) -- the path.
+ *		    suffix: (const char *) -- the suffix, e.g. ".csv".
+ *
+ * RETURN:	    bool -- true if it does.
+ *
+ * NOTES:	    none.
+ ***/
+static bool has_suffix(const char * path, const char * suffix)
+{
+  size_t len = strlen(path), slen = strlen(suffix);
+  return len > slen && !strcmp(path + len - slen, suffix);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    compare_paths
+ *
+ * DESCRIPTION:	    qsort() comparison of two paths.
+ *
+ * ARGUMENTS:	    a: (const void *) -- pointer to the first path.
+ *		    b: (const void *) -- pointer to the second path.
+ *
+ * RETURN:	    int -- as strcmp().
+ *
+ * NOTES:	    none.
+ ***/
+static int compare_paths(const void * a, const void * b)
+{
+  return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/******************************************************************************/
@@ -8,7 +8,7 @@
  *
  * CREATED:	    08/22/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/17/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <gsl/gsl_vector.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_multifit_nlinear.h>
@@ -42,6 +43,11 @@
 
 #include "gnuplot_i/gnuplot_i.h"
 #include "fit.h"
+#include "fitpool.h"
+#include "linfit.h"
+#include "residual.h"
+#include "trust.h"
+#include "util.h"
 
 /*******************************************************************************
  * MACRO DEFINITIONS
@@ -61,22 +67,46 @@
   "%s"
 
 #define COMMAND_FN				\
-  "f(x,y) = %2.4g*y + %2.4g*x + %2.4g*y**2 + %2.4g*x**2 + %2.4g; "
+  "f(x,y) = %s; "
 
 #define COMMAND_PLOT				\
   "splot '%s' using 1:2:3, f(x,y); "
 
+/* Number of rows fit_surface_stream() reads from the file at a time. */
+#define FIT_STREAM_ROWS 4096
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct fit_context {
+  FILE * log; /* NULL to log nothing. */
+  bool iterations; /* Log every iteration of the trust region method. */
+  fit_pool_t * pool; /* Where the buffers of each fit are borrowed from. */
+  bool own_pool; /* The pool was made by, and is freed with, the context. */
+  fit_data_t data; /* The data being fitted, with samples of the
+		    * context's own if it came without. */
+  fit_result_t result;
+};
+
 /*******************************************************************************
  * GLOBAL VARIABLES
  ***/
 
-static FILE * surface_log;
+const char * const fit_columns[FIT_NCOLUMNS] = {
+  [FIT_EP] = "Ep",
+  [FIT_EG] = "Eg",
+  [FIT_IG] = "Ig",
+  [FIT_EP2] = "Ep^2",
+  [FIT_EG2] = "Eg^2"
+};
 
 /*******************************************************************************
  * STATIC FUNCTION PROTOTYPES
  ***/
 
-static int print_to_log(gsl_multifit_nlinear_workspace * w,
+static int print_to_log(FILE * log,
+			gsl_multifit_nlinear_workspace * w,
 			gsl_multifit_nlinear_fdf * fdf,
 			int info,
 			int status,
@@ -85,7 +115,41 @@ static int print_to_log(gsl_multifit_nlinear_workspace * w,
 			double chisq1,
 			size_t n,
 			size_t p);
+static int fit_surface_linear(fit_context_t * ctx);
+static int fit_surface_nonlinear(fit_context_t * ctx);
+static int reweight_linear(fit_context_t * ctx, fit_buffers_t * buffers,
+			   double * chisq);
+static int reweight_nonlinear(fit_context_t * ctx,
+			      gsl_multifit_nlinear_fdf * fdf,
+			      fit_buffers_t * buffers, int * info);
+static void count_evaluations(fit_result_t * result,
+			      const gsl_multifit_nlinear_fdf * fdf,
+			      const gsl_multifit_nlinear_workspace * w);
+static void print_robust_log(FILE * log, const fit_data_t * data,
+			     const fit_result_t * result);
+static int print_stream_log(FILE * log,
+			    const char * method,
+			    const linfit_t * fit,
+			    const gsl_vector * c,
+			    const gsl_matrix * covar,
+			    double chisq,
+			    int status);
+static void fill_coefficients(fit_result_t * result, const linfit_t * fit,
+			      const gsl_vector * c, const gsl_matrix * covar,
+			      double chisq);
+static int copy_coefficients(fit_data_t * data, const fit_result_t * result);
+static void fit_gof(fit_context_t * ctx, const gsl_vector * f);
+static fit_pool_t * context_pool(fit_context_t * ctx);
 static int tmp_write_data(fit_data_t * fit_data, FILE * tmpfd);
+static void print_terms(FILE * log, const fit_data_t * data);
+static char * triode_expr(const fit_data_t * data);
+static void surface_regressors(const fit_data_t * data, size_t i,
+			       double * x);
+static inline const poly_model_t * surface_model(const fit_data_t * data);
+static inline double sample_at(const fit_data_t * data, size_t i, double * ep,
+			       double * eg);
+static inline size_t sample_count(const fit_data_t * data);
+static inline size_t sample_row(const fit_data_t * data, size_t i);
 
 /*******************************************************************************
  * API FUNCTIONS
@@ -97,9 +161,9 @@ static int tmp_write_data(fit_data_t * fit_data, FILE * tmpfd);
  * DESCRIPTION:	    The surface equation. This function, given a vector of
  *		    coefficients, returns a coordinate on the z-axis that
  *		    corresponds to a point on the surface. The function is
- *		    defined as:
+ *		    defined by the terms of data->model; by default it is
  *
- *			f(x,y)_i = B_0x + B_1x^2 + B_2y + B_3y^2 + B_4
+ *			f(x,y)_i = B_0y + B_1x + B_2y^2 + B_3x^2 + B_4
  *
  * ARGUMENTS:	    x: (const gsl_vector *) -- vector of coefficients to test
  *		    data: (void *) -- pointer to a struct containing empirical
@@ -110,29 +174,36 @@ static int tmp_write_data(fit_data_t * fit_data, FILE * tmpfd);
  * RETURN:	    GSL_SUCCESS -- There's virtually no way that the function
  *			will fail, so returning a different value is pointless.
  *
- * NOTES:	    none.
+ * NOTES:	    If the data has the FIT_EP2 and FIT_EG2 columns, the
+ *		    squares are read from them rather than computed. When
+ *		    data has samples, the model's kernel in poly.c reads them
+ *		    instead; the loop below is the reference it is checked
+ *		    against.
  ***/
 int surface_f(const gsl_vector * x, void * data, gsl_vector * f)
 {
-  gsl_matrix * values = ((fit_data_t *)data)->empirical_data;
-  size_t n = values->size1;
-  gsl_vector_view Ig = gsl_matrix_column(values, 2);
-  gsl_vector_view Eg = gsl_matrix_column(values, 1);
-  gsl_vector_view Ep = gsl_matrix_column(values, 0);
+  const poly_model_t * model = surface_model(data);
+  double b[POLY_MAX_TERMS];
+  for (size_t j = 0; j < model->nterms; j++)
+    b[j] = gsl_vector_get(x, j);
 
-  double b0 = gsl_vector_get(x, 0);
-  double b1 = gsl_vector_get(x, 1);
-  double b2 = gsl_vector_get(x, 2);
-  double b3 = gsl_vector_get(x, 3);
-  double b4 = gsl_vector_get(x, 4);
+  const fit_samples_t * samples = ((fit_data_t *)data)->samples;
+  if (samples != NULL && ((fit_data_t *)data)->rows == NULL
+      && f->stride == 1) {
+    poly_residuals(model, samples->column[FIT_EP], samples->column[FIT_EG],
+		   samples->column[FIT_IG], samples->column[FIT_EP2],
+		   samples->column[FIT_EG2], b, f->data, samples->n);
+    return GSL_SUCCESS;
+  }
 
+  size_t n = sample_count(data);
   for (size_t i = 0; i < n; i++) {
-    double yi = (b0 * gsl_vector_get(&Eg.vector, i))
-      + (b1 * gsl_vector_get(&Ep.vector, i))
-      + (b2 * pow(gsl_vector_get(&Eg.vector, i), 2.0))
-      + (b3 * pow(gsl_vector_get(&Ep.vector, i), 2.0))
-      + b4;
-    gsl_vector_set(f, i, gsl_vector_get(&Ig.vector, i) - yi);
+    double terms[POLY_MAX_TERMS], ep, eg;
+    surface_regressors(data, i, terms);
+    double yi = 0.0;
+    for (size_t j = 0; j < model->nterms; j++)
+      yi += b[j] * terms[j];
+    gsl_vector_set(f, i, sample_at(data, i, &ep, &eg) - yi);
   }
   
   return GSL_SUCCESS;
@@ -142,7 +213,11 @@ int surface_f(const gsl_vector * x, void * data, gsl_vector * f)
  * FUNCTION:	    surface_df
  *
  * DESCRIPTION:	    Compute the value of the Jacobian matrix for coefficient
- *		    vector 'x' and parameters 'data'.
+ *		    vector 'x' and parameters 'data'. The residuals are
+ *		    f_i = Ig_i - Y_i, so row i of the Jacobian is the negated
+ *		    terms of Y_i, by default
+ *
+ *			J_i = -(Eg, Ep, Eg^2, Ep^2, 1)
  *
  * ARGUMENTS:	    x: (const gsl_vector *) -- coefficient vector given by gsl.
  *		    data: (void *) -- empirical data struct (void for type 
@@ -154,28 +229,124 @@ int surface_f(const gsl_vector * x, void * data, gsl_vector * f)
  *		    feature since the jacobian entries are continuous at all
  *		    points, no memory allocation, etc.
  *
- * NOTES:	    This function is currently under development. It doesn't
- *		    work.
+ * NOTES:	    The surface is linear in its coefficients, so the
+ *		    Jacobian doesn't depend on 'x'. Supplying it saves the
+ *		    solver the p + 1 calls to surface_f() that a forward
+ *		    difference Jacobian costs.
  ***/
 int surface_df(const gsl_vector * x, void * data, gsl_matrix * J)
 {
-  gsl_matrix * values = ((fit_data_t *)data)->empirical_data;
-  size_t n = values->size1;
-  gsl_vector_view Eg = gsl_matrix_column(values, 1);
-  gsl_vector_view Ep = gsl_matrix_column(values, 2);
+  const poly_model_t * model = surface_model(data);
+  (void)x;
+
+  for (size_t i = 0; i < J->size1; i++) {
+    double * row = gsl_matrix_ptr(J, i, 0);
+    surface_regressors(data, i, row);
+    for (size_t j = 0; j < model->nterms; j++)
+      row[j] = -row[j];
+  }
+
+  return GSL_SUCCESS;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    triode_f
+ *
+ * DESCRIPTION:	    The residuals f_i = Ig_i - Ip(Ep_i, Eg_i) of the triode
+ *		    model data->triode, for coefficients 'x'.
+ *
+ * ARGUMENTS:	    x: (const gsl_vector *) -- vector of coefficients to test.
+ *		    data: (void *) -- the fit_data_t (void for type
+ *			consistency with gsl).
+ *		    f: (gsl_vector *) -- location for the n residuals.
+ *
+ * RETURN:	    GSL_SUCCESS.
+ *
+ * NOTES:	    The voltages are read from the samples if the data has
+ *		    them, as in surface_f().
+ ***/
+int triode_f(const gsl_vector * x, void * data, gsl_vector * f)
+{
+  const triode_model_t * triode = ((fit_data_t *)data)->triode;
+  double b[TRIODE_MAX_PARAMS];
+  for (size_t j = 0; j < triode->p; j++)
+    b[j] = gsl_vector_get(x, j);
 
-  double b0 = gsl_vector_get(x, 0);
-  double b1 = gsl_vector_get(x, 1);
-  double b2 = gsl_vector_get(x, 2);
-  double b3 = gsl_vector_get(x, 3);
+  size_t n = sample_count(data);
+  for (size_t i = 0; i < n; i++) {
+    double ep, eg;
+    double ig = sample_at(data, i, &ep, &eg);
+    gsl_vector_set(f, i, ig - triode->eval(b, ep, eg, NULL));
+  }
+  return GSL_SUCCESS;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    triode_df
+ *
+ * DESCRIPTION:	    The Jacobian of triode_f(): row i is the negated gradient
+ *		    of Ip(Ep_i, Eg_i) in the coefficients, which each model
+ *		    computes analytically.
+ *
+ * ARGUMENTS:	    x: (const gsl_vector *) -- coefficient vector given by gsl.
+ *		    data: (void *) -- the fit_data_t.
+ *		    J: (gsl_matrix *) -- location for the n x p Jacobian.
+ *
+ * RETURN:	    GSL_SUCCESS.
+ *
+ * NOTES:	    none.
+ ***/
+int triode_df(const gsl_vector * x, void * data, gsl_matrix * J)
+{
+  const triode_model_t * triode = ((fit_data_t *)data)->triode;
+  double b[TRIODE_MAX_PARAMS];
+  for (size_t j = 0; j < triode->p; j++)
+    b[j] = gsl_vector_get(x, j);
 
+  size_t n = sample_count(data);
   for (size_t i = 0; i < n; i++) {
-    double y1 = b0 + (2 * b2 * gsl_vector_get(&Eg.vector, i));
-    double y2 = b1 + (2 * b3 * gsl_vector_get(&Ep.vector, i));
-    gsl_matrix_set(J, i, 0, y1);
-    gsl_matrix_set(J, i, 1, y2);
+    double ep, eg, grad[TRIODE_MAX_PARAMS];
+    sample_at(data, i, &ep, &eg);
+    triode->eval(b, ep, eg, grad);
+    for (size_t j = 0; j < triode->p; j++)
+      gsl_matrix_set(J, i, j, -grad[j]);
+  }
+  return GSL_SUCCESS;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    triode_fvv
+ *
+ * DESCRIPTION:	    The second directional derivative of triode_f() along
+ *		    'v', which the trust region method uses for geodesic
+ *		    acceleration: fvv_i = -v^T H_i v for the Hessian H_i of
+ *		    Ip(Ep_i, Eg_i) in the coefficients.
+ *
+ * ARGUMENTS:	    x: (const gsl_vector *) -- coefficient vector given by gsl.
+ *		    v: (const gsl_vector *) -- the direction.
+ *		    data: (void *) -- the fit_data_t.
+ *		    fvv: (gsl_vector *) -- location for the n derivatives.
+ *
+ * RETURN:	    GSL_SUCCESS.
+ *
+ * NOTES:	    none.
+ ***/
+int triode_fvv(const gsl_vector * x, const gsl_vector * v, void * data,
+	       gsl_vector * fvv)
+{
+  const triode_model_t * triode = ((fit_data_t *)data)->triode;
+  double b[TRIODE_MAX_PARAMS], d[TRIODE_MAX_PARAMS];
+  for (size_t j = 0; j < triode->p; j++) {
+    b[j] = gsl_vector_get(x, j);
+    d[j] = gsl_vector_get(v, j);
   }
 
+  size_t n = sample_count(data);
+  for (size_t i = 0; i < n; i++) {
+    double ep, eg;
+    sample_at(data, i, &ep, &eg);
+    gsl_vector_set(fvv, i, -triode->eval_vv(b, d, ep, eg));
+  }
   return GSL_SUCCESS;
 }
 
@@ -185,7 +356,7 @@ int surface_df(const gsl_vector * x, void * data, gsl_matrix * J)
  * DESCRIPTION:	    Callback function executed on every iteration of the solver.
  *
  * ARGUMENTS:	    iter: (const size_t) -- number of iterations thus far.
- *		    params: (void *) -- parameters passed from the caller.
+ *		    params: (void *) -- the fit_context_t of the fit.
  *		    w: (const gsl_multifit_nlinear_workspace *) -- workspace.
  *
  * RETURN:	    void.
@@ -196,103 +367,373 @@ void callback(const size_t iter,
 	      void * params,
 	      const gsl_multifit_nlinear_workspace * w)
 {
+  fit_context_t * ctx = (fit_context_t *)params;
+  const triode_model_t * triode = ctx->data.triode;
+  const poly_model_t * model = surface_model(&ctx->data);
   gsl_vector * x = gsl_multifit_nlinear_position(w);
-  fprintf(surface_log,
-	  "iter %2zu: Y = %2.4eEg + %2.4eEp + %2.4eEg^2 + %2.4eEp^2 + %2.4e\n",
-	  iter,
-	  gsl_vector_get(x, 0),
-	  gsl_vector_get(x, 1),
-	  gsl_vector_get(x, 2),
-	  gsl_vector_get(x, 3),
-	  gsl_vector_get(x, 4));
+  if (triode != NULL) {
+    fprintf(ctx->log, "iter %2zu:", iter);
+    for (size_t j = 0; j < triode->p; j++)
+      fprintf(ctx->log, "%s %s = %2.4e", j > 0 ? "," : "",
+	      triode->params[j], gsl_vector_get(x, j));
+    fprintf(ctx->log, "\n");
+    return;
+  }
+
+  double b[POLY_MAX_TERMS];
+  for (size_t j = 0; j < model->nterms; j++)
+    b[j] = gsl_vector_get(x, j);
+
+  char * expr = poly_expr(model, b, POLY_SYNTAX_TEXT);
+  fprintf(ctx->log, "iter %2zu: Y = %s\n", iter, expr ? expr : "?");
+  free(expr);
 }
 
 /*******************************************************************************
- * FUNCTION:	    fit_surface
+ * FUNCTION:	    fit_context_alloc
  *
- * DESCRIPTION:	    Uses the GSL to perform a multiple polynomial regression
- *		    with the TRS method using 'data'.
+ * DESCRIPTION:	    Makes a context for fits: the log they write to, and
+ *		    storage for the outcome of the last one. Fits with
+ *		    different contexts share nothing, so may run at once on
+ *		    different threads.
  *
- * ARGUMENTS:	    data: (fit_data_t *) -- struct containing the data to fit.
+ * ARGUMENTS:	    log: (FILE *) -- the log, or NULL to log nothing.
+ *		    iterations: (bool) -- log every iteration of the trust
+ *			region method, too.
  *
- * RETURN:	    int --  0 on success, -1 otherwise.
+ * RETURN:	    fit_context_t * -- the context, or NULL if there was no
+ *		    memory.
  *
  * NOTES:	    none.
  ***/
-int fit_surface(fit_data_t * data, bool call, FILE * outfh)
+fit_context_t * fit_context_alloc(FILE * log, bool iterations)
 {
-  surface_log = outfh ? outfh : stdout; /* Setup global file descriptor. */
+  fit_context_t * ctx = calloc(1, sizeof(fit_context_t));
+  if (ctx == NULL)
+    return NULL;
+  fit_context_set_log(ctx, log, iterations);
+  return ctx;
+}
 
-  /* Define constants for fitting */
-  const double xtol = 1e-8; /* Step tolerance */
-  const double gtol = 1e-8; /* Gradient tolerance */
-  const double ftol = 0.0;   /* ??? */
-  size_t numcoef = 5; /* The size of the coefficient vector. */
-  gsl_vector_view view = gsl_vector_view_array(data->initial_values, numcoef);
+/*******************************************************************************
+ * FUNCTION:	    fit_context_set_log
+ *
+ * DESCRIPTION:	    Changes the log of a context, for the fits after.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context.
+ *		    log: (FILE *) -- the log, or NULL to log nothing.
+ *		    iterations: (bool) -- log every iteration, too.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void fit_context_set_log(fit_context_t * ctx, FILE * log, bool iterations)
+{
+  ctx->log = log;
+  ctx->iterations = log != NULL && iterations;
+}
 
-  /* Use the default parameters */
-  gsl_multifit_nlinear_parameters params =
-    gsl_multifit_nlinear_default_parameters();
+/*******************************************************************************
+ * FUNCTION:	    fit_context_set_pool
+ *
+ * DESCRIPTION:	    Makes the fits of a context borrow their workspaces and
+ *		    buffers from <pool>, which may be shared with other
+ *		    contexts, instead of from a pool of the context's own.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context.
+ *		    pool: (fit_pool_t *) -- the pool, or NULL to go back to
+ *			one of the context's own.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The caller still owns <pool>, and must not free it before
+ *		    the context. The context's own pool, if it had made one,
+ *		    is freed.
+ ***/
+void fit_context_set_pool(fit_context_t * ctx, fit_pool_t * pool)
+{
+  if (ctx->own_pool)
+    fit_pool_free(ctx->pool);
+  ctx->pool = pool;
+  ctx->own_pool = false;
+}
 
-  /* Initialize fdf structure */
-  gsl_multifit_nlinear_fdf fdf = (gsl_multifit_nlinear_fdf){
-    .f = surface_f,
-    .df = NULL, /* Use the finite difference Jacobian. */
-    .fvv = NULL,
-    .n = data->empirical_data->size1,
-    .p = numcoef,
-    .params = data
-  };
+/*******************************************************************************
+ * FUNCTION:	    fit_context_free
+ *
+ * DESCRIPTION:	    Frees a context, and the outcome it holds.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The log isn't closed, nor a pool given by
+ *		    fit_context_set_pool() freed.
+ ***/
+void fit_context_free(fit_context_t * ctx)
+{
+  if (ctx == NULL)
+    return;
+  if (ctx->own_pool)
+    fit_pool_free(ctx->pool);
+  free(ctx);
+}
 
-  /* Allocate the solver */
-  gsl_multifit_nlinear_workspace * w =
-    gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust,
-			       &params,
-			       data->empirical_data->size1,
-			       fdf.p);
+/*******************************************************************************
+ * FUNCTION:	    fit_context_result
+ *
+ * DESCRIPTION:	    The outcome of the last fit with a context.
+ *
+ * ARGUMENTS:	    ctx: (const fit_context_t *) -- the context.
+ *
+ * RETURN:	    const fit_result_t * -- the outcome, owned by the context
+ *		    and overwritten by its next fit.
+ *
+ * NOTES:	    result->p is 0 if the fit failed, or there was none.
+ ***/
+const fit_result_t * fit_context_result(const fit_context_t * ctx)
+{
+  return &ctx->result;
+}
 
-  /* Initialize the solver */
-  gsl_multifit_nlinear_winit(&view.vector, NULL, &fdf, w);
+/*******************************************************************************
+ * FUNCTION:	    fit_context_copy
+ *
+ * DESCRIPTION:	    Copies the coefficients of the last fit with a context to
+ *		    data->coefficients, and its statistics to data->gof.
+ *
+ * ARGUMENTS:	    ctx: (const fit_context_t *) -- the context.
+ *		    data: (fit_data_t *) -- struct to receive the outcome.
+ *
+ * RETURN:	    int -- 0 on success, -1 if there was no memory.
+ *
+ * NOTES:	    As for fit_surface(). The statistics are only copied if
+ *		    data->gof is set.
+ ***/
+int fit_context_copy(const fit_context_t * ctx, fit_data_t * data)
+{
+  if (copy_coefficients(data, &ctx->result) != 0)
+    return -1;
+  if (data->gof != NULL)
+    *data->gof = ctx->result.gof;
+  return 0;
+}
 
-  /* Compute the initial cost. */
-  gsl_vector * res = gsl_multifit_nlinear_residual(w);
-  double chisq0;
-  gsl_blas_ddot(res, res, &chisq0);
+/*******************************************************************************
+ * FUNCTION:	    fit_context_fit
+ *
+ * DESCRIPTION:	    Uses the GSL to perform a multiple polynomial regression
+ *		    with the TRS method using 'data'. The surface is linear in
+ *		    its coefficients, so unless data->solver asks for the
+ *		    trust region method, the least squares problem is solved
+ *		    directly instead, in one pass over the data. If
+ *		    data->triode is set, that model is fitted instead, by the
+ *		    trust region method with geodesic acceleration. The
+ *		    outcome is kept in the context, and logged to its log.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context.
+ *		    data: (const fit_data_t *) -- the data to fit; only read.
+ *
+ * RETURN:	    int --  0 on success, -1 otherwise.
+ *
+ * NOTES:	    The Jacobian is computed analytically by surface_df().
+ *		    Both methods give the same coefficients and errors, to
+ *		    within the tolerance of the trust region method; the
+ *		    direct one can't fail to converge. Iterations are only
+ *		    logged by the trust region method, which starts from 1 for
+ *		    every coefficient of a surface, or from the model's own
+ *		    starting point, if data->initial_values is NULL. The
+ *		    workspace and buffers are borrowed from the context's
+ *		    pool, so once it has some of this shape, a fit of data
+ *		    with samples allocates nothing. With data->loss, the
+ *		    plain fit is followed by reweighted ones in the same
+ *		    workspace, as described in robust.c. With data->rows,
+ *		    only those rows are fitted, in their order.
+ ***/
+int fit_context_fit(fit_context_t * ctx, const fit_data_t * data)
+{
+  ctx->data = *data;
+  ctx->data.coefficients = NULL;
+  memset(&ctx->result, 0, sizeof(fit_result_t));
+  if (data->triode == NULL && data->solver != FIT_SOLVER_NONLINEAR)
+    return fit_surface_linear(ctx);
 
-  /* Solve the system. */
-  int info, status;
-  status = gsl_multifit_nlinear_driver(20, xtol, gtol, ftol,
-				       call ? callback : NULL,
-				       NULL, &info, w);
+  /* Give surface_f() and surface_df() the columns for the length of the
+   * fit, unless the caller already has. Without them they are only
+   * slower. */
+  bool own_samples = data->samples == NULL;
+  if (own_samples)
+    ctx->data.samples = fit_samples_alloc(data->empirical_data);
+  int status = fit_surface_nonlinear(ctx);
+  if (own_samples)
+    fit_samples_free(ctx->data.samples);
+  ctx->data.samples = NULL;
+  return status;
+}
 
-  /* Compute covariance of best fit parameters. */
-  gsl_matrix * Jacobian = gsl_multifit_nlinear_jac(w);
-  gsl_matrix * covar = gsl_matrix_alloc(fdf.p, fdf.p);
-  gsl_multifit_nlinear_covar(Jacobian, 0.0, covar);
+/*******************************************************************************
+ * FUNCTION:	    fit_context_stream
+ *
+ * DESCRIPTION:	    Fits the same surface as fit_context_fit(), but reads the
+ *		    data from <filename> a chunk at a time instead of from
+ *		    data->empirical_data. The surface is linear in its
+ *		    coefficients, so each row is folded into a (p+1)x(p+1)
+ *		    QR factor as it is read and the system is solved once at
+ *		    the end.
+ *		    Memory use doesn't depend on the size of the file.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context.
+ *		    data: (const fit_data_t *) -- the model to fit.
+ *			empirical_data and initial_values are not used.
+ *		    filename: (const char *) -- .csv file of (Ep, Eg, Ig) rows.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    The errors are computed as in fit_context_fit(), from the
+ *		    covariance (X^T X)^-1 scaled by the residual. Only the
+ *		    surfaces are linear, so data->triode must not be set.
+ *		    Nor may data->loss, since reweighting needs every
+ *		    residual at once.
+ ***/
+int fit_context_stream(fit_context_t * ctx, const fit_data_t * data,
+		       const char * filename)
+{
+  memset(&ctx->result, 0, sizeof(fit_result_t));
+  if (data->triode != NULL || data->loss != ROBUST_NONE)
+    return -1;
 
-  /* Compute final cost. */
-  double chisq1;
-  gsl_blas_ddot(res, res, &chisq1);
+  const poly_model_t * model = surface_model(data);
+  const size_t numcoef = model->nterms;
+  double * rows = NULL;
+  fit_buffers_t * buffers = NULL;
+  fit_pool_t * pool = context_pool(ctx);
 
-  /* Print the output. */
-  print_to_log(w, &fdf, info, status, covar, chisq0, chisq1,
-	       data->empirical_data->size1, fdf.p);
-
-  /* Fill the struct with the data */
-  data->coefficients = calloc(5, sizeof(fit_param_t));
-  if (data->coefficients == NULL)
-    return 1;
-  fit_param_t * parr = data->coefficients;
-  double c = GSL_MAX_DBL(1, sqrt(chisq1 / (fdf.n - fdf.p)));
-  for (int i = 0; i < 5; i++) {
-    parr[i].value = gsl_vector_get(w->x, i);
-    parr[i].error = c * sqrt(gsl_matrix_get(covar,i,i));
+  tuple_reader_t * reader = tuple_reader_open(filename, 3);
+  if (reader == NULL)
+    return -1;
+
+  if (pool == NULL
+      || (rows = malloc(FIT_STREAM_ROWS * 3 * sizeof(double))) == NULL
+      || (buffers = fit_pool_acquire(pool, NULL, 0, numcoef)) == NULL)
+    goto error_exit;
+
+  linfit_t * fit = buffers->linfit;
+  gsl_vector * c = buffers->c;
+  gsl_matrix * covar = buffers->covar;
+  linfit_reset(fit);
+
+  ssize_t got;
+  while ((got = tuple_reader_read(reader, rows, FIT_STREAM_ROWS)) > 0) {
+    for (ssize_t i = 0; i < got; i++) {
+      double x[POLY_MAX_TERMS];
+      double ep = rows[3 * i], eg = rows[3 * i + 1];
+      poly_basis(model, ep, eg, ep * ep, eg * eg, x);
+      linfit_add(fit, x, rows[3 * i + 2]);
+    }
   }
+  if (got == -1 || fit->n <= numcoef)
+    goto error_exit;
 
-  gsl_multifit_nlinear_free(w);
-  gsl_matrix_free(covar);
-  
+  double chisq;
+  int status = linfit_solve(fit, c, covar, &chisq);
+  print_terms(ctx->log, data);
+  print_stream_log(ctx->log, "streaming QR", fit, c, covar, chisq, status);
+  if (status != GSL_SUCCESS)
+    goto error_exit;
+  fill_coefficients(&ctx->result, fit, c, covar, chisq);
+  ctx->result.cost = 1.0;
+
+  tuple_reader_close(reader);
+  free(rows);
+  fit_pool_release(pool, buffers);
   return 0;
+
+ error_exit: {
+    tuple_reader_close(reader);
+    free(rows);
+    if (buffers != NULL) fit_pool_release(pool, buffers);
+    return -1;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_surface
+ *
+ * DESCRIPTION:	    Fits data with fit_context_fit(), in a context of its own,
+ *		    and copies the coefficients to data->coefficients. Many
+ *		    fits are better made in one context, with
+ *		    fit_context_copy(), which keeps its pool between them.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- struct containing the data to fit.
+ *		    call: (bool) -- log every iteration, too.
+ *		    outfh: (FILE *) -- the log, or NULL for stdout.
+ *
+ * RETURN:	    int --  0 on success, -1 otherwise.
+ *
+ * NOTES:	    data->coefficients must be NULL or from an earlier fit,
+ *		    whose storage is reused. The caller frees it with
+ *		    fit_coefficients_free().
+ ***/
+int fit_surface(fit_data_t * data, bool call, FILE * outfh)
+{
+  fit_context_t * ctx = fit_context_alloc(outfh ? outfh : stdout, call);
+  if (ctx == NULL)
+    return -1;
+
+  int status = fit_context_fit(ctx, data);
+  if (status == 0)
+    status = fit_context_copy(ctx, data);
+  fit_context_free(ctx);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_surface_stream
+ *
+ * DESCRIPTION:	    Fits data from <filename> with fit_context_stream(), in a
+ *		    context of its own, and copies the coefficients to
+ *		    data->coefficients.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- struct to receive the coefficients.
+ *			empirical_data and initial_values are not used.
+ *		    filename: (const char *) -- .csv file of (Ep, Eg, Ig) rows.
+ *		    outfh: (FILE *) -- log for the summary, or NULL for stdout.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    As for fit_surface().
+ ***/
+int fit_surface_stream(fit_data_t * data, const char * filename, FILE * outfh)
+{
+  fit_context_t * ctx = fit_context_alloc(outfh ? outfh : stdout, false);
+  if (ctx == NULL)
+    return -1;
+
+  int status = fit_context_stream(ctx, data, filename);
+  if (status == 0)
+    status = copy_coefficients(data, &ctx->result);
+  fit_context_free(ctx);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_coefficients_free
+ *
+ * DESCRIPTION:	    Frees the coefficients fit_surface() or
+ *		    fit_surface_stream() stored in <data>.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- the data.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    data->coefficients is set to NULL, so this may be called
+ *		    again.
+ ***/
+void fit_coefficients_free(fit_data_t * data)
+{
+  free(data->coefficients);
+  data->coefficients = NULL;
 }
 
 /*******************************************************************************
@@ -322,13 +763,19 @@ int plot(fit_data_t * data, bool png_output)
 
   /* Create the GNUPlot commands. */
   char *script = NULL, *fn = NULL, *plot = NULL, *total = NULL;
-  fit_param_t * parr = data->coefficients;
-  asprintf(&fn, COMMAND_FN,
-	   parr[0].value,
-	   parr[1].value,
-	   parr[2].value,
-	   parr[3].value,
-	   parr[4].value);
+  if (data->triode != NULL) {
+    fn = triode_expr(data);
+  } else {
+    const poly_model_t * model = surface_model(data);
+    double b[POLY_MAX_TERMS];
+    for (size_t j = 0; j < model->nterms; j++)
+      b[j] = data->coefficients[j].value;
+    char * expr = poly_expr(model, b, POLY_SYNTAX_GNUPLOT);
+    if (expr == NULL)
+      goto error_exit;
+    asprintf(&fn, COMMAND_FN, expr);
+    free(expr);
+  }
   if (fn == NULL)
     goto error_exit;
 
@@ -368,16 +815,581 @@ int plot(fit_data_t * data, bool png_output)
   }
 }
 
+/*******************************************************************************
+ * FUNCTION:	    fit_samples_alloc
+ *
+ * DESCRIPTION:	    Converts the empirical data from the row-major matrix it
+ *		    was loaded into to one array per column, which is what the
+ *		    kernels read. The columns share one block, each starts on
+ *		    a FIT_SAMPLES_ALIGN boundary, and each is padded with
+ *		    zeros to a whole number of vectors. The squares are
+ *		    stored too, computed here if the matrix doesn't have them,
+ *		    so no solver iteration computes them again.
+ *
+ * ARGUMENTS:	    values: (const gsl_matrix *) -- the empirical data, with
+ *			at least the Ep, Eg and Ig columns.
+ *
+ * RETURN:	    fit_samples_t * -- the columns, or NULL on failure.
+ *
+ * NOTES:	    Meant to be called once per dataset, as soon as it is
+ *		    loaded; fit_surface() only makes its own if it isn't
+ *		    given one.
+ ***/
+fit_samples_t * fit_samples_alloc(const gsl_matrix * values)
+{
+  if (values->size2 < FIT_IG + 1)
+    return NULL;
+
+  const size_t vector = FIT_SAMPLES_ALIGN / sizeof(double);
+  size_t n = values->size1;
+  size_t stride = (n + vector - 1) / vector * vector;
+  fit_samples_t * samples = malloc(sizeof(fit_samples_t));
+  if (samples == NULL)
+    return NULL;
+  if (posix_memalign((void **)&samples->block, FIT_SAMPLES_ALIGN,
+		     FIT_NCOLUMNS * stride * sizeof(double)) != 0) {
+    free(samples);
+    return NULL;
+  }
+  samples->n = n;
+  samples->stride = stride;
+  for (size_t j = 0; j < FIT_NCOLUMNS; j++)
+    samples->column[j] = samples->block + j * stride;
+
+  fit_samples_fill(samples, values);
+  return samples;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_samples_fill
+ *
+ * DESCRIPTION:	    Writes the empirical data over the columns of samples
+ *		    made earlier, as fit_samples_alloc() would make them, so
+ *		    that data which changes between fits, such as the
+ *		    replicates of a bootstrap, needn't allocate its columns
+ *		    again.
+ *
+ * ARGUMENTS:	    samples: (fit_samples_t *) -- the columns.
+ *		    values: (const gsl_matrix *) -- the empirical data, with
+ *			at least the Ep, Eg and Ig columns, and no more rows
+ *			than samples->stride.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the data doesn't fit.
+ *
+ * NOTES:	    samples->n becomes the number of rows.
+ ***/
+int fit_samples_fill(fit_samples_t * samples, const gsl_matrix * values)
+{
+  size_t n = values->size1, stride = samples->stride;
+  if (values->size2 < FIT_IG + 1 || n > stride)
+    return -1;
+
+  samples->n = n;
+  double ** column = samples->column;
+  bool squares = values->size2 >= FIT_NCOLUMNS;
+  for (size_t i = 0; i < n; i++) {
+    const double * row = gsl_matrix_const_ptr(values, i, 0);
+    column[FIT_EP][i] = row[FIT_EP];
+    column[FIT_EG][i] = row[FIT_EG];
+    column[FIT_IG][i] = row[FIT_IG];
+    column[FIT_EP2][i] = squares ? row[FIT_EP2] : row[FIT_EP] * row[FIT_EP];
+    column[FIT_EG2][i] = squares ? row[FIT_EG2] : row[FIT_EG] * row[FIT_EG];
+  }
+
+  for (size_t j = 0; j < FIT_NCOLUMNS; j++)
+    memset(column[j] + n, 0, (stride - n) * sizeof(double));
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_samples_free
+ *
+ * DESCRIPTION:	    Frees the columns made by fit_samples_alloc().
+ *
+ * ARGUMENTS:	    samples: (fit_samples_t *) -- the columns, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void fit_samples_free(fit_samples_t * samples)
+{
+  if (samples == NULL)
+    return;
+
+  free(samples->block);
+  free(samples);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    jacobian_covar
+ *
+ * DESCRIPTION:	    Computes the covariance (J^T J)^-1 of the coefficients
+ *		    into buffers->covar, by folding the rows of J into the
+ *		    borrowed QR factor and inverting it with linfit_solve(),
+ *		    as fit_surface_linear() does. multistart.c uses it too.
+ *
+ * ARGUMENTS:	    J: (const gsl_matrix *) -- the n x p Jacobian.
+ *		    buffers: (fit_buffers_t *) -- the borrowed buffers.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Used instead of gsl_multifit_nlinear_covar(), which
+ *		    allocates a copy of J every time. If J is rank deficient,
+ *		    the covariance is filled with NaN, so that the errors of
+ *		    the coefficients are NaN rather than a misleading 0.
+ ***/
+void jacobian_covar(const gsl_matrix * J, fit_buffers_t * buffers)
+{
+  linfit_reset(buffers->linfit);
+  for (size_t i = 0; i < J->size1; i++)
+    linfit_add(buffers->linfit, gsl_matrix_const_ptr(J, i, 0), 0.0);
+  if (linfit_solve(buffers->linfit, buffers->c, buffers->covar, NULL)
+      != GSL_SUCCESS)
+    gsl_matrix_set_all(buffers->covar, GSL_NAN);
+}
+
 /*******************************************************************************
  * STATIC FUNCTIONS
  ***/
 
+/*******************************************************************************
+ * FUNCTION:	    fit_surface_linear
+ *
+ * DESCRIPTION:	    Fits the surface to data->empirical_data by linear least
+ *		    squares. Each row of the design matrix is folded into a
+ *		    QR factor with linfit_add(), and the triangular system is
+ *		    solved once at the end, with no iteration.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, holding the data.
+ *			initial_values is not used.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise, including when the data
+ *		    doesn't determine every coefficient.
+ *
+ * NOTES:	    The errors are computed as in fit_surface_nonlinear(),
+ *		    from the covariance (X^T X)^-1, which is (J^T J)^-1 for
+ *		    the Jacobian of surface_f(). A robust fit is reweighted
+ *		    by reweight_linear().
+ ***/
+static int fit_surface_linear(fit_context_t * ctx)
+{
+  const fit_data_t * data = &ctx->data;
+  const size_t numcoef = surface_model(data)->nterms;
+  size_t n = sample_count(data);
+  fit_pool_t * pool = context_pool(ctx);
+  fit_buffers_t * buffers = NULL;
+
+  if (n <= numcoef || pool == NULL
+      || (buffers = fit_pool_acquire(pool, NULL, n, numcoef)) == NULL)
+    goto error_exit;
+
+  linfit_t * fit = buffers->linfit;
+  gsl_vector * c = buffers->c;
+  gsl_matrix * covar = buffers->covar;
+  linfit_reset(fit);
+
+  for (size_t i = 0; i < n; i++) {
+    double x[POLY_MAX_TERMS], ep, eg;
+    surface_regressors(data, i, x);
+    linfit_add(fit, x, sample_at(data, i, &ep, &eg));
+  }
+
+  double chisq;
+  int status = linfit_solve(fit, c, covar, &chisq);
+  ctx->result.cost = 1.0;
+  if (status == GSL_SUCCESS && data->loss != ROBUST_NONE)
+    status = reweight_linear(ctx, buffers, &chisq);
+  print_terms(ctx->log, data);
+  print_stream_log(ctx->log, "linear least squares (QR)", fit, c, covar,
+		   chisq, status);
+  if (status != GSL_SUCCESS)
+    goto error_exit;
+  fill_coefficients(&ctx->result, fit, c, covar, chisq);
+  print_robust_log(ctx->log, data, &ctx->result);
+
+  /* QR keeps no residuals, so compute them for the statistics. */
+  surface_f(c, (void *)data, buffers->work);
+  fit_gof(ctx, buffers->work);
+
+  fit_pool_release(pool, buffers);
+  return 0;
+
+ error_exit: {
+    if (buffers != NULL) fit_pool_release(pool, buffers);
+    return -1;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_surface_nonlinear
+ *
+ * DESCRIPTION:	    Fits the surface, or the triode model, to the data of the
+ *		    context by the trust region method, and keeps the outcome
+ *		    in the context.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, holding the data.
+ *
+ * RETURN:	    int --  0 on success, -1 if there was no memory.
+ *
+ * NOTES:	    A fit which stops at the iteration limit still succeeds;
+ *		    result->status says why it stopped. The workspace is
+ *		    borrowed from the context's pool. The log of a robust fit
+ *		    counts the iterations of its last pass.
+ ***/
+static int fit_surface_nonlinear(fit_context_t * ctx)
+{
+  const fit_data_t * data = &ctx->data;
+  const triode_model_t * triode = data->triode;
+  size_t numcoef = triode ? triode->p : surface_model(data)->nterms;
+  double ones[POLY_MAX_TERMS];
+  for (size_t j = 0; j < numcoef; j++)
+    ones[j] = 1.0;
+  const double * initial = data->initial_values ? data->initial_values
+    : triode ? triode->initial : ones;
+  gsl_vector_const_view view = gsl_vector_const_view_array(initial, numcoef);
+
+  gsl_multifit_nlinear_parameters params;
+  trust_params(&data->method, triode != NULL, &params);
+
+  /* Initialize fdf structure */
+  gsl_multifit_nlinear_fdf fdf = (gsl_multifit_nlinear_fdf){
+    .f = triode ? triode_f : surface_f,
+    .df = triode ? triode_df : surface_df,
+    .fvv = triode ? triode_fvv : NULL,
+    .n = sample_count(data),
+    .p = numcoef,
+    .params = (void *)data
+  };
+
+  /* Borrow the solver */
+  fit_pool_t * pool = context_pool(ctx);
+  fit_buffers_t * buffers = pool == NULL ? NULL
+    : fit_pool_acquire(pool, &params, fdf.n, fdf.p);
+  if (buffers == NULL)
+    return -1;
+  gsl_multifit_nlinear_workspace * w = buffers->w;
+  gsl_matrix * covar = buffers->covar;
+
+  /* Initialize the solver */
+  gsl_multifit_nlinear_winit(&view.vector, NULL, &fdf, w);
+
+  /* Compute the initial cost. */
+  gsl_vector * res = gsl_multifit_nlinear_residual(w);
+  double chisq0;
+  gsl_blas_ddot(res, res, &chisq0);
+
+  /* Solve the system, then reweight it if the fit is robust. */
+  fit_result_t * result = &ctx->result;
+  int info, status;
+  status = trust_driver(&data->method, TRUST_MAX_ITER,
+			ctx->iterations ? callback : NULL, ctx, &info, w);
+  count_evaluations(result, &fdf, w);
+  double plain = result->nevalf + result->nevaldf + result->nevalfvv;
+  if (data->loss != ROBUST_NONE)
+    status = reweight_nonlinear(ctx, &fdf, buffers, &info);
+  result->cost = (result->nevalf + result->nevaldf + result->nevalfvv)
+    / plain;
+
+  /* Compute covariance of best fit parameters. */
+  gsl_matrix * Jacobian = gsl_multifit_nlinear_jac(w);
+  jacobian_covar(Jacobian, buffers);
+
+  /* Compute final cost. */
+  double chisq1;
+  gsl_blas_ddot(res, res, &chisq1);
+
+  /* Print the output. */
+  print_terms(ctx->log, data);
+  print_to_log(ctx->log, w, &fdf, info, status, covar, chisq0, chisq1,
+	       fdf.n, fdf.p);
+  print_robust_log(ctx->log, data, result);
+
+  /* Fill the result with the data */
+  double c = GSL_MAX_DBL(1, sqrt(chisq1 / (fdf.n - fdf.p)));
+  for (size_t i = 0; i < numcoef; i++) {
+    result->coefficients[i].value = gsl_vector_get(w->x, i);
+    result->coefficients[i].error = c * sqrt(gsl_matrix_get(covar,i,i));
+  }
+  result->p = numcoef;
+  result->n = fdf.n;
+  result->chisq0 = chisq0;
+  result->chisq = chisq1;
+  result->info = info;
+  result->status = status;
+
+  /* The solver holds the residuals, weighted if the fit is robust. */
+  if (data->loss != ROBUST_NONE) {
+    fdf.f(w->x, fdf.params, buffers->work);
+    res = buffers->work;
+  }
+  fit_gof(ctx, res);
+
+  fit_pool_release(pool, buffers);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    reweight_linear
+ *
+ * DESCRIPTION:	    Refits the surface by iteratively reweighted least
+ *		    squares, from the plain fit in <buffers>, until the
+ *		    coefficients stop moving. Each pass weighs the residuals
+ *		    of the last and folds the weighted rows into the same QR
+ *		    factor again.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, holding the data.
+ *		    buffers: (fit_buffers_t *) -- the plain fit, with weights.
+ *		    chisq: (double *) -- location for the weighted residual
+ *			sum of squares.
+ *
+ * RETURN:	    int -- the status of the last linfit_solve().
+ *
+ * NOTES:	    Each pass reads the samples twice, once for the residuals
+ *		    and once for the rows, so it costs two plain fits.
+ ***/
+static int reweight_linear(fit_context_t * ctx, fit_buffers_t * buffers,
+			   double * chisq)
+{
+  const fit_data_t * data = &ctx->data;
+  size_t n = sample_count(data);
+  fit_result_t * result = &ctx->result;
+  double k = robust_tuning(data->loss, data->tuning);
+  size_t p = buffers->c->size;
+  double previous[POLY_MAX_TERMS];
+  gsl_vector_view last = gsl_vector_view_array(previous, p);
+  int status = GSL_SUCCESS;
+
+  for (size_t pass = 0; pass < ROBUST_MAX_PASSES; pass++) {
+    gsl_vector_memcpy(&last.vector, buffers->c);
+    for (size_t i = 0; i < n; i++) {
+      double x[POLY_MAX_TERMS], fit = 0.0, ep, eg;
+      surface_regressors(data, i, x);
+      for (size_t j = 0; j < p; j++)
+	fit += x[j] * previous[j];
+      gsl_vector_set(buffers->work, i, sample_at(data, i, &ep, &eg) - fit);
+    }
+    result->scale = robust_weights(data->loss, k, buffers->work,
+				   buffers->weights);
+
+    linfit_reset(buffers->linfit);
+    for (size_t i = 0; i < n; i++) {
+      double x[POLY_MAX_TERMS], ep, eg;
+      double s = sqrt(gsl_vector_get(buffers->weights, i));
+      surface_regressors(data, i, x);
+      for (size_t j = 0; j < p; j++)
+	x[j] *= s;
+      linfit_add(buffers->linfit, x, s * sample_at(data, i, &ep, &eg));
+    }
+    status = linfit_solve(buffers->linfit, buffers->c, buffers->covar,
+			  chisq);
+    result->reweights++;
+    result->cost += 2.0;
+    if (status != GSL_SUCCESS
+	|| robust_converged(&last.vector, buffers->c))
+      break;
+  }
+
+  result->outliers = robust_outliers(buffers->weights);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    reweight_nonlinear
+ *
+ * DESCRIPTION:	    Refits the model by iteratively reweighted least squares,
+ *		    from where the plain fit in the workspace ended, until the
+ *		    coefficients stop moving. Each pass weighs the residuals
+ *		    of the last and restarts the trust region method from its
+ *		    coefficients with those weights.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, holding the data.
+ *		    fdf: (gsl_multifit_nlinear_fdf *) -- the model.
+ *		    buffers: (fit_buffers_t *) -- the workspace of the plain
+ *			fit, with weights.
+ *		    info: (int *) -- location for why the last pass stopped.
+ *
+ * RETURN:	    int -- the status of the last pass.
+ *
+ * NOTES:	    The weights are written over those of the last pass, and
+ *		    gsl_multifit_nlinear_winit() takes them into the same
+ *		    workspace, so nothing is allocated. The counts of every
+ *		    pass, and the residuals computed for the weights, are
+ *		    added to the context's result.
+ ***/
+static int reweight_nonlinear(fit_context_t * ctx,
+			      gsl_multifit_nlinear_fdf * fdf,
+			      fit_buffers_t * buffers, int * info)
+{
+  const fit_data_t * data = &ctx->data;
+  fit_result_t * result = &ctx->result;
+  gsl_multifit_nlinear_workspace * w = buffers->w;
+  double k = robust_tuning(data->loss, data->tuning);
+  int status = GSL_SUCCESS;
+
+  for (size_t pass = 0; pass < ROBUST_MAX_PASSES; pass++) {
+    gsl_vector_memcpy(buffers->c, gsl_multifit_nlinear_position(w));
+    fdf->f(buffers->c, fdf->params, buffers->work);
+    result->nevalf++;
+    result->scale = robust_weights(data->loss, k, buffers->work,
+				   buffers->weights);
+
+    gsl_multifit_nlinear_winit(buffers->c, buffers->weights, fdf, w);
+    status = trust_driver(&data->method, TRUST_MAX_ITER,
+			  ctx->iterations ? callback : NULL, ctx, info, w);
+    count_evaluations(result, fdf, w);
+    result->reweights++;
+    if (robust_converged(buffers->c, gsl_multifit_nlinear_position(w)))
+      break;
+  }
+
+  result->outliers = robust_outliers(buffers->weights);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    count_evaluations
+ *
+ * DESCRIPTION:	    Adds the counts of one run of the trust region method to
+ *		    a result.
+ *
+ * ARGUMENTS:	    result: (fit_result_t *) -- the result.
+ *		    fdf: (const gsl_multifit_nlinear_fdf *) -- the model.
+ *		    w: (const gsl_multifit_nlinear_workspace *) -- the solver.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    gsl_multifit_nlinear_winit() clears the counts of <fdf>,
+ *		    so they are added up after every run.
+ ***/
+static void count_evaluations(fit_result_t * result,
+			      const gsl_multifit_nlinear_fdf * fdf,
+			      const gsl_multifit_nlinear_workspace * w)
+{
+  result->niter += gsl_multifit_nlinear_niter(w);
+  result->nevalf += fdf->nevalf;
+  result->nevaldf += fdf->nevaldf;
+  result->nevalfvv += fdf->nevalfvv;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fill_coefficients
+ *
+ * DESCRIPTION:	    Fills a result from a linear least squares solution,
+ *		    scaling the errors as fit_surface_nonlinear() does.
+ *
+ * ARGUMENTS:	    result: (fit_result_t *) -- the result.
+ *		    fit: (const linfit_t *) -- the factorization.
+ *		    c: (const gsl_vector *) -- the coefficients.
+ *		    covar: (const gsl_matrix *) -- their covariance.
+ *		    chisq: (double) -- the residual sum of squares.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void fill_coefficients(fit_result_t * result, const linfit_t * fit,
+			      const gsl_vector * c, const gsl_matrix * covar,
+			      double chisq)
+{
+  fit_param_t * parr = result->coefficients;
+  double scale = GSL_MAX_DBL(1, sqrt(chisq / (fit->n - fit->p)));
+  for (size_t i = 0; i < fit->p; i++) {
+    parr[i].value = gsl_vector_get(c, i);
+    parr[i].error = scale * sqrt(gsl_matrix_get(covar, i, i));
+  }
+  result->p = fit->p;
+  result->n = fit->n;
+  result->chisq = chisq;
+  result->status = GSL_SUCCESS;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    copy_coefficients
+ *
+ * DESCRIPTION:	    Copies the coefficients of a result to data->coefficients,
+ *		    for fit_context_copy() and plot().
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- struct to receive the coefficients.
+ *		    result: (const fit_result_t *) -- the result.
+ *
+ * RETURN:	    int -- 0 on success, -1 if there was no memory.
+ *
+ * NOTES:	    Coefficients from an earlier fit are reallocated, rather
+ *		    than leaked.
+ ***/
+static int copy_coefficients(fit_data_t * data, const fit_result_t * result)
+{
+  fit_param_t * coefficients = realloc(data->coefficients,
+				       result->p * sizeof(fit_param_t));
+  if (coefficients == NULL)
+    return -1;
+  data->coefficients = coefficients;
+  memcpy(data->coefficients, result->coefficients,
+	 result->p * sizeof(fit_param_t));
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_gof
+ *
+ * DESCRIPTION:	    Computes the statistics of the residuals of the fit in
+ *		    the context, with gof_compute(), into its result.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context, holding the data.
+ *		    f: (const gsl_vector *) -- the unweighted residuals of
+ *			the fit.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Eg and Ig are read from the samples if the data has
+ *		    them, and from the matrix otherwise. A fit of a subset of
+ *		    the rows is left without statistics, since gof_compute()
+ *		    reads the columns in order.
+ ***/
+static void fit_gof(fit_context_t * ctx, const gsl_vector * f)
+{
+  const fit_data_t * data = &ctx->data;
+  fit_result_t * result = &ctx->result;
+  if (data->rows != NULL)
+    return;
+  else if (data->samples != NULL) {
+    gof_compute(&result->gof, f, data->samples->column[FIT_EG],
+		data->samples->column[FIT_IG], 1, result->p);
+  } else {
+    const gsl_matrix * values = data->empirical_data;
+    gof_compute(&result->gof, f, gsl_matrix_const_ptr(values, 0, FIT_EG),
+		gsl_matrix_const_ptr(values, 0, FIT_IG), values->tda,
+		result->p);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    context_pool
+ *
+ * DESCRIPTION:	    The pool a context borrows from: the one it was given, or
+ *		    else one of its own, made the first time it is needed.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context.
+ *
+ * RETURN:	    fit_pool_t * -- the pool, or NULL if there was no memory.
+ *
+ * NOTES:	    none.
+ ***/
+static fit_pool_t * context_pool(fit_context_t * ctx)
+{
+  if (ctx->pool == NULL && (ctx->pool = fit_pool_alloc()) != NULL)
+    ctx->own_pool = true;
+  return ctx->pool;
+}
+
 /*******************************************************************************
  * FUNCTION:	    print_to_log
  *
  * DESCRIPTION:	    Print the results to the output file.
  *
- * ARGUMENTS:	    w: (gsl_multifit_nlinear_workspace *) -- resultant data.
+ * ARGUMENTS:	    log: (FILE *) -- the log, or NULL to print nothing.
+ *		    w: (gsl_multifit_nlinear_workspace *) -- resultant data.
  *		    fdf: (gsl_multifit_nlinear_fdf *) -- resultant data.
  *		    info: (int) -- resultant data.
  *		    status: (int) -- resultant data.
@@ -389,7 +1401,8 @@ int plot(fit_data_t * data, bool png_output)
  *
  * NOTES:	    none.
  ***/
-static int print_to_log(gsl_multifit_nlinear_workspace * w,
+static int print_to_log(FILE * log,
+			gsl_multifit_nlinear_workspace * w,
 			gsl_multifit_nlinear_fdf * fdf,
 			int info,
 			int status,
@@ -399,36 +1412,114 @@ static int print_to_log(gsl_multifit_nlinear_workspace * w,
 			size_t n,
 			size_t p)
 {
-  fprintf(surface_log, "Summary from method: '%s'\n",
+  if (log == NULL)
+    return 0;
+
+  fprintf(log, "Summary from method: '%s'\n",
 	  gsl_multifit_nlinear_trs_name(w));
-  fprintf(surface_log, "Number of iterations: %zu\n",
+  fprintf(log, "Number of iterations: %zu\n",
 	  gsl_multifit_nlinear_niter(w));
-  fprintf(surface_log, "Function evaluations: %zu\n", fdf->nevalf);
-  fprintf(surface_log, "Jacobian evaluations: %zu\n", fdf->nevaldf);
-  fprintf(surface_log, "Reason for stopping: %s\n",
+  fprintf(log, "Function evaluations: %zu\n", fdf->nevalf);
+  fprintf(log, "Jacobian evaluations: %zu\n", fdf->nevaldf);
+  if (fdf->fvv != NULL)
+    fprintf(log, "fvv evaluations: %zu\n", fdf->nevalfvv);
+  fprintf(log, "Reason for stopping: %s\n",
 	  (info == 1) ? "small step size" : "small gradient");
-  fprintf(surface_log, "Initial |f(x)| = %f\n", sqrt(chisq0));
-  fprintf(surface_log, "Final   |f(x)| = %f\n", sqrt(chisq1));
+  fprintf(log, "Initial |f(x)| = %f\n", sqrt(chisq0));
+  fprintf(log, "Final   |f(x)| = %f\n", sqrt(chisq1));
 
   double dof = n - p;
   double c = GSL_MAX_DBL(1, sqrt(chisq1 / dof));
-  fprintf(surface_log, "(Chi^2)/dof = %g\n", chisq1 / dof);
-
-  fprintf (surface_log, "B_0 = %.5f +/- %.5f\n", gsl_vector_get(w->x, 0),
-	   c * sqrt(gsl_matrix_get(covar,0,0)));
-  fprintf (surface_log, "B_1 = %.5f +/- %.5f\n", gsl_vector_get(w->x, 1),
-	   c * sqrt(gsl_matrix_get(covar,1,1)));
-  fprintf (surface_log, "B_2 = %.5f +/- %.5f\n", gsl_vector_get(w->x, 2),
-	   c * sqrt(gsl_matrix_get(covar,2,2)));
-  fprintf (surface_log, "B_3 = %.5f +/- %.5f\n", gsl_vector_get(w->x, 3),
-	   c * sqrt(gsl_matrix_get(covar,3,3)));
-  fprintf (surface_log, "B_4 = %.5f +/- %.5f\n", gsl_vector_get(w->x, 4),
-	   c * sqrt(gsl_matrix_get(covar,4,4)));
+  fprintf(log, "(Chi^2)/dof = %g\n", chisq1 / dof);
+
+  for (size_t i = 0; i < p; i++) {
+    fprintf (log, "B_%zu = %.5f +/- %.5f\n", i,
+	     gsl_vector_get(w->x, i), c * sqrt(gsl_matrix_get(covar, i, i)));
+  }
   
-  fprintf (surface_log, "status = %s\n", gsl_strerror (status));
+  fprintf (log, "status = %s\n", gsl_strerror (status));
   return 0;
 }
 
+/*******************************************************************************
+ * FUNCTION:	    print_stream_log
+ *
+ * DESCRIPTION:	    Print the results of a linear least squares fit, from
+ *		    fit_surface_stream() or fit_surface_linear(), to the
+ *		    output file.
+ *
+ * ARGUMENTS:	    log: (FILE *) -- the log, or NULL to print nothing.
+ *		    method: (const char *) -- the name of the method.
+ *		    fit: (const linfit_t *) -- the accumulated factorization.
+ *		    c: (const gsl_vector *) -- the coefficients.
+ *		    covar: (const gsl_matrix *) -- their covariance.
+ *		    chisq: (double) -- the residual sum of squares.
+ *		    status: (int) -- result of linfit_solve().
+ *
+ * RETURN:	    0
+ *
+ * NOTES:	    none.
+ ***/
+static int print_stream_log(FILE * log,
+			    const char * method,
+			    const linfit_t * fit,
+			    const gsl_vector * c,
+			    const gsl_matrix * covar,
+			    double chisq,
+			    int status)
+{
+  if (log == NULL)
+    return 0;
+
+  fprintf(log, "Summary from method: '%s'\n", method);
+  fprintf(log, "Rows: %zu\n", fit->n);
+  if (status != GSL_SUCCESS) {
+    fprintf(log, "status = %s\n", gsl_strerror(status));
+    return 0;
+  }
+
+  fprintf(log, "Final   |f(x)| = %f\n", sqrt(chisq));
+
+  double dof = fit->n - fit->p;
+  double scale = GSL_MAX_DBL(1, sqrt(chisq / dof));
+  fprintf(log, "(Chi^2)/dof = %g\n", chisq / dof);
+
+  for (size_t i = 0; i < fit->p; i++) {
+    fprintf(log, "B_%zu = %.5f +/- %.5f\n", i, gsl_vector_get(c, i),
+	    scale * sqrt(gsl_matrix_get(covar, i, i)));
+  }
+
+  fprintf(log, "status = %s\n", gsl_strerror(status));
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    print_robust_log
+ *
+ * DESCRIPTION:	    Print how a robust fit was reweighted, and what it cost,
+ *		    to the output file.
+ *
+ * ARGUMENTS:	    log: (FILE *) -- the log, or NULL to print nothing.
+ *		    data: (const fit_data_t *) -- the data, with the loss.
+ *		    result: (const fit_result_t *) -- the outcome.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Prints nothing for a plain least squares fit.
+ ***/
+static void print_robust_log(FILE * log, const fit_data_t * data,
+			     const fit_result_t * result)
+{
+  if (log == NULL || data->loss == ROBUST_NONE)
+    return;
+
+  fprintf(log, "Robust loss: %s, k = %g\n", robust_name(data->loss),
+	  robust_tuning(data->loss, data->tuning));
+  fprintf(log, "Reweighted passes: %zu, scale = %g, outliers = %zu\n",
+	  result->reweights, result->scale, result->outliers);
+  fprintf(log, "Cost: %.2fx a plain fit\n", result->cost);
+}
+
 /*******************************************************************************
  * FUNCTION:	    tmp_write_data
  *
@@ -456,4 +1547,196 @@ static int tmp_write_data(fit_data_t * fit_data, FILE * tmpfd)
   return 0;
 }
 
+/*******************************************************************************
+ * FUNCTION:	    print_terms
+ *
+ * DESCRIPTION:	    Print the terms of the surface, or the names of the
+ *		    triode model's coefficients, in the order of the
+ *		    coefficients B_0, B_1, ..., to the output file.
+ *
+ * ARGUMENTS:	    log: (FILE *) -- the log, or NULL to print nothing.
+ *		    data: (const fit_data_t *) -- the data being fitted.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void print_terms(FILE * log, const fit_data_t * data)
+{
+  if (log == NULL)
+    return;
+
+  const triode_model_t * triode = data->triode;
+  if (triode != NULL) {
+    fprintf(log, "Model: %s (", triode->name);
+    for (size_t j = 0; j < triode->p; j++)
+      fprintf(log, "%s%s", j > 0 ? ", " : "", triode->params[j]);
+    fprintf(log, ")\n");
+    return;
+  }
+
+  const poly_model_t * model = surface_model(data);
+  fprintf(log, "Terms:");
+  for (size_t j = 0; j < model->nterms; j++) {
+    char name[64];
+    poly_term_name(model->term[j], POLY_SYNTAX_TEXT, name, sizeof(name));
+    fprintf(log, "%s %s", j > 0 ? "," : "", name);
+  }
+  fprintf(log, " (%s kernel)\n", poly_kernel_name(model->kernel));
+}
+
+/*******************************************************************************
+ * FUNCTION:	    triode_expr
+ *
+ * DESCRIPTION:	    Writes the fitted triode model as gnuplot commands: one
+ *		    assignment for each coefficient, then f(x,y).
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the fitted data.
+ *
+ * RETURN:	    char * -- the commands, or NULL if there was no memory.
+ *
+ * NOTES:	    The caller frees the commands.
+ ***/
+static char * triode_expr(const fit_data_t * data)
+{
+  char * expr = NULL;
+  size_t size = 0;
+  FILE * stream = open_memstream(&expr, &size);
+  if (stream == NULL)
+    return NULL;
+
+  for (size_t j = 0; j < data->triode->p; j++)
+    fprintf(stream, "b%zu = %.10g; ", j, data->coefficients[j].value);
+  fprintf(stream, COMMAND_FN, data->triode->gnuplot);
+  if (fclose(stream) != 0) {
+    free(expr);
+    return NULL;
+  }
+  return expr;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    surface_regressors
+ *
+ * DESCRIPTION:	    Computes the terms of the surface at sample <i>, which are
+ *		    the regressors of the fit. The voltages are read from the
+ *		    samples if the data has them, and otherwise from the
+ *		    matrix, where the squares come from the FIT_EP2 and
+ *		    FIT_EG2 columns if it has them, as in surface_f().
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the empirical data.
+ *		    i: (size_t) -- the sample.
+ *		    x: (double *) -- location for the model's terms.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void surface_regressors(const fit_data_t * data, size_t i,
+			       double * x)
+{
+  const poly_model_t * model = surface_model(data);
+  i = sample_row(data, i);
+  if (data->samples != NULL) {
+    double * const * column = data->samples->column;
+    poly_basis(model, column[FIT_EP][i], column[FIT_EG][i],
+	       column[FIT_EP2][i], column[FIT_EG2][i], x);
+    return;
+  }
+
+  const gsl_matrix * values = data->empirical_data;
+  double ep = gsl_matrix_get(values, i, FIT_EP);
+  double eg = gsl_matrix_get(values, i, FIT_EG);
+  bool squares = values->size2 >= FIT_NCOLUMNS;
+  poly_basis(model, ep, eg,
+	     squares ? gsl_matrix_get(values, i, FIT_EP2) : ep * ep,
+	     squares ? gsl_matrix_get(values, i, FIT_EG2) : eg * eg, x);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    surface_model
+ *
+ * DESCRIPTION:	    The surface a fit is of.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the data being fitted.
+ *
+ * RETURN:	    const poly_model_t * -- data->model, or poly_quadratic if
+ *		    it isn't set.
+ *
+ * NOTES:	    none.
+ ***/
+static inline const poly_model_t * surface_model(const fit_data_t * data)
+{
+  return data->model != NULL ? data->model : &poly_quadratic;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    sample_at
+ *
+ * DESCRIPTION:	    Reads sample <i>, from the samples if the data has them
+ *		    and from the matrix otherwise, through data->rows if it
+ *		    is set.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the empirical data.
+ *		    i: (size_t) -- the sample.
+ *		    ep, eg: (double *) -- locations for the plate and grid
+ *			voltages.
+ *
+ * RETURN:	    double -- the plate current.
+ *
+ * NOTES:	    none.
+ ***/
+static inline double sample_at(const fit_data_t * data, size_t i, double * ep,
+			       double * eg)
+{
+  i = sample_row(data, i);
+  if (data->samples != NULL) {
+    double * const * column = data->samples->column;
+    *ep = column[FIT_EP][i];
+    *eg = column[FIT_EG][i];
+    return column[FIT_IG][i];
+  }
+
+  const double * row = gsl_matrix_const_ptr(data->empirical_data, i, 0);
+  *ep = row[FIT_EP];
+  *eg = row[FIT_EG];
+  return row[FIT_IG];
+}
+
+/*******************************************************************************
+ * FUNCTION:	    sample_count
+ *
+ * DESCRIPTION:	    The number of samples in the data, or in data->rows if
+ *		    it is set.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the empirical data.
+ *
+ * RETURN:	    size_t -- the number of samples.
+ *
+ * NOTES:	    none.
+ ***/
+static inline size_t sample_count(const fit_data_t * data)
+{
+  return data->rows != NULL ? data->nrows
+    : data->samples != NULL ? data->samples->n
+    : data->empirical_data->size1;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    sample_row
+ *
+ * DESCRIPTION:	    The row of the data that holds sample <i>.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the empirical data.
+ *		    i: (size_t) -- the sample.
+ *
+ * RETURN:	    size_t -- data->rows[i], or <i> if every row is fitted.
+ *
+ * NOTES:	    none.
+ ***/
+static inline size_t sample_row(const fit_data_t * data, size_t i)
+{
+  return data->rows != NULL ? data->rows[i] : i;
+}
+
 /******************************************************************************/
@@ -0,0 +1,375 @@
+/*******************************************************************************
+ * NAME:	    fitpool.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    A pool of solver workspaces and covariance buffers, keyed
+ *		    by the method and the shape of the fit, so that fits of
+ *		    same-shaped datasets allocate nothing once the pool has
+ *		    warmed up.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multifit_nlinear.h>
+
+#include "fitpool.h"
+#include "linfit.h"
+#include "linkedlist.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One set of buffers, and the key it was made for. */
+typedef struct fit_pool_entry {
+  fit_buffers_t buffers; /* First, so buffers can be cast back. */
+  bool linear;
+  gsl_multifit_nlinear_parameters params;
+  size_t n;
+  size_t p;
+  bool in_use;
+  size_t used; /* The pool's clock when last lent out. */
+} fit_pool_entry_t;
+
+struct fit_pool {
+  pthread_mutex_t lock;
+  List entries;
+  size_t clock; /* Counts acquisitions, to find the least recently used. */
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+};
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static bool same_params(const gsl_multifit_nlinear_parameters * a,
+			const gsl_multifit_nlinear_parameters * b);
+static fit_pool_entry_t * entry_alloc(
+			const gsl_multifit_nlinear_parameters * params,
+			size_t n, size_t p);
+static void entry_free(void * data);
+static fit_pool_entry_t * evict(fit_pool_t * pool);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    fit_pool_alloc
+ *
+ * DESCRIPTION:	    Makes an empty pool.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    fit_pool_t * -- the pool, or NULL if there was no memory.
+ *
+ * NOTES:	    none.
+ ***/
+fit_pool_t * fit_pool_alloc(void)
+{
+  fit_pool_t * pool = malloc(sizeof(fit_pool_t));
+  if (pool == NULL)
+    return NULL;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  list_init(&pool->entries, entry_free);
+  pool->clock = 0;
+  pool->hits = 0;
+  pool->misses = 0;
+  pool->evictions = 0;
+  return pool;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_pool_free
+ *
+ * DESCRIPTION:	    Frees a pool and every set of buffers it holds.
+ *
+ * ARGUMENTS:	    pool: (fit_pool_t *) -- the pool, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    No buffers may still be borrowed.
+ ***/
+void fit_pool_free(fit_pool_t * pool)
+{
+  if (pool == NULL)
+    return;
+
+  list_dest(&pool->entries);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_pool_acquire
+ *
+ * DESCRIPTION:	    Lends out a free set of buffers made for the same method,
+ *		    n and p, or makes one and adds it to the pool.
+ *
+ * ARGUMENTS:	    pool: (fit_pool_t *) -- the pool.
+ *		    params: (const gsl_multifit_nlinear_parameters *) -- the
+ *			method, or NULL for a linear fit.
+ *		    n: (size_t) -- the number of samples, or 0 if a linear
+ *			fit needs no weights.
+ *		    p: (size_t) -- the number of coefficients.
+ *
+ * RETURN:	    fit_buffers_t * -- the buffers, or NULL if there was no
+ *		    memory.
+ *
+ * NOTES:	    Every parameter of the method is part of the key, since a
+ *		    workspace is made for one set. Buffers are made outside
+ *		    the lock, so other fits aren't held up by it. If the pool
+ *		    then holds more than FIT_POOL_MAX_ENTRIES sets, the free
+ *		    one lent out least recently is freed, so that a stream of
+ *		    fits of different shapes doesn't grow the pool forever.
+ ***/
+fit_buffers_t * fit_pool_acquire(fit_pool_t * pool,
+				 const gsl_multifit_nlinear_parameters * params,
+				 size_t n, size_t p)
+{
+  bool linear = params == NULL;
+  pthread_mutex_lock(&pool->lock);
+  for (ListElm * elm = list_head(&pool->entries); elm != NULL;
+       elm = list_next(elm)) {
+    fit_pool_entry_t * entry = list_data(elm);
+    if (entry->in_use || entry->linear != linear || entry->n != n
+	|| entry->p != p || (!linear && !same_params(&entry->params, params)))
+      continue;
+    entry->in_use = true;
+    entry->used = ++pool->clock;
+    pool->hits++;
+    pthread_mutex_unlock(&pool->lock);
+    return &entry->buffers;
+  }
+  pool->misses++;
+  pthread_mutex_unlock(&pool->lock);
+
+  fit_pool_entry_t * entry = entry_alloc(params, n, p);
+  if (entry == NULL)
+    return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  entry->used = ++pool->clock;
+  int status = list_insnxt(&pool->entries, list_tail(&pool->entries), entry);
+  fit_pool_entry_t * old = NULL;
+  if (status == 0 && list_size(&pool->entries) > FIT_POOL_MAX_ENTRIES)
+    old = evict(pool);
+  pthread_mutex_unlock(&pool->lock);
+  if (old != NULL)
+    entry_free(old);
+  if (status != 0) {
+    entry_free(entry);
+    return NULL;
+  }
+  return &entry->buffers;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_pool_release
+ *
+ * DESCRIPTION:	    Returns borrowed buffers to the pool, for the next fit of
+ *		    the same shape.
+ *
+ * ARGUMENTS:	    pool: (fit_pool_t *) -- the pool.
+ *		    buffers: (fit_buffers_t *) -- the buffers, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The buffers aren't cleared; the next fit initializes them.
+ ***/
+void fit_pool_release(fit_pool_t * pool, fit_buffers_t * buffers)
+{
+  if (buffers == NULL)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  ((fit_pool_entry_t *)buffers)->in_use = false;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_pool_stats
+ *
+ * DESCRIPTION:	    Reports how many sets of buffers a pool holds, and how
+ *		    many acquisitions it served from them.
+ *
+ * ARGUMENTS:	    pool: (fit_pool_t *) -- the pool.
+ *		    stats: (fit_pool_stats_t *) -- location for the statistics.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void fit_pool_stats(fit_pool_t * pool, fit_pool_stats_t * stats)
+{
+  pthread_mutex_lock(&pool->lock);
+  stats->entries = list_size(&pool->entries);
+  stats->hits = pool->hits;
+  stats->misses = pool->misses;
+  stats->evictions = pool->evictions;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    same_params
+ *
+ * DESCRIPTION:	    Whether two sets of parameters of the trust region method
+ *		    are the same.
+ *
+ * ARGUMENTS:	    a, b: (const gsl_multifit_nlinear_parameters *) -- the
+ *			parameters.
+ *
+ * RETURN:	    bool -- true if every field is equal.
+ *
+ * NOTES:	    Compared field by field, since the struct has padding.
+ ***/
+static bool same_params(const gsl_multifit_nlinear_parameters * a,
+			const gsl_multifit_nlinear_parameters * b)
+{
+  return a->trs == b->trs && a->scale == b->scale && a->solver == b->solver
+    && a->fdtype == b->fdtype && a->factor_up == b->factor_up
+    && a->factor_down == b->factor_down && a->avmax == b->avmax
+    && a->h_df == b->h_df && a->h_fvv == b->h_fvv;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    entry_alloc
+ *
+ * DESCRIPTION:	    Makes a set of buffers, marked in use.
+ *
+ * ARGUMENTS:	    params: (const gsl_multifit_nlinear_parameters *) -- the
+ *			method, or NULL for a linear fit.
+ *		    n: (size_t) -- the number of samples.
+ *		    p: (size_t) -- the number of coefficients.
+ *
+ * RETURN:	    fit_pool_entry_t * -- the entry, or NULL if there was no
+ *		    memory.
+ *
+ * NOTES:	    none.
+ ***/
+static fit_pool_entry_t * entry_alloc(
+			const gsl_multifit_nlinear_parameters * params,
+			size_t n, size_t p)
+{
+  fit_pool_entry_t * entry = calloc(1, sizeof(fit_pool_entry_t));
+  if (entry == NULL)
+    return NULL;
+
+  entry->linear = params == NULL;
+  if (params != NULL)
+    entry->params = *params;
+  entry->n = n;
+  entry->p = p;
+  entry->in_use = true;
+
+  fit_buffers_t * b = &entry->buffers;
+  if ((params != NULL
+       && (b->w = gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust,
+					     params, n, p)) == NULL)
+      || (b->linfit = linfit_alloc(p)) == NULL
+      || (b->c = gsl_vector_alloc(p)) == NULL
+      || (b->covar = gsl_matrix_alloc(p, p)) == NULL
+      || (n > 0 && ((b->weights = gsl_vector_alloc(n)) == NULL
+		    || (b->work = gsl_vector_alloc(n)) == NULL))) {
+    entry_free(entry);
+    return NULL;
+  }
+  return entry;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    entry_free
+ *
+ * DESCRIPTION:	    Frees a set of buffers, and its entry.
+ *
+ * ARGUMENTS:	    data: (void *) -- the fit_pool_entry_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits list_init().
+ ***/
+static void entry_free(void * data)
+{
+  fit_pool_entry_t * entry = (fit_pool_entry_t *)data;
+  fit_buffers_t * b = &entry->buffers;
+  if (b->w != NULL)
+    gsl_multifit_nlinear_free(b->w);
+  linfit_free(b->linfit);
+  if (b->c != NULL)
+    gsl_vector_free(b->c);
+  if (b->covar != NULL)
+    gsl_matrix_free(b->covar);
+  if (b->weights != NULL)
+    gsl_vector_free(b->weights);
+  if (b->work != NULL)
+    gsl_vector_free(b->work);
+  free(entry);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    evict
+ *
+ * DESCRIPTION:	    Takes the free set of buffers lent out least recently out
+ *		    of the pool.
+ *
+ * ARGUMENTS:	    pool: (fit_pool_t *) -- the pool, locked.
+ *
+ * RETURN:	    fit_pool_entry_t * -- the entry, for the caller to free
+ *		    once the lock is released, or NULL if every set is in use.
+ *
+ * NOTES:	    none.
+ ***/
+static fit_pool_entry_t * evict(fit_pool_t * pool)
+{
+  ListElm * before = NULL, * prev = NULL;
+  fit_pool_entry_t * oldest = NULL;
+  for (ListElm * elm = list_head(&pool->entries); elm != NULL;
+       prev = elm, elm = list_next(elm)) {
+    fit_pool_entry_t * entry = list_data(elm);
+    if (!entry->in_use && (oldest == NULL || entry->used < oldest->used)) {
+      oldest = entry;
+      before = prev;
+    }
+  }
+  if (oldest == NULL
+      || list_remnxt(&pool->entries, before, (void **)&oldest) != 0)
+    return NULL;
+  pool->evictions++;
+  return oldest;
+}
+
+/******************************************************************************/
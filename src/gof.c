@@ -0,0 +1,433 @@
+/*******************************************************************************
+ * NAME:	    gof.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Goodness-of-fit statistics of the residuals of a fit, all
+ *		    accumulated in one pass over the residual vector the
+ *		    solver already holds, and written as JSON or CSV so that
+ *		    many fits can be checked automatically.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_vector.h>
+
+#include "gof.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* The sums of one region while the residuals are read. Its band of grid
+ * voltage is [key, key + 1) times the width. */
+typedef struct gof_bin {
+  long key;
+  size_t n;
+  double sum;
+  double sumsq;
+  double max_abs;
+} gof_bin_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static size_t bin_find(gof_bin_t * bins, size_t * nbins, double * width,
+		       double eg);
+static void bin_widen(gof_bin_t * bins, size_t * nbins, double * width);
+static void write_number(FILE * outfh, double value, gof_format_t format);
+static void write_name(FILE * outfh, const char * name, gof_format_t format);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    gof_compute
+ *
+ * DESCRIPTION:	    Computes the statistics of a fit's residuals in a single
+ *		    pass: the sums of the powers of the residuals and of Ig,
+ *		    the sums for the RSS, largest residual and Durbin-Watson
+ *		    statistic, and the sums of the region of each sample.
+ *		    The central moments are made from the sums at the end.
+ *
+ * ARGUMENTS:	    gof: (gof_t *) -- location for the statistics.
+ *		    f: (const gsl_vector *) -- the residuals.
+ *		    eg: (const double *) -- the grid voltages.
+ *		    ig: (const double *) -- the plate currents.
+ *		    stride: (size_t) -- the stride of <eg> and <ig>.
+ *		    p: (size_t) -- the number of coefficients.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The powers are taken about the first sample rather than
+ *		    about 0, which keeps the sums from cancelling when the
+ *		    spread is small beside the mean, without the division
+ *		    per sample of Welford's update. Samples are usually
+ *		    ordered by curve, so the region of the last sample is
+ *		    tried first.
+ ***/
+void gof_compute(gof_t * gof, const gsl_vector * f, const double * eg,
+		 const double * ig, size_t stride, size_t p)
+{
+  size_t n = f->size;
+  memset(gof, 0, sizeof(gof_t));
+  gof->n = n;
+  gof->p = p;
+  if (n == 0)
+    return;
+
+  gof_bin_t bins[GOF_MAX_REGIONS];
+  size_t nbins = 0, bin = 0;
+  double width = GOF_REGION_WIDTH, scale = 1 / width;
+  double shift = f->data[0], yshift = ig[0];
+  double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0, y1 = 0.0, y2 = 0.0;
+  double rss = 0.0, dw = 0.0, last = shift;
+
+  for (size_t i = 0; i < n; i++) {
+    double r = f->data[i * f->stride];
+    double y = ig[i * stride], g = eg[i * stride];
+
+    double d = r - shift, d2 = d * d;
+    s1 += d;
+    s2 += d2;
+    s3 += d2 * d;
+    s4 += d2 * d2;
+    double dy = y - yshift;
+    y1 += dy;
+    y2 += dy * dy;
+
+    rss += r * r;
+    dw += (r - last) * (r - last);
+    last = r;
+    if (fabs(r) > gof->max_abs) {
+      gof->max_abs = fabs(r);
+      gof->max_row = i;
+    }
+
+    if (bin >= nbins || (long)floor(g * scale) != bins[bin].key) {
+      bin = bin_find(bins, &nbins, &width, g);
+      scale = 1 / width;
+    }
+    bins[bin].n++;
+    bins[bin].sum += r;
+    bins[bin].sumsq += r * r;
+    if (fabs(r) > bins[bin].max_abs)
+      bins[bin].max_abs = fabs(r);
+  }
+
+  /* Central moments, as sums, from those about the shift. */
+  double c = s1 / n, c2 = c * c;
+  double m2 = s2 - n * c2;
+  double m3 = s3 - 3 * c * s2 + 2 * n * c2 * c;
+  double m4 = s4 - 4 * c * s3 + 6 * c2 * s2 - 3 * n * c2 * c2;
+  double ym2 = y2 - y1 * y1 / n;
+  double mean = shift + c;
+
+  gof->r2 = ym2 > 0 ? 1 - rss / ym2 : NAN;
+  gof->adj_r2 = n > p ? 1 - (1 - gof->r2) * (n - 1) / (n - p) : NAN;
+  gof->rmse = sqrt(rss / n);
+  gof->mean = mean;
+  gof->skew = m2 > 0 ? sqrt((double)n) * m3 / pow(m2, 1.5) : NAN;
+  gof->kurtosis = m2 > 0 ? n * m4 / (m2 * m2) - 3 : NAN;
+  gof->durbin_watson = rss > 0 ? dw / rss : NAN;
+
+  /* The bins were made in the order the samples came; sort them by Eg. */
+  for (size_t j = 1; j < nbins; j++) {
+    gof_bin_t b = bins[j];
+    size_t k = j;
+    for (; k > 0 && bins[k - 1].key > b.key; k--)
+      bins[k] = bins[k - 1];
+    bins[k] = b;
+  }
+  gof->nregions = nbins;
+  for (size_t j = 0; j < nbins; j++) {
+    gof_region_t * region = &gof->region[j];
+    region->eg_lower = bins[j].key * width;
+    region->eg_upper = (bins[j].key + 1) * width;
+    region->n = bins[j].n;
+    region->mean = bins[j].sum / bins[j].n;
+    region->rms = sqrt(bins[j].sumsq / bins[j].n);
+    region->max_abs = bins[j].max_abs;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    gof_format
+ *
+ * DESCRIPTION:	    Chooses the format of a report by its extension.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the report.
+ *
+ * RETURN:	    gof_format_t -- GOF_CSV for .csv, GOF_JSON otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+gof_format_t gof_format(const char * filename)
+{
+  size_t len = strlen(filename);
+  return len > 4 && !strcmp(filename + len - 4, ".csv") ? GOF_CSV : GOF_JSON;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    gof_write_header
+ *
+ * DESCRIPTION:	    Writes the header row of a CSV report. A JSON report has
+ *		    none, since every line stands alone.
+ *
+ * ARGUMENTS:	    outfh: (FILE *) -- the report.
+ *		    format: (gof_format_t) -- its format.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void gof_write_header(FILE * outfh, gof_format_t format)
+{
+  if (format == GOF_CSV)
+    fprintf(outfh, "name,region,eg_lower,eg_upper,n,p,r2,adj_r2,rmse,"
+	    "max_abs,max_row,mean,skew,kurtosis,durbin_watson\n");
+}
+
+/*******************************************************************************
+ * FUNCTION:	    gof_write
+ *
+ * DESCRIPTION:	    Writes the statistics of one fit. In CSV, the fit is the
+ *		    row of region "all", and each region a row of its own,
+ *		    with the statistics that only apply to the whole fit
+ *		    left empty; its rmse is the RMS of its residuals.
+ *
+ * ARGUMENTS:	    outfh: (FILE *) -- the report.
+ *		    name: (const char *) -- the name of the fit.
+ *		    gof: (const gof_t *) -- the statistics.
+ *		    format: (gof_format_t) -- the format.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Statistics that are undefined, such as the skew of
+ *		    residuals which are all zero, are written as null in
+ *		    JSON, and left empty in CSV.
+ ***/
+void gof_write(FILE * outfh, const char * name, const gof_t * gof,
+	       gof_format_t format)
+{
+  const double overall[] = {
+    gof->r2, gof->adj_r2, gof->rmse, gof->max_abs
+  };
+  const double shape[] = {
+    gof->mean, gof->skew, gof->kurtosis, gof->durbin_watson
+  };
+
+  if (format == GOF_CSV) {
+    write_name(outfh, name, format);
+    fprintf(outfh, ",all,,,%zu,%zu", gof->n, gof->p);
+    for (size_t j = 0; j < 4; j++)
+      write_number(outfh, overall[j], format);
+    fprintf(outfh, ",%zu", gof->max_row);
+    for (size_t j = 0; j < 4; j++)
+      write_number(outfh, shape[j], format);
+    fprintf(outfh, "\n");
+
+    for (size_t j = 0; j < gof->nregions; j++) {
+      const gof_region_t * region = &gof->region[j];
+      write_name(outfh, name, format);
+      fprintf(outfh, ",%zu", j);
+      write_number(outfh, region->eg_lower, format);
+      write_number(outfh, region->eg_upper, format);
+      fprintf(outfh, ",%zu,%zu,,", region->n, gof->p);
+      write_number(outfh, region->rms, format);
+      write_number(outfh, region->max_abs, format);
+      fprintf(outfh, ",");
+      write_number(outfh, region->mean, format);
+      fprintf(outfh, ",,,\n");
+    }
+    return;
+  }
+
+  static const char * const names[] = {
+    "r2", "adj_r2", "rmse", "max_abs", "mean", "skew", "kurtosis",
+    "durbin_watson"
+  };
+  fprintf(outfh, "{\"name\": ");
+  write_name(outfh, name, format);
+  fprintf(outfh, ", \"n\": %zu, \"p\": %zu", gof->n, gof->p);
+  for (size_t j = 0; j < 8; j++) {
+    fprintf(outfh, ", \"%s\": ", names[j]);
+    write_number(outfh, j < 4 ? overall[j] : shape[j - 4], format);
+    if (j == 3)
+      fprintf(outfh, ", \"max_row\": %zu", gof->max_row);
+  }
+  fprintf(outfh, ", \"regions\": [");
+  for (size_t j = 0; j < gof->nregions; j++) {
+    const gof_region_t * region = &gof->region[j];
+    fprintf(outfh, "%s{\"eg\": [", j > 0 ? ", " : "");
+    write_number(outfh, region->eg_lower, format);
+    fprintf(outfh, ", ");
+    write_number(outfh, region->eg_upper, format);
+    fprintf(outfh, "], \"n\": %zu, \"mean\": ", region->n);
+    write_number(outfh, region->mean, format);
+    fprintf(outfh, ", \"rms\": ");
+    write_number(outfh, region->rms, format);
+    fprintf(outfh, ", \"max_abs\": ");
+    write_number(outfh, region->max_abs, format);
+    fprintf(outfh, "}");
+  }
+  fprintf(outfh, "]}\n");
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    bin_find
+ *
+ * DESCRIPTION:	    Finds the bin of a grid voltage, making it if there is
+ *		    none, and widening every bin until there is room.
+ *
+ * ARGUMENTS:	    bins: (gof_bin_t *) -- the bins.
+ *		    nbins: (size_t *) -- the number of bins.
+ *		    width: (double *) -- the width of each, in volts.
+ *		    eg: (double) -- the grid voltage.
+ *
+ * RETURN:	    size_t -- the index of the bin.
+ *
+ * NOTES:	    none.
+ ***/
+static size_t bin_find(gof_bin_t * bins, size_t * nbins, double * width,
+		       double eg)
+{
+  for (;;) {
+    long key = (long)floor(eg / *width);
+    for (size_t j = 0; j < *nbins; j++) {
+      if (bins[j].key == key)
+	return j;
+    }
+    if (*nbins < GOF_MAX_REGIONS) {
+      bins[*nbins] = (gof_bin_t){ .key = key };
+      return (*nbins)++;
+    }
+    bin_widen(bins, nbins, width);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    bin_widen
+ *
+ * DESCRIPTION:	    Doubles the width of the bins, merging the sums of each
+ *		    pair that now share a band.
+ *
+ * ARGUMENTS:	    bins: (gof_bin_t *) -- the bins.
+ *		    nbins: (size_t *) -- the number of bins.
+ *		    width: (double *) -- the width of each.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Band k becomes band floor(k / 2), so that the bands stay
+ *		    aligned to multiples of the width.
+ ***/
+static void bin_widen(gof_bin_t * bins, size_t * nbins, double * width)
+{
+  size_t merged = 0;
+  *width *= 2;
+  for (size_t j = 0; j < *nbins; j++) {
+    long key = bins[j].key >= 0 ? bins[j].key / 2 : -((1 - bins[j].key) / 2);
+    size_t k = 0;
+    while (k < merged && bins[k].key != key)
+      k++;
+    if (k == merged) {
+      bins[merged] = bins[j];
+      bins[merged++].key = key;
+      continue;
+    }
+    bins[k].n += bins[j].n;
+    bins[k].sum += bins[j].sum;
+    bins[k].sumsq += bins[j].sumsq;
+    if (bins[j].max_abs > bins[k].max_abs)
+      bins[k].max_abs = bins[j].max_abs;
+  }
+  *nbins = merged;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    write_number
+ *
+ * DESCRIPTION:	    Writes one field of a report, with the separator before
+ *		    it in CSV.
+ *
+ * ARGUMENTS:	    outfh: (FILE *) -- the report.
+ *		    value: (double) -- the value.
+ *		    format: (gof_format_t) -- the format.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    JSON has no NaN or infinity, so they are written as null.
+ ***/
+static void write_number(FILE * outfh, double value, gof_format_t format)
+{
+  if (format == GOF_CSV)
+    fputc(',', outfh);
+  if (isfinite(value))
+    fprintf(outfh, "%.10g", value);
+  else if (format == GOF_JSON)
+    fprintf(outfh, "null");
+}
+
+/*******************************************************************************
+ * FUNCTION:	    write_name
+ *
+ * DESCRIPTION:	    Writes the name of a fit as a quoted string, escaped as
+ *		    the format needs.
+ *
+ * ARGUMENTS:	    outfh: (FILE *) -- the report.
+ *		    name: (const char *) -- the name.
+ *		    format: (gof_format_t) -- the format.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    CSV doubles its quotes; JSON escapes them, backslashes and
+ *		    control characters.
+ ***/
+static void write_name(FILE * outfh, const char * name, gof_format_t format)
+{
+  fputc('"', outfh);
+  for (const unsigned char * c = (const unsigned char *)name; *c; c++) {
+    if (*c == '"')
+      fputs(format == GOF_CSV ? "\"\"" : "\\\"", outfh);
+    else if (format == GOF_JSON && *c == '\\')
+      fputs("\\\\", outfh);
+    else if (format == GOF_JSON && *c < 0x20)
+      fprintf(outfh, "\\u%04x", *c);
+    else
+      fputc(*c, outfh);
+  }
+  fputc('"', outfh);
+}
+
+/******************************************************************************/
@@ -0,0 +1,332 @@
+/*******************************************************************************
+ * NAME:	    linfit.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    This file contains a least-squares solver for models which
+ *		    are linear in their coefficients. Observations are folded
+ *		    one at a time into the triangular factor of a QR
+ *		    decomposition with Givens rotations, so the memory used is
+ *		    independent of the number of observations.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+#include "linfit.h"
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_alloc
+ *
+ * DESCRIPTION:	    Allocates an empty accumulator for a model with <p>
+ *		    coefficients.
+ *
+ * ARGUMENTS:	    p: (size_t) -- the number of coefficients.
+ *
+ * RETURN:	    linfit_t * -- the accumulator, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+linfit_t * linfit_alloc(size_t p)
+{
+  if (p == 0)
+    return NULL;
+
+  linfit_t * fit = malloc(sizeof(linfit_t));
+  if (fit == NULL)
+    return NULL;
+
+  if ((fit->R = gsl_matrix_calloc(p + 1, p + 1)) == NULL) {
+    free(fit);
+    return NULL;
+  }
+
+  fit->p = p;
+  fit->n = 0;
+  return fit;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_free
+ *
+ * DESCRIPTION:	    Frees an accumulator.
+ *
+ * ARGUMENTS:	    fit: (linfit_t *) -- the accumulator.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void linfit_free(linfit_t * fit)
+{
+  if (fit == NULL)
+    return;
+
+  gsl_matrix_free(fit->R);
+  free(fit);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_reset
+ *
+ * DESCRIPTION:	    Discards every observation added to the accumulator.
+ *
+ * ARGUMENTS:	    fit: (linfit_t *) -- the accumulator.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void linfit_reset(linfit_t * fit)
+{
+  gsl_matrix_set_zero(fit->R);
+  fit->n = 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_add
+ *
+ * DESCRIPTION:	    Folds the observation (x, y) into R. The augmented row
+ *		    [x y] is rotated against each row of R in turn until it is
+ *		    zero; whatever is left in the last column is the part of y
+ *		    that no combination of the regressors can explain, and
+ *		    accumulates in R[p][p].
+ *
+ * ARGUMENTS:	    fit: (linfit_t *) -- the accumulator.
+ *		    x: (const double *) -- the <p> regressors.
+ *		    y: (double) -- the observed value.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    O(p^2) per observation.
+ ***/
+void linfit_add(linfit_t * fit, const double * x, double y)
+{
+  size_t p = fit->p, tda = fit->R->tda;
+  double * R = fit->R->data;
+  double v[p + 1];
+
+  for (size_t j = 0; j < p; j++)
+    v[j] = x[j];
+  v[p] = y;
+
+  for (size_t k = 0; k <= p; k++) {
+    if (v[k] == 0.0)
+      continue;
+
+    double * row = R + k * tda;
+    double h = hypot(row[k], v[k]);
+    double c = row[k] / h, s = v[k] / h;
+    row[k] = h;
+    for (size_t j = k + 1; j <= p; j++) {
+      double t = row[j];
+      row[j] = c * t + s * v[j];
+      v[j] = c * v[j] - s * t;
+    }
+  }
+
+  fit->n++;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_merge
+ *
+ * DESCRIPTION:	    Folds the rows of another accumulator into this one, as if
+ *		    every observation added to <other> had been added here.
+ *		    Since [X y] = Q R, the rows of R stand in for the
+ *		    observations: they have the same R^T R.
+ *
+ * ARGUMENTS:	    fit: (linfit_t *) -- the accumulator.
+ *		    other: (const linfit_t *) -- an accumulator with the same
+ *			p; it isn't changed.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    O(p^3), whatever the number of observations in <other>.
+ ***/
+void linfit_merge(linfit_t * fit, const linfit_t * other)
+{
+  size_t p = fit->p, n = fit->n, tda = other->R->tda;
+  for (size_t k = 0; k <= p; k++) {
+    const double * row = other->R->data + k * tda;
+    linfit_add(fit, row, row[p]);
+  }
+  fit->n = n + other->n;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_remove
+ *
+ * DESCRIPTION:	    Takes the observation (x, y) back out of R, so that
+ *		    R^T R = A - v v^T for the augmented row v = [x y]. The
+ *		    downdate solves R^T a = v, then finds the rotations that
+ *		    fold [sqrt(1 - |a|^2), a] into a single element, and
+ *		    applies them to the columns of R from the bottom up, as
+ *		    LINPACK's dchdd does.
+ *
+ * ARGUMENTS:	    fit: (linfit_t *) -- the accumulator.
+ *		    x: (const double *) -- the <p> regressors.
+ *		    y: (double) -- the observed value.
+ *
+ * RETURN:	    int -- GSL_SUCCESS, or GSL_EDOM if |a| >= 1, meaning the
+ *		    row wasn't one of those added, or the rows left fit
+ *		    exactly or not at all. R is unchanged then.
+ *
+ * NOTES:	    O(p^2) per observation, like linfit_add(). Accuracy falls
+ *		    as more of the rows are removed; refitting from scratch
+ *		    restores it.
+ ***/
+int linfit_remove(linfit_t * fit, const double * x, double y)
+{
+  size_t p = fit->p, tda = fit->R->tda;
+  double * R = fit->R->data;
+  double a[p + 1], c[p + 1], s[p + 1];
+
+  /* Solve R^T a = v by forward substitution. */
+  double norm = 0.0;
+  for (size_t k = 0; k <= p; k++) {
+    double sum = k < p ? x[k] : y;
+    for (size_t i = 0; i < k; i++)
+      sum -= R[i * tda + k] * a[i];
+    if (R[k * tda + k] == 0.0)
+      return GSL_EDOM;
+    a[k] = sum / R[k * tda + k];
+    norm += a[k] * a[k];
+  }
+  if (!(norm < 1.0))
+    return GSL_EDOM;
+
+  /* The rotations which zero a against alpha, last element first. */
+  double alpha = sqrt(1.0 - norm);
+  for (size_t k = p + 1; k-- > 0;) {
+    double scale = alpha + fabs(a[k]);
+    double u = a[k] / scale, w = alpha / scale;
+    double h = hypot(u, w);
+    c[k] = w / h;
+    s[k] = u / h;
+    alpha = scale * h;
+  }
+
+  /* Apply them to each column of R. */
+  for (size_t j = 0; j <= p; j++) {
+    double t = 0.0;
+    for (size_t k = j + 1; k-- > 0;) {
+      double r = R[k * tda + j];
+      R[k * tda + j] = c[k] * r - s[k] * t;
+      t = c[k] * t + s[k] * r;
+    }
+  }
+
+  fit->n--;
+  return GSL_SUCCESS;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    linfit_solve
+ *
+ * DESCRIPTION:	    Solves R c = Q^T y by back substitution, and optionally
+ *		    computes the covariance (X^T X)^-1 = R^-1 R^-T and the
+ *		    residual sum of squares.
+ *
+ * ARGUMENTS:	    fit: (const linfit_t *) -- the accumulator.
+ *		    c: (gsl_vector *) -- vector of size p for the solution.
+ *		    covar: (gsl_matrix *) -- p x p matrix for the covariance,
+ *			or NULL.
+ *		    chisq: (double *) -- location for the residual sum of
+ *			squares, or NULL.
+ *
+ * RETURN:	    int -- GSL_SUCCESS, or GSL_ESING if R is singular, in
+ *		    which case fewer than p independent observations have
+ *		    been seen.
+ *
+ * NOTES:	    Does not modify the accumulator, so more observations may
+ *		    be added afterwards.
+ ***/
+int linfit_solve(const linfit_t * fit, gsl_vector * c, gsl_matrix * covar,
+		 double * chisq)
+{
+  size_t p = fit->p;
+  const gsl_matrix * R = fit->R;
+
+  for (size_t k = 0; k < p; k++) {
+    if (gsl_matrix_get(R, k, k) == 0.0)
+      return GSL_ESING;
+  }
+
+  for (size_t i = p; i-- > 0;) {
+    double sum = gsl_matrix_get(R, i, p);
+    for (size_t j = i + 1; j < p; j++)
+      sum -= gsl_matrix_get(R, i, j) * gsl_vector_get(c, j);
+    gsl_vector_set(c, i, sum / gsl_matrix_get(R, i, i));
+  }
+
+  if (chisq != NULL) {
+    double r = gsl_matrix_get(R, p, p);
+    *chisq = r * r;
+  }
+
+  if (covar == NULL)
+    return GSL_SUCCESS;
+
+  /* Invert R into the upper triangle of covar, a column at a time. */
+  gsl_matrix_set_zero(covar);
+  for (size_t j = 0; j < p; j++) {
+    gsl_matrix_set(covar, j, j, 1.0 / gsl_matrix_get(R, j, j));
+    for (size_t i = j; i-- > 0;) {
+      double sum = 0.0;
+      for (size_t k = i + 1; k <= j; k++)
+	sum += gsl_matrix_get(R, i, k) * gsl_matrix_get(covar, k, j);
+      gsl_matrix_set(covar, i, j, -sum / gsl_matrix_get(R, i, i));
+    }
+  }
+
+  /* covar = R^-1 R^-T, written into the lower triangle, which R^-1 doesn't
+   * use. A diagonal element of R^-1 is only overwritten once no remaining
+   * product needs it. */
+  for (size_t i = 0; i < p; i++) {
+    for (size_t j = i; j < p; j++) {
+      double sum = 0.0;
+      for (size_t k = j; k < p; k++)
+	sum += gsl_matrix_get(covar, i, k) * gsl_matrix_get(covar, j, k);
+      gsl_matrix_set(covar, j, i, sum);
+    }
+  }
+  for (size_t i = 0; i < p; i++) {
+    for (size_t j = i + 1; j < p; j++)
+      gsl_matrix_set(covar, i, j, gsl_matrix_get(covar, j, i));
+  }
+
+  return GSL_SUCCESS;
+}
+
+/******************************************************************************/
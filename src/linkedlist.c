@@ -9,7 +9,7 @@
  *
  * CREATED:	    06/05/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/16/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -150,6 +150,8 @@ int list_remnxt(List * list, ListElm * node, void ** data)
   if (node == NULL) {
     old = list->head;
     list->head = list->head->next;
+    if (list->head == NULL)
+      list->tail = NULL; /* Don't leave tail dangling for list_insnxt. */
     *data = old->data;
 
     /* Handle deletion somewhere else in the list */
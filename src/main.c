@@ -7,7 +7,7 @@
  *
  * CREATED:	    08/22/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/17/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -31,34 +31,188 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include <gsl/gsl_matrix.h>
 
+#include "dataset.h"
 #include "util.h"
+#include "batch.h"
+#include "bootstrap.h"
+#include "crossval.h"
 #include "fit.h"
+#include "gof.h"
+#include "multistart.h"
+#include "trust.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Datasets fitted in each batch, per thread, with -j. */
+#define BATCH_PER_THREAD 8
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* Where the statistics of each fit's residuals are written, with -o. */
+typedef struct report {
+  FILE * file; /* NULL if no report was asked for. */
+  gof_format_t format;
+} report_t;
 
 /*******************************************************************************
  * STATIC FUNCTION PROTOTYPES
  ***/
 
 static void print_matrix(gsl_matrix * matrix, FILE * log);
+static int fit_registry(const char * path, const fit_data_t * proto,
+			const multistart_options_t * starts,
+			const bootstrap_options_t * boot,
+			const crossval_options_t * cv, size_t threads,
+			const report_t * report, FILE * fitlog);
+static int fit_batches(dataset_registry_t * registry,
+		       const fit_data_t * proto, size_t threads,
+		       const report_t * report, FILE * fitlog);
+static void report_fit(const report_t * report, const char * name,
+		       const gof_t * gof);
+static void log_dataset(const dataset_t * dataset, FILE * fitlog);
+static int select_model(const gsl_matrix * values,
+			const crossval_options_t * cv, poly_model_t * model,
+			const triode_model_t ** triode, FILE * fitlog);
+static int fit_one(fit_context_t * ctx, fit_data_t * data,
+		   const multistart_options_t * starts,
+		   const bootstrap_options_t * boot, FILE * fitlog);
+static int fit_bootstrap(const fit_data_t * data,
+			 const bootstrap_options_t * boot, FILE * fitlog);
 
 /*******************************************************************************
  * MAIN
  ***/
 
 int main(int argc, char * argv[]) {
-  gsl_matrix * matrix = read_tuples_csv("data/12AX7-Data.csv", 3);
+  /* -m selects the surface, as described at poly_parse(), or a triode
+   * model by name. -k fits from that many starting points at once, drawn
+   * by Latin hypercube, or by Sobol sequence with -s. -j fits the datasets
+   * of a registry on that many threads at once. -r fits robustly, with the
+   * loss described at robust_parse(). -b estimates intervals for the
+   * coefficients from that many bootstrap replicates of the rows, or -B
+   * of the residuals. -c chooses the model for each dataset instead, by
+   * cross-validating crossval_defaults with that many folds. -o writes the
+   * statistics of each fit's residuals to a report, as CSV if its name
+   * ends in .csv, or as JSON Lines otherwise. -t fits every model by the
+   * trust region method described at trust_parse(), surfaces included. */
+  poly_model_t model = poly_quadratic;
+  const triode_model_t * triode = NULL;
+  robust_loss_t loss = ROBUST_NONE;
+  double tuning = 0.0;
+  multistart_options_t starts = { .sampling = MULTISTART_LHS, .seed = 1 };
+  bootstrap_options_t boot = { .method = BOOTSTRAP_ROWS, .seed = 1 };
+  crossval_options_t cv = { .seed = 1 };
+  size_t threads = 0;
+  report_t report = { .file = NULL, .format = GOF_JSON };
+  trust_method_t method = {0};
+  fit_solver_t solver = FIT_SOLVER_AUTO;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:k:sj:r:b:B:c:o:t:")) != -1) {
+    if (opt == 'm' && (triode = triode_find(optarg)) != NULL)
+      continue;
+    if (opt == 'r' && robust_parse(optarg, &loss, &tuning) == 0)
+      continue;
+    if (opt == 'k' && (starts.starts = strtoul(optarg, NULL, 10)) > 0)
+      continue;
+    if (opt == 'j' && (threads = strtoul(optarg, NULL, 10)) > 0)
+      continue;
+    if ((opt == 'b' || opt == 'B')
+	&& (boot.replicates = strtoul(optarg, NULL, 10)) > 0) {
+      boot.method = opt == 'B' ? BOOTSTRAP_RESIDUALS : BOOTSTRAP_ROWS;
+      continue;
+    }
+    if (opt == 't' && trust_parse(optarg, &method) == 0) {
+      solver = FIT_SOLVER_NONLINEAR;
+      continue;
+    }
+    if (opt == 'c' && (cv.folds = strtoul(optarg, NULL, 10)) > 1)
+      continue;
+    if (opt == 'o') {
+      if (report.file != NULL)
+	fclose(report.file);
+      report.format = gof_format(optarg);
+      if ((report.file = fopen(optarg, "w")) == NULL) {
+	fprintf(stderr, "%s: %s\n", optarg, strerror(errno));
+	return 1;
+      }
+      gof_write_header(report.file, report.format);
+      continue;
+    }
+    if (opt == 's') {
+      starts.sampling = MULTISTART_SOBOL;
+      continue;
+    }
+    if (opt != 'm' || poly_parse(&model, optarg) != 0) {
+      fprintf(stderr, "Usage: %s [-m model] [-k starts [-s]] "
+	      "[-j threads] [-r loss] [-b|-B replicates] [-c folds] "
+	      "[-o report] [-t method] [dir|manifest]\n"
+	      "  model: a surface, such as 2 or 3x, or koren, "
+	      "child-langmuir or dempwolf\n"
+	      "  loss: huber or tukey, optionally with a constant, "
+	      "as in tukey:3.5\n"
+	      "  method: lm, lmaccel, dogleg, ddogleg or subspace2D, "
+	      "levenberg, marquardt\n"
+	      "    or more, and qr, cholesky, mcholesky or svd, with "
+	      "iter=, xtol=, gtol= or\n"
+	      "    ftol=, separated by colons, as in "
+	      "dogleg:svd:iter=50\n", argv[0]);
+      return 1;
+    }
+  }
+
+  boot.threads = threads;
+  cv.threads = threads;
+  const fit_data_t proto = {
+    .model = &model,
+    .triode = triode,
+    .loss = loss,
+    .tuning = tuning,
+    .solver = solver,
+    .method = method
+  };
   FILE * fitlog = fopen("test.log", "w");
+  if (optind < argc) {
+    int status = fit_registry(argv[optind], &proto, &starts, &boot, &cv,
+			      threads, &report, fitlog);
+    fclose(fitlog);
+    if (report.file != NULL)
+      fclose(report.file);
+    return status;
+  }
+
+  gsl_matrix * matrix = read_columns_csv("data/12AX7-Data.csv", fit_columns,
+				       FIT_NCOLUMNS, NULL);
   print_matrix(matrix, fitlog);
 
-  double init[5] = {1.0, 1.0, 1.0, 1.0, 1.0};
   fit_data_t * dat = malloc(sizeof(fit_data_t));
+  *dat = proto;
   dat->empirical_data = matrix;
-  dat->initial_values = init;
-  fit_surface(dat, true, fitlog);
-  plot(dat, true);
+  dat->samples = fit_samples_alloc(matrix);
+  gof_t gof = {0};
+  dat->gof = &gof;
+  if (cv.folds > 0)
+    select_model(matrix, &cv, &model, &dat->triode, fitlog);
+  fit_context_t * ctx = fit_context_alloc(fitlog, true);
+  if (ctx != NULL && fit_one(ctx, dat, &starts, &boot, fitlog) == 0)
+    plot(dat, true);
+  fit_context_free(ctx);
+  report_fit(&report, "data/12AX7-Data.csv", &gof);
   fclose(fitlog);
+  if (report.file != NULL)
+    fclose(report.file);
 
+  fit_coefficients_free(dat);
+  fit_samples_free(dat->samples);
+  free(dat);
   gsl_matrix_free(matrix);
 }
 
@@ -88,4 +242,344 @@ static void print_matrix(gsl_matrix * matrix, FILE * log)
   }
 }
 
+/*******************************************************************************
+ * FUNCTION:	    fit_registry
+ *
+ * DESCRIPTION:	    Fits every dataset in a directory tree or manifest, logging
+ *		    each fit. The next datasets are loaded while the current
+ *		    one is being fitted. With <threads>, the datasets are
+ *		    fitted by fit_batches() instead, many at once.
+ *
+ * ARGUMENTS:	    path: (const char *) -- the directory or manifest.
+ *		    proto: (const fit_data_t *) -- the model and loss to fit
+ *			every dataset with.
+ *		    starts: (const multistart_options_t *) -- the starting
+ *			points, if starts->starts isn't 0.
+ *		    boot: (const bootstrap_options_t *) -- the bootstrap, if
+ *			boot->replicates isn't 0.
+ *		    cv: (const crossval_options_t *) -- the cross-validation
+ *			to choose each dataset's model by, if cv->folds
+ *			isn't 0.
+ *		    threads: (size_t) -- threads to fit datasets on at once,
+ *			or 0 to fit one at a time.
+ *		    report: (const report_t *) -- the report of each fit's
+ *			residuals.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    int -- 0 if every dataset was fitted, 1 otherwise.
+ *
+ * NOTES:	    The files need a header naming Ep, Eg and Ig. The squares
+ *		    aren't loaded, since XML files don't carry them. Multiple
+ *		    starts, bootstrap replicates and cross-validation folds are
+ *		    already fitted in parallel, so they are fitted one dataset
+ *		    at a time whatever <threads> is.
+ ***/
+static int fit_registry(const char * path, const fit_data_t * proto,
+			const multistart_options_t * starts,
+			const bootstrap_options_t * boot,
+			const crossval_options_t * cv, size_t threads,
+			const report_t * report, FILE * fitlog)
+{
+  bool batch = threads > 0 && starts->starts == 0 && boot->replicates == 0
+    && cv->folds == 0;
+  dataset_options_t options = {
+    .prefetch = batch ? threads * BATCH_PER_THREAD : 2,
+    .columns = fit_columns,
+    .ncolumns = FIT_IG + 1
+  };
+  dataset_registry_t * registry = dataset_registry_open(path, &options);
+  if (registry == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  if (batch) {
+    int status = fit_batches(registry, proto, threads, report, fitlog);
+    dataset_registry_close(registry);
+    return status;
+  }
+
+  /* One context for every dataset, so that its pool is kept between them. */
+  fit_context_t * ctx = fit_context_alloc(fitlog, false);
+  if (ctx == NULL) {
+    dataset_registry_close(registry);
+    return 1;
+  }
+
+  int status = 0;
+  dataset_t * dataset;
+  while ((dataset = dataset_registry_next(registry)) != NULL) {
+    log_dataset(dataset, fitlog);
+    if (dataset->data == NULL) {
+      status = 1;
+    } else {
+      fit_data_t dat = *proto;
+      poly_model_t model = proto->model ? *proto->model : poly_quadratic;
+      gof_t gof = {0};
+      dat.model = &model;
+      dat.empirical_data = dataset->data;
+      dat.samples = fit_samples_alloc(dataset->data);
+      dat.gof = &gof;
+      if (cv->folds > 0)
+	select_model(dataset->data, cv, &model, &dat.triode, fitlog);
+      if (fit_one(ctx, &dat, starts, boot, fitlog) != 0)
+	status = 1;
+      report_fit(report, dataset->path, &gof);
+      fit_coefficients_free(&dat);
+      fit_samples_free(dat.samples);
+    }
+    dataset_release(registry, dataset);
+  }
+
+  fit_context_free(ctx);
+  dataset_registry_close(registry);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_batches
+ *
+ * DESCRIPTION:	    Fits the datasets of a registry with batch_fit(), a batch
+ *		    of BATCH_PER_THREAD datasets per thread at a time, and
+ *		    logs each fit in the order of the registry.
+ *
+ * ARGUMENTS:	    registry: (dataset_registry_t *) -- the registry.
+ *		    proto: (const fit_data_t *) -- the model and loss to fit
+ *			every dataset with.
+ *		    threads: (size_t) -- the number of threads.
+ *		    report: (const report_t *) -- the report of each fit's
+ *			residuals.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    int -- 0 if every dataset was fitted, 1 otherwise.
+ *
+ * NOTES:	    Each fit logs to a buffer of its own, so the logs of fits
+ *		    running at once don't interleave.
+ ***/
+static int fit_batches(dataset_registry_t * registry,
+		       const fit_data_t * proto, size_t threads,
+		       const report_t * report, FILE * fitlog)
+{
+  size_t size = threads * BATCH_PER_THREAD;
+  dataset_t ** datasets = calloc(size, sizeof(dataset_t *));
+  fit_data_t * data = calloc(size, sizeof(fit_data_t));
+  batch_item_t * items = calloc(size, sizeof(batch_item_t));
+  if (datasets == NULL || data == NULL || items == NULL) {
+    free(datasets);
+    free(data);
+    free(items);
+    return 1;
+  }
+
+  batch_options_t options = { .threads = threads, .log = true };
+  int status = 0;
+  for (;;) {
+    size_t count = 0, nitems = 0;
+    while (count < size
+	   && (datasets[count] = dataset_registry_next(registry)) != NULL) {
+      if (datasets[count]->data != NULL) {
+	data[nitems] = *proto;
+	data[nitems].empirical_data = datasets[count]->data;
+	data[nitems].samples = fit_samples_alloc(datasets[count]->data);
+	items[nitems].data = &data[nitems];
+	nitems++;
+      }
+      count++;
+    }
+    if (count == 0)
+      break;
+
+    if (batch_fit(items, nitems, &options, NULL) > 0)
+      status = 1;
+
+    for (size_t k = 0, i = 0; k < count; k++) {
+      log_dataset(datasets[k], fitlog);
+      if (datasets[k]->data == NULL) {
+	status = 1;
+      } else {
+	if (items[i].log != NULL)
+	  fputs(items[i].log, fitlog);
+	free(items[i].log);
+	if (items[i].status == 0)
+	  report_fit(report, datasets[k]->path, &items[i].result.gof);
+	fit_samples_free(data[i].samples);
+	i++;
+      }
+      dataset_release(registry, datasets[k]);
+    }
+  }
+
+  free(datasets);
+  free(data);
+  free(items);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    report_fit
+ *
+ * DESCRIPTION:	    Writes the statistics of a fit's residuals to the report,
+ *		    if one was asked for.
+ *
+ * ARGUMENTS:	    report: (const report_t *) -- the report.
+ *		    name: (const char *) -- the dataset's name.
+ *		    gof: (const gof_t *) -- the statistics.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Fits that didn't go through fit_context_copy(), such as
+ *		    those from many starts without a loss, have no
+ *		    statistics (gof->n is 0) and are left out.
+ ***/
+static void report_fit(const report_t * report, const char * name,
+		       const gof_t * gof)
+{
+  if (report->file != NULL && gof->n > 0)
+    gof_write(report->file, name, gof, report->format);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    log_dataset
+ *
+ * DESCRIPTION:	    Logs the path of a dataset, what its load read, and why
+ *		    it failed, if it did.
+ *
+ * ARGUMENTS:	    dataset: (const dataset_t *) -- the dataset.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void log_dataset(const dataset_t * dataset, FILE * fitlog)
+{
+  fprintf(fitlog, "Dataset: %s\n", dataset->path);
+  if (dataset->stats.bytes > 0)
+    csv_stats_print(fitlog, dataset->path, &dataset->stats, CSV_STATS_TEXT);
+  if (dataset->data == NULL)
+    fprintf(fitlog, "error = %s\n", strerror(dataset->error));
+}
+
+/*******************************************************************************
+ * FUNCTION:	    select_model
+ *
+ * DESCRIPTION:	    Chooses the model for a dataset by cross-validating the
+ *		    candidates in crossval_defaults, and logs the scores.
+ *
+ * ARGUMENTS:	    values: (const gsl_matrix *) -- the dataset.
+ *		    cv: (const crossval_options_t *) -- the folds.
+ *		    model: (poly_model_t *) -- the surface; overwritten if a
+ *			surface is chosen.
+ *		    triode: (const triode_model_t **) -- the triode model;
+ *			set to the one chosen, or NULL if a surface is.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    int -- 0 on success, -1 if no candidate could be fitted,
+ *		    in which case the model is left as it was.
+ *
+ * NOTES:	    none.
+ ***/
+static int select_model(const gsl_matrix * values,
+			const crossval_options_t * cv, poly_model_t * model,
+			const triode_model_t ** triode, FILE * fitlog)
+{
+  crossval_t * result = crossval_run(values, NULL, 0, cv);
+  if (result == NULL)
+    return -1;
+  crossval_print(result, fitlog);
+
+  int status = -1;
+  if (result->best < result->count) {
+    const crossval_candidate_t * best = &result->candidate[result->best];
+    *triode = best->triode;
+    if (best->triode == NULL)
+      *model = best->model;
+    status = 0;
+  }
+  crossval_free(result);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_one
+ *
+ * DESCRIPTION:	    Fits one dataset in <ctx>, or from many starting
+ *		    points with multistart_fit() if any were asked for, and
+ *		    logs the fit. A robust fit from many starts is refitted
+ *		    from the best with the loss. The intervals of a bootstrap
+ *		    are logged after the fit, if one was asked for.
+ *
+ * ARGUMENTS:	    ctx: (fit_context_t *) -- the context to fit in, and
+ *			its log.
+ *		    data: (fit_data_t *) -- the data and model, to receive
+ *			the coefficients.
+ *		    starts: (const multistart_options_t *) -- the starting
+ *			points, if starts->starts isn't 0.
+ *		    boot: (const bootstrap_options_t *) -- the bootstrap, if
+ *			boot->replicates isn't 0.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    int -- 0 on success, nonzero otherwise.
+ *
+ * NOTES:	    The context's pool is kept from one dataset to the next,
+ *		    so only the first fit of each shape makes buffers.
+ ***/
+static int fit_one(fit_context_t * ctx, fit_data_t * data,
+		   const multistart_options_t * starts,
+		   const bootstrap_options_t * boot, FILE * fitlog)
+{
+  if (starts->starts == 0) {
+    int status = fit_context_fit(ctx, data);
+    if (status == 0)
+      status = fit_context_copy(ctx, data);
+    if (status == 0 && boot->replicates > 0)
+      status = fit_bootstrap(data, boot, fitlog);
+    return status;
+  }
+
+  multistart_t * result = multistart_fit(data, starts);
+  if (result == NULL)
+    return -1;
+  multistart_print(result, data, fitlog);
+
+  /* The starts are fitted by plain least squares; refit the best robustly
+   * from where it ended, and bootstrap from there too. */
+  int status = 0;
+  double * initial = data->initial_values;
+  data->initial_values = result->start[result->best].x;
+  if (data->loss != ROBUST_NONE
+      && (status = fit_context_fit(ctx, data)) == 0)
+    status = fit_context_copy(ctx, data);
+  if (status == 0 && boot->replicates > 0)
+    status = fit_bootstrap(data, boot, fitlog);
+  data->initial_values = initial;
+  multistart_free(result);
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    fit_bootstrap
+ *
+ * DESCRIPTION:	    Estimates intervals for the coefficients of a fit with
+ *		    bootstrap_fit(), and logs them.
+ *
+ * ARGUMENTS:	    data: (const fit_data_t *) -- the data and model.
+ *		    boot: (const bootstrap_options_t *) -- the bootstrap.
+ *		    fitlog: (FILE *) -- the log.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the data couldn't be fitted.
+ *
+ * NOTES:	    none.
+ ***/
+static int fit_bootstrap(const fit_data_t * data,
+			 const bootstrap_options_t * boot, FILE * fitlog)
+{
+  bootstrap_t * result = bootstrap_fit(data, boot);
+  if (result == NULL)
+    return -1;
+  bootstrap_print(result, data, fitlog);
+  bootstrap_free(result);
+  return 0;
+}
+
 /******************************************************************************/
@@ -0,0 +1,497 @@
+/*******************************************************************************
+ * NAME:	    multistart.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Fits a model from many starting points at once, on a pool
+ *		    of threads, and keeps the best. The trust region method
+ *		    only finds the minimum nearest its start, and the triode
+ *		    models have more than one.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multifit_nlinear.h>
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_qrng.h>
+
+#include "fit.h"
+#include "multistart.h"
+#include "threadpool.h"
+#include "trust.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+#define MULTISTART_MAX_ITER 100
+#define MULTISTART_SPREAD 4.0
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* One fit, as a task for the pool. */
+typedef struct multistart_task {
+  const fit_data_t * data;
+  multistart_start_t * start;
+  size_t p;
+  fit_pool_t * buffers; /* Shared by every start. */
+  size_t max_iter;
+} multistart_task_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void fit_start(void * arg);
+static int unit_points(multistart_sampling_t sampling, size_t starts,
+		       size_t p, unsigned long seed, double * points);
+static double seconds_since(const struct timespec * start);
+
+/*******************************************************************************
+ * STATIC VARIABLES
+ ***/
+
+static const char * const sampling_names[] = {
+  [MULTISTART_LHS] = "Latin hypercube",
+  [MULTISTART_SOBOL] = "Sobol"
+};
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    multistart_fit
+ *
+ * DESCRIPTION:	    Fits data->triode, or the surface, from options->starts
+ *		    starting points, each by the trust region method in its
+ *		    own workspace, on a pool of threads. The coefficients of
+ *		    the fit with the least chisq are written to
+ *		    data->coefficients.
+ *
+ * ARGUMENTS:	    data: (fit_data_t *) -- the data and model.
+ *		    options: (const multistart_options_t *) -- the starts.
+ *
+ * RETURN:	    multistart_t * -- the outcome of every start, or NULL on
+ *		    failure.
+ *
+ * NOTES:	    The first start is the model's own starting point, or
+ *		    data->initial_values, so that K starts never do worse than
+ *		    fit_surface() would. The others are drawn from the box of
+ *		    the options. Since every start is seeded the same way, the
+ *		    outcome doesn't depend on the number of threads. The fits
+ *		    only read <data>, whose samples are made once and shared.
+ *		    Every start is fitted by plain least squares, whatever
+ *		    data->loss is.
+ ***/
+multistart_t * multistart_fit(fit_data_t * data,
+			      const multistart_options_t * options)
+{
+  const triode_model_t * triode = data->triode;
+  size_t p = triode ? triode->p : data->model ? data->model->nterms
+    : poly_quadratic.nterms;
+  size_t starts = options->starts > 0 ? options->starts : 1;
+
+  multistart_t * result = malloc(sizeof(multistart_t));
+  if (result == NULL)
+    return NULL;
+  result->starts = starts;
+  result->p = p;
+  result->sampling = options->sampling;
+  result->best = starts;
+  result->start = calloc(starts, sizeof(multistart_start_t));
+  result->block = malloc(3 * starts * p * sizeof(double));
+  multistart_task_t * tasks = calloc(starts, sizeof(multistart_task_t));
+  fit_pool_t * buffers = fit_pool_alloc();
+  if (result->start == NULL || result->block == NULL || tasks == NULL
+      || buffers == NULL)
+    goto error_exit;
+
+  for (size_t k = 0; k < starts; k++) {
+    result->start[k].start = result->block + 3 * k * p;
+    result->start[k].x = result->start[k].start + p;
+    result->start[k].error = result->start[k].x + p;
+  }
+
+  /* Draw the starts from the unit cube, then scale them to the box. */
+  double * points = malloc(starts * p * sizeof(double));
+  if (points == NULL
+      || unit_points(options->sampling, starts - 1, p, options->seed,
+		     points) != 0) {
+    free(points);
+    goto error_exit;
+  }
+
+  double ones[POLY_MAX_TERMS];
+  for (size_t j = 0; j < p; j++)
+    ones[j] = 1.0;
+  const double * initial = data->initial_values ? data->initial_values
+    : triode ? triode->initial : ones;
+  double spread = options->spread > 0 ? options->spread : MULTISTART_SPREAD;
+  for (size_t j = 0; j < p; j++)
+    result->start[0].start[j] = initial[j];
+  for (size_t k = 1; k < starts; k++) {
+    for (size_t j = 0; j < p; j++) {
+      double u = points[(k - 1) * p + j];
+      double * b = &result->start[k].start[j];
+      if (options->lower != NULL && options->upper != NULL)
+	*b = options->lower[j] + u * (options->upper[j] - options->lower[j]);
+      else if (initial[j] != 0)
+	*b = initial[j] * pow(spread, 2 * u - 1);
+      else
+	*b = 2 * u - 1;
+    }
+  }
+  free(points);
+
+  bool own_samples = data->samples == NULL;
+  if (own_samples)
+    data->samples = fit_samples_alloc(data->empirical_data);
+
+  size_t threads = options->threads > 0 ? options->threads
+    : threadpool_ncpus();
+  if (threads > starts)
+    threads = starts;
+  threadpool_t * pool = threadpool_create(threads);
+  if (pool == NULL) {
+    if (own_samples) {
+      fit_samples_free(data->samples);
+      data->samples = NULL;
+    }
+    goto error_exit;
+  }
+  result->threads = threadpool_size(pool);
+
+  struct timespec begin;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  for (size_t k = 0; k < starts; k++) {
+    tasks[k] = (multistart_task_t){
+      .data = data,
+      .start = &result->start[k],
+      .p = p,
+      .buffers = buffers,
+      .max_iter = options->max_iter > 0 ? options->max_iter
+	: MULTISTART_MAX_ITER
+    };
+    if (threadpool_submit(pool, fit_start, &tasks[k]) != 0)
+      fit_start(&tasks[k]);
+  }
+  threadpool_destroy(pool);
+  result->seconds = seconds_since(&begin);
+  free(tasks);
+  tasks = NULL;
+  fit_pool_free(buffers);
+  buffers = NULL;
+
+  if (own_samples) {
+    fit_samples_free(data->samples);
+    data->samples = NULL;
+  }
+
+  for (size_t k = 0; k < starts; k++) {
+    double chisq = result->start[k].chisq;
+    if (isfinite(chisq) && (result->best == starts
+			    || chisq < result->start[result->best].chisq))
+      result->best = k;
+  }
+  if (result->best == starts)
+    goto error_exit;
+
+  fit_param_t * coefficients = realloc(data->coefficients,
+				       p * sizeof(fit_param_t));
+  if (coefficients == NULL)
+    goto error_exit;
+  data->coefficients = coefficients;
+  for (size_t j = 0; j < p; j++) {
+    data->coefficients[j].value = result->start[result->best].x[j];
+    data->coefficients[j].error = result->start[result->best].error[j];
+  }
+  return result;
+
+ error_exit:
+  free(tasks);
+  fit_pool_free(buffers);
+  multistart_free(result);
+  return NULL;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    multistart_points
+ *
+ * DESCRIPTION:	    Writes <starts> points in the box from <lower> to <upper>,
+ *		    by Latin hypercube or Sobol sampling.
+ *
+ * ARGUMENTS:	    sampling: (multistart_sampling_t) -- how to sample.
+ *		    starts: (size_t) -- the number of points.
+ *		    p: (size_t) -- the dimension.
+ *		    lower, upper: (const double *) -- the corners of the box.
+ *		    seed: (unsigned long) -- the seed for the Latin hypercube.
+ *		    points: (double *) -- location for the points, one after
+ *			another.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+int multistart_points(multistart_sampling_t sampling, size_t starts,
+		      size_t p, const double * lower, const double * upper,
+		      unsigned long seed, double * points)
+{
+  if (unit_points(sampling, starts, p, seed, points) != 0)
+    return -1;
+  for (size_t k = 0; k < starts; k++)
+    for (size_t j = 0; j < p; j++)
+      points[k * p + j] = lower[j] + points[k * p + j] * (upper[j] - lower[j]);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    multistart_print
+ *
+ * DESCRIPTION:	    Logs one line for each start, then the coefficients of the
+ *		    best fit, as fit_surface() does.
+ *
+ * ARGUMENTS:	    result: (const multistart_t *) -- the outcome.
+ *		    data: (const fit_data_t *) -- the data it was fitted to.
+ *		    outfh: (FILE *) -- the log.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The best start is marked with a '*'.
+ ***/
+void multistart_print(const multistart_t * result, const fit_data_t * data,
+		      FILE * outfh)
+{
+  const triode_model_t * triode = data->triode;
+  fprintf(outfh, "Multi-start: %zu starts (%s) on %zu threads, %.3f s\n",
+	  result->starts, sampling_names[result->sampling], result->threads,
+	  result->seconds);
+  for (size_t k = 0; k < result->starts; k++) {
+    const multistart_start_t * start = &result->start[k];
+    fprintf(outfh, "%c start %2zu: chisq = %.6e, iter = %zu, f = %zu, "
+	    "df = %zu, fvv = %zu, %.3f s, %s\n",
+	    k == result->best ? '*' : ' ', k, start->chisq, start->niter,
+	    start->nevalf, start->nevaldf, start->nevalfvv, start->seconds,
+	    gsl_strerror(start->status));
+  }
+  if (result->best == result->starts)
+    return;
+
+  const multistart_start_t * best = &result->start[result->best];
+  double dof = data->empirical_data->size1 - result->p;
+  fprintf(outfh, "Best: start %zu\n", result->best);
+  fprintf(outfh, "(Chi^2)/dof = %g\n", best->chisq / dof);
+  for (size_t j = 0; j < result->p; j++) {
+    if (triode != NULL)
+      fprintf(outfh, "%s = %.5f +/- %.5f\n", triode->params[j], best->x[j],
+	      best->error[j]);
+    else
+      fprintf(outfh, "B_%zu = %.5f +/- %.5f\n", j, best->x[j],
+	      best->error[j]);
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    multistart_free
+ *
+ * DESCRIPTION:	    Frees the outcome of a multi-start fit.
+ *
+ * ARGUMENTS:	    result: (multistart_t *) -- the outcome, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void multistart_free(multistart_t * result)
+{
+  if (result == NULL)
+    return;
+  free(result->block);
+  free(result->start);
+  free(result);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    fit_start
+ *
+ * DESCRIPTION:	    Fits the model from one start, in a workspace borrowed
+ *		    for as long as the fit, and records the outcome.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the multistart_task_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). A start which can't
+ *		    be fitted is left with an infinite chisq. At most one
+ *		    workspace is made per thread, rather than per start.
+ ***/
+static void fit_start(void * arg)
+{
+  multistart_task_t * task = (multistart_task_t *)arg;
+  multistart_start_t * start = task->start;
+  const triode_model_t * triode = task->data->triode;
+  size_t n = task->data->empirical_data->size1;
+  size_t p = task->p;
+
+  struct timespec begin;
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  start->chisq = INFINITY;
+  start->status = GSL_ENOMEM;
+
+  gsl_multifit_nlinear_parameters params;
+  trust_params(&task->data->method, triode != NULL, &params);
+
+  /* The callbacks only read the data. */
+  gsl_multifit_nlinear_fdf fdf = (gsl_multifit_nlinear_fdf){
+    .f = triode ? triode_f : surface_f,
+    .df = triode ? triode_df : surface_df,
+    .fvv = triode ? triode_fvv : NULL,
+    .n = n,
+    .p = p,
+    .params = (void *)task->data
+  };
+
+  fit_buffers_t * buffers = fit_pool_acquire(task->buffers, &params, n, p);
+  if (buffers == NULL)
+    goto out;
+  gsl_multifit_nlinear_workspace * w = buffers->w;
+
+  gsl_vector_view x0 = gsl_vector_view_array(start->start, p);
+  gsl_multifit_nlinear_winit(&x0.vector, NULL, &fdf, w);
+  start->status = trust_driver(&task->data->method, task->max_iter, NULL,
+			       NULL, &start->info, w);
+
+  gsl_vector * res = gsl_multifit_nlinear_residual(w);
+  gsl_blas_ddot(res, res, &start->chisq);
+  jacobian_covar(gsl_multifit_nlinear_jac(w), buffers);
+  double c = GSL_MAX_DBL(1, sqrt(start->chisq / (n - p)));
+  gsl_vector * x = gsl_multifit_nlinear_position(w);
+  for (size_t j = 0; j < p; j++) {
+    start->x[j] = gsl_vector_get(x, j);
+    start->error[j] = c * sqrt(gsl_matrix_get(buffers->covar, j, j));
+  }
+  start->niter = gsl_multifit_nlinear_niter(w);
+  start->nevalf = fdf.nevalf;
+  start->nevaldf = fdf.nevaldf;
+  start->nevalfvv = fdf.nevalfvv;
+
+ out:
+  fit_pool_release(task->buffers, buffers);
+  start->seconds = seconds_since(&begin);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    unit_points
+ *
+ * DESCRIPTION:	    Writes <starts> points in the unit cube of dimension <p>.
+ *		    A Latin hypercube puts, for every coordinate, exactly one
+ *		    point in each of the <starts> slices [i/K, (i+1)/K), in
+ *		    an order shuffled per coordinate.
+ *
+ * ARGUMENTS:	    sampling: (multistart_sampling_t) -- how to sample.
+ *		    starts: (size_t) -- the number of points, K.
+ *		    p: (size_t) -- the dimension.
+ *		    seed: (unsigned long) -- the seed for the Latin hypercube.
+ *		    points: (double *) -- location for the points.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    The Sobol sequence ignores the seed.
+ ***/
+static int unit_points(multistart_sampling_t sampling, size_t starts,
+		       size_t p, unsigned long seed, double * points)
+{
+  if (starts == 0)
+    return 0;
+
+  if (sampling == MULTISTART_SOBOL) {
+    gsl_qrng * q = gsl_qrng_alloc(gsl_qrng_sobol, p);
+    if (q == NULL)
+      return -1;
+    for (size_t k = 0; k < starts; k++)
+      gsl_qrng_get(q, points + k * p);
+    gsl_qrng_free(q);
+    return 0;
+  }
+
+  gsl_rng * r = gsl_rng_alloc(gsl_rng_mt19937);
+  size_t * slice = malloc(starts * sizeof(size_t));
+  if (r == NULL || slice == NULL) {
+    if (r != NULL)
+      gsl_rng_free(r);
+    free(slice);
+    return -1;
+  }
+
+  gsl_rng_set(r, seed);
+  for (size_t j = 0; j < p; j++) {
+    for (size_t k = 0; k < starts; k++)
+      slice[k] = k;
+    for (size_t k = starts - 1; k > 0; k--) {
+      size_t i = gsl_rng_uniform_int(r, k + 1);
+      size_t tmp = slice[k];
+      slice[k] = slice[i];
+      slice[i] = tmp;
+    }
+    for (size_t k = 0; k < starts; k++)
+      points[k * p + j] = (slice[k] + gsl_rng_uniform(r)) / starts;
+  }
+
+  free(slice);
+  gsl_rng_free(r);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    seconds_since
+ *
+ * DESCRIPTION:	    Returns the seconds elapsed since <start>.
+ *
+ * ARGUMENTS:	    start: (const struct timespec *) -- from CLOCK_MONOTONIC.
+ *
+ * RETURN:	    double -- the elapsed time.
+ *
+ * NOTES:	    none.
+ ***/
+static double seconds_since(const struct timespec * start)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+/******************************************************************************/
@@ -0,0 +1,290 @@
+/*******************************************************************************
+ * NAME:	    numparse.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    This file contains the kernel which turns fields of text
+ *		    into doubles for the loaders in util.c. It never reads
+ *		    outside the range it is given, doesn't depend on the
+ *		    locale, and is exact: numbers with few enough digits are
+ *		    converted with a single correctly rounded operation, and
+ *		    everything else goes to strtod_l() in the C locale.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <locale.h>
+#include <pthread.h>
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
+#include "numparse.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The most decimal digits a uint64_t mantissa can hold without overflow. */
+#define MAX_MANTISSA_DIGITS 19
+
+/* Fields longer than this are copied to the heap for strtod_l(). */
+#define FALLBACK_BUFSIZE 128
+
+#define IS_DIGIT(c) ((unsigned)((c) - '0') < 10)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define HAVE_SWAR_DIGITS 1
+#endif
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+/* Every power of ten that is exactly representable as a double. */
+static const double exact_powers[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static pthread_once_t c_locale_once = PTHREAD_ONCE_INIT;
+static locale_t c_locale;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static const char * parse_digits(const char * p, const char * end,
+				 uint64_t * mantissa, int * ndigits);
+static int parse_fallback(const char * begin, const char * end,
+			  double * value);
+static void init_c_locale(void);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    parse_double
+ *
+ * DESCRIPTION:	    Parses [begin, end) as a decimal floating point number of
+ *		    the form [+-]digits[.digits][(e|E)[+-]digits].
+ *
+ * ARGUMENTS:	    begin: (const char *) -- the first character.
+ *		    end: (const char *) -- one past the last character.
+ *		    value: (double *) -- location for the result.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the range is not exactly one
+ *		    number. Surrounding whitespace is not allowed.
+ *
+ * NOTES:	    When the digits fit in 53 bits and the power of ten is
+ *		    itself exact, the result is one IEEE multiplication or
+ *		    division, which rounds correctly (Clinger's fast path).
+ *		    This covers everything a curve tracer writes. Anything
+ *		    else, including inf, nan and hex floats, is handed to
+ *		    strtod_l() in the C locale.
+ ***/
+int parse_double(const char * begin, const char * end, double * value)
+{
+  const char * p = begin;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+
+  uint64_t mantissa = 0;
+  int ndigits = 0, exponent = 0;
+  const char * digits = p;
+  p = parse_digits(p, end, &mantissa, &ndigits);
+  bool any = p != digits;
+
+  if (p < end && *p == '.') {
+    const char * fraction = ++p;
+    p = parse_digits(p, end, &mantissa, &ndigits);
+    exponent -= p - fraction;
+    any = any || p != fraction;
+  }
+  if (!any)
+    return parse_fallback(begin, end, value);
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char * q = p + 1;
+    bool negexp = false;
+    if (q < end && (*q == '-' || *q == '+'))
+      negexp = *q++ == '-';
+    if (q == end || !IS_DIGIT(*q))
+      return parse_fallback(begin, end, value);
+
+    int e = 0;
+    while (q < end && IS_DIGIT(*q)) {
+      if (e < 100000)
+	e = e * 10 + (*q - '0');
+      q++;
+    }
+    exponent += negexp ? -e : e;
+    p = q;
+  }
+
+  if (p != end || ndigits > MAX_MANTISSA_DIGITS)
+    return parse_fallback(begin, end, value);
+
+  if (mantissa == 0) {
+    *value = negative ? -0.0 : 0.0;
+    return 0;
+  }
+  if (mantissa > (UINT64_C(1) << 53) || exponent < -22 || exponent > 22)
+    return parse_fallback(begin, end, value);
+
+  double result = (double)mantissa;
+  if (exponent < 0)
+    result /= exact_powers[-exponent];
+  else
+    result *= exact_powers[exponent];
+  *value = negative ? -result : result;
+  return 0;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    parse_digits
+ *
+ * DESCRIPTION:	    Accumulates a run of decimal digits into <mantissa>. Where
+ *		    eight bytes remain in the range, they are tested and
+ *		    converted as one 64-bit word (SWAR), which is most of the
+ *		    work for long fields.
+ *
+ * ARGUMENTS:	    p: (const char *) -- the first character.
+ *		    end: (const char *) -- the end of the range.
+ *		    mantissa: (uint64_t *) -- the digits so far.
+ *		    ndigits: (int *) -- the number of digits so far.
+ *
+ * RETURN:	    const char * -- the first character that isn't a digit.
+ *
+ * NOTES:	    The mantissa is garbage once ndigits passes
+ *		    MAX_MANTISSA_DIGITS; the caller checks.
+ ***/
+static const char * parse_digits(const char * p, const char * end,
+				 uint64_t * mantissa, int * ndigits)
+{
+  uint64_t m = *mantissa;
+  const char * start = p;
+
+#ifdef HAVE_SWAR_DIGITS
+  while (end - p >= 8) {
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+    /* Every byte is in '0'..'9' iff its high nibble is 3 and adding 6
+     * doesn't carry out of its low nibble. */
+    if (((word & 0xF0F0F0F0F0F0F0F0ULL)
+	 | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+	!= 0x3333333333333333ULL)
+      break;
+
+    word -= 0x3030303030303030ULL;
+    word = word * 10 + (word >> 8);
+    word = (((word & 0x000000FF000000FFULL) * 0x000F424000000064ULL)
+	    + (((word >> 16) & 0x000000FF000000FFULL)
+	       * 0x0000271000000001ULL)) >> 32;
+    m = m * 100000000 + (uint32_t)word;
+    p += 8;
+  }
+#endif /* HAVE_SWAR_DIGITS */
+
+  while (p < end && IS_DIGIT(*p))
+    m = m * 10 + (*p++ - '0');
+
+  *mantissa = m;
+  *ndigits += p - start;
+  return p;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    parse_fallback
+ *
+ * DESCRIPTION:	    Parses the range with strtod_l() in the C locale, and
+ *		    requires it to consume all of it.
+ *
+ * ARGUMENTS:	    begin: (const char *) -- the first character.
+ *		    end: (const char *) -- one past the last character.
+ *		    value: (double *) -- location for the result.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    strtod_l() needs a terminated string, so the range is
+ *		    copied; this path is rare.
+ ***/
+static int parse_fallback(const char * begin, const char * end,
+			  double * value)
+{
+  size_t len = end - begin;
+  if (len == 0 || isspace((unsigned char)*begin))
+    return -1;
+
+  pthread_once(&c_locale_once, init_c_locale);
+  if (c_locale == (locale_t)0)
+    return -1;
+
+  char buf[FALLBACK_BUFSIZE];
+  char * copy = len < sizeof(buf) ? buf : malloc(len + 1);
+  if (copy == NULL)
+    return -1;
+  memcpy(copy, begin, len);
+  copy[len] = '\0';
+
+  char * endptr;
+  double result = strtod_l(copy, &endptr, c_locale);
+  int status = (endptr == copy + len) ? 0 : -1;
+  if (copy != buf)
+    free(copy);
+
+  if (status == 0)
+    *value = result;
+  return status;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    init_c_locale
+ *
+ * DESCRIPTION:	    Creates the C locale used by parse_fallback(), once.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The locale is never freed.
+ ***/
+static void init_c_locale(void)
+{
+  c_locale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+/******************************************************************************/
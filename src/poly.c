@@ -0,0 +1,607 @@
+/*******************************************************************************
+ * NAME:	    poly.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Polynomial surface models: the terms of a surface, and the
+ *		    kernels that evaluate its residuals. The surfaces poly_init()
+ *		    makes for degrees 1 to 4 each have a kernel generated from
+ *		    one template with the degree fixed, so that the compiler
+ *		    can unroll and vectorize it; any other set of terms is
+ *		    evaluated by the generic kernel.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "poly.h"
+#include "residual.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Defines a kernel for the terms poly_init(degree, cross) makes. The loops
+ * over the terms have constant bounds, so they unroll completely, and what
+ * is left of the loop over the samples is straight-line code that the
+ * compiler vectorizes. Each term is evaluated as in poly_basis(), so the
+ * kernels agree exactly with the generic one. */
+#define POLY_KERNEL(name, degree, cross)				\
+  static void name(const poly_model_t * model,				\
+		   const double * restrict ep, const double * restrict eg, \
+		   const double * restrict ig, const double * restrict ep2, \
+		   const double * restrict eg2, const double * restrict b, \
+		   double * restrict f, size_t n)			\
+  {									\
+    (void)model;							\
+    for (size_t i = 0; i < n; i++) {					\
+      double gp[(degree) + 1], pp[(degree) + 1];			\
+      powers(gp, eg[i], eg2 ? eg2[i] : eg[i] * eg[i], (degree));	\
+      powers(pp, ep[i], ep2 ? ep2[i] : ep[i] * ep[i], (degree));	\
+      double y = 0.0;							\
+      size_t t = 0;							\
+      _Pragma("GCC unroll 8")						\
+	for (unsigned k = 1; k <= (degree); k++) {			\
+	  y += b[t++] * gp[k];						\
+	  y += b[t++] * pp[k];						\
+	}								\
+      _Pragma("GCC unroll 8")						\
+	for (unsigned s = 2; (cross) && s <= (degree); s++) {		\
+	  _Pragma("GCC unroll 8")					\
+	    for (unsigned a = s - 1; a >= 1; a--)			\
+	      y += b[t++] * (gp[a] * pp[s - a]);			\
+	}								\
+      f[i] = ig[i] - (y + b[t]);					\
+    }									\
+  }
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef void (*poly_kernel_fn_t)(const poly_model_t * model, const double * ep,
+				 const double * eg, const double * ig,
+				 const double * ep2, const double * eg2,
+				 const double * b, double * f, size_t n);
+
+/* The degree and cross terms of the model a kernel is specialized for. */
+typedef struct poly_shape {
+  unsigned degree;
+  int cross;
+} poly_shape_t;
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static inline void powers(double * x, double v, double v2, unsigned degree);
+static void make_terms(poly_model_t * model, unsigned degree, int cross);
+static void specialize(poly_model_t * model);
+static int has_term(const poly_model_t * model, poly_term_t term);
+static void poly_generic(const poly_model_t * model, const double * ep,
+			 const double * eg, const double * ig,
+			 const double * ep2, const double * eg2,
+			 const double * b, double * f, size_t n);
+static void poly_quadratic_kernel(const poly_model_t * model,
+				  const double * ep, const double * eg,
+				  const double * ig, const double * ep2,
+				  const double * eg2, const double * b,
+				  double * f, size_t n);
+
+/*******************************************************************************
+ * KERNELS
+ ***/
+
+POLY_KERNEL(poly_linear, 1, 0)
+POLY_KERNEL(poly_cubic, 3, 0)
+POLY_KERNEL(poly_quartic, 4, 0)
+POLY_KERNEL(poly_quadratic_cross, 2, 1)
+POLY_KERNEL(poly_cubic_cross, 3, 1)
+POLY_KERNEL(poly_quartic_cross, 4, 1)
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+const poly_model_t poly_quadratic = {
+  .nterms = 5,
+  .term = {{1, 0}, {0, 1}, {2, 0}, {0, 2}, {0, 0}},
+  .degree = 2,
+  .kernel = POLY_KERNEL_QUADRATIC
+};
+
+static const poly_kernel_fn_t kernels[POLY_NKERNELS] = {
+  [POLY_KERNEL_GENERIC] = poly_generic,
+  [POLY_KERNEL_QUADRATIC] = poly_quadratic_kernel,
+  [POLY_KERNEL_LINEAR] = poly_linear,
+  [POLY_KERNEL_CUBIC] = poly_cubic,
+  [POLY_KERNEL_QUARTIC] = poly_quartic,
+  [POLY_KERNEL_QUADRATIC_CROSS] = poly_quadratic_cross,
+  [POLY_KERNEL_CUBIC_CROSS] = poly_cubic_cross,
+  [POLY_KERNEL_QUARTIC_CROSS] = poly_quartic_cross
+};
+
+static const poly_shape_t shapes[POLY_NKERNELS] = {
+  [POLY_KERNEL_QUADRATIC] = {2, 0},
+  [POLY_KERNEL_LINEAR] = {1, 0},
+  [POLY_KERNEL_CUBIC] = {3, 0},
+  [POLY_KERNEL_QUARTIC] = {4, 0},
+  [POLY_KERNEL_QUADRATIC_CROSS] = {2, 1},
+  [POLY_KERNEL_CUBIC_CROSS] = {3, 1},
+  [POLY_KERNEL_QUARTIC_CROSS] = {4, 1}
+};
+
+static const char * const kernel_names[POLY_NKERNELS] = {
+  [POLY_KERNEL_GENERIC] = "generic",
+  [POLY_KERNEL_QUADRATIC] = "quadratic",
+  [POLY_KERNEL_LINEAR] = "linear",
+  [POLY_KERNEL_CUBIC] = "cubic",
+  [POLY_KERNEL_QUARTIC] = "quartic",
+  [POLY_KERNEL_QUADRATIC_CROSS] = "quadratic, cross terms",
+  [POLY_KERNEL_CUBIC_CROSS] = "cubic, cross terms",
+  [POLY_KERNEL_QUARTIC_CROSS] = "quartic, cross terms"
+};
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    poly_init
+ *
+ * DESCRIPTION:	    Makes the surface of degree <degree>: the powers of Eg and
+ *		    Ep, alternately, then the cross terms if <cross> is set,
+ *		    then the constant. poly_init(model, 2, 0) is
+ *		    poly_quadratic.
+ *
+ * ARGUMENTS:	    model: (poly_model_t *) -- location for the model.
+ *		    degree: (unsigned) -- the degree, at least 1.
+ *		    cross: (int) -- nonzero for the cross terms.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the degree is 0 or the model
+ *		    would have more than POLY_MAX_TERMS terms.
+ *
+ * NOTES:	    none.
+ ***/
+int poly_init(poly_model_t * model, unsigned degree, int cross)
+{
+  size_t nterms = 2 * degree + 1 + (cross ? degree * (degree - 1) / 2 : 0);
+  if (degree == 0 || degree > POLY_MAX_DEGREE || nterms > POLY_MAX_TERMS)
+    return -1;
+
+  make_terms(model, degree, cross);
+  specialize(model);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_parse
+ *
+ * DESCRIPTION:	    Makes a surface from a description, either a degree for
+ *		    poly_init() with an optional 'x' for the cross terms, or a
+ *		    list of terms such as "Eg,Ep,Eg*Ep,Ep^3,1".
+ *
+ * ARGUMENTS:	    model: (poly_model_t *) -- location for the model.
+ *		    spec: (const char *) -- the description.
+ *
+ * RETURN:	    int -- 0 on success, -1 if <spec> isn't valid, has a term
+ *		    twice, or has too many terms or too high a power.
+ *
+ * NOTES:	    A list of terms in the order poly_init() makes them gets
+ *		    the same specialized kernel.
+ ***/
+int poly_parse(poly_model_t * model, const char * spec)
+{
+  char * end;
+  if (isdigit((unsigned char)spec[0])) {
+    unsigned long degree = strtoul(spec, &end, 10);
+    if (*end == '\0' || (*end == 'x' && end[1] == '\0'))
+      return degree > POLY_MAX_DEGREE ? -1
+	: poly_init(model, degree, *end == 'x');
+  }
+
+  model->nterms = 0;
+  model->degree = 0;
+  const char * s = spec;
+  for (;;) {
+    poly_term_t term = {0, 0};
+    if (s[0] == '1' && (s[1] == ',' || s[1] == '\0')) {
+      s++;
+    } else {
+      for (;;) {
+	unsigned char * power;
+	if (!strncmp(s, "Eg", 2))
+	  power = &term.eg;
+	else if (!strncmp(s, "Ep", 2))
+	  power = &term.ep;
+	else
+	  return -1;
+	s += 2;
+
+	unsigned long k = 1;
+	if (*s == '^') {
+	  k = strtoul(s + 1, &end, 10);
+	  if (end == s + 1)
+	    return -1;
+	  s = end;
+	}
+	if (k == 0 || *power + k > POLY_MAX_DEGREE)
+	  return -1;
+	*power += k;
+
+	if (*s != '*')
+	  break;
+	s++;
+      }
+    }
+
+    if (model->nterms == POLY_MAX_TERMS || has_term(model, term))
+      return -1;
+    model->term[model->nterms++] = term;
+    if (term.eg > model->degree)
+      model->degree = term.eg;
+    if (term.ep > model->degree)
+      model->degree = term.ep;
+
+    if (*s == '\0')
+      break;
+    if (*s++ != ',')
+      return -1;
+  }
+
+  specialize(model);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_basis
+ *
+ * DESCRIPTION:	    Computes the terms of the surface at one sample, which
+ *		    are the regressors of the least squares problem and, up to
+ *		    sign, a row of its Jacobian.
+ *
+ * ARGUMENTS:	    model: (const poly_model_t *) -- the model.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *		    ep2, eg2: (double) -- their squares, which are used as
+ *			given, since the data may carry them rounded.
+ *		    x: (double *) -- location for the model->nterms terms.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void poly_basis(const poly_model_t * model, double ep, double eg,
+		double ep2, double eg2, double * x)
+{
+  double gp[POLY_MAX_DEGREE + 1], pp[POLY_MAX_DEGREE + 1];
+  powers(gp, eg, eg2, model->degree);
+  powers(pp, ep, ep2, model->degree);
+  for (size_t t = 0; t < model->nterms; t++)
+    x[t] = gp[model->term[t].eg] * pp[model->term[t].ep];
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_residuals
+ *
+ * DESCRIPTION:	    Computes the residuals of the surface,
+ *
+ *			f_i = Ig_i - sum_k b_k term_k(Ep_i, Eg_i),
+ *
+ *		    with the kernel the model was specialized for.
+ *
+ * ARGUMENTS:	    model: (const poly_model_t *) -- the model.
+ *		    ep, eg, ig: (const double *) -- the columns of the data,
+ *			<n> contiguous doubles each.
+ *		    ep2, eg2: (const double *) -- the squares of <ep> and
+ *			<eg>, or NULL for the kernel to compute them.
+ *		    b: (const double *) -- the coefficients.
+ *		    f: (double *) -- location for the <n> residuals.
+ *		    n: (size_t) -- the number of samples.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The quadratic surface is left to residual_surface(), which
+ *		    dispatches on the instruction set and rounds differently.
+ ***/
+void poly_residuals(const poly_model_t * model, const double * ep,
+		    const double * eg, const double * ig, const double * ep2,
+		    const double * eg2, const double * b, double * f,
+		    size_t n)
+{
+  poly_kernel_t kernel = model->kernel < POLY_NKERNELS ? model->kernel
+    : POLY_KERNEL_GENERIC;
+  kernels[kernel](model, ep, eg, ig, ep2, eg2, b, f, n);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_term_name
+ *
+ * DESCRIPTION:	    Writes the name of a term: the power of Eg, then that of
+ *		    Ep, as "Eg^2*Ep", or "y**2*x" for gnuplot.
+ *
+ * ARGUMENTS:	    term: (poly_term_t) -- the term.
+ *		    syntax: (poly_syntax_t) -- the syntax.
+ *		    buf: (char *) -- location for the name.
+ *		    size: (size_t) -- the size of <buf>.
+ *
+ * RETURN:	    int -- the length of the name.
+ *
+ * NOTES:	    none.
+ ***/
+int poly_term_name(poly_term_t term, poly_syntax_t syntax, char * buf,
+		   size_t size)
+{
+  const char * names[2] = { "Eg", "Ep" };
+  const char * power = "^";
+  if (syntax == POLY_SYNTAX_GNUPLOT) {
+    names[0] = "y";
+    names[1] = "x";
+    power = "**";
+  }
+
+  if (term.eg == 0 && term.ep == 0)
+    return snprintf(buf, size, "1");
+
+  const unsigned char exponents[2] = { term.eg, term.ep };
+  int length = 0;
+  for (int v = 0; v < 2; v++) {
+    if (exponents[v] == 0)
+      continue;
+    size_t left = (size_t)length < size ? size - length : 0;
+    char * at = left > 0 ? buf + length : NULL;
+    const char * join = length > 0 ? "*" : "";
+    if (exponents[v] == 1)
+      length += snprintf(at, left, "%s%s", join, names[v]);
+    else
+      length += snprintf(at, left, "%s%s%s%u", join, names[v], power,
+			 exponents[v]);
+  }
+  return length;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_expr
+ *
+ * DESCRIPTION:	    Writes the surface with its coefficients. For the log,
+ *		    each coefficient is followed by its term, as
+ *		    "1.4000e+00Eg + ... + 3.0000e-01"; for gnuplot they are
+ *		    multiplied, as "1.4*y + ... + 0.3".
+ *
+ * ARGUMENTS:	    model: (const poly_model_t *) -- the model.
+ *		    b: (const double *) -- the coefficients.
+ *		    syntax: (poly_syntax_t) -- the syntax.
+ *
+ * RETURN:	    char * -- the expression, or NULL if there was no memory.
+ *
+ * NOTES:	    The caller frees the expression.
+ ***/
+char * poly_expr(const poly_model_t * model, const double * b,
+		 poly_syntax_t syntax)
+{
+  char * expr = NULL;
+  size_t size = 0;
+  FILE * stream = open_memstream(&expr, &size);
+  if (stream == NULL)
+    return NULL;
+
+  for (size_t t = 0; t < model->nterms; t++) {
+    char name[64];
+    poly_term_name(model->term[t], syntax, name, sizeof(name));
+    bool constant = model->term[t].eg == 0 && model->term[t].ep == 0;
+    if (syntax == POLY_SYNTAX_GNUPLOT)
+      fprintf(stream, "%s%2.4g%s%s", t > 0 ? " + " : "", b[t],
+	      constant ? "" : "*", constant ? "" : name);
+    else
+      fprintf(stream, "%s%2.4e%s", t > 0 ? " + " : "", b[t],
+	      constant ? "" : name);
+  }
+
+  if (fclose(stream) != 0) {
+    free(expr);
+    return NULL;
+  }
+  return expr;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_kernel_name
+ *
+ * DESCRIPTION:	    Returns the name of a kernel, for logs and benchmarks.
+ *
+ * ARGUMENTS:	    kernel: (poly_kernel_t) -- the kernel.
+ *
+ * RETURN:	    const char * -- the name, or "unknown".
+ *
+ * NOTES:	    none.
+ ***/
+const char * poly_kernel_name(poly_kernel_t kernel)
+{
+  return kernel < POLY_NKERNELS ? kernel_names[kernel] : "unknown";
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    powers
+ *
+ * DESCRIPTION:	    Fills x[k] = v^k for k = 0 to <degree>, taking v^2 as
+ *		    given.
+ *
+ * ARGUMENTS:	    x: (double *) -- location for the <degree> + 1 powers.
+ *		    v: (double) -- the value.
+ *		    v2: (double) -- its square.
+ *		    degree: (unsigned) -- the highest power.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Inlined into the kernels, where <degree> is a constant.
+ ***/
+static inline void powers(double * x, double v, double v2, unsigned degree)
+{
+  x[0] = 1.0;
+  if (degree >= 1)
+    x[1] = v;
+  if (degree >= 2)
+    x[2] = v2;
+  for (unsigned k = 3; k <= degree; k++)
+    x[k] = x[k - 1] * v;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    make_terms
+ *
+ * DESCRIPTION:	    Fills in the terms of the surface of a degree, in the
+ *		    order described at poly_init().
+ *
+ * ARGUMENTS:	    model: (poly_model_t *) -- the model.
+ *		    degree: (unsigned) -- the degree.
+ *		    cross: (int) -- nonzero for the cross terms.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The caller checks that the terms fit.
+ ***/
+static void make_terms(poly_model_t * model, unsigned degree, int cross)
+{
+  size_t t = 0;
+  for (unsigned k = 1; k <= degree; k++) {
+    model->term[t++] = (poly_term_t){ .eg = k, .ep = 0 };
+    model->term[t++] = (poly_term_t){ .eg = 0, .ep = k };
+  }
+  for (unsigned s = 2; cross && s <= degree; s++) {
+    for (unsigned a = s - 1; a >= 1; a--)
+      model->term[t++] = (poly_term_t){ .eg = a, .ep = s - a };
+  }
+  model->term[t++] = (poly_term_t){ .eg = 0, .ep = 0 };
+  model->nterms = t;
+  model->degree = degree;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    specialize
+ *
+ * DESCRIPTION:	    Sets model->kernel to the kernel specialized for its
+ *		    terms, if there is one, and to the generic one otherwise.
+ *
+ * ARGUMENTS:	    model: (poly_model_t *) -- the model.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void specialize(poly_model_t * model)
+{
+  model->kernel = POLY_KERNEL_GENERIC;
+  for (int k = POLY_KERNEL_GENERIC + 1; k < POLY_NKERNELS; k++) {
+    poly_model_t shape;
+    make_terms(&shape, shapes[k].degree, shapes[k].cross);
+    if (shape.nterms == model->nterms
+	&& !memcmp(shape.term, model->term,
+		   model->nterms * sizeof(poly_term_t))) {
+      model->kernel = k;
+      return;
+    }
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    has_term
+ *
+ * DESCRIPTION:	    Whether a model already has a term.
+ *
+ * ARGUMENTS:	    model: (const poly_model_t *) -- the model.
+ *		    term: (poly_term_t) -- the term.
+ *
+ * RETURN:	    int -- nonzero if it has.
+ *
+ * NOTES:	    none.
+ ***/
+static int has_term(const poly_model_t * model, poly_term_t term)
+{
+  for (size_t t = 0; t < model->nterms; t++) {
+    if (model->term[t].eg == term.eg && model->term[t].ep == term.ep)
+      return 1;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_generic
+ *
+ * DESCRIPTION:	    Computes the residuals of any surface, reading its terms
+ *		    from the model for each sample.
+ *
+ * ARGUMENTS:	    As poly_residuals().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    This is the reference the specialized kernels are checked
+ *		    against.
+ ***/
+static void poly_generic(const poly_model_t * model, const double * ep,
+			 const double * eg, const double * ig,
+			 const double * ep2, const double * eg2,
+			 const double * b, double * f, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    double x[POLY_MAX_TERMS];
+    poly_basis(model, ep[i], eg[i], ep2 ? ep2[i] : ep[i] * ep[i],
+	       eg2 ? eg2[i] : eg[i] * eg[i], x);
+    double y = 0.0;
+    for (size_t t = 0; t < model->nterms; t++)
+      y += b[t] * x[t];
+    f[i] = ig[i] - y;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    poly_quadratic_kernel
+ *
+ * DESCRIPTION:	    Computes the residuals of poly_quadratic with
+ *		    residual_surface().
+ *
+ * ARGUMENTS:	    As poly_residuals().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void poly_quadratic_kernel(const poly_model_t * model,
+				  const double * ep, const double * eg,
+				  const double * ig, const double * ep2,
+				  const double * eg2, const double * b,
+				  double * f, size_t n)
+{
+  (void)model;
+  residual_surface(ep, eg, ig, ep2, eg2, b, f, n);
+}
+
+/******************************************************************************/
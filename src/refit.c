@@ -0,0 +1,267 @@
+/*******************************************************************************
+ * NAME:	    refit.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Incremental fits of a surface. The surfaces are linear in
+ *		    their coefficients, so a fit is just the QR factor of its
+ *		    design matrix, which a row updates when it arrives and
+ *		    downdates when it leaves. A capture that grows by a few
+ *		    hundred rows is refitted in time for those rows alone.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+#include "refit.h"
+#include "fit.h"
+#include "linfit.h"
+#include "poly.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+struct refit {
+  poly_model_t model;
+  linfit_t * fit;
+  gsl_vector * c;
+  gsl_matrix * covar;
+};
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void row_regressors(const refit_t * refit, const gsl_matrix * rows,
+			   size_t i, double * x);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    refit_alloc
+ *
+ * DESCRIPTION:	    Makes an incremental fit with no rows.
+ *
+ * ARGUMENTS:	    model: (const poly_model_t *) -- the surface, or NULL for
+ *			poly_quadratic.
+ *
+ * RETURN:	    refit_t * -- the fit, or NULL if there was no memory.
+ *
+ * NOTES:	    none.
+ ***/
+refit_t * refit_alloc(const poly_model_t * model)
+{
+  refit_t * refit = malloc(sizeof(refit_t));
+  if (refit == NULL)
+    return NULL;
+
+  refit->model = model != NULL ? *model : poly_quadratic;
+  size_t p = refit->model.nterms;
+  refit->fit = linfit_alloc(p);
+  refit->c = gsl_vector_alloc(p);
+  refit->covar = gsl_matrix_alloc(p, p);
+  if (refit->fit == NULL || refit->c == NULL || refit->covar == NULL) {
+    refit_free(refit);
+    return NULL;
+  }
+  return refit;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    refit_free
+ *
+ * DESCRIPTION:	    Frees an incremental fit.
+ *
+ * ARGUMENTS:	    refit: (refit_t *) -- the fit, or NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void refit_free(refit_t * refit)
+{
+  if (refit == NULL)
+    return;
+
+  linfit_free(refit->fit);
+  if (refit->c != NULL)
+    gsl_vector_free(refit->c);
+  if (refit->covar != NULL)
+    gsl_matrix_free(refit->covar);
+  free(refit);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    refit_add
+ *
+ * DESCRIPTION:	    Folds rows into the factor, updating it by one rank for
+ *		    each.
+ *
+ * ARGUMENTS:	    refit: (refit_t *) -- the fit.
+ *		    rows: (const gsl_matrix *) -- the rows, with the columns
+ *			of fit_column_t; the squares may be left out.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    O(p^2) per row.
+ ***/
+void refit_add(refit_t * refit, const gsl_matrix * rows)
+{
+  for (size_t i = 0; i < rows->size1; i++) {
+    double x[POLY_MAX_TERMS];
+    row_regressors(refit, rows, i, x);
+    linfit_add(refit->fit, x, gsl_matrix_get(rows, i, FIT_IG));
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    refit_remove
+ *
+ * DESCRIPTION:	    Takes rows back out of the factor, downdating it by one
+ *		    rank for each.
+ *
+ * ARGUMENTS:	    refit: (refit_t *) -- the fit.
+ *		    rows: (const gsl_matrix *) -- the rows, as they were
+ *			added.
+ *
+ * RETURN:	    int -- 0 on success, -1 if a row couldn't be removed, as
+ *		    described at linfit_remove(). The rows before it were.
+ *
+ * NOTES:	    O(p^2) per row. The regressors must be computed the same
+ *		    way as when the rows were added, so the rows should be
+ *		    passed with the same columns.
+ ***/
+int refit_remove(refit_t * refit, const gsl_matrix * rows)
+{
+  for (size_t i = 0; i < rows->size1; i++) {
+    double x[POLY_MAX_TERMS];
+    row_regressors(refit, rows, i, x);
+    if (linfit_remove(refit->fit, x, gsl_matrix_get(rows, i, FIT_IG))
+	!= GSL_SUCCESS)
+      return -1;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    refit_solve
+ *
+ * DESCRIPTION:	    Solves the factor for the coefficients of the rows in the
+ *		    fit, with their errors scaled as fit_context_fit() scales
+ *		    them.
+ *
+ * ARGUMENTS:	    refit: (refit_t *) -- the fit.
+ *		    result: (fit_result_t *) -- location for the outcome.
+ *		    covar: (gsl_matrix *) -- p x p matrix for the unscaled
+ *			covariance (X^T X)^-1, or NULL.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the rows don't determine every
+ *		    coefficient, in which case result->p is 0.
+ *
+ * NOTES:	    O(p^3), whatever the number of rows, and allocates
+ *		    nothing.
+ ***/
+int refit_solve(refit_t * refit, fit_result_t * result, gsl_matrix * covar)
+{
+  const linfit_t * fit = refit->fit;
+  size_t p = fit->p;
+  result->p = 0;
+  result->n = fit->n;
+  if (fit->n <= p
+      || linfit_solve(fit, refit->c, refit->covar, &result->chisq)
+      != GSL_SUCCESS)
+    return -1;
+
+  double scale = GSL_MAX_DBL(1, sqrt(result->chisq / (fit->n - p)));
+  for (size_t j = 0; j < p; j++) {
+    result->coefficients[j].value = gsl_vector_get(refit->c, j);
+    result->coefficients[j].error = scale
+      * sqrt(gsl_matrix_get(refit->covar, j, j));
+  }
+  result->p = p;
+  result->status = GSL_SUCCESS;
+  result->cost = 1.0;
+  if (covar != NULL)
+    gsl_matrix_memcpy(covar, refit->covar);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    refit_rows
+ *
+ * DESCRIPTION:	    The number of rows in the fit.
+ *
+ * ARGUMENTS:	    refit: (const refit_t *) -- the fit.
+ *
+ * RETURN:	    size_t -- the rows added, less those removed.
+ *
+ * NOTES:	    none.
+ ***/
+size_t refit_rows(const refit_t * refit)
+{
+  return refit->fit->n;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    row_regressors
+ *
+ * DESCRIPTION:	    Computes the terms of the surface at one row, from the
+ *		    squares in the row if it has them, as fit_context_fit()
+ *		    does.
+ *
+ * ARGUMENTS:	    refit: (const refit_t *) -- the fit.
+ *		    rows: (const gsl_matrix *) -- the rows.
+ *		    i: (size_t) -- the row.
+ *		    x: (double *) -- location for the terms.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void row_regressors(const refit_t * refit, const gsl_matrix * rows,
+			   size_t i, double * x)
+{
+  double ep = gsl_matrix_get(rows, i, FIT_EP);
+  double eg = gsl_matrix_get(rows, i, FIT_EG);
+  bool squares = rows->size2 >= FIT_NCOLUMNS;
+  poly_basis(&refit->model, ep, eg,
+	     squares ? gsl_matrix_get(rows, i, FIT_EP2) : ep * ep,
+	     squares ? gsl_matrix_get(rows, i, FIT_EG2) : eg * eg, x);
+}
+
+/******************************************************************************/
@@ -0,0 +1,407 @@
+/*******************************************************************************
+ * NAME:	    residual.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    This file contains the kernels which compute the residuals
+ *		    of the surface for the solver. The samples are read from
+ *		    contiguous per-column arrays, so each kernel is a single
+ *		    streaming pass of vector loads and multiply-adds. There
+ *		    is a kernel for each of SSE2, AVX2 and AVX-512 on x86,
+ *		    and the best one this CPU supports is picked at run time,
+ *		    so one binary runs everywhere. Elsewhere the scalar
+ *		    reference is used.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "residual.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Arguments of a kernel, offset to start at sample i, for its scalar tail. */
+#define RESIDUAL_TAIL(i)						\
+  ep + (i), eg + (i), ig + (i), ep2 ? ep2 + (i) : NULL,			\
+    eg2 ? eg2 + (i) : NULL, b, f + (i), n - (i)
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef void (*residual_kernel_t)(const double * ep, const double * eg,
+				  const double * ig, const double * ep2,
+				  const double * eg2, const double * b,
+				  double * f, size_t n);
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void surface_scalar(const double * ep, const double * eg,
+			   const double * ig, const double * ep2,
+			   const double * eg2, const double * b, double * f,
+			   size_t n);
+#ifdef HAVE_X86_KERNELS
+static void surface_sse2(const double * ep, const double * eg,
+			 const double * ig, const double * ep2,
+			 const double * eg2, const double * b, double * f,
+			 size_t n)
+  __attribute__((target("sse2")));
+static void surface_avx2(const double * ep, const double * eg,
+			 const double * ig, const double * ep2,
+			 const double * eg2, const double * b, double * f,
+			 size_t n)
+  __attribute__((target("avx2,fma")));
+static void surface_avx512(const double * ep, const double * eg,
+			   const double * ig, const double * ep2,
+			   const double * eg2, const double * b, double * f,
+			   size_t n)
+  __attribute__((target("avx512f")));
+#endif /* HAVE_X86_KERNELS */
+static void init_dispatch(void);
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+static const residual_kernel_t kernels[RESIDUAL_NISAS] = {
+  [RESIDUAL_SCALAR] = surface_scalar,
+#ifdef HAVE_X86_KERNELS
+  [RESIDUAL_SSE2] = surface_sse2,
+  [RESIDUAL_AVX2] = surface_avx2,
+  [RESIDUAL_AVX512] = surface_avx512
+#endif
+};
+
+static const char * const isa_names[RESIDUAL_NISAS] = {
+  [RESIDUAL_SCALAR] = "scalar",
+  [RESIDUAL_SSE2] = "sse2",
+  [RESIDUAL_AVX2] = "avx2",
+  [RESIDUAL_AVX512] = "avx512"
+};
+
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+static bool supported[RESIDUAL_NISAS];
+static residual_isa_t best_isa;
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    residual_surface
+ *
+ * DESCRIPTION:	    Computes the residuals of the surface fitted by fit.c,
+ *
+ *			f_i = Ig_i - (b0 Eg_i + b1 Ep_i + b2 Eg_i^2
+ *				      + b3 Ep_i^2 + b4),
+ *
+ *		    with the best kernel this CPU supports.
+ *
+ * ARGUMENTS:	    ep, eg, ig: (const double *) -- the columns of the data,
+ *			<n> contiguous doubles each.
+ *		    ep2, eg2: (const double *) -- the squares of <ep> and
+ *			<eg>, or NULL for the kernel to compute them.
+ *		    b: (const double *) -- the 5 coefficients.
+ *		    f: (double *) -- location for the <n> residuals.
+ *		    n: (size_t) -- the number of samples.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The arrays needn't be aligned. The AVX2 and AVX-512
+ *		    kernels use fused multiply-adds, so they may differ from
+ *		    the scalar reference in the last bit or two.
+ ***/
+void residual_surface(const double * ep, const double * eg,
+		      const double * ig, const double * ep2,
+		      const double * eg2, const double * b, double * f,
+		      size_t n)
+{
+  pthread_once(&dispatch_once, init_dispatch);
+  kernels[best_isa](ep, eg, ig, ep2, eg2, b, f, n);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    residual_surface_isa
+ *
+ * DESCRIPTION:	    As residual_surface(), but with the kernel for <isa>, so
+ *		    that the kernels can be compared against each other.
+ *
+ * ARGUMENTS:	    isa: (residual_isa_t) -- the instruction set.
+ *		    The rest are as for residual_surface().
+ *
+ * RETURN:	    int -- 0 on success, -1 if <isa> isn't supported.
+ *
+ * NOTES:	    none.
+ ***/
+int residual_surface_isa(residual_isa_t isa, const double * ep,
+			 const double * eg, const double * ig,
+			 const double * ep2, const double * eg2,
+			 const double * b, double * f, size_t n)
+{
+  if (!residual_isa_supported(isa))
+    return -1;
+
+  kernels[isa](ep, eg, ig, ep2, eg2, b, f, n);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    residual_isa_supported
+ *
+ * DESCRIPTION:	    Reports whether there is a kernel for <isa> in this build
+ *		    and the CPU can run it.
+ *
+ * ARGUMENTS:	    isa: (residual_isa_t) -- the instruction set.
+ *
+ * RETURN:	    bool -- true if the kernel can be used.
+ *
+ * NOTES:	    none.
+ ***/
+bool residual_isa_supported(residual_isa_t isa)
+{
+  pthread_once(&dispatch_once, init_dispatch);
+  return isa < RESIDUAL_NISAS && supported[isa];
+}
+
+/*******************************************************************************
+ * FUNCTION:	    residual_isa
+ *
+ * DESCRIPTION:	    Reports the instruction set residual_surface() uses.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    residual_isa_t -- the most capable one supported.
+ *
+ * NOTES:	    none.
+ ***/
+residual_isa_t residual_isa(void)
+{
+  pthread_once(&dispatch_once, init_dispatch);
+  return best_isa;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    residual_isa_name
+ *
+ * DESCRIPTION:	    Names an instruction set, for reports.
+ *
+ * ARGUMENTS:	    isa: (residual_isa_t) -- the instruction set.
+ *
+ * RETURN:	    const char * -- its name, or "unknown".
+ *
+ * NOTES:	    none.
+ ***/
+const char * residual_isa_name(residual_isa_t isa)
+{
+  return isa < RESIDUAL_NISAS ? isa_names[isa] : "unknown";
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    surface_scalar
+ *
+ * DESCRIPTION:	    The reference kernel, one sample at a time. The terms are
+ *		    summed in the same order as by surface_f().
+ *
+ * ARGUMENTS:	    As residual_surface().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Also finishes the samples left over by the vector kernels.
+ ***/
+static void surface_scalar(const double * ep, const double * eg,
+			   const double * ig, const double * ep2,
+			   const double * eg2, const double * b, double * f,
+			   size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    double g2 = eg2 ? eg2[i] : eg[i] * eg[i];
+    double p2 = ep2 ? ep2[i] : ep[i] * ep[i];
+    double y = (b[0] * eg[i]) + (b[1] * ep[i]) + (b[2] * g2) + (b[3] * p2)
+      + b[4];
+    f[i] = ig[i] - y;
+  }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/*******************************************************************************
+ * FUNCTION:	    surface_sse2
+ *
+ * DESCRIPTION:	    The SSE2 kernel, two samples at a time. Without fused
+ *		    multiply-adds it rounds exactly as the scalar reference.
+ *
+ * ARGUMENTS:	    As residual_surface().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void surface_sse2(const double * ep, const double * eg,
+			 const double * ig, const double * ep2,
+			 const double * eg2, const double * b, double * f,
+			 size_t n)
+{
+  const __m128d b0 = _mm_set1_pd(b[0]), b1 = _mm_set1_pd(b[1]);
+  const __m128d b2 = _mm_set1_pd(b[2]), b3 = _mm_set1_pd(b[3]);
+  const __m128d b4 = _mm_set1_pd(b[4]);
+
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d g = _mm_loadu_pd(eg + i), p = _mm_loadu_pd(ep + i);
+    __m128d g2 = eg2 ? _mm_loadu_pd(eg2 + i) : _mm_mul_pd(g, g);
+    __m128d p2 = ep2 ? _mm_loadu_pd(ep2 + i) : _mm_mul_pd(p, p);
+    __m128d y = _mm_add_pd(_mm_mul_pd(b0, g), _mm_mul_pd(b1, p));
+    y = _mm_add_pd(y, _mm_mul_pd(b2, g2));
+    y = _mm_add_pd(y, _mm_mul_pd(b3, p2));
+    y = _mm_add_pd(y, b4);
+    _mm_storeu_pd(f + i, _mm_sub_pd(_mm_loadu_pd(ig + i), y));
+  }
+
+  surface_scalar(RESIDUAL_TAIL(i));
+}
+
+/*******************************************************************************
+ * FUNCTION:	    surface_avx2
+ *
+ * DESCRIPTION:	    The AVX2 kernel, four samples at a time, with the terms
+ *		    accumulated by fused multiply-adds.
+ *
+ * ARGUMENTS:	    As residual_surface().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void surface_avx2(const double * ep, const double * eg,
+			 const double * ig, const double * ep2,
+			 const double * eg2, const double * b, double * f,
+			 size_t n)
+{
+  const __m256d b0 = _mm256_set1_pd(b[0]), b1 = _mm256_set1_pd(b[1]);
+  const __m256d b2 = _mm256_set1_pd(b[2]), b3 = _mm256_set1_pd(b[3]);
+  const __m256d b4 = _mm256_set1_pd(b[4]);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d g = _mm256_loadu_pd(eg + i), p = _mm256_loadu_pd(ep + i);
+    __m256d g2 = eg2 ? _mm256_loadu_pd(eg2 + i) : _mm256_mul_pd(g, g);
+    __m256d p2 = ep2 ? _mm256_loadu_pd(ep2 + i) : _mm256_mul_pd(p, p);
+    __m256d y = _mm256_fmadd_pd(b0, g, b4);
+    y = _mm256_fmadd_pd(b1, p, y);
+    y = _mm256_fmadd_pd(b2, g2, y);
+    y = _mm256_fmadd_pd(b3, p2, y);
+    _mm256_storeu_pd(f + i, _mm256_sub_pd(_mm256_loadu_pd(ig + i), y));
+  }
+
+  surface_scalar(RESIDUAL_TAIL(i));
+}
+
+/*******************************************************************************
+ * FUNCTION:	    surface_avx512
+ *
+ * DESCRIPTION:	    The AVX-512 kernel, eight samples at a time. The last
+ *		    partial vector is loaded and stored under a mask, so
+ *		    there is no scalar tail.
+ *
+ * ARGUMENTS:	    As residual_surface().
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void surface_avx512(const double * ep, const double * eg,
+			   const double * ig, const double * ep2,
+			   const double * eg2, const double * b, double * f,
+			   size_t n)
+{
+  const __m512d b0 = _mm512_set1_pd(b[0]), b1 = _mm512_set1_pd(b[1]);
+  const __m512d b2 = _mm512_set1_pd(b[2]), b3 = _mm512_set1_pd(b[3]);
+  const __m512d b4 = _mm512_set1_pd(b[4]);
+
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 m = n - i >= 8 ? 0xFF : (__mmask8)((1u << (n - i)) - 1);
+    __m512d g = _mm512_maskz_loadu_pd(m, eg + i);
+    __m512d p = _mm512_maskz_loadu_pd(m, ep + i);
+    __m512d g2 = eg2 ? _mm512_maskz_loadu_pd(m, eg2 + i)
+      : _mm512_mul_pd(g, g);
+    __m512d p2 = ep2 ? _mm512_maskz_loadu_pd(m, ep2 + i)
+      : _mm512_mul_pd(p, p);
+    __m512d y = _mm512_fmadd_pd(b0, g, b4);
+    y = _mm512_fmadd_pd(b1, p, y);
+    y = _mm512_fmadd_pd(b2, g2, y);
+    y = _mm512_fmadd_pd(b3, p2, y);
+    _mm512_mask_storeu_pd(f + i, m,
+			  _mm512_sub_pd(_mm512_maskz_loadu_pd(m, ig + i), y));
+  }
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+/*******************************************************************************
+ * FUNCTION:	    init_dispatch
+ *
+ * DESCRIPTION:	    Asks the CPU which of the kernels it can run, once, and
+ *		    picks the most capable.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void init_dispatch(void)
+{
+  supported[RESIDUAL_SCALAR] = true;
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  supported[RESIDUAL_SSE2] = __builtin_cpu_supports("sse2");
+  supported[RESIDUAL_AVX2] = __builtin_cpu_supports("avx2")
+    && __builtin_cpu_supports("fma");
+  supported[RESIDUAL_AVX512] = __builtin_cpu_supports("avx512f");
+#endif
+
+  best_isa = RESIDUAL_SCALAR;
+  for (int isa = 0; isa < RESIDUAL_NISAS; isa++) {
+    if (supported[isa])
+      best_isa = isa;
+  }
+}
+
+/******************************************************************************/
@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * NAME:	    robust.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    The loss functions for robust fits. A robust fit is a
+ *		    plain least squares fit, then repeated fits with each
+ *		    sample weighed by how far its residual lies from the last
+ *		    fit, in units of a scale which outliers can't inflate, so
+ *		    that a few glitches in the data don't pull the surface
+ *		    towards them.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_sort.h>
+#include <gsl/gsl_statistics_double.h>
+
+#include "robust.h"
+
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* The median of |u| for u standard normal, so that the scale of normal
+ * residuals is their standard deviation. */
+#define ROBUST_MAD_NORMAL 0.6745
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    robust_parse
+ *
+ * DESCRIPTION:	    Reads a loss by name, with an optional tuning constant
+ *		    after a colon.
+ *
+ * ARGUMENTS:	    spec: (const char *) -- the description.
+ *		    loss: (robust_loss_t *) -- location for the loss.
+ *		    tuning: (double *) -- location for the constant, or 0 if
+ *			there is none.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the name isn't known or the
+ *		    constant isn't a positive number.
+ *
+ * NOTES:	    none.
+ ***/
+int robust_parse(const char * spec, robust_loss_t * loss, double * tuning)
+{
+  size_t len = strcspn(spec, ":");
+  if (len == 5 && !strncmp(spec, "huber", len))
+    *loss = ROBUST_HUBER;
+  else if (len == 5 && !strncmp(spec, "tukey", len))
+    *loss = ROBUST_TUKEY;
+  else
+    return -1;
+
+  *tuning = 0.0;
+  if (spec[len] == '\0')
+    return 0;
+  char * end;
+  *tuning = strtod(spec + len + 1, &end);
+  return *end == '\0' && *tuning > 0 ? 0 : -1;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    robust_name
+ *
+ * DESCRIPTION:	    The name of a loss.
+ *
+ * ARGUMENTS:	    loss: (robust_loss_t) -- the loss.
+ *
+ * RETURN:	    const char * -- its name, as robust_parse() reads it.
+ *
+ * NOTES:	    none.
+ ***/
+const char * robust_name(robust_loss_t loss)
+{
+  switch (loss) {
+  case ROBUST_HUBER: return "huber";
+  case ROBUST_TUKEY: return "tukey";
+  default: return "least squares";
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    robust_tuning
+ *
+ * DESCRIPTION:	    The tuning constant k of a loss.
+ *
+ * ARGUMENTS:	    loss: (robust_loss_t) -- the loss.
+ *		    tuning: (double) -- a constant, or 0 for the usual one.
+ *
+ * RETURN:	    double -- k.
+ *
+ * NOTES:	    none.
+ ***/
+double robust_tuning(robust_loss_t loss, double tuning)
+{
+  if (tuning > 0)
+    return tuning;
+  return loss == ROBUST_TUKEY ? ROBUST_TUKEY_K : ROBUST_HUBER_K;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    robust_weights
+ *
+ * DESCRIPTION:	    Computes the weight of each sample from its residual, in
+ *		    units of the median absolute residual, scaled to be the
+ *		    standard deviation of normal residuals.
+ *
+ * ARGUMENTS:	    loss: (robust_loss_t) -- the loss.
+ *		    k: (double) -- the tuning constant.
+ *		    r: (const gsl_vector *) -- the n residuals, unweighted.
+ *		    weights: (gsl_vector *) -- location for the n weights.
+ *
+ * RETURN:	    double -- the scale.
+ *
+ * NOTES:	    The absolute residuals are sorted in <weights> to find
+ *		    their median, so nothing is allocated. If more than half
+ *		    of the residuals are 0, the scale is 0, and every sample
+ *		    with a residual is an outlier.
+ ***/
+double robust_weights(robust_loss_t loss, double k, const gsl_vector * r,
+		      gsl_vector * weights)
+{
+  size_t n = r->size;
+  for (size_t i = 0; i < n; i++)
+    gsl_vector_set(weights, i, fabs(gsl_vector_get(r, i)));
+  gsl_sort(weights->data, weights->stride, n);
+  double scale = gsl_stats_median_from_sorted_data(weights->data,
+						   weights->stride, n)
+    / ROBUST_MAD_NORMAL;
+
+  for (size_t i = 0; i < n; i++) {
+    double a = fabs(gsl_vector_get(r, i));
+    double u = a == 0 ? 0 : scale > 0 ? a / scale : INFINITY;
+    double wt = 1.0;
+    if (loss == ROBUST_HUBER && u > k) {
+      wt = k / u;
+    } else if (loss == ROBUST_TUKEY) {
+      double t = u / k;
+      wt = t < 1 ? (1 - t * t) * (1 - t * t) : 0.0;
+    }
+    gsl_vector_set(weights, i, wt);
+  }
+  return scale;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    robust_outliers
+ *
+ * DESCRIPTION:	    Counts the samples with less than half weight.
+ *
+ * ARGUMENTS:	    weights: (const gsl_vector *) -- the weights.
+ *
+ * RETURN:	    size_t -- the count.
+ *
+ * NOTES:	    none.
+ ***/
+size_t robust_outliers(const gsl_vector * weights)
+{
+  size_t outliers = 0;
+  for (size_t i = 0; i < weights->size; i++)
+    outliers += gsl_vector_get(weights, i) < 0.5;
+  return outliers;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    robust_converged
+ *
+ * DESCRIPTION:	    Whether the coefficients have stopped moving between two
+ *		    passes.
+ *
+ * ARGUMENTS:	    previous: (const gsl_vector *) -- those of the last pass.
+ *		    x: (const gsl_vector *) -- those of this one.
+ *
+ * RETURN:	    bool -- true if every coefficient moved by no more than
+ *		    ROBUST_TOL of its size.
+ *
+ * NOTES:	    The test is that of the trust region method's step.
+ ***/
+bool robust_converged(const gsl_vector * previous, const gsl_vector * x)
+{
+  for (size_t j = 0; j < x->size; j++) {
+    double b = gsl_vector_get(x, j);
+    if (fabs(b - gsl_vector_get(previous, j))
+	> ROBUST_TOL * (ROBUST_TOL + fabs(b)))
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************/
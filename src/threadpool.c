@@ -0,0 +1,277 @@
+/*******************************************************************************
+ * NAME:	    threadpool.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    A fixed-size pool of worker threads which run tasks from a
+ *		    shared FIFO queue.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "linkedlist.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+typedef struct threadpool_task {
+  void (*func)(void *);
+  void * arg;
+} threadpool_task_t;
+
+struct threadpool {
+  pthread_t * threads;
+  size_t nthreads;
+  List tasks;
+  size_t pending; /* Tasks queued or running. */
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t work; /* A task was queued, or the pool is stopping. */
+  pthread_cond_t idle; /* pending dropped to zero. */
+};
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void * worker(void * arg);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_create
+ *
+ * DESCRIPTION:	    Starts a pool of <nthreads> worker threads.
+ *
+ * ARGUMENTS:	    nthreads: (size_t) -- the number of threads, or 0 for one
+ *			per online CPU.
+ *
+ * RETURN:	    threadpool_t * -- the pool, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+threadpool_t * threadpool_create(size_t nthreads)
+{
+  if (nthreads == 0)
+    nthreads = threadpool_ncpus();
+
+  threadpool_t * pool = malloc(sizeof(threadpool_t));
+  if (pool == NULL)
+    return NULL;
+  if ((pool->threads = calloc(nthreads, sizeof(pthread_t))) == NULL) {
+    free(pool);
+    return NULL;
+  }
+
+  list_init(&pool->tasks, free);
+  pool->nthreads = 0;
+  pool->pending = 0;
+  pool->stop = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+
+  for (size_t i = 0; i < nthreads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker, pool) != 0) {
+      threadpool_destroy(pool);
+      return NULL;
+    }
+    pool->nthreads++;
+  }
+
+  return pool;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_submit
+ *
+ * DESCRIPTION:	    Queues func(arg) to be run by the next free thread.
+ *
+ * ARGUMENTS:	    pool: (threadpool_t *) -- the pool.
+ *		    func: (void (*)(void *)) -- the task.
+ *		    arg: (void *) -- its argument.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+int threadpool_submit(threadpool_t * pool, void (*func)(void *), void * arg)
+{
+  threadpool_task_t * task = malloc(sizeof(threadpool_task_t));
+  if (task == NULL)
+    return -1;
+  task->func = func;
+  task->arg = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  if (list_insnxt(&pool->tasks, list_tail(&pool->tasks), task) != 0) {
+    pthread_mutex_unlock(&pool->lock);
+    free(task);
+    return -1;
+  }
+  pool->pending++;
+  pthread_cond_signal(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_wait
+ *
+ * DESCRIPTION:	    Blocks until every task submitted so far has finished.
+ *
+ * ARGUMENTS:	    pool: (threadpool_t *) -- the pool.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Must not be called from one of the pool's own tasks.
+ ***/
+void threadpool_wait(threadpool_t * pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0)
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_destroy
+ *
+ * DESCRIPTION:	    Lets the queued tasks finish, then stops and joins the
+ *		    threads and frees the pool.
+ *
+ * ARGUMENTS:	    pool: (threadpool_t *) -- the pool.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void threadpool_destroy(threadpool_t * pool)
+{
+  if (pool == NULL)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->nthreads; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  list_dest(&pool->tasks);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->threads);
+  free(pool);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_size
+ *
+ * DESCRIPTION:	    Returns the number of threads in the pool.
+ *
+ * ARGUMENTS:	    pool: (const threadpool_t *) -- the pool.
+ *
+ * RETURN:	    size_t -- the number of threads.
+ *
+ * NOTES:	    none.
+ ***/
+size_t threadpool_size(const threadpool_t * pool)
+{
+  return pool->nthreads;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    threadpool_ncpus
+ *
+ * DESCRIPTION:	    Returns the number of online CPUs.
+ *
+ * ARGUMENTS:	    none.
+ *
+ * RETURN:	    size_t -- the number of CPUs, at least 1.
+ *
+ * NOTES:	    none.
+ ***/
+size_t threadpool_ncpus(void)
+{
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return ncpus > 0 ? (size_t)ncpus : 1;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    worker
+ *
+ * DESCRIPTION:	    Body of each thread in the pool. Runs tasks from the head
+ *		    of the queue until the pool is stopped and the queue is
+ *		    empty.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the pool.
+ *
+ * RETURN:	    void * -- NULL.
+ *
+ * NOTES:	    none.
+ ***/
+static void * worker(void * arg)
+{
+  threadpool_t * pool = (threadpool_t *)arg;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (list_isempty(&pool->tasks) && !pool->stop)
+      pthread_cond_wait(&pool->work, &pool->lock);
+    if (list_isempty(&pool->tasks))
+      break;
+
+    threadpool_task_t * task;
+    list_remnxt(&pool->tasks, NULL, (void **)&task);
+    pthread_mutex_unlock(&pool->lock);
+
+    task->func(task->arg);
+    free(task);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0)
+      pthread_cond_broadcast(&pool->idle);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+/******************************************************************************/
@@ -0,0 +1,433 @@
+/*******************************************************************************
+ * NAME:	    triode.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    Physical models of the plate current of a triode, with the
+ *		    first and second derivatives in their coefficients that
+ *		    the trust region method needs to fit them with geodesic
+ *		    acceleration. The currents are in mA, so the coefficients
+ *		    that scale them differ by 1000 from the published ones.
+ *
+ * CREATED:	    10/16/2026
+ *
+ * LAST EDITED:	    10/16/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "triode.h"
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static void softplus(double u, double * lnL, double * sigma, double * r);
+static double zero(double * grad, size_t p);
+static double koren(const double * b, double ep, double eg, double * grad);
+static double koren_vv(const double * b, const double * v, double ep,
+		       double eg);
+static double child_langmuir(const double * b, double ep, double eg,
+			     double * grad);
+static double child_langmuir_vv(const double * b, const double * v,
+				double ep, double eg);
+static double dempwolf(const double * b, double ep, double eg, double * grad);
+static double dempwolf_vv(const double * b, const double * v, double ep,
+			  double eg);
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+static const char * const koren_params[] = {
+  "mu", "ex", "kg1", "kp", "kvb"
+};
+static const double koren_initial[] = { 100.0, 1.4, 1.06, 600.0, 300.0 };
+
+const triode_model_t triode_koren = {
+  .name = "koren",
+  .p = 5,
+  .params = koren_params,
+  .initial = koren_initial,
+  .eval = koren,
+  .eval_vv = koren_vv,
+  .gnuplot = "2/b2*(x/b3*log(1+exp(b3*(1/b0+y/sqrt(b4+x**2)))))**b1"
+};
+
+static const char * const child_langmuir_params[] = { "K", "mu" };
+static const double child_langmuir_initial[] = { 1.5, 100.0 };
+
+const triode_model_t triode_child_langmuir = {
+  .name = "child-langmuir",
+  .p = 2,
+  .params = child_langmuir_params,
+  .initial = child_langmuir_initial,
+  .eval = child_langmuir,
+  .eval_vv = child_langmuir_vv,
+  .gnuplot = "(y+x/b1 > 0 ? b0*(y+x/b1)**1.5 : 0)"
+};
+
+static const char * const dempwolf_params[] = { "G", "C", "mu", "gamma" };
+static const double dempwolf_initial[] = { 2.242, 3.4, 103.2, 1.26 };
+
+const triode_model_t triode_dempwolf = {
+  .name = "dempwolf",
+  .p = 4,
+  .params = dempwolf_params,
+  .initial = dempwolf_initial,
+  .eval = dempwolf,
+  .eval_vv = dempwolf_vv,
+  .gnuplot = "b0*(log(1+exp(b1*(x/b2+y)))/b1)**b3"
+};
+
+static const triode_model_t * const models[] = {
+  &triode_koren, &triode_child_langmuir, &triode_dempwolf
+};
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    triode_find
+ *
+ * DESCRIPTION:	    Looks up a triode model by name.
+ *
+ * ARGUMENTS:	    name: (const char *) -- the name.
+ *
+ * RETURN:	    const triode_model_t * -- the model, or NULL.
+ *
+ * NOTES:	    none.
+ ***/
+const triode_model_t * triode_find(const char * name)
+{
+  for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+    if (!strcmp(name, models[i]->name))
+      return models[i];
+  }
+  return NULL;
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    softplus
+ *
+ * DESCRIPTION:	    Computes L = log(1 + e^u), which Koren's and Dempwolf's
+ *		    models use to smooth the knee at cutoff, in the forms the
+ *		    derivatives need.
+ *
+ * ARGUMENTS:	    u: (double) -- the argument.
+ *		    lnL: (double *) -- location for log(L).
+ *		    sigma: (double *) -- location for dL/du, the logistic
+ *			function of u.
+ *		    r: (double *) -- location for sigma / L.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Far below cutoff L underflows, but log(L) and sigma / L
+ *		    tend to u and 1, which keeps every derivative finite.
+ ***/
+static void softplus(double u, double * lnL, double * sigma, double * r)
+{
+  if (u < -30.0) {
+    *lnL = u;
+    *sigma = exp(u);
+    *r = 1.0;
+    return;
+  }
+
+  double L = u > 30.0 ? u : log1p(exp(u));
+  *lnL = log(L);
+  *sigma = 1.0 / (1.0 + exp(-u));
+  *r = *sigma / L;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    zero
+ *
+ * DESCRIPTION:	    Zeroes a gradient, for samples where a model gives no
+ *		    current.
+ *
+ * ARGUMENTS:	    grad: (double *) -- the gradient, or NULL.
+ *		    p: (size_t) -- its size.
+ *
+ * RETURN:	    double -- 0, the current.
+ *
+ * NOTES:	    none.
+ ***/
+static double zero(double * grad, size_t p)
+{
+  if (grad != NULL)
+    memset(grad, 0, p * sizeof(double));
+  return 0.0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    koren
+ *
+ * DESCRIPTION:	    Koren's model of the plate current,
+ *
+ *			E1 = Ep/kp log(1 + exp(kp (1/mu + Eg/sqrt(kvb + Ep^2))))
+ *			Ip = 2 E1^ex / kg1
+ *
+ *		    with b = (mu, ex, kg1, kp, kvb). Writing Ip = 2 h / kg1
+ *		    with h = exp(ex l), l = log(E1), every derivative is one
+ *		    of l.
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *		    grad: (double *) -- location for the gradient, or NULL.
+ *
+ * RETURN:	    double -- the plate current.
+ *
+ * NOTES:	    There is no current for Ep <= 0, or for kp <= 0, where
+ *		    the model isn't defined.
+ ***/
+static double koren(const double * b, double ep, double eg, double * grad)
+{
+  double mu = b[0], ex = b[1], kg1 = b[2], kp = b[3], kvb = b[4];
+  if (ep <= 0.0 || kp <= 0.0 || kvb + ep * ep <= 0.0)
+    return zero(grad, 5);
+
+  double s = sqrt(kvb + ep * ep);
+  double u = kp * (1.0 / mu + eg / s);
+  double lnL, sigma, r;
+  softplus(u, &lnL, &sigma, &r);
+  double l = log(ep) - log(kp) + lnL;
+  double y = 2.0 * exp(ex * l) / kg1;
+
+  if (grad != NULL) {
+    grad[0] = y * ex * r * (-kp / (mu * mu));
+    grad[1] = y * l;
+    grad[2] = -y / kg1;
+    grad[3] = y * ex * (r * u - 1.0) / kp;
+    grad[4] = y * ex * r * (-kp * eg / (2.0 * s * s * s));
+  }
+  return y;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    koren_vv
+ *
+ * DESCRIPTION:	    The second derivative of koren() along <v>, by the chain
+ *		    rule through u, l and h: with dots for derivatives along
+ *		    v, l'' = (v_kp/kp)^2 + r((1 - sigma) u'^2 + u'')
+ *		    - (r u')^2, h'' = h((ex l)'' + (ex l)'^2), and
+ *		    Ip'' = 2 (m'' h + 2 m' h' + m h'') for m = 1/kg1.
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    v: (const double *) -- the direction.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *
+ * RETURN:	    double -- v^T H v.
+ *
+ * NOTES:	    none.
+ ***/
+static double koren_vv(const double * b, const double * v, double ep,
+		       double eg)
+{
+  double mu = b[0], ex = b[1], kg1 = b[2], kp = b[3], kvb = b[4];
+  if (ep <= 0.0 || kp <= 0.0 || kvb + ep * ep <= 0.0)
+    return 0.0;
+
+  double s = sqrt(kvb + ep * ep), s3 = s * s * s, s5 = s3 * s * s;
+  double u = kp * (1.0 / mu + eg / s);
+  double lnL, sigma, r;
+  softplus(u, &lnL, &sigma, &r);
+  double l = log(ep) - log(kp) + lnL;
+  double h = exp(ex * l);
+
+  double du = v[3] * (1.0 / mu + eg / s) - kp * v[0] / (mu * mu)
+    - kp * eg * v[4] / (2.0 * s3);
+  double ddu = -2.0 * v[3] * v[0] / (mu * mu)
+    + 2.0 * kp * v[0] * v[0] / (mu * mu * mu)
+    - eg * v[3] * v[4] / s3
+    + 3.0 * kp * eg * v[4] * v[4] / (4.0 * s5);
+
+  double dl = -v[3] / kp + r * du;
+  double ddl = (v[3] / kp) * (v[3] / kp)
+    + r * ((1.0 - sigma) * du * du + ddu) - (r * du) * (r * du);
+  double dq = v[1] * l + ex * dl;
+  double ddq = 2.0 * v[1] * dl + ex * ddl;
+  double dh = h * dq;
+  double ddh = h * (ddq + dq * dq);
+
+  double m = 1.0 / kg1;
+  double dm = -v[2] / (kg1 * kg1);
+  double ddm = 2.0 * v[2] * v[2] / (kg1 * kg1 * kg1);
+  return 2.0 * (ddm * h + 2.0 * dm * dh + m * ddh);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    child_langmuir
+ *
+ * DESCRIPTION:	    The Child-Langmuir law of the plate current,
+ *
+ *			Ip = K (Eg + Ep/mu)^(3/2)
+ *
+ *		    with b = (K, mu), and no current when Eg + Ep/mu <= 0.
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *		    grad: (double *) -- location for the gradient, or NULL.
+ *
+ * RETURN:	    double -- the plate current.
+ *
+ * NOTES:	    none.
+ ***/
+static double child_langmuir(const double * b, double ep, double eg,
+			     double * grad)
+{
+  double K = b[0], mu = b[1];
+  double a = eg + ep / mu;
+  if (a <= 0.0)
+    return zero(grad, 2);
+
+  double root = sqrt(a);
+  if (grad != NULL) {
+    grad[0] = a * root;
+    grad[1] = K * 1.5 * root * (-ep / (mu * mu));
+  }
+  return K * a * root;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    child_langmuir_vv
+ *
+ * DESCRIPTION:	    The second derivative of child_langmuir() along <v>:
+ *		    with g(a) = a^(3/2), Ip'' = 2 v_K g' a' + K (g'' a'^2 +
+ *		    g' a'').
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    v: (const double *) -- the direction.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *
+ * RETURN:	    double -- v^T H v.
+ *
+ * NOTES:	    g'' grows without bound at cutoff; the solver limits the
+ *		    acceleration it takes from samples there.
+ ***/
+static double child_langmuir_vv(const double * b, const double * v,
+				double ep, double eg)
+{
+  double K = b[0], mu = b[1];
+  double a = eg + ep / mu;
+  if (a <= 0.0)
+    return 0.0;
+
+  double root = sqrt(a);
+  double da = -ep * v[1] / (mu * mu);
+  double dda = 2.0 * ep * v[1] * v[1] / (mu * mu * mu);
+  double g1 = 1.5 * root, g2 = 0.75 / root;
+  return 2.0 * v[0] * g1 * da + K * (g2 * da * da + g1 * dda);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dempwolf
+ *
+ * DESCRIPTION:	    The cathode current of Dempwolf and Zoelzer's model,
+ *
+ *			Ip = G (log(1 + exp(C (Ep/mu + Eg))) / C)^gamma
+ *
+ *		    with b = (G, C, mu, gamma). As in koren(), it is written
+ *		    as Ip = G h with h = exp(gamma l), l = log(L / C).
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *		    grad: (double *) -- location for the gradient, or NULL.
+ *
+ * RETURN:	    double -- the plate current.
+ *
+ * NOTES:	    There is no current for C <= 0, where the model isn't
+ *		    defined.
+ ***/
+static double dempwolf(const double * b, double ep, double eg, double * grad)
+{
+  double G = b[0], C = b[1], mu = b[2], gamma = b[3];
+  if (C <= 0.0)
+    return zero(grad, 4);
+
+  double a = ep / mu + eg;
+  double lnL, sigma, r;
+  softplus(C * a, &lnL, &sigma, &r);
+  double l = lnL - log(C);
+  double h = exp(gamma * l);
+  double y = G * h;
+
+  if (grad != NULL) {
+    grad[0] = h;
+    grad[1] = y * gamma * (r * a - 1.0 / C);
+    grad[2] = y * gamma * r * C * (-ep / (mu * mu));
+    grad[3] = y * l;
+  }
+  return y;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    dempwolf_vv
+ *
+ * DESCRIPTION:	    The second derivative of dempwolf() along <v>, as in
+ *		    koren_vv(), with u = C a: l'' = r((1 - sigma) u'^2 + u'')
+ *		    - (r u')^2 + (v_C/C)^2, and Ip'' = 2 v_G h' + G h''.
+ *
+ * ARGUMENTS:	    b: (const double *) -- the coefficients.
+ *		    v: (const double *) -- the direction.
+ *		    ep, eg: (double) -- the plate and grid voltages.
+ *
+ * RETURN:	    double -- v^T H v.
+ *
+ * NOTES:	    none.
+ ***/
+static double dempwolf_vv(const double * b, const double * v, double ep,
+			  double eg)
+{
+  double G = b[0], C = b[1], mu = b[2], gamma = b[3];
+  if (C <= 0.0)
+    return 0.0;
+
+  double a = ep / mu + eg;
+  double lnL, sigma, r;
+  softplus(C * a, &lnL, &sigma, &r);
+  double l = lnL - log(C);
+  double h = exp(gamma * l);
+
+  double da = -ep * v[2] / (mu * mu);
+  double dda = 2.0 * ep * v[2] * v[2] / (mu * mu * mu);
+  double du = v[1] * a + C * da;
+  double ddu = 2.0 * v[1] * da + C * dda;
+
+  double dl = r * du - v[1] / C;
+  double ddl = r * ((1.0 - sigma) * du * du + ddu) - (r * du) * (r * du)
+    + (v[1] / C) * (v[1] / C);
+  double dq = v[3] * l + gamma * dl;
+  double ddq = 2.0 * v[3] * dl + gamma * ddl;
+  double dh = h * dq;
+  double ddh = h * (ddq + dq * dq);
+  return 2.0 * v[0] * dh + G * ddh;
+}
+
+/******************************************************************************/
@@ -0,0 +1,319 @@
+/*******************************************************************************
+ * NAME:	    trust.c
+ *
+ * AUTHOR:	    Ethan D. Twardy
+ *
+ * DESCRIPTION:	    The choice of trust region method for nonlinear fits: how
+ *		    each step solves its subproblem, how the coefficients are
+ *		    scaled, how the step's linear system is solved, and when
+ *		    the iterations stop. Which is fastest depends on the
+ *		    model and the data, so every one is left to the caller.
+ *
+ * CREATED:	    10/17/2026
+ *
+ * LAST EDITED:	    10/17/2026
+ *
+ * Copyright 2017, Ethan D. Twardy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***/
+
+/*******************************************************************************
+ * INCLUDES
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <gsl/gsl_multifit_nlinear.h>
+
+#include "trust.h"
+
+/*******************************************************************************
+ * GLOBAL VARIABLES
+ ***/
+
+const char * const trust_trs_names[TRUST_NTRS] = {
+  [TRUST_TRS_DEFAULT] = "default",
+  [TRUST_LM] = "lm",
+  [TRUST_LMACCEL] = "lmaccel",
+  [TRUST_DOGLEG] = "dogleg",
+  [TRUST_DDOGLEG] = "ddogleg",
+  [TRUST_SUBSPACE2D] = "subspace2D"
+};
+
+const char * const trust_scale_names[TRUST_NSCALES] = {
+  [TRUST_SCALE_DEFAULT] = "default",
+  [TRUST_LEVENBERG] = "levenberg",
+  [TRUST_MARQUARDT] = "marquardt",
+  [TRUST_MORE] = "more"
+};
+
+const char * const trust_solver_names[TRUST_NSOLVERS] = {
+  [TRUST_SOLVER_DEFAULT] = "default",
+  [TRUST_QR] = "qr",
+  [TRUST_CHOLESKY] = "cholesky",
+  [TRUST_MCHOLESKY] = "mcholesky",
+  [TRUST_SVD] = "svd"
+};
+
+/*******************************************************************************
+ * STATIC FUNCTION PROTOTYPES
+ ***/
+
+static int find_name(const char * const * names, size_t count,
+		     const char * name, size_t len);
+static int parse_limit(trust_method_t * method, const char * spec,
+		       size_t len);
+
+/*******************************************************************************
+ * API FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    trust_parse
+ *
+ * DESCRIPTION:	    Reads a method from names and limits separated by colons.
+ *		    Names are looked for among the subproblems, the scales
+ *		    and the solvers, which share none.
+ *
+ * ARGUMENTS:	    spec: (const char *) -- the description.
+ *		    method: (trust_method_t *) -- location for the method.
+ *
+ * RETURN:	    int -- 0 on success, -1 if a name isn't known or a limit
+ *		    isn't a positive number.
+ *
+ * NOTES:	    The method is zeroed first, so what <spec> doesn't name
+ *		    takes its default.
+ ***/
+int trust_parse(const char * spec, trust_method_t * method)
+{
+  memset(method, 0, sizeof(trust_method_t));
+  for (;;) {
+    size_t len = strcspn(spec, ":");
+    int k;
+    if (len == 0)
+      return -1;
+    else if (memchr(spec, '=', len) != NULL) {
+      if (parse_limit(method, spec, len) != 0)
+	return -1;
+    } else if ((k = find_name(trust_trs_names, TRUST_NTRS, spec, len)) > 0)
+      method->trs = k;
+    else if ((k = find_name(trust_scale_names, TRUST_NSCALES, spec, len)) > 0)
+      method->scale = k;
+    else if ((k = find_name(trust_solver_names, TRUST_NSOLVERS, spec,
+			    len)) > 0)
+      method->solver = k;
+    else
+      return -1;
+
+    if (spec[len] == '\0')
+      return 0;
+    spec += len + 1;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    trust_name
+ *
+ * DESCRIPTION:	    Describes a method by the names of its subproblem, scale
+ *		    and solver, with the defaults filled in.
+ *
+ * ARGUMENTS:	    method: (const trust_method_t *) -- the method.
+ *		    triode: (bool) -- whether the fit is of a triode model.
+ *		    buf: (char *) -- location for the description.
+ *		    len: (size_t) -- the size of <buf>.
+ *
+ * RETURN:	    int -- the length of the description, as snprintf().
+ *
+ * NOTES:	    The limits aren't described.
+ ***/
+int trust_name(const trust_method_t * method, bool triode, char * buf,
+	       size_t len)
+{
+  trust_trs_t trs = method->trs != TRUST_TRS_DEFAULT ? method->trs
+    : triode ? TRUST_LMACCEL : TRUST_LM;
+  trust_scale_t scale = method->scale != TRUST_SCALE_DEFAULT ? method->scale
+    : TRUST_MORE;
+  trust_solver_t solver = method->solver != TRUST_SOLVER_DEFAULT
+    ? method->solver : TRUST_QR;
+  return snprintf(buf, len, "%s:%s:%s", trust_trs_names[trs],
+		  trust_scale_names[scale], trust_solver_names[solver]);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    trust_params
+ *
+ * DESCRIPTION:	    Fills the GSL's parameters for a method. The defaults are
+ *		    the GSL's own, but triode models are accelerated along the
+ *		    geodesic, since they are curved enough for it to save
+ *		    iterations.
+ *
+ * ARGUMENTS:	    method: (const trust_method_t *) -- the method.
+ *		    triode: (bool) -- whether the fit is of a triode model.
+ *		    params: (gsl_multifit_nlinear_parameters *) -- location
+ *			for the parameters.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Workspaces are made for one set of parameters, so fits
+ *		    with different methods don't share them in a fit_pool_t.
+ ***/
+void trust_params(const trust_method_t * method, bool triode,
+		  gsl_multifit_nlinear_parameters * params)
+{
+  *params = gsl_multifit_nlinear_default_parameters();
+  if (triode)
+    params->trs = gsl_multifit_nlinear_trs_lmaccel;
+
+  switch (method->trs) {
+  case TRUST_LM: params->trs = gsl_multifit_nlinear_trs_lm; break;
+  case TRUST_LMACCEL: params->trs = gsl_multifit_nlinear_trs_lmaccel; break;
+  case TRUST_DOGLEG: params->trs = gsl_multifit_nlinear_trs_dogleg; break;
+  case TRUST_DDOGLEG: params->trs = gsl_multifit_nlinear_trs_ddogleg; break;
+  case TRUST_SUBSPACE2D:
+    params->trs = gsl_multifit_nlinear_trs_subspace2D;
+    break;
+  default: break;
+  }
+
+  switch (method->scale) {
+  case TRUST_LEVENBERG:
+    params->scale = gsl_multifit_nlinear_scale_levenberg;
+    break;
+  case TRUST_MARQUARDT:
+    params->scale = gsl_multifit_nlinear_scale_marquardt;
+    break;
+  case TRUST_MORE: params->scale = gsl_multifit_nlinear_scale_more; break;
+  default: break;
+  }
+
+  switch (method->solver) {
+  case TRUST_QR: params->solver = gsl_multifit_nlinear_solver_qr; break;
+  case TRUST_CHOLESKY:
+    params->solver = gsl_multifit_nlinear_solver_cholesky;
+    break;
+  case TRUST_MCHOLESKY:
+    params->solver = gsl_multifit_nlinear_solver_mcholesky;
+    break;
+  case TRUST_SVD: params->solver = gsl_multifit_nlinear_solver_svd; break;
+  default: break;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    trust_driver
+ *
+ * DESCRIPTION:	    Runs gsl_multifit_nlinear_driver() with the method's
+ *		    limits.
+ *
+ * ARGUMENTS:	    method: (const trust_method_t *) -- the method.
+ *		    max_iter: (size_t) -- the iteration limit, if the method
+ *			has none.
+ *		    callback: -- called after every iteration, or NULL.
+ *		    callback_params: (void *) -- passed to <callback>.
+ *		    info: (int *) -- location for why the iterations stopped.
+ *		    w: (gsl_multifit_nlinear_workspace *) -- the workspace.
+ *
+ * RETURN:	    int -- as gsl_multifit_nlinear_driver().
+ *
+ * NOTES:	    none.
+ ***/
+int trust_driver(const trust_method_t * method, size_t max_iter,
+		 void (*callback)(const size_t iter, void * params,
+				  const gsl_multifit_nlinear_workspace * w),
+		 void * callback_params, int * info,
+		 gsl_multifit_nlinear_workspace * w)
+{
+  return gsl_multifit_nlinear_driver(
+    method->max_iter > 0 ? method->max_iter : max_iter,
+    method->xtol > 0 ? method->xtol : TRUST_XTOL,
+    method->gtol > 0 ? method->gtol : TRUST_GTOL,
+    method->ftol > 0 ? method->ftol : TRUST_FTOL,
+    callback, callback_params, info, w);
+}
+
+/*******************************************************************************
+ * STATIC FUNCTIONS
+ ***/
+
+/*******************************************************************************
+ * FUNCTION:	    find_name
+ *
+ * DESCRIPTION:	    Looks for a name among the choices of one kind.
+ *
+ * ARGUMENTS:	    names: (const char * const *) -- the names of the choices.
+ *		    count: (size_t) -- the number of choices.
+ *		    name: (const char *) -- the name, not terminated.
+ *		    len: (size_t) -- its length.
+ *
+ * RETURN:	    int -- the choice, or 0 if there is none by that name.
+ *
+ * NOTES:	    The default, choice 0, isn't looked for, since every kind
+ *		    has one.
+ ***/
+static int find_name(const char * const * names, size_t count,
+		     const char * name, size_t len)
+{
+  for (size_t k = 1; k < count; k++) {
+    if (strlen(names[k]) == len && !strncmp(names[k], name, len))
+      return k;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    parse_limit
+ *
+ * DESCRIPTION:	    Reads one limit of a method, as iter=N or xtol=X, gtol=X
+ *		    or ftol=X.
+ *
+ * ARGUMENTS:	    method: (trust_method_t *) -- the method.
+ *		    spec: (const char *) -- the limit, not terminated.
+ *		    len: (size_t) -- its length.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the limit isn't known or its
+ *		    value isn't a positive number.
+ *
+ * NOTES:	    none.
+ ***/
+static int parse_limit(trust_method_t * method, const char * spec,
+		       size_t len)
+{
+  const char * value = memchr(spec, '=', len) + 1;
+  size_t key = value - 1 - spec;
+  char * end;
+  if (key == 4 && !strncmp(spec, "iter", key)) {
+    if (*value < '0' || *value > '9')
+      return -1;
+    method->max_iter = strtoul(value, &end, 10);
+    return end == spec + len && method->max_iter > 0 ? 0 : -1;
+  }
+
+  double tol = strtod(value, &end);
+  if (end != spec + len || !(tol > 0))
+    return -1;
+  if (key == 4 && !strncmp(spec, "xtol", key))
+    method->xtol = tol;
+  else if (key == 4 && !strncmp(spec, "gtol", key))
+    method->gtol = tol;
+  else if (key == 4 && !strncmp(spec, "ftol", key))
+    method->ftol = tol;
+  else
+    return -1;
+  return 0;
+}
+
+/******************************************************************************/
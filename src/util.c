@@ -7,7 +7,7 @@
  *
  * CREATED:	    08/21/2017
  *
- * LAST EDITED:	    08/25/2017
+ * LAST EDITED:	    10/17/2026
  *
  * Copyright 2017, Ethan D. Twardy
  *
@@ -29,17 +29,192 @@
  * INCLUDES
  ***/
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <gsl/gsl_matrix.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-#include "linkedlist.h"
+#include "cache.h"
+#include "numparse.h"
+#include "threadpool.h"
 #include "util.h"
 
+/*******************************************************************************
+ * MACRO DEFINITIONS
+ ***/
+
+/* Initial capacity, in rows, of the buffer used by read_tuples_stream(). */
+#define TUPLE_BUFFER_ROWS 1024
+
+/* Size, in bytes, of the window a tuple_reader_t holds of its file. */
+#define TUPLE_READER_BUFSIZE (1 << 20)
+
+/* Smallest range, in bytes, read_tuples_mapped() gives to one thread. */
+#define CSV_MIN_CHUNK (1 << 20)
+
+/* Results of parse_tuple(). The negative ones are lines without a row. */
+#define TUPLE_PARSED 0
+#define TUPLE_RAGGED 1 /* Parsed, but fields were empty or missing. */
+#define TUPLE_BLANK -1 /* Empty or whitespace. */
+#define TUPLE_COMMENT -2 /* Nothing but blanks before a '#'. */
+#define TUPLE_NOT_NUMBER -3 /* Malformed, as the csv_reject_t reasons. */
+#define TUPLE_EMPTY_FIELD -4
+#define TUPLE_SHORT -5
+
+/* Longest element name, attribute name or value read_tuples_xml() keeps. */
+#define XML_TOKEN_MAX 63
+
+#define XML_SPACE_CHAR(c)					\
+  ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+#define XML_NAME_CHAR(c)						\
+  (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z')		\
+   || ((c) >= '0' && (c) <= '9') || (c) == '_' || (c) == '-'		\
+   || (c) == ':' || (c) == '.')
+
+/*******************************************************************************
+ * TYPE DEFINITIONS
+ ***/
+
+/* Where each field of a line goes in a row, for read_columns_csv(). */
+typedef struct csv_projection {
+  size_t nfields; /* Fields up to and including the last one wanted. */
+  ssize_t * column; /* column[f] is the column of field f, or -1. */
+} csv_projection_t;
+
+/* What parsing some lines found. Lines count from the first of them. */
+typedef struct csv_tally {
+  csv_stats_t stats;
+  csv_error_t error;
+} csv_tally_t;
+
+struct tuple_reader {
+  int fd;
+  size_t size;
+  char * buffer;
+  size_t capacity;
+  size_t start; /* First byte not yet parsed. */
+  size_t end; /* One past the last byte read. */
+  bool eof;
+  bool strict;
+  csv_tally_t tally;
+  csv_projection_t * projection; /* NULL to read the leading fields. */
+};
+
+/* A range of a mapped .csv file, and the rows parsed from it. */
+typedef struct csv_chunk {
+  const char * begin;
+  const char * end;
+  size_t size;
+  size_t lines; /* Bounds the number of rows in the range. */
+  double * out; /* The range's region of the matrix. */
+  size_t tda;
+  size_t rows;
+  const csv_projection_t * projection;
+  bool strict;
+  csv_tally_t tally;
+  double cpu; /* Seconds of CPU spent on the range by its thread. */
+  int error;
+} csv_chunk_t;
+
+typedef enum xml_state {
+  XML_TEXT,		/* Character data between tags. */
+  XML_TAG,		/* Just after '<'. */
+  XML_BANG,		/* "<!", possibly the start of a comment. */
+  XML_COMMENT,		/* Inside "<!-- -->". */
+  XML_SKIP,		/* Inside a declaration, up to the next '>'. */
+  XML_OPEN_NAME,	/* The name of an opening tag. */
+  XML_ATTRS,		/* Between attributes. */
+  XML_ATTR_NAME,	/* The name of an attribute. */
+  XML_ATTR_EQ,		/* After an attribute name, before '='. */
+  XML_VALUE_START,	/* After '=', before the value. */
+  XML_VALUE,		/* An attribute value, quoted or not. */
+  XML_EMPTY_TAG,	/* After the '/' of "/>". */
+  XML_CLOSE_NAME	/* The name of a closing tag. */
+} xml_state_t;
+
+typedef enum xml_element {
+  XML_ELEMENT_OTHER,
+  XML_ELEMENT_TUPLE,
+  XML_ELEMENT_DIM
+} xml_element_t;
+
+typedef struct xml_parser {
+  xml_state_t state;
+  xml_element_t element; /* The element whose tag is open. */
+  size_t size;
+  double * rows;
+  size_t capacity;
+  size_t count;
+  bool in_tuple;
+  bool bad_row;
+  bool is_val; /* The attribute being read is the val of a <dim>. */
+  size_t dim;
+  char quote;
+  int dashes;
+  char token[XML_TOKEN_MAX + 1];
+  size_t toklen;
+} xml_parser_t;
+
 /*******************************************************************************
  * STATIC FUNCTION PROTOTYPES
  ***/
 
+static gsl_matrix * load_csv(const char * filename, size_t size,
+			     const char * const * names,
+			     const csv_options_t * options);
+static gsl_matrix * load_csv_file(const char * filename, size_t size,
+				  const char * const * names,
+				  const csv_options_t * options,
+				  csv_tally_t * tally);
+static gsl_matrix * read_cached(const char * filename, size_t size,
+				const char * const * names,
+				csv_tally_t * tally);
+static gsl_matrix * read_tuples_mapped(const char * map, size_t len,
+				       size_t size,
+				       const csv_projection_t * projection,
+				       const csv_options_t * options,
+				       csv_tally_t * tally);
+static void csv_chunk_count(void * arg);
+static void csv_chunk_parse(void * arg);
+static csv_projection_t * csv_projection_create(const char * header,
+						size_t len,
+						const char * const * names,
+						size_t n);
+static void csv_projection_free(csv_projection_t * projection);
+static const char * csv_header_field(const char * p, const char * end,
+				     const char ** name, size_t * len);
+static char ** csv_header_names(const char * header, size_t len, size_t n);
+static tuple_reader_t * tuple_reader_fdopen(int fd, size_t size, bool strict);
+static int tuple_reader_fill(tuple_reader_t * reader);
+static int tuple_reader_header(tuple_reader_t * reader,
+			       const char * const * names, size_t n);
+static gsl_matrix * read_tuples_stream(tuple_reader_t * reader,
+				       csv_tally_t * tally);
+static gsl_matrix * adopt_buffer(double * buffer, size_t rows, size_t size);
+static int xml_feed(xml_parser_t * parser, const char * buf, size_t len);
+static void xml_append(xml_parser_t * parser, char c);
+static bool xml_token_is(const xml_parser_t * parser, const char * name);
+static int xml_open_element(xml_parser_t * parser);
+static void xml_value(xml_parser_t * parser);
+static void xml_close_tuple(xml_parser_t * parser);
+static int parse_tuple(const char * line, size_t len, double * row,
+		       size_t size, const csv_projection_t * projection,
+		       size_t * field);
+static int parse_projected(const char * line, size_t len, double * row,
+			   const csv_projection_t * projection,
+			   size_t * field);
+static void tally_line(csv_tally_t * tally, int result, size_t field);
+static void tally_merge(csv_tally_t * into, const csv_tally_t * from,
+			size_t line);
+static double clock_seconds(clockid_t clock);
+static size_t count_lines(const char * map, size_t len);
 static size_t remove_comments(char ** string, size_t size);
 
 /*******************************************************************************
@@ -58,83 +233,253 @@ static size_t remove_comments(char ** string, size_t size);
  * RETURN:	    gsl_matrix * -- pointer to a matrix of doubles created from
  *		    reading the tuples in, or NULL if there was an error.
  *
- * NOTES:	    none.
+ * NOTES:	    Same as read_tuples_csv_opt() with the default options.
  ***/
 gsl_matrix * read_tuples_csv(const char * filename, size_t size)
 {
-  FILE * file;
-  if ((file = fopen(filename, "r")) == NULL || size <= 0)
-    return NULL;
+  return read_tuples_csv_opt(filename, size, NULL);
+}
 
-  List * list = malloc(sizeof(List));
-  list_init(list, free);
+/*******************************************************************************
+ * FUNCTION:	    read_tuples_csv_opt
+ *
+ * DESCRIPTION:	    Reads tuples of size <n> from a .csv file, with options.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the file to read.
+ *		    n: (size_t) -- the size of the tuple to read.
+ *		    options: (const csv_options_t *) -- the options, or NULL
+ *			for the defaults.
+ *
+ * RETURN:	    gsl_matrix * -- pointer to a matrix of doubles created from
+ *		    reading the tuples in, or NULL if there was an error.
+ *
+ * NOTES:	    Regular files are mapped into memory and scanned in place;
+ *		    the tuples are parsed directly into the block of the
+ *		    returned matrix, so no line is ever copied or allocated.
+ *		    With options->threads > 1, the mapping is split into that
+ *		    many ranges, each parsed on its own thread. Anything which
+ *		    can't be mapped (pipes, empty files) is read with
+ *		    read_tuples_stream() instead.
+ *
+ *		    The first parse of a regular file writes a columnar cache
+ *		    of it (see cache.c). Later loads are served from the cache
+ *		    without parsing, for as long as the file is unchanged.
+ *		    Files with malformed rows are never cached, so that a
+ *		    strict load of them can't be served from the cache, and
+ *		    nor are files with ragged rows, whose columns would
+ *		    differ from what read_columns_csv() finds by position.
+ *
+ *		    A row with a field that isn't a number is dropped and
+ *		    counted in options->error, or with options->strict, the
+ *		    load fails at the first one. options->stats receives the
+ *		    counts of every kind of line and the time taken.
+ ***/
+gsl_matrix * read_tuples_csv_opt(const char * filename, size_t size,
+				 const csv_options_t * options)
+{
+  return load_csv(filename, size, NULL, options);
+}
 
-  double * arr;
-  char * line = NULL;
-  size_t n = 0;
-  while (getline(&line, &n, file) != -1) {
+/*******************************************************************************
+ * FUNCTION:	    read_columns_csv
+ *
+ * DESCRIPTION:	    Reads the columns called <names> from a .csv file whose
+ *		    first line is a header comment naming its columns, like
+ *		    the one in data/12AX7-Data.csv:
+ *
+ *			# Ep, Eg, Ig, Ep^2, Eg^2
+ *
+ *		    Column j of the result is the column called names[j].
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the file to read.
+ *		    names: (const char * const *) -- the names of the columns.
+ *		    n: (size_t) -- the number of names.
+ *		    options: (const csv_options_t *) -- the options, or NULL
+ *			for the defaults.
+ *
+ * RETURN:	    gsl_matrix * -- the rows x <n> matrix, or NULL if there was
+ *		    an error or the header doesn't name every column.
+ *
+ * NOTES:	    Fields are taken by position, so unlike read_tuples_csv(),
+ *		    an empty field is malformed rather than skipped. Fields
+ *		    which weren't asked for are stepped over without being
+ *		    parsed, and nothing after the last one asked for is
+ *		    looked at. A current cache with all of the columns is
+ *		    used if there is one. Otherwise, once the load is done,
+ *		    the columns it read are cached under their names, so a
+ *		    later load of the same columns maps them; a load of any
+ *		    other column parses the file again.
+ ***/
+gsl_matrix * read_columns_csv(const char * filename,
+			      const char * const * names, size_t n,
+			      const csv_options_t * options)
+{
+  return load_csv(filename, n, names, options);
+}
 
-    if (remove_comments((char **)&line, n) <= 0) goto error_continue;
-    if ((arr = calloc(size, sizeof(double))) == NULL) goto error_exit;
-    char * scratch, *hack = line;
-    hack = strtok_r(hack, ",", &scratch);
-    if (hack == NULL) goto error_exit;
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_open
+ *
+ * DESCRIPTION:	    Opens a .csv file for reading tuples of size <n> a chunk at
+ *		    a time. The reader only holds a fixed-size window of the
+ *		    file, so it can be used on files larger than memory.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the path of the file to open.
+ *		    n: (size_t) -- the size of the tuples to read.
+ *
+ * RETURN:	    tuple_reader_t * -- the reader, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+tuple_reader_t * tuple_reader_open(const char * filename, size_t n)
+{
+  if (n <= 0)
+    return NULL;
 
-    int i = 0;
-    do {
-      int ret = sscanf(hack, "%lf", &arr[i]);
-      if (ret <= 0) {
-	free(arr);
-	arr = NULL;
-	goto error_continue;
-      }
-      i++;
-    } while ((hack = strtok_r(NULL, ",", &scratch)) != NULL && i < size);
+  int fd;
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return NULL;
 
-    if (list_insnxt(list, list_tail(list), arr) != 0)
-      goto error_exit;
+  tuple_reader_t * reader = tuple_reader_fdopen(fd, n, false);
+  if (reader == NULL)
+    close(fd);
+  return reader;
+}
 
-  error_continue:
-    if (line != NULL) {
-      free(line);
-      line = NULL; 
-    }
-  }
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_open_columns
+ *
+ * DESCRIPTION:	    Opens a .csv file for reading the columns called <names> a
+ *		    chunk at a time. The file must start with a header
+ *		    comment, as for read_columns_csv().
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the path of the file to open.
+ *		    names: (const char * const *) -- the names of the columns.
+ *		    n: (size_t) -- the number of names.
+ *
+ * RETURN:	    tuple_reader_t * -- the reader, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+tuple_reader_t * tuple_reader_open_columns(const char * filename,
+					   const char * const * names,
+					   size_t n)
+{
+  tuple_reader_t * reader = tuple_reader_open(filename, n);
+  if (reader == NULL)
+    return NULL;
 
-  /* If the .csv file contains and empty line at the end, the while() {} will
-   * break on this line and line will never be freed (mem leak). */
-  if (line != NULL) {
-    free(line);
-    line = NULL;
+  if (tuple_reader_header(reader, names, n) != 0) {
+    tuple_reader_close(reader);
+    return NULL;
   }
+  return reader;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_error
+ *
+ * DESCRIPTION:	    Reports the rows the reader has dropped so far because a
+ *		    field wasn't a number.
+ *
+ * ARGUMENTS:	    reader: (const tuple_reader_t *) -- the reader.
+ *
+ * RETURN:	    const csv_error_t * -- the count, and the line and field of
+ *		    the first, or NULL if there were none.
+ *
+ * NOTES:	    none.
+ ***/
+const csv_error_t * tuple_reader_error(const tuple_reader_t * reader)
+{
+  return reader->tally.error.malformed > 0 ? &reader->tally.error : NULL;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_stats
+ *
+ * DESCRIPTION:	    Reports what the reader has read so far: the bytes of the
+ *		    file, and the lines of each kind among them.
+ *
+ * ARGUMENTS:	    reader: (const tuple_reader_t *) -- the reader.
+ *
+ * RETURN:	    const csv_stats_t * -- the counts.
+ *
+ * NOTES:	    The reader is driven by its caller, so it isn't timed.
+ ***/
+const csv_stats_t * tuple_reader_stats(const tuple_reader_t * reader)
+{
+  return &reader->tally.stats;
+}
 
-  fclose(file);
-  file = NULL;
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_read
+ *
+ * DESCRIPTION:	    Reads up to <max> tuples from the reader into <rows>, which
+ *		    is filled row-major, <n> doubles per row.
+ *
+ * ARGUMENTS:	    reader: (tuple_reader_t *) -- the reader.
+ *		    rows: (double *) -- space for <max> tuples.
+ *		    max: (size_t) -- the number of tuples to read at most.
+ *
+ * RETURN:	    ssize_t -- the number of tuples read, 0 at the end of the
+ *		    file, or -1 if there was an error, including a malformed
+ *		    field in a strict reader.
+ *
+ * NOTES:	    Lines are parsed exactly as read_tuples_csv() parses them.
+ *		    The window only grows if a single line doesn't fit in it.
+ ***/
+ssize_t tuple_reader_read(tuple_reader_t * reader, double * rows, size_t max)
+{
+  size_t count = 0;
+  while (count < max) {
+    char * line = reader->buffer + reader->start;
+    size_t avail = reader->end - reader->start;
+    char * eol = memchr(line, '\n', avail);
 
-  gsl_matrix * matrix = gsl_matrix_alloc(list_size(list), size);
-  int i = 0;
-  while (list_size(list) > 0) {
-    double * vector;
-    list_remnxt(list, NULL, (void **)&vector);
-    for (int j = 0; j < size; j++) {
-      gsl_matrix_set(matrix, i, j, vector[j]);
+    if (eol != NULL || (reader->eof && avail > 0)) {
+      size_t linelen = eol != NULL ? (size_t)(eol - line) : avail, field;
+      int result = parse_tuple(line, linelen, rows + count * reader->size,
+			       reader->size, reader->projection, &field);
+      tally_line(&reader->tally, result, field);
+      reader->start += linelen + (eol != NULL);
+      if (result >= TUPLE_PARSED)
+	count++;
+      if (result <= TUPLE_NOT_NUMBER && reader->strict) {
+	errno = EINVAL;
+	return -1;
+      }
+      continue;
     }
-    free(vector); /* It's not done by list_remnxt. */
-    i++;
+
+    if (reader->eof)
+      break;
+    if (tuple_reader_fill(reader) != 0)
+      return -1;
   }
 
-  list_dest(list);
-  free(list);
+  return count;
+}
 
-  return matrix;
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_close
+ *
+ * DESCRIPTION:	    Closes the file and frees the reader.
+ *
+ * ARGUMENTS:	    reader: (tuple_reader_t *) -- the reader.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+void tuple_reader_close(tuple_reader_t * reader)
+{
+  if (reader == NULL)
+    return;
 
- error_exit: {
-    if (file != NULL) fclose(file);
-    list_dest(list);
-    free(arr);
-    free(list);
-    return NULL;
-  }
+  close(reader->fd);
+  csv_projection_free(reader->projection);
+  free(reader->buffer);
+  free(reader);
 }
 
 /*******************************************************************************
@@ -156,17 +501,1466 @@ gsl_matrix * read_tuples_csv(const char * filename, size_t size)
  *
  * RETURN:	    gsl_matrix or NULL if unsuccessful.
  *
- * NOTES:	    none.
+ * NOTES:	    The file is read a chunk at a time and pushed through the
+ *		    xml_feed() state machine, which never holds more than one
+ *		    name or value of the document. Values may be quoted or
+ *		    not. A tuple with a value that doesn't parse is dropped,
+ *		    missing dims are zero and extra dims are ignored, as for
+ *		    read_tuples_csv().
  ***/
 gsl_matrix * read_tuples_xml(const char * filename, size_t n) {
-  /* TODO: Implement this. */
-  return NULL;
+  if (n <= 0)
+    return NULL;
+
+  int fd;
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return NULL;
+
+  xml_parser_t parser = {
+    .state = XML_TEXT,
+    .size = n,
+    .capacity = TUPLE_BUFFER_ROWS
+  };
+  char * chunk = malloc(TUPLE_READER_BUFSIZE);
+  parser.rows = malloc(parser.capacity * n * sizeof(double));
+  if (chunk == NULL || parser.rows == NULL)
+    goto error_exit;
+
+  ssize_t got;
+  while ((got = read(fd, chunk, TUPLE_READER_BUFSIZE)) != 0) {
+    if (got == -1) {
+      if (errno == EINTR)
+	continue;
+      goto error_exit;
+    }
+    if (xml_feed(&parser, chunk, got) != 0)
+      goto error_exit;
+  }
+
+  close(fd);
+  free(chunk);
+  if (parser.count == 0) {
+    free(parser.rows);
+    errno = EINVAL; /* No tuples. */
+    return NULL;
+  }
+  return adopt_buffer(parser.rows, parser.count, n);
+
+ error_exit: {
+    close(fd);
+    free(chunk);
+    free(parser.rows);
+    return NULL;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_stats_throughput
+ *
+ * DESCRIPTION:	    Computes the rate at which a load read its file.
+ *
+ * ARGUMENTS:	    stats: (const csv_stats_t *) -- the stats of the load.
+ *
+ * RETURN:	    double -- megabytes (10^6 bytes) per second of wall time,
+ *		    or 0 if the load wasn't timed.
+ *
+ * NOTES:	    A load served from the cache counts the bytes of the cache.
+ ***/
+double csv_stats_throughput(const csv_stats_t * stats)
+{
+  return stats->wall > 0 ? stats->bytes / stats->wall / 1e6 : 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_stats_print
+ *
+ * DESCRIPTION:	    Writes the stats of a load on one line, either as text or
+ *		    as a JSON object, so that a run over many files produces
+ *		    JSON Lines which other tools can read.
+ *
+ * ARGUMENTS:	    stream: (FILE *) -- where to write.
+ *		    filename: (const char *) -- the file that was loaded.
+ *		    stats: (const csv_stats_t *) -- its stats.
+ *		    format: (csv_stats_format_t) -- CSV_STATS_TEXT or
+ *			CSV_STATS_JSON.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the write failed.
+ *
+ * NOTES:	    The filename is written as is; it must not need escaping
+ *		    in JSON.
+ ***/
+int csv_stats_print(FILE * stream, const char * filename,
+		    const csv_stats_t * stats, csv_stats_format_t format)
+{
+  const size_t * rejected = stats->rejected;
+  int status;
+  if (format == CSV_STATS_JSON) {
+    status =
+      fprintf(stream, "{\"file\": \"%s\", \"cached\": %s, \"bytes\": %zu, "
+	      "\"lines\": %zu, \"rows\": %zu, \"ragged\": %zu, "
+	      "\"rejected\": {\"number\": %zu, \"empty\": %zu, "
+	      "\"short\": %zu}, \"comments\": %zu, \"blank\": %zu, "
+	      "\"wall\": %.6f, \"cpu\": %.6f, \"mb_per_s\": %.3f}\n",
+	      filename, stats->cached ? "true" : "false", stats->bytes,
+	      stats->lines, stats->rows, stats->ragged,
+	      rejected[CSV_REJECT_NUMBER], rejected[CSV_REJECT_EMPTY],
+	      rejected[CSV_REJECT_SHORT], stats->comments, stats->blank,
+	      stats->wall, stats->cpu, csv_stats_throughput(stats));
+  } else {
+    status =
+      fprintf(stream, "%s: %zu bytes%s, %zu rows (%zu ragged), "
+	      "rejected %zu not a number, %zu empty, %zu short, "
+	      "%zu comments, %zu blank; %.3f s wall, %.3f s cpu, "
+	      "%.1f MB/s\n",
+	      filename, stats->bytes, stats->cached ? " from cache" : "",
+	      stats->rows, stats->ragged, rejected[CSV_REJECT_NUMBER],
+	      rejected[CSV_REJECT_EMPTY], rejected[CSV_REJECT_SHORT],
+	      stats->comments, stats->blank, stats->wall, stats->cpu,
+	      csv_stats_throughput(stats));
+  }
+  return status < 0 ? -1 : 0;
 }
 
 /*******************************************************************************
  * STATIC FUNCTIONS
  ***/
 
+/*******************************************************************************
+ * FUNCTION:	    load_csv
+ *
+ * DESCRIPTION:	    Loads a .csv file for read_tuples_csv_opt() and
+ *		    read_columns_csv(), timing the load and reporting what it
+ *		    found through options->error and options->stats.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the file to read.
+ *		    size: (size_t) -- the number of columns to read.
+ *		    names: (const char * const *) -- the names of the
+ *			columns, or NULL to read the leading <size> fields.
+ *		    options: (const csv_options_t *) -- the options, or NULL
+ *			for the defaults.
+ *
+ * RETURN:	    gsl_matrix * -- the tuples, or NULL if there was an error.
+ *
+ * NOTES:	    CPU time is that of the calling thread, plus that of the
+ *		    pool threads which parsed for it, so concurrent loads on
+ *		    other threads don't inflate it.
+ ***/
+static gsl_matrix * load_csv(const char * filename, size_t size,
+			     const char * const * names,
+			     const csv_options_t * options)
+{
+  static const csv_options_t defaults = {0};
+  if (options == NULL)
+    options = &defaults;
+
+  csv_tally_t tally = {0};
+  double wall = clock_seconds(CLOCK_MONOTONIC);
+  double cpu = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+  gsl_matrix * matrix = NULL;
+  if (size > 0)
+    matrix = load_csv_file(filename, size, names, options, &tally);
+  tally.stats.wall = clock_seconds(CLOCK_MONOTONIC) - wall;
+  tally.stats.cpu += clock_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu;
+
+  if (options->error != NULL)
+    *options->error = tally.error;
+  if (options->stats != NULL)
+    *options->stats = tally.stats;
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    load_csv_file
+ *
+ * DESCRIPTION:	    Does the work of load_csv(): serves the load from the
+ *		    cache if it can, and otherwise parses the file in place or
+ *		    as a stream.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the file to read.
+ *		    size: (size_t) -- the number of columns to read.
+ *		    names: (const char * const *) -- the names of the
+ *			columns, or NULL to read the leading <size> fields.
+ *		    options: (const csv_options_t *) -- the options.
+ *		    tally: (csv_tally_t *) -- receives what the load found.
+ *
+ * RETURN:	    gsl_matrix * -- the tuples, or NULL if there was an error.
+ *
+ * NOTES:	    See read_tuples_csv_opt() and read_columns_csv().
+ ***/
+static gsl_matrix * load_csv_file(const char * filename, size_t size,
+				  const char * const * names,
+				  const csv_options_t * options,
+				  csv_tally_t * tally)
+{
+  int fd;
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    tuple_reader_t * reader = tuple_reader_fdopen(fd, size, options->strict);
+    if (reader == NULL) {
+      close(fd);
+      return NULL;
+    }
+    if (names != NULL && tuple_reader_header(reader, names, size) != 0) {
+      *tally = reader->tally;
+      tuple_reader_close(reader);
+      return NULL;
+    }
+    return read_tuples_stream(reader, tally);
+  }
+
+  gsl_matrix * matrix;
+  if (!options->no_cache
+      && (matrix = read_cached(filename, size, names, tally)) != NULL) {
+    close(fd);
+    return matrix;
+  }
+
+  size_t len = (size_t)st.st_size;
+  char * map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); /* The mapping holds its own reference to the file. */
+  if (map == MAP_FAILED)
+    return NULL;
+  madvise(map, len, MADV_SEQUENTIAL);
+
+  csv_projection_t * projection = NULL;
+  const char * eol = memchr(map, '\n', len);
+  size_t header = eol != NULL ? (size_t)(eol - map) : len;
+  if (names != NULL) {
+    projection = csv_projection_create(map, header, names, size);
+    if (projection == NULL) {
+      munmap(map, len);
+      return NULL;
+    }
+  }
+
+  matrix = read_tuples_mapped(map, len, size, projection, options, tally);
+
+  /* Failing to write the cache only costs the next load a parse. A load
+   * by name caches the columns it parsed, under the names asked for. */
+  if (matrix != NULL && !options->no_cache
+      && tally->error.malformed == 0 && tally->error.ragged == 0) {
+    if (projection == NULL) {
+      char ** header_names = csv_header_names(map, header, size);
+      tuple_cache_write(filename, matrix, NULL,
+			(const char * const *)header_names);
+      free(header_names);
+    } else {
+      size_t fields[size];
+      for (size_t f = 0; f < projection->nfields; f++) {
+	if (projection->column[f] != -1)
+	  fields[projection->column[f]] = f;
+      }
+      tuple_cache_write(filename, matrix, fields, names);
+    }
+  }
+  csv_projection_free(projection);
+  munmap(map, len);
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    read_cached
+ *
+ * DESCRIPTION:	    Serves a load from the cache of a .csv file, if it is
+ *		    current and has the columns wanted.
+ *
+ * ARGUMENTS:	    filename: (const char *) -- the name of the .csv file.
+ *		    size: (size_t) -- the number of columns to read.
+ *		    names: (const char * const *) -- the names of the
+ *			columns, or NULL for the first <size>.
+ *		    tally: (csv_tally_t *) -- receives the bytes and rows read.
+ *
+ * RETURN:	    gsl_matrix * -- the tuples, or NULL if the cache can't
+ *		    serve the load.
+ *
+ * NOTES:	    A load by position needs the cache's leading columns to be
+ *		    the leading fields of the file, and a load by name needs
+ *		    every name to be exactly one column's.
+ ***/
+static gsl_matrix * read_cached(const char * filename, size_t size,
+				const char * const * names,
+				csv_tally_t * tally)
+{
+  tuple_cache_t * cache = tuple_cache_open(filename, names ? 1 : size);
+  if (cache == NULL)
+    return NULL;
+
+  gsl_matrix * matrix = NULL;
+  if (names == NULL) {
+    size_t j;
+    for (j = 0; j < size && cache->fields[j] == j; j++);
+    if (j == size)
+      matrix = tuple_cache_matrix(cache, size);
+  } else {
+    size_t columns[size], j;
+    for (j = 0; j < size; j++) {
+      ssize_t column = tuple_cache_find(cache, names[j]);
+      if (column == -1)
+	break;
+      columns[j] = column;
+    }
+    if (j == size)
+      matrix = tuple_cache_gather(cache, columns, size);
+  }
+
+  if (matrix != NULL) {
+    tally->stats.cached = true;
+    tally->stats.bytes = cache->length;
+    tally->stats.rows = matrix->size1;
+  }
+  tuple_cache_close(cache);
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    read_tuples_mapped
+ *
+ * DESCRIPTION:	    Parses a .csv file mapped into memory. The mapping is cut
+ *		    into ranges which start and end on line boundaries. Each
+ *		    range first counts its lines, which bounds the number of
+ *		    rows it can produce, and the prefix sums of the counts
+ *		    give every range its own region of one matrix. The ranges
+ *		    are then parsed into their regions, and the regions are
+ *		    slid together to close the gaps left by comment lines.
+ *
+ * ARGUMENTS:	    map: (const char *) -- the mapping.
+ *		    len: (size_t) -- its length.
+ *		    size: (size_t) -- the size of the tuples.
+ *		    projection: (const csv_projection_t *) -- the fields to
+ *			read, or NULL for the leading ones.
+ *		    options: (const csv_options_t *) -- the options; threads
+ *			gives the number of threads to parse with, where 0 or
+ *			1 parses on the calling thread.
+ *		    tally: (csv_tally_t *) -- receives what the ranges found.
+ *
+ * RETURN:	    gsl_matrix * -- the tuples in file order, or NULL if
+ *		    there were none, there was an error, or a strict load
+ *		    found a malformed row.
+ *
+ * NOTES:	    Ranges are never smaller than CSV_MIN_CHUNK bytes, so
+ *		    small files are parsed on one thread regardless.
+ ***/
+static gsl_matrix * read_tuples_mapped(const char * map, size_t len,
+				       size_t size,
+				       const csv_projection_t * projection,
+				       const csv_options_t * options,
+				       csv_tally_t * tally)
+{
+  tally->stats.bytes = len;
+  size_t nchunks = options->threads > 1 ? options->threads : 1;
+  if (len / nchunks < CSV_MIN_CHUNK)
+    nchunks = len / CSV_MIN_CHUNK > 0 ? len / CSV_MIN_CHUNK : 1;
+
+  csv_chunk_t * chunks = calloc(nchunks, sizeof(csv_chunk_t));
+  if (chunks == NULL)
+    return NULL;
+
+  const char * p = map, * end = map + len;
+  for (size_t k = 0; k < nchunks; k++) {
+    chunks[k].begin = p;
+    chunks[k].end = end;
+    chunks[k].size = size;
+    chunks[k].projection = projection;
+    chunks[k].strict = options->strict;
+    if (k < nchunks - 1) {
+      const char * cut = map + len / nchunks * (k + 1);
+      if (cut < p)
+	cut = p;
+      const char * eol = memchr(cut, '\n', end - cut);
+      if (eol != NULL)
+	chunks[k].end = eol + 1;
+    }
+    p = chunks[k].end;
+  }
+
+  threadpool_t * pool = NULL;
+  if (nchunks > 1 && (pool = threadpool_create(nchunks)) == NULL)
+    goto error_exit;
+
+  for (size_t k = 0; k < nchunks; k++) {
+    if (pool == NULL)
+      csv_chunk_count(&chunks[k]);
+    else if (threadpool_submit(pool, csv_chunk_count, &chunks[k]) != 0)
+      goto error_exit;
+  }
+  if (pool != NULL)
+    threadpool_wait(pool);
+
+  size_t lines = 0;
+  for (size_t k = 0; k < nchunks; k++)
+    lines += chunks[k].lines;
+  if (lines == 0) {
+    errno = EINVAL; /* No tuples. */
+    goto error_exit;
+  }
+
+  gsl_matrix * matrix = gsl_matrix_alloc(lines, size);
+  if (matrix == NULL)
+    goto error_exit;
+
+  size_t offset = 0;
+  for (size_t k = 0; k < nchunks; k++) {
+    chunks[k].out = matrix->data + offset * matrix->tda;
+    chunks[k].tda = matrix->tda;
+    offset += chunks[k].lines;
+    if (pool == NULL)
+      csv_chunk_parse(&chunks[k]);
+    else if (threadpool_submit(pool, csv_chunk_parse, &chunks[k]) != 0)
+      chunks[k].error = -1;
+  }
+  if (pool != NULL)
+    threadpool_wait(pool);
+
+  size_t rows = 0;
+  lines = 0;
+  for (size_t k = 0; k < nchunks; k++) {
+    tally_merge(tally, &chunks[k].tally, lines);
+    lines += chunks[k].lines;
+    if (pool != NULL)
+      tally->stats.cpu += chunks[k].cpu;
+
+    if (chunks[k].error != 0
+	|| (options->strict && tally->error.malformed > 0)) {
+      gsl_matrix_free(matrix);
+      if (chunks[k].error == 0)
+	errno = EINVAL;
+      goto error_exit;
+    }
+
+    double * dest = matrix->data + rows * matrix->tda;
+    if (dest != chunks[k].out)
+      memmove(dest, chunks[k].out,
+	      chunks[k].rows * matrix->tda * sizeof(double));
+    rows += chunks[k].rows;
+  }
+
+  threadpool_destroy(pool);
+  free(chunks);
+  if (rows == 0) {
+    gsl_matrix_free(matrix);
+    errno = EINVAL; /* No tuples. */
+    return NULL;
+  }
+
+  /* The block keeps its original size, so gsl_matrix_free() still releases
+   * all of it. */
+  matrix->size1 = rows;
+  return matrix;
+
+ error_exit: {
+    threadpool_destroy(pool);
+    free(chunks);
+    return NULL;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_chunk_count
+ *
+ * DESCRIPTION:	    Counts the lines in a range of the mapping.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the csv_chunk_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). Adds the CPU time
+ *		    taken to chunk->cpu.
+ ***/
+static void csv_chunk_count(void * arg)
+{
+  csv_chunk_t * chunk = (csv_chunk_t *)arg;
+  double cpu = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+  chunk->lines = count_lines(chunk->begin, chunk->end - chunk->begin);
+  chunk->cpu += clock_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_chunk_parse
+ *
+ * DESCRIPTION:	    Parses the lines of a range of the mapping into the rows
+ *		    starting at chunk->out.
+ *
+ * ARGUMENTS:	    arg: (void *) -- the csv_chunk_t.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Signature suits threadpool_submit(). A strict range stops
+ *		    at its first malformed row. Adds the CPU time taken to
+ *		    chunk->cpu.
+ ***/
+static void csv_chunk_parse(void * arg)
+{
+  csv_chunk_t * chunk = (csv_chunk_t *)arg;
+  const char * line = chunk->begin, * end = chunk->end;
+  double cpu = clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+  size_t field;
+
+  while (line < end) {
+    const char * eol = memchr(line, '\n', end - line);
+    const char * eor = eol != NULL ? eol : end;
+    double * row = chunk->out + chunk->rows * chunk->tda;
+
+    int result = parse_tuple(line, eor - line, row, chunk->size,
+			     chunk->projection, &field);
+    tally_line(&chunk->tally, result, field);
+    if (result >= TUPLE_PARSED)
+      chunk->rows++;
+    if (result <= TUPLE_NOT_NUMBER && chunk->strict)
+      break;
+    line = eor + 1;
+  }
+
+  chunk->cpu += clock_seconds(CLOCK_THREAD_CPUTIME_ID) - cpu;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_projection_create
+ *
+ * DESCRIPTION:	    Matches <names> against the fields of a header comment,
+ *		    and records which column of a row each field goes to.
+ *
+ * ARGUMENTS:	    header: (const char *) -- the first line of the file.
+ *		    len: (size_t) -- its length, excluding '\n'.
+ *		    names: (const char * const *) -- the names of the columns.
+ *		    n: (size_t) -- the number of names.
+ *
+ * RETURN:	    csv_projection_t * -- the projection, or NULL with errno
+ *		    set to EINVAL if the line isn't a header or a name isn't
+ *		    in it (or is given twice).
+ *
+ * NOTES:	    Names in the header are trimmed of blanks and compared
+ *		    exactly.
+ ***/
+static csv_projection_t * csv_projection_create(const char * header,
+						size_t len,
+						const char * const * names,
+						size_t n)
+{
+  if (len == 0 || header[0] != '#') {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  const char * p = header + 1, * end = header + len;
+  size_t nheader = 1;
+  for (const char * q = p; (q = memchr(q, ',', end - q)) != NULL; q++)
+    nheader++;
+
+  csv_projection_t * projection = malloc(sizeof(csv_projection_t));
+  if (projection == NULL)
+    return NULL;
+  if ((projection->column = malloc(nheader * sizeof(ssize_t))) == NULL) {
+    free(projection);
+    return NULL;
+  }
+  projection->nfields = 0;
+
+  bool found[n];
+  memset(found, 0, sizeof(found));
+  size_t nfound = 0;
+  for (size_t f = 0; f < nheader; f++) {
+    const char * q;
+    size_t field;
+    p = csv_header_field(p, end, &q, &field);
+
+    projection->column[f] = -1;
+    for (size_t j = 0; j < n; j++) {
+      if (!found[j] && strlen(names[j]) == field
+	  && !memcmp(names[j], q, field)) {
+	found[j] = true;
+	nfound++;
+	projection->column[f] = j;
+	projection->nfields = f + 1;
+	break;
+      }
+    }
+  }
+
+  if (nfound < n) {
+    csv_projection_free(projection);
+    errno = EINVAL;
+    return NULL;
+  }
+  return projection;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_projection_free
+ *
+ * DESCRIPTION:	    Frees a projection.
+ *
+ * ARGUMENTS:	    projection: (csv_projection_t *) -- the projection, or
+ *			NULL.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void csv_projection_free(csv_projection_t * projection)
+{
+  if (projection == NULL)
+    return;
+
+  free(projection->column);
+  free(projection);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_header_field
+ *
+ * DESCRIPTION:	    Finds the next name in a header comment, trimmed of
+ *		    blanks.
+ *
+ * ARGUMENTS:	    p: (const char *) -- the start of the field.
+ *		    end: (const char *) -- the end of the header.
+ *		    name: (const char **) -- location for the name.
+ *		    len: (size_t *) -- location for its length.
+ *
+ * RETURN:	    const char * -- the start of the next field, or <end>.
+ *
+ * NOTES:	    csv_projection_create() and csv_header_names() both read
+ *		    names through this, so that the cache and the projection
+ *		    agree on them.
+ ***/
+static const char * csv_header_field(const char * p, const char * end,
+				     const char ** name, size_t * len)
+{
+  const char * comma = memchr(p, ',', end - p);
+  const char * q = p, * r = comma != NULL ? comma : end;
+  while (q < r && (*q == ' ' || *q == '\t')) q++;
+  while (r > q && (r[-1] == ' ' || r[-1] == '\t' || r[-1] == '\r')) r--;
+  *name = q;
+  *len = r - q;
+  return comma != NULL ? comma + 1 : end;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    csv_header_names
+ *
+ * DESCRIPTION:	    Copies the names of the first <n> fields of a header
+ *		    comment, for the cache.
+ *
+ * ARGUMENTS:	    header: (const char *) -- the first line of the file.
+ *		    len: (size_t) -- its length, excluding '\n'.
+ *		    n: (size_t) -- the number of names.
+ *
+ * RETURN:	    char ** -- <n> names, NULL past the end of the header, in
+ *		    one block for the caller to free(); or NULL if the line
+ *		    isn't a header or there was no memory.
+ *
+ * NOTES:	    The whole header is read, however long it is.
+ ***/
+static char ** csv_header_names(const char * header, size_t len, size_t n)
+{
+  if (len == 0 || header[0] != '#')
+    return NULL;
+  char ** names = malloc(n * sizeof(char *) + len + n);
+  if (names == NULL)
+    return NULL;
+
+  char * out = (char *)(names + n);
+  const char * p = header + 1, * end = header + len;
+  for (size_t j = 0; j < n; j++) {
+    if (p == end) {
+      names[j] = NULL;
+      continue;
+    }
+    const char * name;
+    size_t field;
+    p = csv_header_field(p, end, &name, &field);
+    names[j] = memcpy(out, name, field);
+    out[field] = '\0';
+    out += field + 1;
+  }
+  return names;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_fdopen
+ *
+ * DESCRIPTION:	    Creates a tuple reader over an open file descriptor.
+ *
+ * ARGUMENTS:	    fd: (int) -- the file descriptor. Ownership passes to the
+ *			reader on success.
+ *		    size: (size_t) -- the size of the tuples to read.
+ *		    strict: (bool) -- fail on a malformed field.
+ *
+ * RETURN:	    tuple_reader_t * -- the reader, or NULL on failure.
+ *
+ * NOTES:	    none.
+ ***/
+static tuple_reader_t * tuple_reader_fdopen(int fd, size_t size, bool strict)
+{
+  tuple_reader_t * reader = malloc(sizeof(tuple_reader_t));
+  if (reader == NULL)
+    return NULL;
+
+  if ((reader->buffer = malloc(TUPLE_READER_BUFSIZE)) == NULL) {
+    free(reader);
+    return NULL;
+  }
+
+  reader->fd = fd;
+  reader->size = size;
+  reader->capacity = TUPLE_READER_BUFSIZE;
+  reader->start = 0;
+  reader->end = 0;
+  reader->eof = false;
+  reader->strict = strict;
+  memset(&reader->tally, 0, sizeof(csv_tally_t));
+  reader->projection = NULL;
+  return reader;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_fill
+ *
+ * DESCRIPTION:	    Slides the unparsed bytes of the window to its front and
+ *		    reads more of the file after them, growing the window if
+ *		    it is already full.
+ *
+ * ARGUMENTS:	    reader: (tuple_reader_t *) -- the reader.
+ *
+ * RETURN:	    int -- 0 on success, -1 if there was an error.
+ *
+ * NOTES:	    Sets reader->eof at the end of the file.
+ ***/
+static int tuple_reader_fill(tuple_reader_t * reader)
+{
+  size_t avail = reader->end - reader->start;
+  memmove(reader->buffer, reader->buffer + reader->start, avail);
+  reader->start = 0;
+  reader->end = avail;
+  if (reader->end == reader->capacity) {
+    char * grown = realloc(reader->buffer, 2 * reader->capacity);
+    if (grown == NULL)
+      return -1;
+    reader->buffer = grown;
+    reader->capacity *= 2;
+  }
+
+  ssize_t got;
+  while ((got = read(reader->fd, reader->buffer + reader->end,
+		     reader->capacity - reader->end)) == -1) {
+    if (errno != EINTR)
+      return -1;
+  }
+  if (got == 0)
+    reader->eof = true;
+  reader->end += got;
+  reader->tally.stats.bytes += got;
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tuple_reader_header
+ *
+ * DESCRIPTION:	    Consumes the first line of the file as a header comment,
+ *		    and sets the reader up to read the columns called <names>.
+ *
+ * ARGUMENTS:	    reader: (tuple_reader_t *) -- a reader which hasn't read
+ *			anything yet.
+ *		    names: (const char * const *) -- the names of the columns.
+ *		    n: (size_t) -- the number of names.
+ *
+ * RETURN:	    int -- 0 on success, -1 otherwise.
+ *
+ * NOTES:	    none.
+ ***/
+static int tuple_reader_header(tuple_reader_t * reader,
+			       const char * const * names, size_t n)
+{
+  char * eol;
+  while ((eol = memchr(reader->buffer + reader->start, '\n',
+		       reader->end - reader->start)) == NULL && !reader->eof) {
+    if (tuple_reader_fill(reader) != 0)
+      return -1;
+  }
+
+  const char * line = reader->buffer + reader->start;
+  size_t len = eol != NULL ? (size_t)(eol - line) : reader->end - reader->start;
+  if ((reader->projection = csv_projection_create(line, len, names, n))
+      == NULL)
+    return -1;
+
+  reader->start += len + (eol != NULL);
+  reader->tally.stats.lines++;
+  reader->tally.stats.comments++;
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    read_tuples_stream
+ *
+ * DESCRIPTION:	    Reads all of the tuples from a tuple reader into a
+ *		    matrix. This is the path taken by
+ *		    read_tuples_csv() when the file can't be mapped into
+ *		    memory. Rows are appended to one contiguous buffer which
+ *		    doubles in size as it fills, and which becomes the block
+ *		    of the returned matrix.
+ *
+ * ARGUMENTS:	    reader: (tuple_reader_t *) -- the reader to read from.
+ *		    tally: (csv_tally_t *) -- receives what the reader found.
+ *
+ * RETURN:	    gsl_matrix * -- matrix of the tuples read, or NULL if there
+ *		    was an error.
+ *
+ * NOTES:	    Closes <reader>.
+ ***/
+static gsl_matrix * read_tuples_stream(tuple_reader_t * reader,
+				       csv_tally_t * tally)
+{
+  size_t size = reader->size;
+  size_t capacity = TUPLE_BUFFER_ROWS, rows = 0;
+  double * buffer = malloc(capacity * size * sizeof(double));
+  if (buffer == NULL)
+    goto error_exit;
+
+  ssize_t got;
+  while ((got = tuple_reader_read(reader, buffer + rows * size,
+				  capacity - rows)) > 0) {
+    rows += got;
+    if (rows == capacity) {
+      double * grown = realloc(buffer, 2 * capacity * size * sizeof(double));
+      if (grown == NULL)
+	goto error_exit;
+      buffer = grown;
+      capacity *= 2;
+    }
+  }
+
+  if (rows == 0 && got != -1)
+    errno = EINVAL; /* No tuples. */
+  if (got == -1 || rows == 0)
+    goto error_exit;
+
+  *tally = reader->tally;
+  tuple_reader_close(reader);
+  return adopt_buffer(buffer, rows, size);
+
+ error_exit: {
+    *tally = reader->tally;
+    tuple_reader_close(reader);
+    free(buffer);
+    return NULL;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    adopt_buffer
+ *
+ * DESCRIPTION:	    Wraps a malloc()'d array of <rows> x <size> doubles in a
+ *		    gsl_matrix, without copying it. The array is trimmed to
+ *		    its final size first.
+ *
+ * ARGUMENTS:	    buffer: (double *) -- the array. Ownership passes to this
+ *			function, which frees it if there is an error.
+ *		    rows: (size_t) -- the number of rows in <buffer>.
+ *		    size: (size_t) -- the number of columns in <buffer>.
+ *
+ * RETURN:	    gsl_matrix * -- the matrix, or NULL if there was an error.
+ *
+ * NOTES:	    gsl_block_free() releases the block with free(), which is
+ *		    what makes it safe to hand it our own allocation. The
+ *		    matrix owns the block, so gsl_matrix_free() releases
+ *		    everything as usual.
+ ***/
+static gsl_matrix * adopt_buffer(double * buffer, size_t rows, size_t size)
+{
+  double * trimmed = realloc(buffer, rows * size * sizeof(double));
+  if (trimmed != NULL)
+    buffer = trimmed;
+
+  gsl_block * block = malloc(sizeof(gsl_block));
+  if (block == NULL) {
+    free(buffer);
+    return NULL;
+  }
+  block->size = rows * size;
+  block->data = buffer;
+
+  gsl_matrix * matrix = gsl_matrix_alloc_from_block(block, 0, rows, size,
+						    size);
+  if (matrix == NULL) {
+    gsl_block_free(block);
+    return NULL;
+  }
+  matrix->owner = 1;
+  return matrix;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_feed
+ *
+ * DESCRIPTION:	    Advances the XML state machine over <len> bytes of the
+ *		    document. Every state consumes one byte at a time, so the
+ *		    document may be split anywhere between calls.
+ *
+ * ARGUMENTS:	    parser: (xml_parser_t *) -- the parser.
+ *		    buf: (const char *) -- the next bytes of the document.
+ *		    len: (size_t) -- the number of bytes in <buf>.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the row buffer couldn't grow.
+ *
+ * NOTES:	    Only as much of XML as the tuple format needs is
+ *		    understood. Declarations, processing instructions and
+ *		    comments are skipped, and unknown elements are ignored.
+ ***/
+static int xml_feed(xml_parser_t * parser, const char * buf, size_t len)
+{
+  for (size_t i = 0; i < len; i++) {
+    char c = buf[i];
+
+  again:
+    switch (parser->state) {
+    case XML_TEXT: {
+      /* Most of a document is skipped here, so look for the next tag with
+       * memchr() rather than a byte at a time. */
+      const char * lt = memchr(buf + i, '<', len - i);
+      if (lt == NULL)
+	return 0;
+      i = lt - buf;
+      parser->state = XML_TAG;
+      break;
+    }
+
+    case XML_TAG:
+      parser->toklen = 0;
+      if (c == '/') {
+	parser->state = XML_CLOSE_NAME;
+      } else if (c == '!') {
+	parser->dashes = 0;
+	parser->state = XML_BANG;
+      } else if (c == '?') {
+	parser->state = XML_SKIP;
+      } else if (XML_NAME_CHAR(c)) {
+	xml_append(parser, c);
+	parser->state = XML_OPEN_NAME;
+      } else {
+	parser->state = XML_TEXT;
+      }
+      break;
+
+    case XML_BANG:
+      if (c == '-' && ++parser->dashes == 2) {
+	parser->dashes = 0;
+	parser->state = XML_COMMENT;
+      } else if (c != '-') {
+	parser->state = c == '>' ? XML_TEXT : XML_SKIP;
+      }
+      break;
+
+    case XML_COMMENT:
+      if (c == '>' && parser->dashes >= 2)
+	parser->state = XML_TEXT;
+      else
+	parser->dashes = c == '-' ? parser->dashes + 1 : 0;
+      break;
+
+    case XML_SKIP:
+      if (c == '>')
+	parser->state = XML_TEXT;
+      break;
+
+    case XML_OPEN_NAME:
+      if (XML_NAME_CHAR(c)) {
+	xml_append(parser, c);
+	break;
+      }
+      if (xml_open_element(parser) != 0)
+	return -1;
+      parser->state = XML_ATTRS;
+      goto again;
+
+    case XML_ATTRS:
+      if (c == '/') {
+	parser->state = XML_EMPTY_TAG;
+      } else if (c == '>') {
+	parser->state = XML_TEXT;
+      } else if (XML_NAME_CHAR(c)) {
+	parser->toklen = 0;
+	xml_append(parser, c);
+	parser->state = XML_ATTR_NAME;
+      }
+      break;
+
+    case XML_ATTR_NAME:
+      if (XML_NAME_CHAR(c)) {
+	xml_append(parser, c);
+	break;
+      }
+      parser->is_val = parser->element == XML_ELEMENT_DIM
+	&& xml_token_is(parser, "val");
+      parser->state = XML_ATTR_EQ;
+      goto again;
+
+    case XML_ATTR_EQ:
+      if (c == '=') {
+	parser->state = XML_VALUE_START;
+      } else if (!XML_SPACE_CHAR(c)) {
+	/* An attribute without a value. */
+	parser->state = XML_ATTRS;
+	goto again;
+      }
+      break;
+
+    case XML_VALUE_START:
+      if (XML_SPACE_CHAR(c))
+	break;
+      parser->toklen = 0;
+      if (c == '"' || c == '\'') {
+	parser->quote = c;
+	parser->state = XML_VALUE;
+	break;
+      }
+      parser->quote = '\0';
+      parser->state = XML_VALUE;
+      goto again;
+
+    case XML_VALUE:
+      if (parser->quote != '\0') {
+	if (c != parser->quote) {
+	  xml_append(parser, c);
+	  break;
+	}
+	xml_value(parser);
+	parser->state = XML_ATTRS;
+	break;
+      }
+      if (!XML_SPACE_CHAR(c) && c != '/' && c != '>') {
+	xml_append(parser, c);
+	break;
+      }
+      xml_value(parser);
+      parser->state = XML_ATTRS;
+      goto again;
+
+    case XML_EMPTY_TAG:
+      if (c == '>') {
+	if (parser->element == XML_ELEMENT_TUPLE)
+	  xml_close_tuple(parser);
+	parser->state = XML_TEXT;
+      } else {
+	parser->state = XML_ATTRS;
+	goto again;
+      }
+      break;
+
+    case XML_CLOSE_NAME:
+      if (XML_NAME_CHAR(c)) {
+	xml_append(parser, c);
+      } else if (c == '>') {
+	if (xml_token_is(parser, "tuple"))
+	  xml_close_tuple(parser);
+	parser->state = XML_TEXT;
+      }
+      break;
+    }
+  }
+
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_append
+ *
+ * DESCRIPTION:	    Appends a character to the current name or value. Tokens
+ *		    longer than XML_TOKEN_MAX are marked as overflowed rather
+ *		    than grown; nothing that long is a name or a number we
+ *		    care about.
+ *
+ * ARGUMENTS:	    parser: (xml_parser_t *) -- the parser.
+ *		    c: (char) -- the character.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void xml_append(xml_parser_t * parser, char c)
+{
+  if (parser->toklen < XML_TOKEN_MAX)
+    parser->token[parser->toklen] = c;
+  parser->toklen++;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_token_is
+ *
+ * DESCRIPTION:	    Compares the current token with a string.
+ *
+ * ARGUMENTS:	    parser: (const xml_parser_t *) -- the parser.
+ *		    name: (const char *) -- the string to compare with.
+ *
+ * RETURN:	    bool -- true if they are equal.
+ *
+ * NOTES:	    none.
+ ***/
+static bool xml_token_is(const xml_parser_t * parser, const char * name)
+{
+  size_t len = strlen(name);
+  return parser->toklen == len && !memcmp(parser->token, name, len);
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_open_element
+ *
+ * DESCRIPTION:	    Called once the name of an opening tag is complete. A
+ *		    <tuple> claims the next row of the buffer, growing it if
+ *		    necessary.
+ *
+ * ARGUMENTS:	    parser: (xml_parser_t *) -- the parser.
+ *
+ * RETURN:	    int -- 0 on success, -1 if the buffer couldn't grow.
+ *
+ * NOTES:	    none.
+ ***/
+static int xml_open_element(xml_parser_t * parser)
+{
+  parser->element = XML_ELEMENT_OTHER;
+  if (xml_token_is(parser, "dim")) {
+    parser->element = XML_ELEMENT_DIM;
+    return 0;
+  } else if (!xml_token_is(parser, "tuple")) {
+    return 0;
+  }
+
+  if (parser->count == parser->capacity) {
+    double * grown = realloc(parser->rows, 2 * parser->capacity
+			     * parser->size * sizeof(double));
+    if (grown == NULL)
+      return -1;
+    parser->rows = grown;
+    parser->capacity *= 2;
+  }
+
+  memset(parser->rows + parser->count * parser->size, 0,
+	 parser->size * sizeof(double));
+  parser->element = XML_ELEMENT_TUPLE;
+  parser->in_tuple = true;
+  parser->bad_row = false;
+  parser->dim = 0;
+  return 0;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_value
+ *
+ * DESCRIPTION:	    Called at the end of an attribute value. If it was the val
+ *		    of a <dim> in a <tuple>, it is parsed into the next column
+ *		    of the current row.
+ *
+ * ARGUMENTS:	    parser: (xml_parser_t *) -- the parser.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void xml_value(xml_parser_t * parser)
+{
+  if (!parser->is_val || !parser->in_tuple)
+    return;
+  parser->is_val = false;
+
+  size_t dim = parser->dim++;
+  if (dim >= parser->size)
+    return;
+  if (parser->toklen > XML_TOKEN_MAX) {
+    parser->bad_row = true;
+    return;
+  }
+
+  const char * p = parser->token, * end = p + parser->toklen;
+  while (p < end && XML_SPACE_CHAR(*p)) p++;
+  while (end > p && XML_SPACE_CHAR(end[-1])) end--;
+
+  if (parse_double(p, end, &parser->rows[parser->count * parser->size + dim])
+      != 0)
+    parser->bad_row = true;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    xml_close_tuple
+ *
+ * DESCRIPTION:	    Called at </tuple> (or <tuple/>). Keeps the row if it held
+ *		    at least one value and all of its values parsed.
+ *
+ * ARGUMENTS:	    parser: (xml_parser_t *) -- the parser.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    none.
+ ***/
+static void xml_close_tuple(xml_parser_t * parser)
+{
+  if (!parser->in_tuple)
+    return;
+
+  if (!parser->bad_row && parser->dim > 0)
+    parser->count++;
+  parser->in_tuple = false;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    parse_tuple
+ *
+ * DESCRIPTION:	    Parses one line of a .csv file into <row>. Comments are
+ *		    stripped with remove_comments(), empty fields are skipped
+ *		    (as strtok() would) and fields past <size> are ignored.
+ *		    Missing trailing fields are left as zero. Each field is
+ *		    trimmed of blanks and must then be exactly one number.
+ *
+ * ARGUMENTS:	    line: (const char *) -- start of the line. Need not be
+ *			NUL-terminated.
+ *		    len: (size_t) -- length of the line, excluding '\n'.
+ *		    row: (double *) -- destination of <size> doubles.
+ *		    size: (size_t) -- the size of the tuple.
+ *		    projection: (const csv_projection_t *) -- if not NULL,
+ *			the line is parsed by parse_projected() instead.
+ *		    field: (size_t *) -- receives the field, counting from 1,
+ *			which made the line malformed.
+ *
+ * RETURN:	    int -- TUPLE_PARSED if the line held a tuple,
+ *		    TUPLE_RAGGED if it did but empty fields were skipped or
+ *		    missing ones zeroed, TUPLE_BLANK or TUPLE_COMMENT if it
+ *		    held nothing, TUPLE_EMPTY_FIELD if a field was only blanks
+ *		    or TUPLE_NOT_NUMBER if one wasn't a number.
+ *
+ * NOTES:	    Nothing outside [line, line + len) is read.
+ ***/
+static int parse_tuple(const char * line, size_t len, double * row,
+		       size_t size, const csv_projection_t * projection,
+		       size_t * field)
+{
+  if (projection != NULL)
+    return parse_projected(line, len, row, projection, field);
+
+  size_t linelen = remove_comments((char **)&line, len);
+  if (linelen == (size_t)-1)
+    return TUPLE_BLANK;
+  int blank = linelen < len ? TUPLE_COMMENT : TUPLE_BLANK;
+
+  const char * p = line, * end = line + linelen;
+  size_t i = 0, n = 0;
+  while (p < end && i < size) {
+    const char * comma = memchr(p, ',', end - p);
+    const char * fend = comma != NULL ? comma : end;
+    n++;
+
+    if (fend != p) {
+      const char * q = p, * r = fend;
+      while (q < r && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+      while (r > q && (r[-1] == ' ' || r[-1] == '\t' || r[-1] == '\r')) r--;
+      if (q == r && comma == NULL && i == 0)
+	return blank;
+      if (q == r || parse_double(q, r, &row[i]) != 0) {
+	*field = n;
+	return q == r ? TUPLE_EMPTY_FIELD : TUPLE_NOT_NUMBER;
+      }
+      i++;
+    }
+
+    p = fend + 1;
+  }
+
+  if (i == 0)
+    return blank;
+  bool ragged = n != i || i < size;
+  for (; i < size; i++)
+    row[i] = 0.0;
+  return ragged ? TUPLE_RAGGED : TUPLE_PARSED;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    parse_projected
+ *
+ * DESCRIPTION:	    Parses the fields of a line named by <projection> into
+ *		    their columns of <row>. The fields in between are skipped
+ *		    over with memchr() and never parsed.
+ *
+ * ARGUMENTS:	    line: (const char *) -- start of the line.
+ *		    len: (size_t) -- length of the line, excluding '\n'.
+ *		    row: (double *) -- destination of the columns.
+ *		    projection: (const csv_projection_t *) -- the projection.
+ *		    field: (size_t *) -- receives the field, counting from 1,
+ *			which made the line malformed.
+ *
+ * RETURN:	    int -- as parse_tuple(), but never TUPLE_RAGGED.
+ *
+ * NOTES:	    A line which ends before the last field wanted is
+ *		    TUPLE_SHORT.
+ ***/
+static int parse_projected(const char * line, size_t len, double * row,
+			   const csv_projection_t * projection,
+			   size_t * field)
+{
+  size_t linelen = remove_comments((char **)&line, len);
+  if (linelen == (size_t)-1)
+    return TUPLE_BLANK;
+
+  const char * p = line, * end = line + linelen;
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+  if (p == end)
+    return linelen < len ? TUPLE_COMMENT : TUPLE_BLANK;
+
+  p = line;
+  for (size_t f = 0; f < projection->nfields; f++) {
+    if (p > end) {
+      *field = f + 1;
+      return TUPLE_SHORT;
+    }
+
+    const char * comma = memchr(p, ',', end - p);
+    const char * fend = comma != NULL ? comma : end;
+    ssize_t column = projection->column[f];
+    if (column != -1) {
+      const char * q = p, * r = fend;
+      while (q < r && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+      while (r > q && (r[-1] == ' ' || r[-1] == '\t' || r[-1] == '\r')) r--;
+      if (q == r || parse_double(q, r, &row[column]) != 0) {
+	*field = f + 1;
+	return q == r ? TUPLE_EMPTY_FIELD : TUPLE_NOT_NUMBER;
+      }
+    }
+    p = fend + 1;
+  }
+
+  return TUPLE_PARSED;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tally_line
+ *
+ * DESCRIPTION:	    Counts a line by what parse_tuple() made of it. A dropped
+ *		    row is counted by its reason and as malformed, and the
+ *		    first one's position is remembered.
+ *
+ * ARGUMENTS:	    tally: (csv_tally_t *) -- the counts.
+ *		    result: (int) -- the result of parse_tuple().
+ *		    field: (size_t) -- the field which made the row malformed,
+ *			if it was.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    The line is numbered by the count of lines so far.
+ ***/
+static void tally_line(csv_tally_t * tally, int result, size_t field)
+{
+  csv_stats_t * stats = &tally->stats;
+  csv_error_t * error = &tally->error;
+  stats->lines++;
+  switch (result) {
+  case TUPLE_RAGGED:
+    stats->ragged++;
+    error->ragged++;
+    /* fall through */
+  case TUPLE_PARSED:
+    stats->rows++;
+    return;
+  case TUPLE_BLANK:
+    stats->blank++;
+    return;
+  case TUPLE_COMMENT:
+    stats->comments++;
+    return;
+  case TUPLE_NOT_NUMBER:
+    stats->rejected[CSV_REJECT_NUMBER]++;
+    break;
+  case TUPLE_EMPTY_FIELD:
+    stats->rejected[CSV_REJECT_EMPTY]++;
+    break;
+  case TUPLE_SHORT:
+    stats->rejected[CSV_REJECT_SHORT]++;
+    break;
+  }
+
+  if (error->malformed++ == 0) {
+    error->line = stats->lines;
+    error->field = field;
+  }
+}
+
+/*******************************************************************************
+ * FUNCTION:	    tally_merge
+ *
+ * DESCRIPTION:	    Adds the counts of a later range of lines to <into>.
+ *
+ * ARGUMENTS:	    into: (csv_tally_t *) -- the counts so far.
+ *		    from: (const csv_tally_t *) -- the counts of the range.
+ *		    line: (size_t) -- the number of lines before the range,
+ *			by which its line numbers are offset.
+ *
+ * RETURN:	    void.
+ *
+ * NOTES:	    Times and bytes aren't merged; they are the caller's.
+ ***/
+static void tally_merge(csv_tally_t * into, const csv_tally_t * from,
+			size_t line)
+{
+  if (from->error.malformed > 0 && into->error.malformed == 0) {
+    into->error.line = line + from->error.line;
+    into->error.field = from->error.field;
+  }
+  into->error.malformed += from->error.malformed;
+  into->error.ragged += from->error.ragged;
+
+  into->stats.lines += from->stats.lines;
+  into->stats.rows += from->stats.rows;
+  into->stats.ragged += from->stats.ragged;
+  for (int r = 0; r < CSV_REJECT_REASONS; r++)
+    into->stats.rejected[r] += from->stats.rejected[r];
+  into->stats.comments += from->stats.comments;
+  into->stats.blank += from->stats.blank;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    clock_seconds
+ *
+ * DESCRIPTION:	    Reads a clock in seconds.
+ *
+ * ARGUMENTS:	    clock: (clockid_t) -- the clock, e.g. CLOCK_MONOTONIC.
+ *
+ * RETURN:	    double -- the time, or 0 if the clock can't be read.
+ *
+ * NOTES:	    none.
+ ***/
+static double clock_seconds(clockid_t clock)
+{
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0)
+    return 0;
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * FUNCTION:	    count_lines
+ *
+ * DESCRIPTION:	    Counts the lines in a buffer, including a final line which
+ *		    is not terminated by '\n'.
+ *
+ * ARGUMENTS:	    map: (const char *) -- the buffer.
+ *		    len: (size_t) -- the length of the buffer.
+ *
+ * RETURN:	    size_t -- the number of lines.
+ *
+ * NOTES:	    none.
+ ***/
+static size_t count_lines(const char * map, size_t len)
+{
+  size_t lines = 0;
+  const char * p = map, * end = map + len;
+  while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+    lines++;
+    p++;
+  }
+
+  if (len > 0 && map[len - 1] != '\n')
+    lines++;
+  return lines;
+}
+
 /*******************************************************************************
  * FUNCTION:	    remove_comments
  *